@@ -118,6 +118,16 @@
         '../../include/zmsg.h',
         '../../src/zosc.c',
         '../../include/zosc.h',
+        '../../src/zloop_pool.c',
+        '../../include/zloop_pool.h',
+        '../../src/zsock_picture.c',
+        '../../include/zsock_picture.h',
+        '../../src/zchannel.c',
+        '../../include/zchannel.h',
+        '../../src/zmetrics.c',
+        '../../include/zmetrics.h',
+        '../../src/zhistogram.c',
+        '../../include/zhistogram.h',
         '../../src/zpoller.c',
         '../../include/zpoller.h',
         '../../src/zproc.c',
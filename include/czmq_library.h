@@ -147,6 +147,16 @@ typedef struct _zhttp_response_t zhttp_response_t;
 #define ZHTTP_RESPONSE_T_DEFINED
 typedef struct _zosc_t zosc_t;
 #define ZOSC_T_DEFINED
+typedef struct _zloop_pool_t zloop_pool_t;
+#define ZLOOP_POOL_T_DEFINED
+typedef struct _zsock_picture_t zsock_picture_t;
+#define ZSOCK_PICTURE_T_DEFINED
+typedef struct _zchannel_t zchannel_t;
+#define ZCHANNEL_T_DEFINED
+typedef struct _zmetrics_t zmetrics_t;
+#define ZMETRICS_T_DEFINED
+typedef struct _zhistogram_t zhistogram_t;
+#define ZHISTOGRAM_T_DEFINED
 #endif // CZMQ_BUILD_DRAFT_API
 
 
@@ -192,6 +202,11 @@ typedef struct _zosc_t zosc_t;
 #include "zhttp_request.h"
 #include "zhttp_response.h"
 #include "zosc.h"
+#include "zloop_pool.h"
+#include "zsock_picture.h"
+#include "zchannel.h"
+#include "zmetrics.h"
+#include "zhistogram.h"
 #endif // CZMQ_BUILD_DRAFT_API
 
 #ifdef CZMQ_BUILD_DRAFT_API
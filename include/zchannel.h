@@ -0,0 +1,90 @@
+/*  =========================================================================
+    zchannel - lock-free channel of pointers between threads
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+    =========================================================================
+*/
+
+#ifndef ZCHANNEL_H_INCLUDED
+#define ZCHANNEL_H_INCLUDED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//  @warning THE FOLLOWING @INTERFACE BLOCK IS AUTO-GENERATED BY ZPROJECT
+//  @warning Please edit the model at "api/zchannel.api" to make changes.
+//  @interface
+//  This is a draft class, and may change without notice. It is disabled in
+//  stable builds by default. If you use this in applications, please ask
+//  for it to be pushed to stable state. Use --enable-drafts to enable.
+#ifdef CZMQ_BUILD_DRAFT_API
+// Destroy an item
+typedef void (zchannel_destructor_fn) (
+    void **item);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Create a new channel that holds up to size items. The size is rounded
+//  up to a power of two. Returns NULL if size is zero, or if the wakeup
+//  handle could not be created.
+CZMQ_EXPORT zchannel_t *
+    zchannel_new (size_t size);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Destroy a channel. If an item destructor was specified, any items
+//  still in the channel are destroyed as well.
+CZMQ_EXPORT void
+    zchannel_destroy (zchannel_t **self_p);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Set a user-defined deallocator for items; by default items still in
+//  the channel are not freed when the channel is destroyed.
+CZMQ_EXPORT void
+    zchannel_set_destructor (zchannel_t *self, zchannel_destructor_fn destructor);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Send an item, which must not be NULL, to the channel. Any number of
+//  threads may send to one channel. Does not block: returns 0 if the item
+//  was queued, or -1 if the channel is full.
+CZMQ_EXPORT int
+    zchannel_send (zchannel_t *self, void *item);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Receive the next item from the channel, or NULL if the channel is
+//  empty. Only one thread may receive from a channel. Does not block;
+//  wait on the channel's handle to know when there are items.
+CZMQ_EXPORT void *
+    zchannel_recv (zchannel_t *self);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Return the number of items waiting in the channel. As other threads
+//  may be sending, this is only a snapshot.
+CZMQ_EXPORT size_t
+    zchannel_size (zchannel_t *self);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Return the handle that becomes readable when items arrive, for use
+//  with zpoller or zloop_poller. Once it is readable, call recv until it
+//  returns NULL; that also clears the handle.
+CZMQ_EXPORT SOCKET
+    zchannel_fd (zchannel_t *self);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Self test of this class.
+CZMQ_EXPORT void
+    zchannel_test (bool verbose);
+
+#endif // CZMQ_BUILD_DRAFT_API
+//  @end
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -173,6 +173,52 @@ CZMQ_EXPORT int
 CZMQ_EXPORT void
     zframe_print_n (zframe_t *self, const char *prefix, size_t length);
 
+//  *** Draft method, for development use, may change without warning ***
+//  Create a new frame that shares the content of an existing frame, rather
+//  than copying it. The content is reference counted by libzmq, and freed
+//  when the last frame that shares it is destroyed. As any change to the
+//  content shows in every share, you must not modify the content of either
+//  frame afterwards. If frame is null, or memory was exhausted, returns null.
+CZMQ_EXPORT zframe_t *
+    zframe_share (zframe_t *self);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Return the number of frames taken from the thread pools, rather than
+//  allocated, by threads that have exited and by the calling thread. Returns
+//  zero if pooling is not available.
+CZMQ_EXPORT uint64_t
+    zframe_pool_hits (void);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Return the number of frames allocated while pooling was on, because
+//  the thread pool was empty, by threads that have exited and by the calling
+//  thread. Returns zero if pooling is not available.
+CZMQ_EXPORT uint64_t
+    zframe_pool_misses (void);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Receive up to max frames from socket into the frames array. Waits up to
+//  timeout msecs for the first frame, or forever if timeout is -1, and then
+//  takes only the frames that are ready, without waiting. Resolves the
+//  socket once, and takes each frame's more indicator from the frame itself,
+//  so this is cheaper than calling zframe_recv for each frame. Does not stop
+//  at message boundaries; use zframe_more to find them. Returns the number
+//  of frames received, which is zero if the timeout expired or the call was
+//  interrupted. Caller owns the frames and must destroy them when done.
+CZMQ_EXPORT int
+    zframe_recv_batch (void *source, zframe_t **frames, size_t max, int timeout);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Send count frames from the frames array to socket. Sends each frame with
+//  the more indicator set if zframe_more says so, so frames received with
+//  zframe_recv_batch go out as they came in. Resolves the socket once, and
+//  checks its type once. Destroys each frame after sending it, and nullifies
+//  its reference in the array. Keeps retrying if interrupted in the middle
+//  of a multipart sequence. Returns the number of frames sent; if that is
+//  less than count, the send failed and errno says why.
+CZMQ_EXPORT int
+    zframe_send_batch (void *dest, zframe_t **frames, size_t count);
+
 #endif // CZMQ_BUILD_DRAFT_API
 //  @end
 
@@ -255,6 +255,14 @@ CZMQ_EXPORT void
     zhashx_test (bool verbose);
 
 #ifdef CZMQ_BUILD_DRAFT_API
+//  *** Draft method, for development use, may change without warning ***
+//  Create a new, empty hash container that keeps its items in one flat
+//  array, using open addressing, instead of chaining them in buckets. It
+//  has the same methods, callbacks and cursor semantics as other hash
+//  containers, and uses less memory and fewer cache misses on large tables.
+CZMQ_EXPORT zhashx_t *
+    zhashx_new_flat (void);
+
 //  *** Draft method, for development use, may change without warning ***
 //  Same as unpack but uses a user-defined deserializer function to convert
 //  a longstr back into item format.
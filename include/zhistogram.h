@@ -0,0 +1,126 @@
+/*  =========================================================================
+    zhistogram - log-linear histogram of latencies and other values
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+    =========================================================================
+*/
+
+#ifndef ZHISTOGRAM_H_INCLUDED
+#define ZHISTOGRAM_H_INCLUDED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//  @warning THE FOLLOWING @INTERFACE BLOCK IS AUTO-GENERATED BY ZPROJECT
+//  @warning Please edit the model at "api/zhistogram.api" to make changes.
+//  @interface
+//  This is a draft class, and may change without notice. It is disabled in
+//  stable builds by default. If you use this in applications, please ask
+//  for it to be pushed to stable state. Use --enable-drafts to enable.
+#ifdef CZMQ_BUILD_DRAFT_API
+//  *** Draft method, for development use, may change without warning ***
+//  Create a new histogram for values from 0 to highest, keeping the
+//  given number of significant decimal digits (1 to 5). Larger values
+//  are recorded as highest. Returns NULL if digits is out of range.
+CZMQ_EXPORT zhistogram_t *
+    zhistogram_new (uint64_t highest, int digits);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Unpack a histogram from a frame made by zhistogram_pack. Returns NULL
+//  if the frame is not a valid histogram.
+CZMQ_EXPORT zhistogram_t *
+    zhistogram_unpack (zframe_t *frame);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Destroy a histogram.
+CZMQ_EXPORT void
+    zhistogram_destroy (zhistogram_t **self_p);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Record a value. Takes constant time, and never allocates memory.
+CZMQ_EXPORT void
+    zhistogram_record (zhistogram_t *self, uint64_t value);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Start timing an operation, on the monotonic clock.
+CZMQ_EXPORT void
+    zhistogram_start (zhistogram_t *self);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Stop timing the operation started by zhistogram_start, record its
+//  duration in microseconds, and return that.
+CZMQ_EXPORT int64_t
+    zhistogram_stop (zhistogram_t *self);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Add the values of another histogram to this one. Both must have the
+//  same highest value and digits. Returns 0 if OK, -1 if not.
+CZMQ_EXPORT int
+    zhistogram_merge (zhistogram_t *self, zhistogram_t *other);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Forget all recorded values.
+CZMQ_EXPORT void
+    zhistogram_reset (zhistogram_t *self);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Return the number of values recorded.
+CZMQ_EXPORT uint64_t
+    zhistogram_count (zhistogram_t *self);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Return the smallest value recorded, or 0 if there are none.
+CZMQ_EXPORT uint64_t
+    zhistogram_min (zhistogram_t *self);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Return the largest value recorded, or 0 if there are none.
+CZMQ_EXPORT uint64_t
+    zhistogram_max (zhistogram_t *self);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Return the mean of the values recorded, or 0 if there are none.
+CZMQ_EXPORT double
+    zhistogram_mean (zhistogram_t *self);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Return the value at the given percentile, from 0 to 100: the value
+//  that at least that percentage of recorded values are no larger than,
+//  to within the histogram's precision. Returns 0 if there are no values.
+CZMQ_EXPORT uint64_t
+    zhistogram_percentile (zhistogram_t *self, double percentile);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Serialize the histogram to a binary frame that can be sent in a
+//  message. Only buckets that hold values take space in the frame.
+//  Caller owns return value and must destroy it when done.
+CZMQ_EXPORT zframe_t *
+    zhistogram_pack (zhistogram_t *self);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Return a text summary of the histogram: count, minimum, mean, and
+//  maximum, then the values at the usual percentiles, one per line.
+//  Caller owns return value and must destroy it when done.
+CZMQ_EXPORT char *
+    zhistogram_str (zhistogram_t *self);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Self test of this class.
+CZMQ_EXPORT void
+    zhistogram_test (bool verbose);
+
+#endif // CZMQ_BUILD_DRAFT_API
+//  @end
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -119,11 +119,11 @@ CZMQ_EXPORT void
 CZMQ_EXPORT void
     zloop_set_ticket_delay (zloop_t *self, size_t ticket_delay);
 
-//  Set hard limit on number of timers allowed. Setting more than a small
-//  number of timers (10-100) can have a dramatic impact on the performance
-//  of the reactor. For high-volume cases, use ticket timers. If the hard
-//  limit is reached, the reactor stops creating new timers and logs an
-//  error.
+//  Set hard limit on number of timers allowed. Timers are held on a heap,
+//  so adding and cancelling timers costs O(log n), while finding the next
+//  timer to expire is constant time. For high-volume cases that constantly
+//  reset expiry timers, ticket timers are still cheaper. If the hard limit
+//  is reached, the reactor stops creating new timers and logs an error.
 CZMQ_EXPORT void
     zloop_set_max_timers (zloop_t *self, size_t max_timers);
 
@@ -150,6 +150,49 @@ CZMQ_EXPORT int
 CZMQ_EXPORT void
     zloop_test (bool verbose);
 
+#ifdef CZMQ_BUILD_DRAFT_API
+//  *** Draft method, for development use, may change without warning ***
+//  Set the number of times the reactor may call a reader's handler for each
+//  poll, while the socket still has input. This cuts the cost of polling for
+//  busy sockets, while the budget stops one socket from starving the others.
+//  The default budget is 1. Applies to all readers for the socket.
+CZMQ_EXPORT void
+    zloop_reader_set_budget (zloop_t *self, zsock_t *sock, size_t budget);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Return the number of times a reader's handler was called as often as its
+//  budget allows in one poll, since the reactor was created. If this grows
+//  quickly, the reader's budget may be too low for its traffic.
+CZMQ_EXPORT uint64_t
+    zloop_budget_exhausted (zloop_t *self);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Set collection of reactor statistics on/off. When on, the reactor counts
+//  calls and measures the time spent in each reader, poller and timer handler,
+//  how late each timer fires, and how long it waits in poll compared to how
+//  long it is busy. This costs a clock read around each handler call. The
+//  default stats setting is off (false).
+CZMQ_EXPORT void
+    zloop_set_stats (zloop_t *self, bool stats);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Log a summary of reactor statistics via zsys_info every so many msecs.
+//  Setting a non-zero interval also switches on collection of statistics.
+//  Use 0 to stop logging.
+CZMQ_EXPORT void
+    zloop_set_stats_interval (zloop_t *self, size_t stats_interval);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Return reactor statistics collected since they were switched on, as a
+//  zconfig tree. Times are in usecs. The tree holds loop/polls, loop/wait and
+//  loop/busy, and calls, busy and busy_max for each reader, poller, and timer.
+//  Timers also hold late and late_max, the total and longest delay between
+//  the time they were due and the time they fired. Caller owns return value
+//  and must destroy it when done.
+CZMQ_EXPORT zconfig_t *
+    zloop_stats (zloop_t *self);
+
+#endif // CZMQ_BUILD_DRAFT_API
 //  @end
 
 
@@ -0,0 +1,112 @@
+/*  =========================================================================
+    zloop_pool - run reactors on a pool of threads
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+    =========================================================================
+*/
+
+#ifndef ZLOOP_POOL_H_INCLUDED
+#define ZLOOP_POOL_H_INCLUDED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//  @warning THE FOLLOWING @INTERFACE BLOCK IS AUTO-GENERATED BY ZPROJECT
+//  @warning Please edit the model at "api/zloop_pool.api" to make changes.
+//  @interface
+//  This is a draft class, and may change without notice. It is disabled in
+//  stable builds by default. If you use this in applications, please ask
+//  for it to be pushed to stable state. Use --enable-drafts to enable.
+#ifdef CZMQ_BUILD_DRAFT_API
+//  *** Draft method, for development use, may change without warning ***
+//  Create a new pool of reactors, running on the given number of threads.
+//  Returns NULL if size is zero.
+CZMQ_EXPORT zloop_pool_t *
+    zloop_pool_new (size_t size);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Destroy the pool. Stops all threads and cancels all readers and timers;
+//  does not destroy the registered sockets.
+CZMQ_EXPORT void
+    zloop_pool_destroy (zloop_pool_t **self_p);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Return the number of reactor threads in the pool.
+CZMQ_EXPORT size_t
+    zloop_pool_size (zloop_pool_t *self);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Register socket reader with the pool. When the reader has messages, a
+//  pool thread will call the handler, passing the arg. Returns 0 if OK, -1
+//  if there was an error, or if the socket already has a reader in the
+//  pool. Until you cancel the reader, only the handler may use the socket.
+CZMQ_EXPORT int
+    zloop_pool_reader (zloop_pool_t *self, zsock_t *sock, zloop_reader_fn handler, void *arg);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Cancel a socket reader. When this returns, the handler is no longer
+//  running, and the calling thread may use the socket again.
+CZMQ_EXPORT void
+    zloop_pool_reader_end (zloop_pool_t *self, zsock_t *sock);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Create an actor that runs on the pool instead of on a thread of its own;
+//  to the caller it is a normal zactor. A pool thread calls the handler,
+//  passing the actor's end of the pipe and the arg, each time the pipe has
+//  input. The handler returns -1 when the actor has finished, and must do so
+//  on $TERM. The actor never changes thread, so the handler may add readers
+//  and timers for its own sockets to the zloop it is passed, if it removes
+//  them before finishing. Destroy all actors before the pool. Returns NULL
+//  if there was an error.
+CZMQ_EXPORT zactor_t *
+    zloop_pool_actor (zloop_pool_t *self, zloop_reader_fn handler, void *arg);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Register a timer that expires after some delay and repeats some number of
+//  times. At each expiry, a pool thread will call the handler, passing the
+//  arg. To run a timer forever, use 0 times. Returns a timer_id that is used
+//  to cancel the timer in the future. Returns -1 if there was an error.
+CZMQ_EXPORT int
+    zloop_pool_timer (zloop_pool_t *self, size_t delay, size_t times, zloop_timer_fn handler, void *arg);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Cancel a specific timer identified by a specific timer_id (as returned by
+//  zloop_pool_timer). Returns 0 if OK, -1 if there was no such timer, or it
+//  had already expired.
+CZMQ_EXPORT int
+    zloop_pool_timer_end (zloop_pool_t *self, int timer_id);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Set how often the pool balances readers across threads, in msecs. Each
+//  time, it moves at most one reader from the busiest thread to the least
+//  busy thread. The default interval is 100 msecs; 0 means never balance
+//  except when asked to with zloop_pool_balance.
+CZMQ_EXPORT void
+    zloop_pool_set_balance_ivl (zloop_pool_t *self, size_t balance_ivl);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Balance readers across threads now, as if the balance interval had
+//  expired. Returns the number of readers moved.
+CZMQ_EXPORT int
+    zloop_pool_balance (zloop_pool_t *self);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Self test of this class.
+CZMQ_EXPORT void
+    zloop_pool_test (bool verbose);
+
+#endif // CZMQ_BUILD_DRAFT_API
+//  @end
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,119 @@
+/*  =========================================================================
+    zmetrics - registry of counters, gauges and histograms
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+    =========================================================================
+*/
+
+#ifndef ZMETRICS_H_INCLUDED
+#define ZMETRICS_H_INCLUDED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//  @warning THE FOLLOWING @INTERFACE BLOCK IS AUTO-GENERATED BY ZPROJECT
+//  @warning Please edit the model at "api/zmetrics.api" to make changes.
+//  @interface
+//  This is a draft class, and may change without notice. It is disabled in
+//  stable builds by default. If you use this in applications, please ask
+//  for it to be pushed to stable state. Use --enable-drafts to enable.
+#ifdef CZMQ_BUILD_DRAFT_API
+//  *** Draft method, for development use, may change without warning ***
+//  Create a new, empty metrics registry. Returns NULL on platforms
+//  without POSIX threads.
+CZMQ_EXPORT zmetrics_t *
+    zmetrics_new (void);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Destroy a metrics registry. No thread may still be updating it.
+CZMQ_EXPORT void
+    zmetrics_destroy (zmetrics_t **self_p);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Register a counter, which only goes up. The name follows Prometheus
+//  rules, and may end in labels, e.g. 'requests_total{method="get"}'.
+//  The help text may be NULL. Returns the metric's id, or -1 if the name
+//  is invalid or already taken, or the registry is full.
+CZMQ_EXPORT int
+    zmetrics_counter (zmetrics_t *self, const char *name, const char *help);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Register a gauge, which can go up and down. Arguments and return
+//  value are as for counter.
+CZMQ_EXPORT int
+    zmetrics_gauge (zmetrics_t *self, const char *name, const char *help);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Register a histogram with exponential buckets: the first bucket
+//  holds values up to start, and each next bucket's upper bound is
+//  factor times the one before. There is always a final bucket for
+//  larger values. Returns -1 if start is not positive, factor is not
+//  above 1, or buckets is zero or over 64; otherwise as for counter.
+CZMQ_EXPORT int
+    zmetrics_histogram (zmetrics_t *self, const char *name, const char *help, double start, double factor, size_t buckets);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Add a value to a counter. Lock-free; each thread counts on its own
+//  shard of the registry.
+CZMQ_EXPORT void
+    zmetrics_add (zmetrics_t *self, int id, uint64_t value);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Set a gauge to a value. Lock-free.
+CZMQ_EXPORT void
+    zmetrics_set (zmetrics_t *self, int id, double value);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Add a positive or negative value to a gauge. Lock-free.
+CZMQ_EXPORT void
+    zmetrics_adjust (zmetrics_t *self, int id, double delta);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Record a value in a histogram. Lock-free, and on the thread's own
+//  shard, like counters.
+CZMQ_EXPORT void
+    zmetrics_observe (zmetrics_t *self, int id, double value);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Return the current value of a metric: the total over all threads for
+//  a counter, the value of a gauge, or the number of observations in a
+//  histogram.
+CZMQ_EXPORT double
+    zmetrics_value (zmetrics_t *self, int id);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Return all metrics in the Prometheus text exposition format, as a
+//  fresh string.
+//  Caller owns return value and must destroy it when done.
+CZMQ_EXPORT char *
+    zmetrics_render (zmetrics_t *self);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Serve the metrics over HTTP on the given port, in the Prometheus text
+//  format, at the /metrics path. Returns an actor that runs the server;
+//  destroy it to stop serving. Returns NULL if CZMQ was built without
+//  libmicrohttpd.
+//  Caller owns return value and must destroy it when done.
+CZMQ_EXPORT zactor_t *
+    zmetrics_serve (zmetrics_t *self, int port);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Self test of this class.
+CZMQ_EXPORT void
+    zmetrics_test (bool verbose);
+
+#endif // CZMQ_BUILD_DRAFT_API
+//  @end
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
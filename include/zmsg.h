@@ -234,6 +234,75 @@ CZMQ_EXPORT void
 CZMQ_EXPORT void
     zmsg_print_n (zmsg_t *self, size_t size);
 
+//  *** Draft method, for development use, may change without warning ***
+//  Create a new message whose frames share the content of an existing
+//  message, rather than copying it, as zframe_share does. You must not
+//  modify the content of either message afterwards. If message is null, or
+//  memory was exhausted, returns null.
+CZMQ_EXPORT zmsg_t *
+    zmsg_share (zmsg_t *self);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Return the number of messages taken from the thread pools, rather than
+//  allocated, by threads that have exited and by the calling thread. Returns
+//  zero if pooling is not available.
+CZMQ_EXPORT uint64_t
+    zmsg_pool_hits (void);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Return the number of messages allocated while pooling was on, because
+//  the thread pool was empty, by threads that have exited and by the calling
+//  thread. Returns zero if pooling is not available.
+CZMQ_EXPORT uint64_t
+    zmsg_pool_misses (void);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Receive up to max messages from socket into the msgs array. Waits up to
+//  timeout msecs for the first message, or forever if timeout is -1, and
+//  then takes only the messages that are ready, without waiting. This costs
+//  less per message than calling zmsg_recv, as it uses zframe_recv_batch
+//  to read frames. Returns the number of messages received, which is zero
+//  if the timeout expired or the call was interrupted. Caller owns the
+//  messages and must destroy them when done.
+CZMQ_EXPORT int
+    zmsg_recv_batch (void *source, zmsg_t **msgs, size_t max, int timeout);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Send count messages from the msgs array to socket, using one call to
+//  zframe_send_batch for all their frames. Destroys each message after
+//  sending it, and nullifies its reference in the array. Returns the number
+//  of messages sent; if that is less than count, the send failed and errno
+//  says why. The first unsent message keeps any frames that were not sent.
+CZMQ_EXPORT int
+    zmsg_send_batch (void *dest, zmsg_t **msgs, size_t count);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Serialize multipart message into a buffer provided by the caller, in the
+//  same format as zmsg_encode, without allocating a frame. Returns the
+//  encoded size. If that is more than the buffer size, writes nothing, so
+//  you can call this with a null buffer and zero size to find out how large
+//  a buffer you need.
+CZMQ_EXPORT size_t
+    zmsg_encode_buffer (zmsg_t *self, byte *buffer, size_t size);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Serialize multipart message and append it to the chunk, in the same
+//  format as zmsg_encode. The chunk must have room for the encoded message,
+//  which is the size that zmsg_encode_buffer returns. Returns 0 if OK, or
+//  -1 if the chunk was too small, in which case it is left unchanged.
+CZMQ_EXPORT int
+    zmsg_encode_chunk (zmsg_t *self, zchunk_t *chunk);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Decodes a serialized message frame created by zmsg_encode () like
+//  zmsg_decode, except that larger frames of the new message refer to the
+//  content of the serialized frame, rather than copying it. The content
+//  lives until the last frame that refers to it is destroyed, so you may
+//  destroy the serialized frame at once. You must not modify the content
+//  of the serialized frame or the new message.
+CZMQ_EXPORT zmsg_t *
+    zmsg_decode_shared (zframe_t *frame);
+
 #endif // CZMQ_BUILD_DRAFT_API
 //  @end
 
@@ -72,6 +72,16 @@ extern "C" {
 //      zstr_sendx (proxy, "CAPTURE", endpoint, NULL);
 //      zsock_wait (proxy);
 //
+//  To keep the cost of capture down, you can capture only some messages by
+//  giving options after the endpoint. SAMPLE captures one message in N,
+//  PREFIX captures only messages whose first frame starts with the given
+//  string, and TRUNCATE cuts each captured frame to at most K bytes. The
+//  proxy always captures whole messages, or nothing of a message:
+//
+//      zstr_sendx (proxy, "CAPTURE", endpoint,
+//          "SAMPLE", "100", "PREFIX", "ORDER", "TRUNCATE", "64", NULL);
+//      zsock_wait (proxy);
+//
 //  Pause the proxy. A paused proxy will cease processing messages, causing
 //  them to be queued up and potentially hit the high-water mark on the
 //  frontend or backend socket, causing messages to be dropped, or writing
@@ -106,6 +116,57 @@ extern "C" {
 //      zstr_sendx (proxy, "CURVE", "FRONTEND", public_txt, secret_txt, NULL);
 //      zsock_wait (proxy);
 //
+//  Switch messages in several threads. The proxy starts this many workers,
+//  each with its own frontend and backend socket, and passes every later
+//  command on to all of them; STATISTICS adds up their counters. Send this
+//  before any other configuration command. As only one socket can bind an
+//  endpoint, use connect endpoints ('>') with more than one worker. This
+//  suits stateless patterns such as PUSH/PULL and DEALER/DEALER:
+//
+//      zstr_sendx (proxy, "WORKERS", "4", NULL);
+//      zsock_wait (proxy);
+//
+//  Balance requests over the peers of the backend, instead of forwarding
+//  blindly. Both sockets must then be ROUTER sockets, and BALANCE must come
+//  before FRONTEND and BACKEND. Each peer starts by sending one ready
+//  message; a REQ peer sends any message, and a DEALER peer sends a single
+//  non-empty frame. The proxy sends each request to the peer with the fewest
+//  requests outstanding, up to the given number per peer (always one for a
+//  REQ peer), and holds requests back while every peer is full. Replies go
+//  back to the client that sent the request. The authentication and
+//  heartbeat commands work as usual:
+//
+//      zstr_sendx (proxy, "BALANCE", "4", NULL);
+//      zsock_wait (proxy);
+//
+//  Keep the last message on each topic, and send the cached messages that
+//  match a subscription as soon as a subscriber subscribes. The frontend
+//  must be XSUB and the backend XPUB, and LVC must come before FRONTEND and
+//  BACKEND. The topic is the first frame of a message, taken as a string.
+//  The argument limits the size of the cache in bytes; when it is full, the
+//  proxy forgets the topics that it has not seen for longest. Subscribers
+//  that already had a topic also get its cached message again:
+//
+//      zstr_sendx (proxy, "LVC", "1000000", NULL);
+//      zsock_wait (proxy);
+//
+//  Set how many messages the proxy switches in each direction before it
+//  checks its command pipe again. The default is 100; a smaller budget makes
+//  the proxy more responsive to commands under load:
+//
+//      zstr_sendx (proxy, "BUDGET", "10", NULL);
+//      zsock_wait (proxy);
+//
+//  Get the traffic counters for each direction, frontend to backend first.
+//  For each direction the proxy reports the messages and bytes switched, the
+//  messages that the output socket refused (drops), and the times that the
+//  output socket was at its high-water mark and held up the proxy (stalls):
+//
+//      zstr_sendx (proxy, "STATISTICS", NULL);
+//      zsock_recv (proxy, "88888888",
+//          &msgs, &bytes, &drops, &stalls,
+//          &back_msgs, &back_bytes, &back_drops, &back_stalls);
+//
 //  This is the zproxy constructor as a zactor_fn; the argument is a
 //  character string specifying frontend and backend socket types as two
 //  uppercase strings separated by a hyphen:
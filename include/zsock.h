@@ -1334,6 +1334,30 @@ CZMQ_EXPORT int
 CZMQ_EXPORT bool
     zsock_has_in (void *self);
 
+//  *** Draft method, for development use, may change without warning ***
+//  Set collection of traffic statistics on/off. When on, the socket counts
+//  the messages, frames and bytes sent and received through zframe, zmsg,
+//  zstr and zsock calls, along with failed and retried sends, and notes the
+//  largest message. Switching off drops the counters. The default stats
+//  setting is off (false).
+CZMQ_EXPORT void
+    zsock_set_stats (zsock_t *self, bool stats);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Return traffic statistics collected since they were switched on or last
+//  reset, as a zconfig tree, or NULL if statistics are off. The tree holds
+//  sent/msgs, sent/frames, sent/bytes, sent/failed, sent/again (failed with
+//  EAGAIN, usually at the high-water mark), sent/retries, recv/msgs,
+//  recv/frames, recv/bytes, and msg_max, the largest message in bytes.
+//  Caller owns return value and must destroy it when done.
+CZMQ_EXPORT zconfig_t *
+    zsock_stats (zsock_t *self);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Reset traffic statistics to zero, if they are on.
+CZMQ_EXPORT void
+    zsock_stats_reset (zsock_t *self);
+
 #endif // CZMQ_BUILD_DRAFT_API
 //  @end
 
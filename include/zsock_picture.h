@@ -0,0 +1,97 @@
+/*  =========================================================================
+    zsock_picture - precompiled picture messages
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+    =========================================================================
+*/
+
+#ifndef ZSOCK_PICTURE_H_INCLUDED
+#define ZSOCK_PICTURE_H_INCLUDED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//  @warning THE FOLLOWING @INTERFACE BLOCK IS AUTO-GENERATED BY ZPROJECT
+//  @warning Please edit the model at "api/zsock_picture.api" to make changes.
+//  @interface
+//  This is a draft class, and may change without notice. It is disabled in
+//  stable builds by default. If you use this in applications, please ask
+//  for it to be pushed to stable state. Use --enable-drafts to enable.
+#ifdef CZMQ_BUILD_DRAFT_API
+//  *** Draft method, for development use, may change without warning ***
+//  Compile a picture, as used by zsock_send and zsock_bsend, for sending
+//  and receiving many messages. A picture may be valid for the text format
+//  (zsock_send, zsock_recv), for the binary format (zsock_bsend,
+//  zsock_brecv), or for both. Returns NULL and logs an error if the
+//  picture is valid for neither format.
+CZMQ_EXPORT zsock_picture_t *
+    zsock_picture_new (const char *picture);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Destroy a compiled picture.
+CZMQ_EXPORT void
+    zsock_picture_destroy (zsock_picture_t **self_p);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Return the picture string the picture was compiled from.
+CZMQ_EXPORT const char *
+    zsock_picture_picture (zsock_picture_t *self);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Send a message to the socket (or actor), like zsock_send with the
+//  compiled picture. Frames are sent as they are built, without an
+//  intermediate zmsg. The picture must be valid for the text format; the
+//  deprecated 'u' element is not supported. Returns 0 if successful, -1
+//  if sending failed for any reason.
+CZMQ_EXPORT int
+    zsock_picture_send (zsock_picture_t *self, void *dest, ...);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Receive a message from the socket (or actor), like zsock_recv with the
+//  compiled picture, and with the same rules for the returned values. Frames
+//  that the picture does not ask for are discarded. Returns 0 if successful,
+//  or -1 if it failed to recv a message or the message was a signal.
+CZMQ_EXPORT int
+    zsock_picture_recv (zsock_picture_t *self, void *source, ...);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Send a binary encoded message to the socket (or actor), like zsock_bsend
+//  with the compiled picture. The size of fixed-size elements is worked out
+//  when the picture is compiled, so only pictures with strings or chunks
+//  need a sizing pass over the arguments. The picture must be valid for the
+//  binary format. Returns 0 if successful, -1 if sending failed for any
+//  reason.
+CZMQ_EXPORT int
+    zsock_picture_bsend (zsock_picture_t *self, void *dest, ...);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Receive a binary encoded message from the socket (or actor), like
+//  zsock_brecv with the compiled picture, and with the same rules for the
+//  returned values, except that 's' strings are held in the picture rather
+//  than the socket. They stay valid until the next call to brecv with this
+//  picture, so do not share one picture between threads that call brecv.
+//  Returns 0 if successful, -1 if it failed to recv a message or the
+//  message was malformed.
+CZMQ_EXPORT int
+    zsock_picture_brecv (zsock_picture_t *self, void *source, ...);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Self test of this class.
+CZMQ_EXPORT void
+    zsock_picture_test (bool verbose);
+
+#endif // CZMQ_BUILD_DRAFT_API
+//  @end
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
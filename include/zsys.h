@@ -476,6 +476,25 @@ CZMQ_EXPORT void
 CZMQ_EXPORT int
     zsys_zero_copy_recv (void);
 
+//  *** Draft method, for development use, may change without warning ***
+//  Configure the number of zframe_t and zmsg_t objects that threads keep
+//  for reuse, rather than freeing them. This saves a malloc and free per
+//  frame and message for code that handles many messages. Each thread has
+//  its own pool, and the limit applies to all of them together, for frames
+//  and for messages. Threads free their pooled objects when they exit. Set this before starting threads
+//  that send or receive messages. If the environment variable ZSYS_POOL_SIZE
+//  is defined, that provides the default. Otherwise the default is 0, which
+//  switches pooling off. Pooling needs POSIX threads, and is not available
+//  on other platforms.
+CZMQ_EXPORT void
+    zsys_set_pool_size (size_t pool_size);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Return the number of zframe_t and zmsg_t objects that threads keep for
+//  reuse; 0 means pooling is off.
+CZMQ_EXPORT size_t
+    zsys_pool_size (void);
+
 //  *** Draft method, for development use, may change without warning ***
 //  Configure the threshold value of filesystem object age per st_mtime
 //  that should elapse until we consider that object "stable" at the
@@ -564,6 +583,73 @@ CZMQ_EXPORT char *
 CZMQ_EXPORT char *
     zsys_zplprintf_error (const char *format, zconfig_t *args);
 
+//  *** Draft method, for development use, may change without warning ***
+//  Enable or disable asynchronous logging. When enabled, the zsys log
+//  functions format each message into a ring kept by the calling thread,
+//  and return without waiting for I/O; a background thread writes out the
+//  messages in batches, to the same log stream, log sender, and system
+//  facility. Messages from one thread keep their order. If a thread logs
+//  faster than the writer can keep up, its ring fills, and further messages
+//  are dropped, see zsys_log_dropped (). Messages longer than 495 bytes are
+//  truncated, see zsys_log_truncated (). If the environment variable
+//  ZSYS_LOGASYNC is "true", that enables it by default. Asynchronous logging
+//  needs POSIX threads; on other platforms, logging stays synchronous.
+CZMQ_EXPORT void
+    zsys_set_logasync (bool logasync);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Return true if logging is asynchronous.
+CZMQ_EXPORT bool
+    zsys_logasync (void);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Wait until the background writer has written out all messages logged
+//  so far. Does nothing unless logging is asynchronous.
+CZMQ_EXPORT void
+    zsys_log_flush (void);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Return the number of log messages dropped since the process started,
+//  because a thread's log ring was full.
+CZMQ_EXPORT uint64_t
+    zsys_log_dropped (void);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Return the number of log messages truncated since the process started,
+//  because they did not fit into a log record.
+CZMQ_EXPORT uint64_t
+    zsys_log_truncated (void);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Set a stream to receive log events in binary form, instead of as text.
+//  Events are written as they are recorded, with their format and their
+//  arguments, and not formatted; use zsys_log_decode () or the zlogdump tool
+//  to read them. The stream should be open in binary mode. When this returns,
+//  the log writer no longer uses the previous stream. Set the stream to NULL
+//  to format log events as text again. This needs asynchronous logging.
+CZMQ_EXPORT void
+    zsys_set_logbinary (FILE *stream);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Log a debug-level event. With asynchronous logging, this copies the
+//  format and arguments into the calling thread's log ring, and the log
+//  writer formats them later, or writes them to the binary log stream, if
+//  one is set. So the format must be a string constant, and be there for
+//  as long as the process runs. Events support the printf conversions,
+//  except %n and wide characters; if the format uses those, or without
+//  asynchronous logging, this works like zsys_debug ().
+CZMQ_EXPORT void
+    zsys_log_event (const char *format, ...);
+
+//  *** Draft method, for development use, may change without warning ***
+//  Read a binary log written via zsys_set_logbinary () from the input, and
+//  write it to the output as text, in the same form as the zsys log
+//  functions. Returns the number of events decoded, or -1 if the input is
+//  not a binary log, was written by a newer version of CZMQ, or by a machine
+//  with a different byte order, or is cut short.
+CZMQ_EXPORT int
+    zsys_log_decode (FILE *input, FILE *output);
+
 #endif // CZMQ_BUILD_DRAFT_API
 //  @end
 
@@ -200,6 +200,9 @@ python3 setup.py install --root=%{buildroot} --skip-build --prefix %{_prefix}
 %doc README.md
 %doc README.txt
 %{_bindir}/zmakecert
+%if %{with drafts}
+%{_bindir}/zlogdump
+%endif
 %{_mandir}/man1/zmakecert*
 
 %changelog
@@ -198,6 +198,60 @@ CZMQ_PRIVATE int
 CZMQ_PRIVATE void
     zframe_print_n (zframe_t *self, const char *prefix, size_t length);
 
+//  *** Draft method, defined for internal use only ***
+//  Create a new frame that shares the content of an existing frame, rather
+//  than copying it. The content is reference counted by libzmq, and freed
+//  when the last frame that shares it is destroyed. As any change to the
+//  content shows in every share, you must not modify the content of either
+//  frame afterwards. If frame is null, or memory was exhausted, returns null.
+CZMQ_PRIVATE zframe_t *
+    zframe_share (zframe_t *self);
+
+//  *** Draft method, defined for internal use only ***
+//  Return the number of frames taken from the thread pools, rather than
+//  allocated, by threads that have exited and by the calling thread. Returns
+//  zero if pooling is not available.
+CZMQ_PRIVATE uint64_t
+    zframe_pool_hits (void);
+
+//  *** Draft method, defined for internal use only ***
+//  Return the number of frames allocated while pooling was on, because
+//  the thread pool was empty, by threads that have exited and by the calling
+//  thread. Returns zero if pooling is not available.
+CZMQ_PRIVATE uint64_t
+    zframe_pool_misses (void);
+
+//  *** Draft method, defined for internal use only ***
+//  Receive up to max frames from socket into the frames array. Waits up to
+//  timeout msecs for the first frame, or forever if timeout is -1, and then
+//  takes only the frames that are ready, without waiting. Resolves the
+//  socket once, and takes each frame's more indicator from the frame itself,
+//  so this is cheaper than calling zframe_recv for each frame. Does not stop
+//  at message boundaries; use zframe_more to find them. Returns the number
+//  of frames received, which is zero if the timeout expired or the call was
+//  interrupted. Caller owns the frames and must destroy them when done.
+CZMQ_PRIVATE int
+    zframe_recv_batch (void *source, zframe_t **frames, size_t max, int timeout);
+
+//  *** Draft method, defined for internal use only ***
+//  Send count frames from the frames array to socket. Sends each frame with
+//  the more indicator set if zframe_more says so, so frames received with
+//  zframe_recv_batch go out as they came in. Resolves the socket once, and
+//  checks its type once. Destroys each frame after sending it, and nullifies
+//  its reference in the array. Keeps retrying if interrupted in the middle
+//  of a multipart sequence. Returns the number of frames sent; if that is
+//  less than count, the send failed and errno says why.
+CZMQ_PRIVATE int
+    zframe_send_batch (void *dest, zframe_t **frames, size_t count);
+
+//  *** Draft method, defined for internal use only ***
+//  Create a new, empty hash container that keeps its items in one flat
+//  array, using open addressing, instead of chaining them in buckets. It
+//  has the same methods, callbacks and cursor semantics as other hash
+//  containers, and uses less memory and fewer cache misses on large tables.
+CZMQ_PRIVATE zhashx_t *
+    zhashx_new_flat (void);
+
 //  *** Draft method, defined for internal use only ***
 //  Same as pack but uses a user-defined serializer function to convert items
 //  into longstr.
@@ -259,6 +313,47 @@ CZMQ_PRIVATE zframe_t *
 CZMQ_PRIVATE zlistx_t *
     zlistx_unpack (zframe_t *frame);
 
+//  *** Draft method, defined for internal use only ***
+//  Set the number of times the reactor may call a reader's handler for each
+//  poll, while the socket still has input. This cuts the cost of polling for
+//  busy sockets, while the budget stops one socket from starving the others.
+//  The default budget is 1. Applies to all readers for the socket.
+CZMQ_PRIVATE void
+    zloop_reader_set_budget (zloop_t *self, zsock_t *sock, size_t budget);
+
+//  *** Draft method, defined for internal use only ***
+//  Return the number of times a reader's handler was called as often as its
+//  budget allows in one poll, since the reactor was created. If this grows
+//  quickly, the reader's budget may be too low for its traffic.
+CZMQ_PRIVATE uint64_t
+    zloop_budget_exhausted (zloop_t *self);
+
+//  *** Draft method, defined for internal use only ***
+//  Set collection of reactor statistics on/off. When on, the reactor counts
+//  calls and measures the time spent in each reader, poller and timer handler,
+//  how late each timer fires, and how long it waits in poll compared to how
+//  long it is busy. This costs a clock read around each handler call. The
+//  default stats setting is off (false).
+CZMQ_PRIVATE void
+    zloop_set_stats (zloop_t *self, bool stats);
+
+//  *** Draft method, defined for internal use only ***
+//  Log a summary of reactor statistics via zsys_info every so many msecs.
+//  Setting a non-zero interval also switches on collection of statistics.
+//  Use 0 to stop logging.
+CZMQ_PRIVATE void
+    zloop_set_stats_interval (zloop_t *self, size_t stats_interval);
+
+//  *** Draft method, defined for internal use only ***
+//  Return reactor statistics collected since they were switched on, as a
+//  zconfig tree. Times are in usecs. The tree holds loop/polls, loop/wait and
+//  loop/busy, and calls, busy and busy_max for each reader, poller, and timer.
+//  Timers also hold late and late_max, the total and longest delay between
+//  the time they were due and the time they fired. Caller owns return value
+//  and must destroy it when done.
+CZMQ_PRIVATE zconfig_t *
+    zloop_stats (zloop_t *self);
+
 //  *** Draft method, defined for internal use only ***
 //  Return message routing ID, if the message came from a ZMQ_SERVER socket.
 //  Else returns zero.
@@ -279,6 +374,75 @@ CZMQ_PRIVATE void
 CZMQ_PRIVATE void
     zmsg_print_n (zmsg_t *self, size_t size);
 
+//  *** Draft method, defined for internal use only ***
+//  Create a new message whose frames share the content of an existing
+//  message, rather than copying it, as zframe_share does. You must not
+//  modify the content of either message afterwards. If message is null, or
+//  memory was exhausted, returns null.
+CZMQ_PRIVATE zmsg_t *
+    zmsg_share (zmsg_t *self);
+
+//  *** Draft method, defined for internal use only ***
+//  Return the number of messages taken from the thread pools, rather than
+//  allocated, by threads that have exited and by the calling thread. Returns
+//  zero if pooling is not available.
+CZMQ_PRIVATE uint64_t
+    zmsg_pool_hits (void);
+
+//  *** Draft method, defined for internal use only ***
+//  Return the number of messages allocated while pooling was on, because
+//  the thread pool was empty, by threads that have exited and by the calling
+//  thread. Returns zero if pooling is not available.
+CZMQ_PRIVATE uint64_t
+    zmsg_pool_misses (void);
+
+//  *** Draft method, defined for internal use only ***
+//  Receive up to max messages from socket into the msgs array. Waits up to
+//  timeout msecs for the first message, or forever if timeout is -1, and
+//  then takes only the messages that are ready, without waiting. This costs
+//  less per message than calling zmsg_recv, as it uses zframe_recv_batch
+//  to read frames. Returns the number of messages received, which is zero
+//  if the timeout expired or the call was interrupted. Caller owns the
+//  messages and must destroy them when done.
+CZMQ_PRIVATE int
+    zmsg_recv_batch (void *source, zmsg_t **msgs, size_t max, int timeout);
+
+//  *** Draft method, defined for internal use only ***
+//  Send count messages from the msgs array to socket, using one call to
+//  zframe_send_batch for all their frames. Destroys each message after
+//  sending it, and nullifies its reference in the array. Returns the number
+//  of messages sent; if that is less than count, the send failed and errno
+//  says why. The first unsent message keeps any frames that were not sent.
+CZMQ_PRIVATE int
+    zmsg_send_batch (void *dest, zmsg_t **msgs, size_t count);
+
+//  *** Draft method, defined for internal use only ***
+//  Serialize multipart message into a buffer provided by the caller, in the
+//  same format as zmsg_encode, without allocating a frame. Returns the
+//  encoded size. If that is more than the buffer size, writes nothing, so
+//  you can call this with a null buffer and zero size to find out how large
+//  a buffer you need.
+CZMQ_PRIVATE size_t
+    zmsg_encode_buffer (zmsg_t *self, byte *buffer, size_t size);
+
+//  *** Draft method, defined for internal use only ***
+//  Serialize multipart message and append it to the chunk, in the same
+//  format as zmsg_encode. The chunk must have room for the encoded message,
+//  which is the size that zmsg_encode_buffer returns. Returns 0 if OK, or
+//  -1 if the chunk was too small, in which case it is left unchanged.
+CZMQ_PRIVATE int
+    zmsg_encode_chunk (zmsg_t *self, zchunk_t *chunk);
+
+//  *** Draft method, defined for internal use only ***
+//  Decodes a serialized message frame created by zmsg_encode () like
+//  zmsg_decode, except that larger frames of the new message refer to the
+//  content of the serialized frame, rather than copying it. The content
+//  lives until the last frame that refers to it is destroyed, so you may
+//  destroy the serialized frame at once. You must not modify the content
+//  of the serialized frame or the new message.
+CZMQ_PRIVATE zmsg_t *
+    zmsg_decode_shared (zframe_t *frame);
+
 //  *** Draft method, defined for internal use only ***
 //  Create a SERVER socket. Default action is bind.
 //  Caller owns return value and must destroy it when done.
@@ -358,6 +522,30 @@ CZMQ_PRIVATE int
 CZMQ_PRIVATE bool
     zsock_has_in (void *self);
 
+//  *** Draft method, defined for internal use only ***
+//  Set collection of traffic statistics on/off. When on, the socket counts
+//  the messages, frames and bytes sent and received through zframe, zmsg,
+//  zstr and zsock calls, along with failed and retried sends, and notes the
+//  largest message. Switching off drops the counters. The default stats
+//  setting is off (false).
+CZMQ_PRIVATE void
+    zsock_set_stats (zsock_t *self, bool stats);
+
+//  *** Draft method, defined for internal use only ***
+//  Return traffic statistics collected since they were switched on or last
+//  reset, as a zconfig tree, or NULL if statistics are off. The tree holds
+//  sent/msgs, sent/frames, sent/bytes, sent/failed, sent/again (failed with
+//  EAGAIN, usually at the high-water mark), sent/retries, recv/msgs,
+//  recv/frames, recv/bytes, and msg_max, the largest message in bytes.
+//  Caller owns return value and must destroy it when done.
+CZMQ_PRIVATE zconfig_t *
+    zsock_stats (zsock_t *self);
+
+//  *** Draft method, defined for internal use only ***
+//  Reset traffic statistics to zero, if they are on.
+CZMQ_PRIVATE void
+    zsock_stats_reset (zsock_t *self);
+
 //  *** Draft method, defined for internal use only ***
 //  De-compress and receive C string from socket, received as a message
 //  with two frames: size of the uncompressed string, and the string itself.
@@ -439,6 +627,25 @@ CZMQ_PRIVATE void
 CZMQ_PRIVATE int
     zsys_zero_copy_recv (void);
 
+//  *** Draft method, defined for internal use only ***
+//  Configure the number of zframe_t and zmsg_t objects that threads keep
+//  for reuse, rather than freeing them. This saves a malloc and free per
+//  frame and message for code that handles many messages. Each thread has
+//  its own pool, and the limit applies to all of them together, for frames
+//  and for messages. Threads free their pooled objects when they exit. Set this before starting threads
+//  that send or receive messages. If the environment variable ZSYS_POOL_SIZE
+//  is defined, that provides the default. Otherwise the default is 0, which
+//  switches pooling off. Pooling needs POSIX threads, and is not available
+//  on other platforms.
+CZMQ_PRIVATE void
+    zsys_set_pool_size (size_t pool_size);
+
+//  *** Draft method, defined for internal use only ***
+//  Return the number of zframe_t and zmsg_t objects that threads keep for
+//  reuse; 0 means pooling is off.
+CZMQ_PRIVATE size_t
+    zsys_pool_size (void);
+
 //  *** Draft method, defined for internal use only ***
 //  Configure the threshold value of filesystem object age per st_mtime
 //  that should elapse until we consider that object "stable" at the
@@ -527,6 +734,73 @@ CZMQ_PRIVATE char *
 CZMQ_PRIVATE char *
     zsys_zplprintf_error (const char *format, zconfig_t *args);
 
+//  *** Draft method, defined for internal use only ***
+//  Enable or disable asynchronous logging. When enabled, the zsys log
+//  functions format each message into a ring kept by the calling thread,
+//  and return without waiting for I/O; a background thread writes out the
+//  messages in batches, to the same log stream, log sender, and system
+//  facility. Messages from one thread keep their order. If a thread logs
+//  faster than the writer can keep up, its ring fills, and further messages
+//  are dropped, see zsys_log_dropped (). Messages longer than 495 bytes are
+//  truncated, see zsys_log_truncated (). If the environment variable
+//  ZSYS_LOGASYNC is "true", that enables it by default. Asynchronous logging
+//  needs POSIX threads; on other platforms, logging stays synchronous.
+CZMQ_PRIVATE void
+    zsys_set_logasync (bool logasync);
+
+//  *** Draft method, defined for internal use only ***
+//  Return true if logging is asynchronous.
+CZMQ_PRIVATE bool
+    zsys_logasync (void);
+
+//  *** Draft method, defined for internal use only ***
+//  Wait until the background writer has written out all messages logged
+//  so far. Does nothing unless logging is asynchronous.
+CZMQ_PRIVATE void
+    zsys_log_flush (void);
+
+//  *** Draft method, defined for internal use only ***
+//  Return the number of log messages dropped since the process started,
+//  because a thread's log ring was full.
+CZMQ_PRIVATE uint64_t
+    zsys_log_dropped (void);
+
+//  *** Draft method, defined for internal use only ***
+//  Return the number of log messages truncated since the process started,
+//  because they did not fit into a log record.
+CZMQ_PRIVATE uint64_t
+    zsys_log_truncated (void);
+
+//  *** Draft method, defined for internal use only ***
+//  Set a stream to receive log events in binary form, instead of as text.
+//  Events are written as they are recorded, with their format and their
+//  arguments, and not formatted; use zsys_log_decode () or the zlogdump tool
+//  to read them. The stream should be open in binary mode. When this returns,
+//  the log writer no longer uses the previous stream. Set the stream to NULL
+//  to format log events as text again. This needs asynchronous logging.
+CZMQ_PRIVATE void
+    zsys_set_logbinary (FILE *stream);
+
+//  *** Draft method, defined for internal use only ***
+//  Log a debug-level event. With asynchronous logging, this copies the
+//  format and arguments into the calling thread's log ring, and the log
+//  writer formats them later, or writes them to the binary log stream, if
+//  one is set. So the format must be a string constant, and be there for
+//  as long as the process runs. Events support the printf conversions,
+//  except %n and wide characters; if the format uses those, or without
+//  asynchronous logging, this works like zsys_debug ().
+CZMQ_PRIVATE void
+    zsys_log_event (const char *format, ...);
+
+//  *** Draft method, defined for internal use only ***
+//  Read a binary log written via zsys_set_logbinary () from the input, and
+//  write it to the output as text, in the same form as the zsys log
+//  functions. Returns the number of events decoded, or -1 if the input is
+//  not a binary log, was written by a newer version of CZMQ, or by a machine
+//  with a different byte order, or is cut short.
+CZMQ_PRIVATE int
+    zsys_log_decode (FILE *input, FILE *output);
+
 //  *** Draft constants, defined for internal use only ***
 
 #define ZGOSSIP_MSG_HELLO 1
@@ -632,4 +906,39 @@ CZMQ_PRIVATE void
 
 #endif // CZMQ_BUILD_DRAFT_API
 
+//  Socket traffic statistics, counted by the send and receive paths only
+//  while zsock_stats_used () is true. The flag is set by zsock_set_stats
+//  on one thread and read by the send and receive paths on all others.
+extern CZMQ_PRIVATE bool
+    zsock_stats_flag;
+
+static inline bool
+zsock_stats_used (void)
+{
+#if defined (__UNIX__)
+    return __atomic_load_n (&zsock_stats_flag, __ATOMIC_RELAXED);
+#else
+    return *(volatile bool *) &zsock_stats_flag;
+#endif
+}
+
+CZMQ_PRIVATE void
+    zsock_stats_sent (void *self, int rc, bool more);
+
+CZMQ_PRIVATE void
+    zsock_stats_received (void *self, int rc, bool more);
+
+CZMQ_PRIVATE void
+    zsock_stats_retried (void *self);
+
+//  Destroy a frame without keeping it in the calling thread's pool, for
+//  code that may run on threads that are not ours
+CZMQ_PRIVATE void
+    zframe_destroy_unpooled (zframe_t **self_p);
+
+//  Actor whose other end of the pipe is served by the caller, not by a
+//  thread of its own
+CZMQ_PRIVATE zactor_t *
+    zactor_new_for_pipe (zsock_t *pipe);
+
 #endif
@@ -80,6 +80,11 @@ all_tests [] = {
     { "zhttp_request", zhttp_request_test, false, true, NULL },
     { "zhttp_response", zhttp_response_test, false, true, NULL },
     { "zosc", zosc_test, false, true, NULL },
+    { "zloop_pool", zloop_pool_test, false, true, NULL },
+    { "zsock_picture", zsock_picture_test, false, true, NULL },
+    { "zchannel", zchannel_test, false, true, NULL },
+    { "zmetrics", zmetrics_test, false, true, NULL },
+    { "zhistogram", zhistogram_test, false, true, NULL },
 #endif // CZMQ_BUILD_DRAFT_API
     {NULL, NULL, 0, 0, NULL}          //  Sentinel
 };
@@ -157,6 +157,24 @@ zactor_new (zactor_fn actor, void *args)
 }
 
 
+//  --------------------------------------------------------------------------
+//  Create an actor around a pipe whose other end is already being served,
+//  rather than starting a thread for it. The actor takes ownership of the
+//  pipe. zloop_pool uses this for actors that run on its threads.
+
+zactor_t *
+zactor_new_for_pipe (zsock_t *pipe)
+{
+    assert (pipe);
+    zactor_t *self = (zactor_t *) zmalloc (sizeof (zactor_t));
+    assert (self);
+    self->tag = ZACTOR_TAG;
+    self->destructor = s_zactor_destructor;
+    self->pipe = pipe;
+    return self;
+}
+
+
 //  --------------------------------------------------------------------------
 //  Destroy the actor.
 
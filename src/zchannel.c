@@ -0,0 +1,482 @@
+/*  =========================================================================
+    zchannel - lock-free channel of pointers between threads
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+    =========================================================================
+*/
+
+/*
+@header
+    The zchannel class passes pointers (zmsg_t, zframe_t, or anything else)
+    from any number of threads to one receiving thread, through a bounded
+    ring. Sending an item costs a compare-and-swap and a store, rather than
+    a trip through a libzmq pipe, mailbox and signaler.
+@discuss
+    The ring is a bounded queue in which each slot carries a sequence
+    number, so senders claim slots with one compare-and-swap and never wait
+    for each other. The receiver is the only thread that takes items out.
+
+    The channel has a handle (an eventfd on Linux, a pipe elsewhere) that
+    becomes readable when items arrive, so a receiving thread can wait on
+    it in zpoller or zloop alongside its sockets. We only write to the
+    handle when the receiver has found the channel empty, so a busy channel
+    costs no system calls at all. After the handle becomes readable, the
+    receiver should call zchannel_recv until it returns NULL.
+
+    The channel owns items only while they are in it: whoever receives an
+    item owns it. Not available on Windows, where zchannel_new returns NULL.
+@end
+*/
+
+#include "czmq_classes.h"
+#if defined (__UTYPE_LINUX)
+#   include <sys/eventfd.h>
+#endif
+
+//  Keep the sending and receiving ends of the ring on separate cache lines
+#define CACHE_LINE_SIZE 64
+
+//  One slot in the ring. The sequence says whose turn it is: when it
+//  equals the send position, the slot is free for that send; when it is
+//  one more than the receive position, it holds that item.
+
+typedef struct {
+    size_t sequence;
+    void *item;
+} s_slot_t;
+
+//  Structure of our class
+
+struct _zchannel_t {
+    s_slot_t *ring;             //  Ring of slots
+    size_t mask;                //  Ring size - 1, as the size is a power of 2
+    SOCKET wakeup [2];          //  Read and write ends of wakeup handle
+    zchannel_destructor_fn *destructor;
+    char pad1 [CACHE_LINE_SIZE];
+    size_t send_pos;            //  Next position to send to
+    char pad2 [CACHE_LINE_SIZE];
+    size_t recv_pos;            //  Next position to receive from
+    int sleeping;               //  Receiver found the channel empty
+    char pad3 [CACHE_LINE_SIZE];
+};
+
+#if !defined (__WINDOWS__)
+
+//  Wake up the receiver
+
+static void
+s_wakeup_signal (zchannel_t *self)
+{
+#if defined (__UTYPE_LINUX)
+    uint64_t value = 1;
+    ssize_t rc = write (self->wakeup [1], &value, sizeof (value));
+#else
+    byte value = 1;
+    ssize_t rc = write (self->wakeup [1], &value, sizeof (value));
+#endif
+    //  A full pipe or counter is still readable, which is all we need
+    (void) rc;
+}
+
+//  Clear the wakeup handle so it isn't readable any more
+
+static void
+s_wakeup_clear (zchannel_t *self)
+{
+#if defined (__UTYPE_LINUX)
+    uint64_t value;
+    ssize_t rc = read (self->wakeup [0], &value, sizeof (value));
+    (void) rc;
+#else
+    byte buffer [64];
+    while (read (self->wakeup [0], buffer, sizeof (buffer)) > 0) ;
+#endif
+}
+
+//  Take the next item out of the ring, or return NULL if it is empty
+
+static void *
+s_ring_take (zchannel_t *self)
+{
+    size_t pos = self->recv_pos;
+    s_slot_t *slot = &self->ring [pos & self->mask];
+    size_t sequence = __atomic_load_n (&slot->sequence, __ATOMIC_ACQUIRE);
+    if (sequence != pos + 1)
+        return NULL;
+    void *item = slot->item;
+    //  Hand the slot back for the send one lap ahead of us
+    __atomic_store_n (&slot->sequence, pos + self->mask + 1, __ATOMIC_RELEASE);
+    //  Only we write recv_pos, but zchannel_size may read it from elsewhere
+    __atomic_store_n (&self->recv_pos, pos + 1, __ATOMIC_RELAXED);
+    return item;
+}
+#endif
+
+
+//  --------------------------------------------------------------------------
+//  Create a new channel that holds up to size items. The size is rounded
+//  up to a power of two. Returns NULL if size is zero, or if the wakeup
+//  handle could not be created.
+
+zchannel_t *
+zchannel_new (size_t size)
+{
+#if defined (__WINDOWS__)
+    zsys_error ("zchannel: not supported on Windows");
+    return NULL;
+#else
+    if (size == 0)
+        return NULL;
+
+    zchannel_t *self = (zchannel_t *) zmalloc (sizeof (zchannel_t));
+    assert (self);
+    size_t ring_size = 1;
+    while (ring_size < size)
+        ring_size <<= 1;
+    self->ring = (s_slot_t *) zmalloc (ring_size * sizeof (s_slot_t));
+    assert (self->ring);
+    self->mask = ring_size - 1;
+    size_t index;
+    for (index = 0; index < ring_size; index++)
+        self->ring [index].sequence = index;
+    self->sleeping = 1;
+
+#if defined (__UTYPE_LINUX)
+    self->wakeup [0] = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+    self->wakeup [1] = self->wakeup [0];
+    int rc = self->wakeup [0] == -1? -1: 0;
+#else
+    int rc = pipe (self->wakeup);
+    if (rc == 0) {
+        fcntl (self->wakeup [0], F_SETFL, O_NONBLOCK);
+        fcntl (self->wakeup [1], F_SETFL, O_NONBLOCK);
+    }
+#endif
+    if (rc == -1) {
+        zsys_error ("zchannel: cannot create wakeup handle: %s", strerror (errno));
+        freen (self->ring);
+        freen (self);
+    }
+    return self;
+#endif
+}
+
+
+//  --------------------------------------------------------------------------
+//  Destroy a channel. If an item destructor was specified, any items
+//  still in the channel are destroyed as well.
+
+void
+zchannel_destroy (zchannel_t **self_p)
+{
+    assert (self_p);
+    if (*self_p) {
+        zchannel_t *self = *self_p;
+#if !defined (__WINDOWS__)
+        void *item;
+        while ((item = s_ring_take (self)))
+            if (self->destructor)
+                (self->destructor) (&item);
+        close (self->wakeup [0]);
+        if (self->wakeup [1] != self->wakeup [0])
+            close (self->wakeup [1]);
+#endif
+        freen (self->ring);
+        freen (self);
+        *self_p = NULL;
+    }
+}
+
+
+//  --------------------------------------------------------------------------
+//  Set a user-defined deallocator for items; by default items still in
+//  the channel are not freed when the channel is destroyed.
+
+void
+zchannel_set_destructor (zchannel_t *self, zchannel_destructor_fn destructor)
+{
+    assert (self);
+    self->destructor = destructor;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Send an item, which must not be NULL, to the channel. Any number of
+//  threads may send to one channel. Does not block: returns 0 if the item
+//  was queued, or -1 if the channel is full.
+
+int
+zchannel_send (zchannel_t *self, void *item)
+{
+    assert (self);
+    assert (item);
+#if defined (__WINDOWS__)
+    return -1;
+#else
+    size_t pos = __atomic_load_n (&self->send_pos, __ATOMIC_RELAXED);
+    s_slot_t *slot;
+    while (true) {
+        slot = &self->ring [pos & self->mask];
+        size_t sequence = __atomic_load_n (&slot->sequence, __ATOMIC_ACQUIRE);
+        intptr_t lag = (intptr_t) sequence - (intptr_t) pos;
+        if (lag == 0) {
+            //  The slot is free; try to claim it. On failure, pos has the
+            //  position that another sender moved on to.
+            if (__atomic_compare_exchange_n (&self->send_pos, &pos, pos + 1,
+                true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                break;
+        }
+        else
+        if (lag < 0)
+            return -1;          //  The receiver is a whole lap behind
+        else
+            pos = __atomic_load_n (&self->send_pos, __ATOMIC_RELAXED);
+    }
+    slot->item = item;
+    __atomic_store_n (&slot->sequence, pos + 1, __ATOMIC_RELEASE);
+
+    //  If the receiver found the channel empty, wake it up. The fence
+    //  orders our store above against our read of sleeping, just as the
+    //  receiver orders its write of sleeping against its last look at the
+    //  ring, so one of us always sees the other.
+    __atomic_thread_fence (__ATOMIC_SEQ_CST);
+    if (__atomic_load_n (&self->sleeping, __ATOMIC_RELAXED)
+    &&  __atomic_exchange_n (&self->sleeping, 0, __ATOMIC_ACQ_REL))
+        s_wakeup_signal (self);
+    return 0;
+#endif
+}
+
+
+//  --------------------------------------------------------------------------
+//  Receive the next item from the channel, or NULL if the channel is
+//  empty. Only one thread may receive from a channel. Does not block;
+//  wait on the channel's handle to know when there are items.
+
+void *
+zchannel_recv (zchannel_t *self)
+{
+    assert (self);
+#if defined (__WINDOWS__)
+    return NULL;
+#else
+    void *item = s_ring_take (self);
+    if (!item) {
+        //  Clear the handle and tell senders to wake us, then look once
+        //  more, in case an item arrived before they could see that
+        s_wakeup_clear (self);
+        __atomic_store_n (&self->sleeping, 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence (__ATOMIC_SEQ_CST);
+        item = s_ring_take (self);
+    }
+    return item;
+#endif
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return the number of items waiting in the channel. As other threads
+//  may be sending, this is only a snapshot.
+
+size_t
+zchannel_size (zchannel_t *self)
+{
+    assert (self);
+#if defined (__WINDOWS__)
+    return 0;
+#else
+    size_t recv_pos = __atomic_load_n (&self->recv_pos, __ATOMIC_RELAXED);
+    size_t send_pos = __atomic_load_n (&self->send_pos, __ATOMIC_RELAXED);
+    return send_pos - recv_pos;
+#endif
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return the handle that becomes readable when items arrive, for use
+//  with zpoller or zloop_poller. Once it is readable, call recv until it
+//  returns NULL; that also clears the handle.
+
+SOCKET
+zchannel_fd (zchannel_t *self)
+{
+    assert (self);
+    return self->wakeup [0];
+}
+
+
+//  --------------------------------------------------------------------------
+//  Selftest
+
+#if !defined (__WINDOWS__)
+#define TEST_SENDERS    4
+#define TEST_ITEMS      100000
+
+//  Sends TEST_ITEMS numbers, each tagged with the sender, to the channel
+
+static void
+s_test_sender (zsock_t *pipe, void *args)
+{
+    zchannel_t *channel = (zchannel_t *) args;
+    zsock_signal (pipe, 0);
+    int sender;
+    zsock_recv (pipe, "i", &sender);
+    int index;
+    for (index = 0; index < TEST_ITEMS; index++) {
+        intptr_t item = (intptr_t) sender * TEST_ITEMS + index + 1;
+        while (zchannel_send (channel, (void *) item) == -1)
+            zclock_sleep (0);
+    }
+    zsock_wait (pipe);
+}
+
+//  Sends TEST_ITEMS pointers over an actor pipe, for comparison
+
+static void
+s_test_pipe_sender (zsock_t *pipe, void *args)
+{
+    zsock_signal (pipe, 0);
+    intptr_t index;
+    for (index = 0; index < TEST_ITEMS; index++)
+        zsock_send (pipe, "p", (void *) index);
+}
+
+static int
+s_test_reader (zloop_t *loop, zmq_pollitem_t *item, void *arg)
+{
+    zchannel_t *channel = (zchannel_t *) arg;
+    char *string = (char *) zchannel_recv (channel);
+    assert (string);
+    assert (streq (string, "Hello"));
+    zstr_free (&string);
+    assert (zchannel_recv (channel) == NULL);
+    return -1;
+}
+
+static void
+s_test_destructor (void **item)
+{
+    zstr_free ((char **) item);
+}
+#endif
+
+void
+zchannel_test (bool verbose)
+{
+    printf (" * zchannel: ");
+    if (verbose)
+        printf ("\n");
+
+#if !defined (__WINDOWS__)
+    //  @selftest
+    //  A channel holds a power of two items, in order
+    zchannel_t *channel = zchannel_new (0);
+    assert (channel == NULL);
+    channel = zchannel_new (3);
+    assert (channel);
+    intptr_t index;
+    for (index = 1; index <= 4; index++)
+        assert (zchannel_send (channel, (void *) index) == 0);
+    assert (zchannel_send (channel, (void *) index) == -1);
+    assert (zchannel_size (channel) == 4);
+    for (index = 1; index <= 4; index++)
+        assert (zchannel_recv (channel) == (void *) index);
+    assert (zchannel_recv (channel) == NULL);
+    assert (zchannel_size (channel) == 0);
+
+    //  The handle is readable only once there is something to receive
+    SOCKET handle = zchannel_fd (channel);
+    zpoller_t *poller = zpoller_new (NULL);
+    assert (poller);
+    zpoller_add (poller, &handle);
+    assert (zpoller_wait (poller, 0) == NULL);
+    zchannel_send (channel, (void *) 1);
+    zchannel_send (channel, (void *) 2);
+    assert (zpoller_wait (poller, 0) == &handle);
+    assert (zchannel_recv (channel) == (void *) 1);
+    assert (zchannel_recv (channel) == (void *) 2);
+    assert (zchannel_recv (channel) == NULL);
+    assert (zpoller_wait (poller, 0) == NULL);
+    zpoller_destroy (&poller);
+
+    //  Many senders, one receiver waiting on a poller
+    zchannel_destroy (&channel);
+    channel = zchannel_new (1024);
+    assert (channel);
+    zactor_t *senders [TEST_SENDERS];
+    int sender;
+    for (sender = 0; sender < TEST_SENDERS; sender++) {
+        senders [sender] = zactor_new (s_test_sender, channel);
+        assert (senders [sender]);
+    }
+    handle = zchannel_fd (channel);
+    poller = zpoller_new (NULL);
+    assert (poller);
+    zpoller_add (poller, &handle);
+    int64_t start = zclock_usecs ();
+    for (sender = 0; sender < TEST_SENDERS; sender++)
+        zsock_send (senders [sender], "i", sender);
+
+    intptr_t last [TEST_SENDERS] = { 0 };
+    int received = 0;
+    while (received < TEST_SENDERS * TEST_ITEMS) {
+        void *which = zpoller_wait (poller, 1000);
+        assert (which == &handle);
+        void *item;
+        while ((item = zchannel_recv (channel))) {
+            //  Items from each sender arrive in the order it sent them
+            intptr_t value = (intptr_t) item - 1;
+            sender = (int) (value / TEST_ITEMS);
+            assert (value % TEST_ITEMS == last [sender]);
+            last [sender]++;
+            received++;
+        }
+    }
+    if (verbose)
+        zsys_info ("zchannel: %d senders passed %d items in %d usecs",
+            TEST_SENDERS, received, (int) (zclock_usecs () - start));
+    if (verbose) {
+        start = zclock_usecs ();
+        zactor_t *pipe_sender = zactor_new (s_test_pipe_sender, NULL);
+        assert (pipe_sender);
+        for (index = 0; index < TEST_ITEMS; index++) {
+            void *item;
+            zsock_recv (pipe_sender, "p", &item);
+            assert (item == (void *) index);
+        }
+        zactor_destroy (&pipe_sender);
+        zsys_info ("zchannel: an actor pipe passed %d items in %d usecs",
+            TEST_ITEMS, (int) (zclock_usecs () - start));
+    }
+    for (sender = 0; sender < TEST_SENDERS; sender++) {
+        zsock_signal (senders [sender], 0);
+        zactor_destroy (&senders [sender]);
+    }
+    zpoller_destroy (&poller);
+
+    //  The handle works with zloop too
+    zloop_t *loop = zloop_new ();
+    assert (loop);
+    zmq_pollitem_t pollitem = { NULL, zchannel_fd (channel), ZMQ_POLLIN };
+    zloop_poller (loop, &pollitem, s_test_reader, channel);
+    zchannel_send (channel, strdup ("Hello"));
+    zloop_start (loop);
+    zloop_destroy (&loop);
+
+    //  Items left in the channel go to the destructor
+    zchannel_set_destructor (channel, s_test_destructor);
+    zchannel_send (channel, strdup ("Hello"));
+    zchannel_send (channel, strdup ("World"));
+    zchannel_destroy (&channel);
+    assert (channel == NULL);
+    //  @end
+#endif
+
+    printf ("OK\n");
+}
@@ -44,6 +44,113 @@ struct _zframe_t {
     void * hint;                        //  Hint for destroying the memory
 };
 
+//  Each thread keeps a pool of free frames for reuse. All the pools together
+//  hold no more than the size set by zsys_set_pool_size. Freeing the pool
+//  when a thread exits needs a thread-specific destructor, which we have
+//  only with POSIX threads.
+
+#if defined (__UNIX__)
+#   define ZFRAME_POOL
+
+typedef struct {
+    zframe_t *free;             //  Free frames, linked via hint
+    size_t size;                //  Number of free frames
+    uint64_t hits;              //  Frames taken from pool
+    uint64_t misses;            //  Frames allocated while pooling
+} s_pool_t;
+
+static CZMQ_THREADLS s_pool_t *s_pool = NULL;
+static pthread_key_t s_pool_key;
+static pthread_once_t s_pool_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t s_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t s_pool_hits = 0;        //  Totals from exited threads
+static uint64_t s_pool_misses = 0;
+static size_t s_pooled = 0;             //  Objects in all pools, for the cap
+
+static void
+s_pool_free (void *arg)
+{
+    s_pool_t *pool = (s_pool_t *) arg;
+    while (pool->free) {
+        zframe_t *self = pool->free;
+        pool->free = (zframe_t *) self->hint;
+        freen (self);
+    }
+    __atomic_sub_fetch (&s_pooled, pool->size, __ATOMIC_RELAXED);
+    pthread_mutex_lock (&s_pool_mutex);
+    s_pool_hits += pool->hits;
+    s_pool_misses += pool->misses;
+    pthread_mutex_unlock (&s_pool_mutex);
+    freen (pool);
+    s_pool = NULL;
+}
+
+static void
+s_pool_init (void)
+{
+    int rc = pthread_key_create (&s_pool_key, s_pool_free);
+    assert (rc == 0);
+}
+
+static s_pool_t *
+s_pool_get (void)
+{
+    if (!s_pool) {
+        pthread_once (&s_pool_once, s_pool_init);
+        s_pool = (s_pool_t *) zmalloc (sizeof (s_pool_t));
+        assert (s_pool);
+        pthread_setspecific (s_pool_key, s_pool);
+    }
+    return s_pool;
+}
+#endif
+
+//  Allocate a frame, from the pool if we can. Returns zeroed memory.
+
+static zframe_t *
+s_frame_alloc (void)
+{
+#if defined (ZFRAME_POOL)
+    if (zsys_pool_size ()) {
+        s_pool_t *pool = s_pool_get ();
+        zframe_t *self = pool->free;
+        if (self) {
+            pool->free = (zframe_t *) self->hint;
+            pool->size--;
+            __atomic_sub_fetch (&s_pooled, 1, __ATOMIC_RELAXED);
+            pool->hits++;
+            memset (self, 0, sizeof (zframe_t));
+            return self;
+        }
+        pool->misses++;
+    }
+#endif
+    zframe_t *self = (zframe_t *) zmalloc (sizeof (zframe_t));
+    assert (self);
+    return self;
+}
+
+//  Free a frame, to the pool if it has room
+
+static void
+s_frame_free (zframe_t *self)
+{
+#if defined (ZFRAME_POOL)
+    //  The cap is on objects pooled by all threads together
+    if (zsys_pool_size ()) {
+        if (__atomic_add_fetch (&s_pooled, 1, __ATOMIC_RELAXED) <= zsys_pool_size ()) {
+            s_pool_t *pool = s_pool_get ();
+            self->hint = pool->free;
+            pool->free = self;
+            pool->size++;
+            return;
+        }
+        __atomic_sub_fetch (&s_pooled, 1, __ATOMIC_RELAXED);
+    }
+#endif
+    freen (self);
+}
+
 //  --------------------------------------------------------------------------
 //  Constructor; if size is >0, allocates frame with that size, and if data
 //  is not null, copies data into frame.
@@ -51,13 +158,12 @@ struct _zframe_t {
 zframe_t *
 zframe_new (const void *data, size_t size)
 {
-    zframe_t *self = (zframe_t *) zmalloc (sizeof (zframe_t));
-    assert (self);
+    zframe_t *self = s_frame_alloc ();
     self->tag = ZFRAME_TAG;
     if (size) {
         //  Catch heap exhaustion in this specific case
         if (zmq_msg_init_size (&self->zmsg, size)) {
-            freen (self);
+            s_frame_free (self);
             return NULL;
         }
         if (data)
@@ -77,8 +183,7 @@ zframe_new (const void *data, size_t size)
 zframe_t *
 zframe_new_empty (void)
 {
-    zframe_t *self = (zframe_t *) zmalloc (sizeof (zframe_t));
-    assert (self);
+    zframe_t *self = s_frame_alloc ();
     self->tag = ZFRAME_TAG;
     zmq_msg_init (&self->zmsg);
     return self;
@@ -97,13 +202,33 @@ zframe_destroy (zframe_t **self_p)
         assert (zframe_is (self));
         zmq_msg_close (&self->zmsg);
         self->tag = 0xDeadBeef;
-        freen (self);
+        s_frame_free (self);
 
         *self_p = NULL;
     }
 }
 
 
+//  --------------------------------------------------------------------------
+//  Destroy a frame without keeping it in the calling thread's pool. Use this
+//  where the caller may be a libzmq I/O thread, which would hold pooled
+//  frames until it exits.
+
+void
+zframe_destroy_unpooled (zframe_t **self_p)
+{
+    assert (self_p);
+    if (*self_p) {
+        zframe_t *self = *self_p;
+        assert (zframe_is (self));
+        zmq_msg_close (&self->zmsg);
+        self->tag = 0xDeadBeef;
+        freen (self);
+        *self_p = NULL;
+    }
+}
+
+
 //  --------------------------------------------------------------------------
 //  Create a frame with a specified string content.
 //  The caller is responsible for destroying the return value when finished with it.
@@ -135,8 +260,7 @@ zframe_t *
 zframe_frommem (void *data, size_t size, zframe_destructor_fn destructor, void *hint) {
     assert (data);
 
-    zframe_t *self = (zframe_t *) zmalloc (sizeof (zframe_t));
-    assert (self);
+    zframe_t *self = s_frame_alloc ();
     self->tag = ZFRAME_TAG;
     self->destructor = destructor;
     self->hint = hint;
@@ -169,11 +293,14 @@ zframe_recv (void *source)
     zframe_t *self = zframe_new (NULL, 0);
     assert (self);
 
-    if (zmq_recvmsg (handle, &self->zmsg, 0) < 0) {
+    int rc = zmq_recvmsg (handle, &self->zmsg, 0);
+    if (rc < 0) {
         zframe_destroy (&self);
         return NULL;            //  Interrupted or terminated
     }
     self->more = zsock_rcvmore (source);
+    if (zsock_stats_used ())
+        zsock_stats_received (source, rc, self->more != 0);
 #if defined (ZMQ_SERVER)
     //  Grab routing ID if we're reading from a SERVER socket (ZMQ 4.2 and later)
     if (zsock_type (source) == ZMQ_SERVER)
@@ -205,6 +332,7 @@ zframe_send (zframe_t **self_p, void *dest, int flags)
 
         int send_flags = (flags & ZFRAME_MORE)? ZMQ_SNDMORE: 0;
         send_flags |= (flags & ZFRAME_DONTWAIT)? ZMQ_DONTWAIT: 0;
+        int rc;
         if (flags & ZFRAME_REUSE) {
             zmq_msg_t copy;
             zmq_msg_init (&copy);
@@ -218,10 +346,9 @@ zframe_send (zframe_t **self_p, void *dest, int flags)
             if (zsock_type (dest) == ZMQ_RADIO)
                 zmq_msg_set_group (&copy, self->group);
 #endif
-            if (zmq_sendmsg (handle, &copy, send_flags) == -1) {
+            rc = zmq_sendmsg (handle, &copy, send_flags);
+            if (rc == -1)
                 zmq_msg_close (&copy);
-                return -1;
-            }
         }
         else {
 #if defined (ZMQ_SERVER)
@@ -232,16 +359,126 @@ zframe_send (zframe_t **self_p, void *dest, int flags)
             if (zsock_type (dest) == ZMQ_RADIO)
                 zmq_msg_set_group (&self->zmsg, self->group);
 #endif
-            if (zmq_sendmsg (handle, &self->zmsg, send_flags) >= 0)
+            rc = zmq_sendmsg (handle, &self->zmsg, send_flags);
+            if (rc >= 0)
                 zframe_destroy (self_p);
-            else
-                return -1;
         }
+        if (zsock_stats_used ())
+            zsock_stats_sent (dest, rc, (flags & ZFRAME_MORE) != 0);
+        if (rc == -1)
+            return -1;
     }
     return 0;
 }
 
 
+//  --------------------------------------------------------------------------
+//  Receive up to max frames from socket into the frames array. Waits up to
+//  timeout msecs for the first frame, or forever if timeout is -1, and then
+//  takes only the frames that are ready, without waiting. Resolves the
+//  socket once, and takes each frame's more indicator from the frame itself,
+//  so this is cheaper than calling zframe_recv for each frame. Does not stop
+//  at message boundaries; use zframe_more to find them. Returns the number
+//  of frames received, which is zero if the timeout expired or the call was
+//  interrupted. Caller owns the frames and must destroy them when done.
+
+int
+zframe_recv_batch (void *source, zframe_t **frames, size_t max, int timeout)
+{
+    assert (source);
+    assert (frames);
+    void *handle = zsock_resolve (source);
+
+    int flags = 0;
+    if (timeout >= 0) {
+        flags = ZMQ_DONTWAIT;
+        if (timeout > 0) {
+            zmq_pollitem_t item = { handle, 0, ZMQ_POLLIN, 0 };
+            if (zmq_poll (&item, 1, timeout) <= 0)
+                return 0;       //  Timed out or interrupted
+        }
+    }
+    size_t count;
+    for (count = 0; count < max; count++) {
+        zframe_t *self = zframe_new_empty ();
+        int rc = zmq_recvmsg (handle, &self->zmsg, flags);
+        if (rc < 0) {
+            zframe_destroy (&self);
+            break;              //  No more input, interrupted or terminated
+        }
+        self->more = zmq_msg_more (&self->zmsg);
+        if (zsock_stats_used ())
+            zsock_stats_received (source, rc, self->more != 0);
+#if defined (ZMQ_SERVER)
+        //  These are empty unless we're reading from a SERVER or DISH socket,
+        //  and reading them is cheaper than asking for the socket type
+        self->routing_id = zmq_msg_routing_id (&self->zmsg);
+#endif
+#if defined (ZMQ_DISH)
+        const char *group = zmq_msg_group (&self->zmsg);
+        if (group)
+            strcpy (self->group, group);
+#endif
+        frames [count] = self;
+        flags = ZMQ_DONTWAIT;
+    }
+    return (int) count;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Send count frames from the frames array to socket. Sends each frame with
+//  the more indicator set if zframe_more says so, so frames received with
+//  zframe_recv_batch go out as they came in. Resolves the socket once, and
+//  checks its type once. Destroys each frame after sending it, and nullifies
+//  its reference in the array. Keeps retrying if interrupted in the middle
+//  of a multipart sequence. Returns the number of frames sent; if that is
+//  less than count, the send failed and errno says why.
+
+int
+zframe_send_batch (void *dest, zframe_t **frames, size_t count)
+{
+    assert (dest);
+    assert (frames);
+    void *handle = zsock_resolve (dest);
+#if defined (ZMQ_SERVER)
+    bool server = zsock_type (dest) == ZMQ_SERVER;
+#endif
+#if defined (ZMQ_RADIO)
+    bool radio = zsock_type (dest) == ZMQ_RADIO;
+#endif
+    bool more = false;          //  Previous frame had more indicator
+    size_t index;
+    for (index = 0; index < count; index++) {
+        zframe_t *self = frames [index];
+        assert (zframe_is (self));
+#if defined (ZMQ_SERVER)
+        if (server)
+            zmq_msg_set_routing_id (&self->zmsg, self->routing_id);
+#endif
+#if defined (ZMQ_RADIO)
+        if (radio)
+            zmq_msg_set_group (&self->zmsg, self->group);
+#endif
+        int rc = zmq_sendmsg (handle, &self->zmsg, self->more? ZMQ_SNDMORE: 0);
+        if (zsock_stats_used ())
+            zsock_stats_sent (dest, rc, self->more != 0);
+        if (rc == -1) {
+            if (errno == EINTR && more) {
+                if (zsock_stats_used ())
+                    zsock_stats_retried (dest);
+                index--;
+                continue;
+            }
+            break;
+        }
+        more = self->more != 0;
+        zframe_destroy (&frames [index]);
+    }
+    return (int) index;
+}
+
+
 //  --------------------------------------------------------------------------
 //  Return size of frame.
 
@@ -303,6 +540,68 @@ zframe_dup (zframe_t *self)
 }
 
 
+//  --------------------------------------------------------------------------
+//  Create a new frame that shares the content of an existing frame, rather
+//  than copying it. The content is reference counted by libzmq, and freed
+//  when the last frame that shares it is destroyed. As any change to the
+//  content shows in every share, you must not modify the content of either
+//  frame afterwards. If frame is null, or memory was exhausted, returns null.
+
+zframe_t *
+zframe_share (zframe_t *self)
+{
+    if (self) {
+        assert (zframe_is (self));
+        zframe_t *share = zframe_new_empty ();
+        if (zmq_msg_copy (&share->zmsg, &self->zmsg)) {
+            zframe_destroy (&share);
+            return NULL;
+        }
+        return share;
+    }
+    else
+        return NULL;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return the number of frames taken from the thread pools, rather than
+//  allocated, by threads that have exited and by the calling thread. Returns
+//  zero if pooling is not available.
+
+uint64_t
+zframe_pool_hits (void)
+{
+#if defined (ZFRAME_POOL)
+    pthread_mutex_lock (&s_pool_mutex);
+    uint64_t hits = s_pool_hits + (s_pool? s_pool->hits: 0);
+    pthread_mutex_unlock (&s_pool_mutex);
+    return hits;
+#else
+    return 0;
+#endif
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return the number of frames allocated while pooling was on, because
+//  the thread pool was empty, by threads that have exited and by the calling
+//  thread. Returns zero if pooling is not available.
+
+uint64_t
+zframe_pool_misses (void)
+{
+#if defined (ZFRAME_POOL)
+    pthread_mutex_lock (&s_pool_mutex);
+    uint64_t misses = s_pool_misses + (s_pool? s_pool->misses: 0);
+    pthread_mutex_unlock (&s_pool_mutex);
+    return misses;
+#else
+    return 0;
+#endif
+}
+
+
 //  --------------------------------------------------------------------------
 //  Return frame data encoded as printable hex string, useful for 0MQ UUIDs.
 //  Caller must free string when finished with it.
@@ -586,11 +885,14 @@ zframe_recv_nowait (void *source)
 
     zframe_t *self = zframe_new (NULL, 0);
     assert (self);
-    if (zmq_recvmsg (handle, &self->zmsg, ZMQ_DONTWAIT) < 0) {
+    int rc = zmq_recvmsg (handle, &self->zmsg, ZMQ_DONTWAIT);
+    if (rc < 0) {
         zframe_destroy (&self);
         return NULL;            //  Interrupted or terminated
     }
     self->more = zsock_rcvmore (source);
+    if (zsock_stats_used ())
+        zsock_stats_received (source, rc, self->more != 0);
 #if defined (ZMQ_SERVER)
     //  Grab routing ID if we're reading from a SERVER socket (ZMQ 4.2 and later)
     if (zsock_type (source) == ZMQ_SERVER)
@@ -654,6 +956,88 @@ mem_destructor (void **hint) {
     strcpy ((char*)*hint, "world");
 }
 
+//  Runs in its own thread so its frame pool is freed when it exits
+
+static void
+s_pool_test_actor (zsock_t *pipe, void *args)
+{
+#if defined (ZFRAME_POOL)
+    //  Count this thread's pool only, as threads that exit add to the totals
+    s_pool_t *pool = s_pool_get ();
+    uint64_t hits = pool->hits;
+    uint64_t misses = pool->misses;
+#else
+    uint64_t hits = zframe_pool_hits ();
+#endif
+    zframe_t *frame = zframe_new ("Hello", 5);
+    assert (frame);
+    void *stale = frame;
+    zframe_destroy (&frame);
+    frame = zframe_new ("World", 5);
+    assert (frame);
+    assert (zframe_streq (frame, "World"));
+    zframe_destroy (&frame);
+#if defined (ZFRAME_POOL)
+    //  The second frame came from the pool, and the stale reference to the
+    //  first frame no longer looks like a frame
+    assert (pool->misses == misses + 1);
+    assert (pool->hits == hits + 1);
+    assert (!zframe_is (stale));
+    //  A frame destroyed without the pool is not there to reuse
+    frame = zframe_new ("Hello", 5);
+    zframe_destroy_unpooled (&frame);
+    assert (frame == NULL);
+    frame = zframe_new ("World", 5);
+    zframe_destroy (&frame);
+    assert (pool->misses == misses + 2);
+    assert (pool->hits == hits + 2);
+#else
+    assert (zframe_pool_hits () == hits);
+#endif
+    zsock_signal (pipe, 0);
+    char *command = zstr_recv (pipe);
+    zstr_free (&command);
+}
+
+//  Fills the pools up to their cap, and keeps its own pool until it ends
+
+static void
+s_pool_fill_actor (zsock_t *pipe, void *args)
+{
+    zframe_t *frames [3];
+    int frame_nbr;
+    for (frame_nbr = 0; frame_nbr < 3; frame_nbr++)
+        frames [frame_nbr] = zframe_new ("Hello", 5);
+    for (frame_nbr = 0; frame_nbr < 3; frame_nbr++)
+        zframe_destroy (&frames [frame_nbr]);
+    zsock_signal (pipe, 0);
+    char *command = zstr_recv (pipe);
+    zstr_free (&command);
+}
+
+//  Finds the pools full, so keeps nothing for reuse
+
+static void
+s_pool_full_actor (zsock_t *pipe, void *args)
+{
+#if defined (ZFRAME_POOL)
+    s_pool_t *pool = s_pool_get ();
+    uint64_t hits = pool->hits;
+    uint64_t misses = pool->misses;
+#endif
+    zframe_t *frame = zframe_new ("Hello", 5);
+    zframe_destroy (&frame);
+    frame = zframe_new ("World", 5);
+    zframe_destroy (&frame);
+#if defined (ZFRAME_POOL)
+    assert (pool->misses == misses + 2);
+    assert (pool->hits == hits);
+#endif
+    zsock_signal (pipe, 0);
+    char *command = zstr_recv (pipe);
+    zstr_free (&command);
+}
+
 
 void
 zframe_test (bool verbose)
@@ -697,6 +1081,43 @@ zframe_test (bool verbose)
     zframe_destroy (&copy);
     assert (!zframe_eq (frame, copy));
 
+    //  Sharing a frame does not copy its content, which lives until the
+    //  last share is destroyed
+    frame = zframe_new (NULL, 1024);
+    assert (frame);
+    memset (zframe_data (frame), 'A', 1024);
+    zframe_t *share = zframe_share (frame);
+    assert (share);
+    assert (zframe_data (share) == zframe_data (frame));
+    assert (zframe_eq (frame, share));
+    zframe_destroy (&frame);
+    assert (zframe_size (share) == 1024);
+    assert (zframe_data (share) [1023] == 'A');
+    zframe_destroy (&share);
+    assert (zframe_share (NULL) == NULL);
+
+    if (verbose) {
+        //  Compare the cost of fanning out a large frame
+        frame = zframe_new (NULL, 4 * 1024 * 1024);
+        assert (frame);
+        memset (zframe_data (frame), 'A', zframe_size (frame));
+        int64_t start = zclock_usecs ();
+        for (frame_nbr = 0; frame_nbr < 100; frame_nbr++) {
+            copy = zframe_dup (frame);
+            zframe_destroy (&copy);
+        }
+        int64_t dup_usecs = zclock_usecs () - start;
+        start = zclock_usecs ();
+        for (frame_nbr = 0; frame_nbr < 100; frame_nbr++) {
+            share = zframe_share (frame);
+            zframe_destroy (&share);
+        }
+        int64_t share_usecs = zclock_usecs () - start;
+        zsys_debug ("zframe: 4MB frame, dup %d usec, share %d usec",
+                    (int) (dup_usecs / 100), (int) (share_usecs / 100));
+        zframe_destroy (&frame);
+    }
+
     //  Test zframe_new_empty
     frame = zframe_new_empty ();
     assert (frame);
@@ -731,6 +1152,40 @@ zframe_test (bool verbose)
     }
     assert (frame_nbr == 10);
 
+    //  Send and receive frames in batches, over inproc, where all the frames
+    //  we send are ready at once
+    zsock_t *batch_output = zsock_new_pair ("@inproc://zframe.batch");
+    assert (batch_output);
+    zsock_t *batch_input = zsock_new_pair (">inproc://zframe.batch");
+    assert (batch_input);
+    zframe_t *batch [10];
+    for (frame_nbr = 0; frame_nbr < 6; frame_nbr++) {
+        batch [frame_nbr] = zframe_new ("Batch", 5);
+        assert (batch [frame_nbr]);
+        zframe_set_more (batch [frame_nbr], frame_nbr % 3 != 2);
+    }
+    rc = zframe_send_batch (batch_output, batch, 6);
+    assert (rc == 6);
+    assert (batch [0] == NULL && batch [5] == NULL);
+    rc = zframe_recv_batch (batch_input, batch, 4, -1);
+    assert (rc == 4);
+    assert (zframe_more (batch [0]) && zframe_more (batch [1]));
+    assert (!zframe_more (batch [2]) && zframe_more (batch [3]));
+    rc = zframe_recv_batch (batch_input, batch + 4, 6, 1000);
+    assert (rc == 2);
+    assert (zframe_more (batch [4]) && !zframe_more (batch [5]));
+    for (frame_nbr = 0; frame_nbr < 6; frame_nbr++) {
+        assert (zframe_streq (batch [frame_nbr], "Batch"));
+        zframe_destroy (&batch [frame_nbr]);
+    }
+    //  Nothing is waiting, so we get nothing back
+    rc = zframe_recv_batch (batch_input, batch, 10, 0);
+    assert (rc == 0);
+    rc = zframe_recv_batch (batch_input, batch, 10, 10);
+    assert (rc == 0);
+    zsock_destroy (&batch_input);
+    zsock_destroy (&batch_output);
+
 #if (ZMQ_VERSION >= ZMQ_MAKE_VERSION (4, 1, 0))
     // Test zframe_meta
     frame = zframe_new ("Hello", 5);
@@ -951,6 +1406,25 @@ zframe_test (bool verbose)
 
     zframe_destroy (&frame);
 
+    //  Test frame pooling. The pool size caps the frames that all threads
+    //  keep together; once one thread has filled it, other threads free
+    //  their frames. We test this first, as a thread that has ended may
+    //  not yet have given up its pool.
+    size_t pool_size = zsys_pool_size ();
+    zsys_set_pool_size (2);
+    zactor_t *actor = zactor_new (s_pool_fill_actor, NULL);
+    assert (actor);
+    zactor_t *other = zactor_new (s_pool_full_actor, NULL);
+    assert (other);
+    zactor_destroy (&other);
+    zactor_destroy (&actor);
+
+    zsys_set_pool_size (10);
+    actor = zactor_new (s_pool_test_actor, NULL);
+    assert (actor);
+    zactor_destroy (&actor);
+    zsys_set_pool_size (pool_size);
+
 #if defined (__WINDOWS__)
     zsys_shutdown();
 #endif
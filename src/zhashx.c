@@ -21,6 +21,15 @@
     linked list. The hash table size is increased slightly (up to 5 times
     before roughly doubling the size) when an overly long chain (between 1
     and 63 items depending on table size) is detected.
+
+    A table made with zhashx_new_flat stores its items in one flat array
+    instead, with open addressing. Each entry has a control byte that says
+    whether it is empty, deleted, or full, and for a full entry holds seven
+    bits of the key's hash. A lookup compares the control bytes of sixteen
+    entries at once (with SSE2, where available), and only compares keys
+    whose hash bits match. The array has a size that is a power of two, and
+    doubles when 7/8 full. This saves an allocation per item, and is faster
+    and smaller for large tables.
 @end
 */
 
@@ -36,6 +45,19 @@
 
 #include "zhash_primes.inc"
 
+//  Flat table parameters
+
+#define FLAT_GROUP      16    //  Control bytes compared at once
+#define FLAT_CAPACITY   16    //  Initial number of entries, a power of 2
+#define CTRL_EMPTY    -128    //  Entry was never used since last rehash
+#define CTRL_DELETED    -2    //  Entry was deleted
+//  A full entry has a control byte from 0 to 127, from its key's hash
+
+#if defined (__SSE2__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 2)
+#   include <emmintrin.h>
+#   define ZHASHX_SSE2
+#endif
+
 
 //  Hash item, used internally only
 
@@ -48,6 +70,25 @@ typedef struct _item_t {
 } item_t;
 
 
+//  Flat table entry, used internally only
+
+typedef struct {
+    const void *key;            //  Item's original key
+    void *value;                //  Opaque item value
+    zhashx_free_fn *free_fn;    //  Value free function if any
+} entry_t;
+
+
+//  Iterator over items in either kind of table, used internally only
+
+typedef struct {
+    size_t index;               //  Next bucket or entry to look at
+    item_t *item;               //  Next item in bucket, if chained
+    const void *key;            //  Key of item we just passed
+    void *value;                //  Value of item we just passed
+} walk_t;
+
+
 //  ---------------------------------------------------------------------
 //  Structure of our class
 
@@ -57,9 +98,13 @@ struct _zhashx_t {
     uint chain_limit;           //  Current limit on chain length
     item_t **items;             //  Array of items
     size_t cached_index;        //  Avoids duplicate hash calculations
-    size_t cursor_index;        //  For first/next iteration
-    item_t *cursor_item;        //  For first/next iteration
+    walk_t cursor;              //  For first/next iteration
     const void *cursor_key;     //  After first/next call, points to key
+    //  Flat tables have no items, and keep their entries here
+    entry_t *entries;           //  Array of entries
+    int8_t *controls;           //  Control byte for each entry
+    size_t capacity;            //  Number of entries, a power of 2
+    size_t growth_left;         //  Empty entries we may fill before rehash
     zlistx_t *comments;         //  File comments, if any
     time_t modified;            //  Set during zhashx_load
     char *filename;             //  Set during zhashx_load
@@ -78,6 +123,12 @@ struct _zhashx_t {
 static item_t *s_item_lookup (zhashx_t *self, const void *key);
 static item_t *s_item_insert (zhashx_t *self, const void *key, void *value);
 static void s_item_destroy (zhashx_t *self, item_t *item, bool hard);
+static void s_flat_alloc (zhashx_t *self, size_t capacity);
+static entry_t *s_entry_lookup (zhashx_t *self, const void *key);
+static entry_t *s_entry_claim (zhashx_t *self);
+static void s_entry_free (zhashx_t *self, entry_t *entry);
+static void s_entry_destroy (zhashx_t *self, entry_t *entry, bool hard);
+static bool s_walk_next (zhashx_t *self, walk_t *walk);
 
 
 //  --------------------------------------------------------------------------
@@ -116,12 +167,43 @@ zhashx_new (void)
 }
 
 
+//  --------------------------------------------------------------------------
+//  Create a new, empty hash container that keeps its items in one flat
+//  array, using open addressing, instead of chaining them in buckets. It
+//  has the same methods, callbacks and cursor semantics as other hash
+//  containers, and uses less memory and fewer cache misses on large tables.
+
+zhashx_t *
+zhashx_new_flat (void)
+{
+    zhashx_t *self = (zhashx_t *) zmalloc (sizeof (zhashx_t));
+    assert (self);
+    s_flat_alloc (self, FLAT_CAPACITY);
+    self->hasher = s_bernstein_hash;
+    self->key_destructor = (zhashx_destructor_fn *) zstr_free;
+    self->key_duplicator = (zhashx_duplicator_fn *) strdup;
+    self->key_comparator = (zhashx_comparator_fn *) strcmp;
+
+    return self;
+}
+
+
 //  --------------------------------------------------------------------------
 //  Purge all items from a hash table
 
 static void
 s_purge (zhashx_t *self)
 {
+    if (self->entries) {
+        size_t index;
+        for (index = 0; index < self->capacity; index++)
+            if (self->controls [index] >= 0)
+                s_entry_free (self, &self->entries [index]);
+        memset (self->controls, CTRL_EMPTY, self->capacity + FLAT_GROUP);
+        self->size = 0;
+        self->growth_left = self->capacity - self->capacity / 8;
+        return;
+    }
     uint index;
     size_t limit = primes [self->prime_index];
 
@@ -150,6 +232,11 @@ zhashx_destroy (zhashx_t **self_p)
             s_purge (self);
             freen (self->items);
         }
+        if (self->entries) {
+            s_purge (self);
+            freen (self->entries);
+            freen (self->controls);
+        }
         zlistx_destroy (&self->comments);
         freen (self->filename);
         freen (self);
@@ -184,7 +271,7 @@ s_item_destroy (zhashx_t *self, item_t *item, bool hard)
         if (item->free_fn)
             (item->free_fn)(item->value);
 
-        self->cursor_item = NULL;
+        self->cursor.item = NULL;
         self->cursor_key = NULL;
 
         if (self->key_destructor)
@@ -233,6 +320,281 @@ s_zhashx_rehash (zhashx_t *self, uint new_prime_index)
 }
 
 
+//  --------------------------------------------------------------------------
+//  Flat table engine: hash a key for a flat table. We take the position
+//  from the high bits and the control byte from the low bits, so spread
+//  the bits of the key hash over both.
+
+static size_t
+s_flat_hash (zhashx_t *self, const void *key)
+{
+    uint64_t hash = (uint64_t) self->hasher (key) * 0x9E3779B97F4A7C15ULL;
+    return (size_t) (hash ^ (hash >> 32));
+}
+
+//  Return index of lowest bit set in a non-zero group mask
+
+static int
+s_first_bit (uint32_t mask)
+{
+#if defined (__GNUC__)
+    return __builtin_ctz (mask);
+#else
+    int bit = 0;
+    while ((mask & 1) == 0) {
+        mask >>= 1;
+        bit++;
+    }
+    return bit;
+#endif
+}
+
+//  Return number of clear bits above the highest bit set in a non-zero
+//  group mask
+
+static int
+s_leading_zeros (uint32_t mask)
+{
+    int zeros = 0;
+    while ((mask & (1 << (FLAT_GROUP - 1))) == 0) {
+        mask <<= 1;
+        zeros++;
+    }
+    return zeros;
+}
+
+//  Return a mask of the control bytes in a group that equal a value
+
+static uint32_t
+s_group_match (const int8_t *group, int8_t control)
+{
+#if defined (ZHASHX_SSE2)
+    __m128i controls = _mm_loadu_si128 ((const __m128i *) group);
+    return (uint32_t) _mm_movemask_epi8 (
+        _mm_cmpeq_epi8 (controls, _mm_set1_epi8 (control)));
+#else
+    uint32_t mask = 0;
+    int index;
+    for (index = 0; index < FLAT_GROUP; index++)
+        if (group [index] == control)
+            mask |= 1 << index;
+    return mask;
+#endif
+}
+
+//  Return a mask of the entries in a group that are empty or deleted,
+//  which are those with the top bit set
+
+static uint32_t
+s_group_free (const int8_t *group)
+{
+#if defined (ZHASHX_SSE2)
+    return (uint32_t) _mm_movemask_epi8 (
+        _mm_loadu_si128 ((const __m128i *) group));
+#else
+    uint32_t mask = 0;
+    int index;
+    for (index = 0; index < FLAT_GROUP; index++)
+        if (group [index] < 0)
+            mask |= 1 << index;
+    return mask;
+#endif
+}
+
+//  Set the control byte of an entry. The first group of control bytes is
+//  copied after the last, so a group that starts near the end of the
+//  table can be read in one go.
+
+static void
+s_control_set (zhashx_t *self, size_t index, int8_t control)
+{
+    self->controls [index] = control;
+    if (index < FLAT_GROUP)
+        self->controls [self->capacity + index] = control;
+}
+
+//  Allocate empty entries and control bytes for a flat table
+
+static void
+s_flat_alloc (zhashx_t *self, size_t capacity)
+{
+    self->entries = (entry_t *) zmalloc (sizeof (entry_t) * capacity);
+    assert (self->entries);
+    self->controls = (int8_t *) zmalloc (capacity + FLAT_GROUP);
+    assert (self->controls);
+    memset (self->controls, CTRL_EMPTY, capacity + FLAT_GROUP);
+    self->capacity = capacity;
+    self->growth_left = capacity - capacity / 8;
+}
+
+//  Return the first empty or deleted entry on the probe path of a hash.
+//  We probe group by group, skipping one more group each time; as the
+//  capacity is a power of 2, this reaches every group.
+
+static size_t
+s_entry_free_index (zhashx_t *self, size_t hash)
+{
+    size_t mask = self->capacity - 1;
+    size_t index = (hash >> 7) & mask;
+    size_t step = 0;
+    while (true) {
+        uint32_t free_mask = s_group_free (self->controls + index);
+        if (free_mask)
+            return (index + s_first_bit (free_mask)) & mask;
+        step += FLAT_GROUP;
+        index = (index + step) & mask;
+    }
+}
+
+//  Rebuild a flat table without its deleted entries, doubling its size if
+//  it is at least half full
+
+static void
+s_flat_rehash (zhashx_t *self)
+{
+    entry_t *entries = self->entries;
+    int8_t *controls = self->controls;
+    size_t capacity = self->capacity;
+    if (self->size >= (capacity - capacity / 8) / 2)
+        s_flat_alloc (self, capacity * 2);
+    else
+        s_flat_alloc (self, capacity);
+
+    size_t index;
+    for (index = 0; index < capacity; index++) {
+        if (controls [index] >= 0) {
+            size_t hash = s_flat_hash (self, entries [index].key);
+            size_t new_index = s_entry_free_index (self, hash);
+            s_control_set (self, new_index, (int8_t) (hash & 0x7F));
+            self->entries [new_index] = entries [index];
+        }
+    }
+    self->growth_left -= self->size;
+    freen (entries);
+    freen (controls);
+}
+
+//  Lookup entry in flat table, returns entry or NULL. Leaves the key's
+//  hash in self->cached_index.
+
+static entry_t *
+s_entry_lookup (zhashx_t *self, const void *key)
+{
+    size_t hash = s_flat_hash (self, key);
+    self->cached_index = hash;
+    int8_t control = (int8_t) (hash & 0x7F);
+    size_t mask = self->capacity - 1;
+    size_t index = (hash >> 7) & mask;
+    size_t step = 0;
+    while (true) {
+        const int8_t *group = self->controls + index;
+        uint32_t match = s_group_match (group, control);
+        while (match) {
+            entry_t *entry = &self->entries [(index + s_first_bit (match)) & mask];
+            if ((self->key_comparator)(entry->key, key) == 0)
+                return entry;
+            match &= match - 1;
+        }
+        //  An empty entry ends the probe path, as no insert went past it
+        if (s_group_match (group, CTRL_EMPTY))
+            return NULL;
+        step += FLAT_GROUP;
+        index = (index + step) & mask;
+    }
+}
+
+//  Claim a free entry for the key whose hash s_entry_lookup left in
+//  self->cached_index, rehashing first if the table is too full. Returns
+//  the entry, which the caller fills in.
+
+static entry_t *
+s_entry_claim (zhashx_t *self)
+{
+    size_t hash = self->cached_index;
+    size_t index = s_entry_free_index (self, hash);
+    if (self->growth_left == 0 && self->controls [index] == CTRL_EMPTY) {
+        s_flat_rehash (self);
+        index = s_entry_free_index (self, hash);
+    }
+    if (self->controls [index] == CTRL_EMPTY)
+        self->growth_left--;
+    s_control_set (self, index, (int8_t) (hash & 0x7F));
+    self->size++;
+    return &self->entries [index];
+}
+
+//  Destroy the value and key of an entry
+
+static void
+s_entry_free (zhashx_t *self, entry_t *entry)
+{
+    if (self->destructor)
+        (self->destructor)(&entry->value);
+    else
+    if (entry->free_fn)
+        (entry->free_fn)(entry->value);
+
+    self->cursor_key = NULL;
+
+    if (self->key_destructor)
+        (self->key_destructor)((void **) &entry->key);
+}
+
+//  Remove entry from flat table, and destroy its value and key if hard
+
+static void
+s_entry_destroy (zhashx_t *self, entry_t *entry, bool hard)
+{
+    //  If there are fewer than a group of non-empty entries around this
+    //  one, no probe path can have passed over it, and it can be empty
+    //  again. Otherwise it must stay in the way, marked as deleted.
+    size_t mask = self->capacity - 1;
+    size_t index = entry - self->entries;
+    uint32_t empty_after = s_group_match (self->controls + index, CTRL_EMPTY);
+    uint32_t empty_before = s_group_match (
+        self->controls + ((index - FLAT_GROUP) & mask), CTRL_EMPTY);
+    if (empty_before && empty_after
+    &&  s_first_bit (empty_after) + s_leading_zeros (empty_before) < FLAT_GROUP) {
+        s_control_set (self, index, CTRL_EMPTY);
+        self->growth_left++;
+    }
+    else
+        s_control_set (self, index, CTRL_DELETED);
+    self->size--;
+    if (hard)
+        s_entry_free (self, entry);
+}
+
+//  Walk to the next item in either kind of table, in table order. Start
+//  the walk with a zero index and no item. Returns false at the end of
+//  the table.
+
+static bool
+s_walk_next (zhashx_t *self, walk_t *walk)
+{
+    if (self->entries) {
+        while (walk->index < self->capacity && self->controls [walk->index] < 0)
+            walk->index++;
+        if (walk->index >= self->capacity)
+            return false;
+        entry_t *entry = &self->entries [walk->index++];
+        walk->key = entry->key;
+        walk->value = entry->value;
+        return true;
+    }
+    size_t limit = primes [self->prime_index];
+    while (walk->item == NULL) {
+        if (walk->index >= limit)
+            return false;
+        walk->item = self->items [walk->index++];
+    }
+    walk->key = walk->item->key;
+    walk->value = walk->item->value;
+    walk->item = walk->item->next;
+    return true;
+}
+
+
 //  --------------------------------------------------------------------------
 //  Insert item into hash table with specified key and item. Returns 0 on
 //  success. If the key is already present, returns -1 and leaves existing
@@ -246,6 +608,27 @@ zhashx_insert (zhashx_t *self, const void *key, void *value)
     assert (self);
     assert (key);
 
+    if (self->entries) {
+        if (s_entry_lookup (self, key))
+            return -1;          //  Signal duplicate insertion
+        entry_t *entry = s_entry_claim (self);
+
+        //  If necessary, take duplicate of item key and value
+        if (self->key_duplicator)
+            entry->key = (self->key_duplicator)((void *) key);
+        else
+            entry->key = key;
+        if (self->duplicator)
+            entry->value = (self->duplicator)(value);
+        else
+            entry->value = value;
+        entry->free_fn = NULL;
+
+        self->cursor.index = entry - self->entries;
+        self->cursor.item = NULL;
+        self->cursor_key = entry->key;
+        return 0;
+    }
     //  If we're exceeding the load factor of the hash table,
     //  resize it according to the growth factor
     size_t limit = primes [self->prime_index];
@@ -293,7 +676,8 @@ s_item_insert (zhashx_t *self, const void *key, void *value)
         item->next = self->items [self->cached_index];
         self->items [self->cached_index] = item;
         self->size++;
-        self->cursor_item = item;
+        self->cursor.index = item->index + 1;
+        self->cursor.item = item;
         self->cursor_key = item->key;
     }
     else
@@ -348,6 +732,25 @@ zhashx_update (zhashx_t *self, const void *key, void *value)
     assert (self);
     assert (key);
 
+    if (self->entries) {
+        entry_t *entry = s_entry_lookup (self, key);
+        if (entry) {
+            if (self->destructor)
+                (self->destructor)(&entry->value);
+            else
+            if (entry->free_fn)
+                (entry->free_fn)(entry->value);
+
+            //  If necessary, take duplicate of item value
+            if (self->duplicator)
+                entry->value = (self->duplicator)(value);
+            else
+                entry->value = value;
+        }
+        else
+            zhashx_insert (self, key, value);
+        return;
+    }
     item_t *item = s_item_lookup (self, key);
     if (item) {
         if (self->destructor)
@@ -377,6 +780,12 @@ zhashx_delete (zhashx_t *self, const void *key)
     assert (self);
     assert (key);
 
+    if (self->entries) {
+        entry_t *entry = s_entry_lookup (self, key);
+        if (entry)
+            s_entry_destroy (self, entry, true);
+        return;
+    }
     item_t *item = s_item_lookup (self, key);
     if (item)
         s_item_destroy (self, item, true);
@@ -393,6 +802,15 @@ zhashx_purge (zhashx_t *self)
     assert (self);
     s_purge (self);
 
+    if (self->entries) {
+        if (self->capacity > FLAT_CAPACITY) {
+            // Shrink flat table
+            freen (self->entries);
+            freen (self->controls);
+            s_flat_alloc (self, FLAT_CAPACITY);
+        }
+    }
+    else
     if (self->prime_index > INITIAL_PRIME) {
         // Try to shrink hash table
         size_t limit = primes [INITIAL_PRIME];
@@ -416,9 +834,21 @@ zhashx_lookup (zhashx_t *self, const void *key)
     assert (self);
     assert (key);
 
+    if (self->entries) {
+        entry_t *entry = s_entry_lookup (self, key);
+        if (entry) {
+            self->cursor.index = entry - self->entries;
+            self->cursor.item = NULL;
+            self->cursor_key = entry->key;
+            return entry->value;
+        }
+        else
+            return NULL;
+    }
     item_t *item = s_item_lookup (self, key);
     if (item) {
-        self->cursor_item = item;
+        self->cursor.index = item->index + 1;
+        self->cursor.item = item;
         self->cursor_key = item->key;
         return item->value;
     }
@@ -435,6 +865,28 @@ zhashx_lookup (zhashx_t *self, const void *key)
 int
 zhashx_rename (zhashx_t *self, const void *old_key, const void *new_key)
 {
+    if (self->entries) {
+        entry_t *old_entry = s_entry_lookup (self, old_key);
+        if (!old_entry || s_entry_lookup (self, new_key))
+            return -1;
+        //  Move item to an entry for its new key, which may rehash
+        entry_t item = *old_entry;
+        s_entry_destroy (self, old_entry, false);
+        if (self->key_destructor)
+            (self->key_destructor)((void **) &item.key);
+
+        entry_t *new_entry = s_entry_claim (self);
+        if (self->key_duplicator)
+            new_entry->key = (self->key_duplicator)(new_key);
+        else
+            new_entry->key = new_key;
+        new_entry->value = item.value;
+        new_entry->free_fn = item.free_fn;
+        self->cursor.index = new_entry - self->entries;
+        self->cursor.item = NULL;
+        self->cursor_key = new_entry->key;
+        return 0;
+    }
     item_t *old_item = s_item_lookup (self, old_key);
     item_t *new_item = s_item_lookup (self, new_key);
     if (old_item && !new_item) {
@@ -451,7 +903,8 @@ zhashx_rename (zhashx_t *self, const void *old_key, const void *new_key)
         old_item->next = self->items [self->cached_index];
         self->items [self->cached_index] = old_item;
         self->size++;
-        self->cursor_item = old_item;
+        self->cursor.index = old_item->index + 1;
+        self->cursor.item = old_item;
         self->cursor_key = old_item->key;
         return 0;
     }
@@ -473,6 +926,15 @@ zhashx_freefn (zhashx_t *self, const void *key, zhashx_free_fn free_fn)
     assert (self);
     assert (key);
 
+    if (self->entries) {
+        entry_t *entry = s_entry_lookup (self, key);
+        if (entry) {
+            entry->free_fn = free_fn;
+            return entry->value;
+        }
+        else
+            return NULL;
+    }
     item_t *item = s_item_lookup (self, key);
     if (item) {
         item->free_fn = free_fn;
@@ -509,16 +971,11 @@ zhashx_keys (zhashx_t *self)
     zlistx_set_destructor (keys, self->key_destructor);
     zlistx_set_duplicator (keys, self->key_duplicator);
 
-    uint index;
-    size_t limit = primes [self->prime_index];
-    for (index = 0; index < limit; index++) {
-        item_t *item = self->items [index];
-        while (item) {
-            if (zlistx_add_end (keys, (void *) item->key) == NULL) {
-                zlistx_destroy (&keys);
-                return NULL;
-            }
-            item = item->next;
+    walk_t walk = { 0, NULL, NULL, NULL };
+    while (s_walk_next (self, &walk)) {
+        if (zlistx_add_end (keys, (void *) walk.key) == NULL) {
+            zlistx_destroy (&keys);
+            return NULL;
         }
     }
     return keys;
@@ -540,18 +997,13 @@ zhashx_values (zhashx_t *self)
     zlistx_set_destructor (values, self->destructor);
     zlistx_set_duplicator (values, self->duplicator);
 
-    uint index;
-    size_t limit = primes [self->prime_index];
-    for (index = 0; index < limit; index++) {
-        item_t *item = self->items [index];
-        while (item) {
-            if (zlistx_add_end (values, (void *) item->value) == NULL) {
-                zlistx_destroy (&values);
-                return NULL;
-            }
-            item = item->next;
+    walk_t walk = { 0, NULL, NULL, NULL };
+    while (s_walk_next (self, &walk)) {
+        if (zlistx_add_end (values, walk.value) == NULL) {
+            zlistx_destroy (&values);
+            return NULL;
         }
-     }
+    }
     return values;
 }
 
@@ -566,9 +1018,9 @@ void *
 zhashx_first (zhashx_t *self)
 {
     assert (self);
-    //  Point to before or at first item
-    self->cursor_index = 0;
-    self->cursor_item = self->items [self->cursor_index];
+    //  Point to before first item
+    self->cursor.index = 0;
+    self->cursor.item = NULL;
     //  Now scan forwards to find it, leave cursor after item
     return zhashx_next (self);
 }
@@ -585,23 +1037,11 @@ void *
 zhashx_next (zhashx_t *self)
 {
     assert (self);
-    //  Scan forward from cursor until we find an item
-    size_t limit = primes [self->prime_index];
-    while (self->cursor_item == NULL) {
-        if (self->cursor_index < limit - 1)
-            self->cursor_index++;
-        else
-            return NULL;        //  At end of table
-
-        //  Get first item in next bucket
-        self->cursor_item = self->items [self->cursor_index];
-    }
-    //  We have an item, so return it, and bump past it
-    assert (self->cursor_item);
-    item_t *item = self->cursor_item;
-    self->cursor_key = item->key;
-    self->cursor_item = self->cursor_item->next;
-    return item->value;
+    //  Scan forward from cursor until we find an item, and bump past it
+    if (!s_walk_next (self, &self->cursor))
+        return NULL;            //  At end of table
+    self->cursor_key = self->cursor.key;
+    return self->cursor.value;
 }
 
 
@@ -669,15 +1109,9 @@ zhashx_save (zhashx_t *self, const char *filename)
         }
         fprintf (handle, "\n");
     }
-    uint index;
-    size_t limit = primes [self->prime_index];
-    for (index = 0; index < limit; index++) {
-        item_t *item = self->items [index];
-        while (item) {
-            fprintf (handle, "%s=%s\n", (char *) item->key, (char *) item->value);
-            item = item->next;
-        }
-    }
+    walk_t walk = { 0, NULL, NULL, NULL };
+    while (s_walk_next (self, &walk))
+        fprintf (handle, "%s=%s\n", (char *) walk.key, (char *) walk.value);
     fclose (handle);
     return 0;
 }
@@ -747,18 +1181,8 @@ zhashx_refresh (zhashx_t *self)
     if (self->filename) {
         if (zsys_file_modified (self->filename) > self->modified
         &&  zsys_file_stable (self->filename)) {
-            //  Empty the hash table; code is copied from zhashx_destroy
-            uint index;
-            size_t limit = primes [self->prime_index];
-            for (index = 0; index < limit; index++) {
-                //  Destroy all items in this hash bucket
-                item_t *cur_item = self->items [index];
-                while (cur_item) {
-                    item_t *next_item = cur_item->next;
-                    s_item_destroy (self, cur_item, true);
-                    cur_item = next_item;
-                }
-            }
+            //  Empty the hash table
+            s_purge (self);
             zhashx_load (self, self->filename);
         }
     }
@@ -778,25 +1202,20 @@ zhashx_pack_own (zhashx_t *self, zhashx_serializer_fn serializer)
 
     //  First, calculate packed data size
     size_t frame_size = 4;      //  Dictionary size, number-4
-    uint index;
     uint vindex = 0;
-    size_t limit = primes [self->prime_index];
     char **values = (char **) zmalloc (self->size * sizeof (char*));
-    for (index = 0; index < limit; index++) {
-        item_t *item = self->items [index];
-        while (item) {
-            //  We store key as short string
-            frame_size += 1 + strlen ((char *) item->key);
-            //  We store value as long string
-            if (serializer != NULL)
-                values [vindex] = serializer (item->value);
-            else
-                values [vindex] = (char *) item->value;
+    walk_t walk = { 0, NULL, NULL, NULL };
+    while (s_walk_next (self, &walk)) {
+        //  We store key as short string
+        frame_size += 1 + strlen ((char *) walk.key);
+        //  We store value as long string
+        if (serializer != NULL)
+            values [vindex] = serializer (walk.value);
+        else
+            values [vindex] = (char *) walk.value;
 
-            frame_size += 4 + strlen ((char *) values [vindex]);
-            item = item->next;
-            vindex++;
-        }
+        frame_size += 4 + strlen ((char *) values [vindex]);
+        vindex++;
     }
     //  Now serialize items into the frame
     zframe_t *frame = zframe_new (NULL, frame_size);
@@ -810,30 +1229,28 @@ zhashx_pack_own (zhashx_t *self, zhashx_serializer_fn serializer)
     *(uint32_t *) needle = htonl ((u_long) self->size);
     needle += 4;
     vindex = 0;
-    for (index = 0; index < limit; index++) {
-        item_t *item = self->items [index];
-        while (item) {
-            //  Store key as string
-            size_t length = strlen ((char *) item->key);
-            *needle++ = (byte) length;
-            memcpy (needle, item->key, length);
-            needle += length;
-
-            //  Store value as longstr
-            length = strlen (values [vindex]);
-            uint32_t serialize = htonl ((u_long) length);
-            memcpy (needle, &serialize, 4);
-            needle += 4;
-            memcpy (needle, values [vindex], length);
-            needle += length;
-            item = item->next;
-
-            //  Destroy serialized value
-            if (serializer != NULL)
-                zstr_free (&values [vindex]);
-
-            vindex++;
-        }
+    walk.index = 0;
+    walk.item = NULL;
+    while (s_walk_next (self, &walk)) {
+        //  Store key as string
+        size_t length = strlen ((char *) walk.key);
+        *needle++ = (byte) length;
+        memcpy (needle, walk.key, length);
+        needle += length;
+
+        //  Store value as longstr
+        length = strlen (values [vindex]);
+        uint32_t serialize = htonl ((u_long) length);
+        memcpy (needle, &serialize, 4);
+        needle += 4;
+        memcpy (needle, values [vindex], length);
+        needle += length;
+
+        //  Destroy serialized value
+        if (serializer != NULL)
+            zstr_free (&values [vindex]);
+
+        vindex++;
     }
     freen (values);
     return frame;
@@ -963,7 +1380,7 @@ zhashx_dup (zhashx_t *self)
     if (!self)
         return NULL;
 
-    zhashx_t *copy = zhashx_new ();
+    zhashx_t *copy = self->entries? zhashx_new_flat (): zhashx_new ();
     if (copy) {
         copy->destructor = self->destructor;
         copy->duplicator = self->duplicator;
@@ -971,16 +1388,11 @@ zhashx_dup (zhashx_t *self)
         copy->key_destructor = self->key_destructor;
         copy->key_comparator = self->key_comparator;
         copy->hasher = self->hasher;
-        uint index;
-        size_t limit = primes [self->prime_index];
-        for (index = 0; index < limit; index++) {
-            item_t *item = self->items [index];
-            while (item) {
-                if (zhashx_insert (copy, item->key, item->value)) {
-                    zhashx_destroy (&copy);
-                    break;
-                }
-                item = item->next;
+        walk_t walk = { 0, NULL, NULL, NULL };
+        while (s_walk_next (self, &walk)) {
+            if (zhashx_insert (copy, walk.key, walk.value)) {
+                zhashx_destroy (&copy);
+                break;
             }
         }
     }
@@ -1074,20 +1486,15 @@ zhashx_dup_v2 (zhashx_t *self)
     if (!self)
         return NULL;
 
-    zhashx_t *copy = zhashx_new ();
+    zhashx_t *copy = self->entries? zhashx_new_flat (): zhashx_new ();
     if (copy) {
         zhashx_set_destructor (copy, (zhashx_destructor_fn *) zstr_free);
         zhashx_set_duplicator (copy, (zhashx_duplicator_fn *) strdup);
-        uint index;
-        size_t limit = primes [self->prime_index];
-        for (index = 0; index < limit; index++) {
-            item_t *item = self->items [index];
-            while (item) {
-                if (zhashx_insert (copy, item->key, item->value)) {
-                    zhashx_destroy (&copy);
-                    break;
-                }
-                item = item->next;
+        walk_t walk = { 0, NULL, NULL, NULL };
+        while (s_walk_next (self, &walk)) {
+            if (zhashx_insert (copy, walk.key, walk.value)) {
+                zhashx_destroy (&copy);
+                break;
             }
         }
     }
@@ -1123,6 +1530,105 @@ s_test_destroy_int (void **item)
     int *int_item = (int *) *item;
     freen (int_item);
 }
+
+//  Checks that the cursor follows lookup, insert, rename, and first/next
+//  in the same way, whichever engine the table has
+
+static void
+s_test_cursor (zhashx_t *hash)
+{
+    zhashx_insert (hash, "a", "A");
+    zhashx_insert (hash, "b", "B");
+    zhashx_insert (hash, "c", "C");
+
+    //  These methods put the cursor on their item, so next returns it
+    assert (streq ((char *) zhashx_lookup (hash, "b"), "B"));
+    assert (streq ((char *) zhashx_next (hash), "B"));
+    assert (streq ((const char *) zhashx_cursor (hash), "b"));
+    assert (zhashx_rename (hash, "b", "bb") == 0);
+    assert (streq ((char *) zhashx_next (hash), "B"));
+    assert (streq ((const char *) zhashx_cursor (hash), "bb"));
+    assert (zhashx_insert (hash, "d", "D") == 0);
+    assert (streq ((char *) zhashx_next (hash), "D"));
+    assert (streq ((const char *) zhashx_cursor (hash), "d"));
+
+    //  A lookup during a walk returns the item again, then the walk goes
+    //  on from there, so each item is visited once
+    size_t visited = 0;
+    char *item = (char *) zhashx_first (hash);
+    while (item) {
+        const char *key = (const char *) zhashx_cursor (hash);
+        assert (zhashx_lookup (hash, key) == item);
+        assert (zhashx_next (hash) == item);
+        visited++;
+        item = (char *) zhashx_next (hash);
+    }
+    assert (visited == 4);
+    zhashx_purge (hash);
+}
+
+//  Puts every key in the same place, to test long probe paths
+
+static size_t
+s_test_hash_constant (const void *key)
+{
+    return 42;
+}
+
+//  Inserts, looks up, and deletes keys in a table, and reports timings
+
+static void
+s_test_benchmark (const char *name, zhashx_t *hash, char **keys, char **misses,
+                  int count)
+{
+    //  Measure the table, not the copying of keys
+    zhashx_set_key_duplicator (hash, NULL);
+    zhashx_set_key_destructor (hash, NULL);
+
+    int64_t start = zclock_usecs ();
+    int index;
+    for (index = 0; index < count; index++)
+        zhashx_insert (hash, keys [index], keys [index]);
+    int64_t inserted = zclock_usecs ();
+    for (index = 0; index < count; index++) {
+        void *value = zhashx_lookup (hash, keys [index]);
+        assert (value == keys [index]);
+    }
+    int64_t found = zclock_usecs ();
+    for (index = 0; index < count; index++) {
+        void *value = zhashx_lookup (hash, misses [index]);
+        assert (value == NULL);
+    }
+    int64_t missed = zclock_usecs ();
+    size_t walked = 0;
+    void *value = zhashx_first (hash);
+    while (value) {
+        walked++;
+        value = zhashx_next (hash);
+    }
+    assert (walked == (size_t) count);
+    int64_t iterated = zclock_usecs ();
+
+    //  Table memory, without keys and allocator overhead
+    size_t memory = hash->entries
+        ? hash->capacity * (sizeof (entry_t) + 1)
+        : primes [hash->prime_index] * sizeof (item_t *) + hash->size * sizeof (item_t);
+
+    for (index = 0; index < count; index++)
+        zhashx_delete (hash, keys [index]);
+    assert (zhashx_size (hash) == 0);
+    int64_t deleted = zclock_usecs ();
+
+    zsys_info ("zhashx: %s %d keys: insert %.0f, hit %.0f, miss %.0f, "
+        "next %.0f, delete %.0f ns; %.1f bytes per key",
+        name, count,
+        (double) (inserted - start) * 1000 / count,
+        (double) (found - inserted) * 1000 / count,
+        (double) (missed - found) * 1000 / count,
+        (double) (iterated - missed) * 1000 / count,
+        (double) (deleted - iterated) * 1000 / count,
+        (double) memory / count);
+}
 #endif // CZMQ_BUILD_DRAFT_API
 
 void
@@ -1368,6 +1874,165 @@ zhashx_test (bool verbose)
     zhashx_purge (hash);
     zhashx_destroy (&hash);
 
+#ifdef CZMQ_BUILD_DRAFT_API
+    //  A flat table works just like a chained one
+    hash = zhashx_new_flat ();
+    assert (hash);
+    assert (zhashx_size (hash) == 0);
+    assert (zhashx_first (hash) == NULL);
+    assert (zhashx_cursor (hash) == NULL);
+    rc = zhashx_insert (hash, "DEADBEEF", "dead beef");
+    assert (rc == 0);
+    assert (streq ((char *) zhashx_cursor (hash), "DEADBEEF"));
+    rc = zhashx_insert (hash, "ABADCAFE", "a bad cafe");
+    assert (rc == 0);
+    rc = zhashx_insert (hash, "DEADBEEF", "foo");
+    assert (rc == -1);
+    assert (streq ((char *) zhashx_lookup (hash, "DEADBEEF"), "dead beef"));
+    assert (streq ((char *) zhashx_cursor (hash), "DEADBEEF"));
+    assert (zhashx_lookup (hash, "foo") == NULL);
+    rc = zhashx_rename (hash, "DEADBEEF", "LIVEBEEF");
+    assert (rc == 0);
+    assert (streq ((char *) zhashx_cursor (hash), "LIVEBEEF"));
+    assert (zhashx_lookup (hash, "DEADBEEF") == NULL);
+    assert (streq ((char *) zhashx_lookup (hash, "LIVEBEEF"), "dead beef"));
+    assert (zhashx_rename (hash, "LIVEBEEF", "ABADCAFE") == -1);
+    zhashx_update (hash, "ABADCAFE", "a good cafe");
+    assert (streq ((char *) zhashx_lookup (hash, "ABADCAFE"), "a good cafe"));
+    assert (zhashx_size (hash) == 2);
+
+    copy = zhashx_dup (hash);
+    assert (copy->entries);
+    assert (zhashx_size (copy) == 2);
+    assert (streq ((char *) zhashx_lookup (copy, "LIVEBEEF"), "dead beef"));
+    zhashx_destroy (&copy);
+    frame = zhashx_pack (hash);
+    copy = zhashx_unpack (frame);
+    zframe_destroy (&frame);
+    assert (zhashx_size (copy) == 2);
+    assert (streq ((char *) zhashx_lookup (copy, "ABADCAFE"), "a good cafe"));
+    zhashx_destroy (&copy);
+    keys = zhashx_keys (hash);
+    assert (zlistx_size (keys) == 2);
+    zlistx_destroy (&keys);
+
+    zhashx_destroy (&hash);
+
+    //  The cursor behaves the same in both kinds of table
+    hash = zhashx_new ();
+    s_test_cursor (hash);
+    zhashx_destroy (&hash);
+    hash = zhashx_new_flat ();
+    s_test_cursor (hash);
+    zhashx_destroy (&hash);
+
+    //  Flat tables grow, shrink, and keep their items, whatever the hash
+    //  function does
+    int pass;
+    for (pass = 0; pass < 2; pass++) {
+        hash = zhashx_new_flat ();
+        zhashx_set_destructor (hash, (zhashx_destructor_fn *) zstr_free);
+        zhashx_set_duplicator (hash, (zhashx_duplicator_fn *) strdup);
+        int nbr_keys = 20000;
+        if (pass == 1) {
+            zhashx_set_key_hasher (hash, s_test_hash_constant);
+            nbr_keys = 500;
+        }
+        char key [16];
+        for (iteration = 0; iteration < nbr_keys; iteration++) {
+            snprintf (key, sizeof (key), "%d", iteration);
+            assert (zhashx_insert (hash, key, key) == 0);
+        }
+        assert (zhashx_size (hash) == (size_t) nbr_keys);
+        assert ((hash->capacity & (hash->capacity - 1)) == 0);
+        assert (hash->capacity - hash->capacity / 8 >= (size_t) nbr_keys);
+        size_t visited = 0;
+        item = (char *) zhashx_first (hash);
+        while (item) {
+            assert (streq (item, (char *) zhashx_cursor (hash)));
+            visited++;
+            item = (char *) zhashx_next (hash);
+        }
+        assert (visited == (size_t) nbr_keys);
+
+        //  Delete odd keys, then churn through many more keys without the
+        //  table growing, as deleted entries are reused
+        for (iteration = 1; iteration < nbr_keys; iteration += 2) {
+            snprintf (key, sizeof (key), "%d", iteration);
+            zhashx_delete (hash, key);
+        }
+        size_t capacity = hash->capacity;
+        for (iteration = 0; iteration < nbr_keys * 4; iteration++) {
+            snprintf (key, sizeof (key), "churn-%d", iteration);
+            assert (zhashx_insert (hash, key, key) == 0);
+            zhashx_delete (hash, key);
+        }
+        assert (hash->capacity == capacity);
+        assert (zhashx_size (hash) == (size_t) nbr_keys / 2);
+        for (iteration = 0; iteration < nbr_keys; iteration++) {
+            snprintf (key, sizeof (key), "%d", iteration);
+            item = (char *) zhashx_lookup (hash, key);
+            assert (iteration % 2? item == NULL: streq (item, key));
+        }
+        zhashx_purge (hash);
+        assert (zhashx_size (hash) == 0);
+        assert (hash->capacity == FLAT_CAPACITY);
+        zhashx_destroy (&hash);
+    }
+
+    //  Random use keeps a flat table in step with what we put in it
+    hash = zhashx_new_flat ();
+    memset (testset, 0, sizeof (testset));
+    testmax = 200;
+    for (iteration = 0; iteration < 25000; iteration++) {
+        testnbr = randof (testmax);
+        if (testset [testnbr].exists) {
+            item = (char *) zhashx_lookup (hash, testset [testnbr].name);
+            assert (item);
+            zhashx_delete (hash, testset [testnbr].name);
+            testset [testnbr].exists = false;
+        }
+        else {
+            sprintf (testset [testnbr].name, "%x-%x", rand (), rand ());
+            if (zhashx_insert (hash, testset [testnbr].name, "") == 0)
+                testset [testnbr].exists = true;
+        }
+    }
+    size_t present = 0;
+    for (testnbr = 0; testnbr < testmax; testnbr++)
+        if (testset [testnbr].exists) {
+            assert (zhashx_lookup (hash, testset [testnbr].name));
+            present++;
+        }
+    assert (zhashx_size (hash) == present);
+    zhashx_destroy (&hash);
+
+    if (verbose) {
+        //  Compare the chained and flat tables on a million keys
+        int count = 1000000;
+        char **bench_keys = (char **) zmalloc (count * sizeof (char *));
+        char **bench_misses = (char **) zmalloc (count * sizeof (char *));
+        assert (bench_keys && bench_misses);
+        int index;
+        for (index = 0; index < count; index++) {
+            bench_keys [index] = zsys_sprintf ("session-%08x", index * 2654435761U);
+            bench_misses [index] = zsys_sprintf ("missing-%08x", index);
+        }
+        hash = zhashx_new ();
+        s_test_benchmark ("chained", hash, bench_keys, bench_misses, count);
+        zhashx_destroy (&hash);
+        hash = zhashx_new_flat ();
+        s_test_benchmark ("flat", hash, bench_keys, bench_misses, count);
+        zhashx_destroy (&hash);
+        for (index = 0; index < count; index++) {
+            zstr_free (&bench_keys [index]);
+            zstr_free (&bench_misses [index]);
+        }
+        freen (bench_keys);
+        freen (bench_misses);
+    }
+#endif // CZMQ_BUILD_DRAFT_API
+
 #if defined (__WINDOWS__)
     zsys_shutdown();
 #endif
@@ -0,0 +1,599 @@
+/*  =========================================================================
+    zhistogram - log-linear histogram of latencies and other values
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+    =========================================================================
+*/
+
+/*
+@header
+    The zhistogram class records the distribution of values such as
+    latencies, so you can see the tail and not just the average. Recording
+    a value takes constant time, and the memory is fixed when you create the
+    histogram, so you can record in a hot loop.
+@discuss
+    The histogram keeps values to a given number of significant decimal
+    digits, in the manner of HdrHistogram. Values below 2^(bits+1), where
+    bits is the least number of bits that holds 10^digits, each have their
+    own bucket. Above that, each power of two is split into 2^bits buckets
+    of equal width, so a value's bucket comes from the position of its top
+    bit and the bits just below it.
+
+    For timing, call zhistogram_start before an operation and
+    zhistogram_stop after it; this records the elapsed time in microseconds
+    on the monotonic clock of zclock_usecs.
+
+    A histogram is not thread safe. Give each thread its own, and merge
+    them, or pack them and send them to one thread that merges them.
+@end
+*/
+
+#include "czmq_classes.h"
+
+//  Version of our packed format
+#define ZHISTOGRAM_VERSION  1
+
+//  Structure of our class
+
+struct _zhistogram_t {
+    uint64_t highest;           //  Largest value we keep apart
+    int digits;                 //  Significant decimal digits
+    int bits;                   //  Bits of precision below the top bit
+    size_t nbr_buckets;         //  Number of buckets
+    uint64_t *buckets;          //  Count of values in each bucket
+    uint64_t count;             //  Number of values recorded
+    uint64_t min;               //  Smallest value recorded
+    uint64_t max;               //  Largest value recorded
+    double sum;                 //  Sum of values, for the mean
+    int64_t started;            //  Start of timed operation, in usecs
+};
+
+
+//  --------------------------------------------------------------------------
+//  Return the position of the highest bit set in a value above zero
+
+static int
+s_top_bit (uint64_t value)
+{
+#if defined (__GNUC__)
+    return 63 - __builtin_clzll (value);
+#else
+    int bit = 0;
+    while (value >>= 1)
+        bit++;
+    return bit;
+#endif
+}
+
+//  Return the bucket that holds a value
+
+static size_t
+s_bucket (zhistogram_t *self, uint64_t value)
+{
+    if (value >> (self->bits + 1) == 0)
+        return (size_t) value;
+    int shift = s_top_bit (value) - self->bits;
+    return ((size_t) shift << self->bits) + (size_t) (value >> shift);
+}
+
+//  Return the largest value that falls in a bucket
+
+static uint64_t
+s_bucket_top (zhistogram_t *self, size_t bucket)
+{
+    if (bucket >> (self->bits + 1) == 0)
+        return (uint64_t) bucket;
+    int shift = (int) (bucket >> self->bits) - 1;
+    uint64_t mantissa = bucket - ((size_t) shift << self->bits);
+    return ((mantissa + 1) << shift) - 1;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Create a new histogram for values from 0 to highest, keeping the
+//  given number of significant decimal digits (1 to 5). Larger values
+//  are recorded as highest. Returns NULL if digits is out of range.
+
+zhistogram_t *
+zhistogram_new (uint64_t highest, int digits)
+{
+    if (digits < 1 || digits > 5)
+        return NULL;
+
+    zhistogram_t *self = (zhistogram_t *) zmalloc (sizeof (zhistogram_t));
+    assert (self);
+    self->highest = highest;
+    self->digits = digits;
+    int power;
+    uint64_t scale = 1;
+    for (power = 0; power < digits; power++)
+        scale *= 10;
+    while (((uint64_t) 1 << self->bits) < scale)
+        self->bits++;
+    self->nbr_buckets = s_bucket (self, highest) + 1;
+    self->buckets = (uint64_t *) zmalloc (self->nbr_buckets * sizeof (uint64_t));
+    assert (self->buckets);
+    return self;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Network byte order helpers for pack and unpack
+
+static byte *
+s_put_number4 (byte *needle, uint32_t value)
+{
+    needle [0] = (byte) (value >> 24);
+    needle [1] = (byte) (value >> 16);
+    needle [2] = (byte) (value >> 8);
+    needle [3] = (byte) value;
+    return needle + 4;
+}
+
+static byte *
+s_put_number8 (byte *needle, uint64_t value)
+{
+    needle = s_put_number4 (needle, (uint32_t) (value >> 32));
+    return s_put_number4 (needle, (uint32_t) value);
+}
+
+static uint32_t
+s_get_number4 (byte **needle_p)
+{
+    byte *needle = *needle_p;
+    *needle_p += 4;
+    return ((uint32_t) needle [0] << 24) + ((uint32_t) needle [1] << 16)
+         + ((uint32_t) needle [2] << 8) + (uint32_t) needle [3];
+}
+
+static uint64_t
+s_get_number8 (byte **needle_p)
+{
+    uint64_t value = (uint64_t) s_get_number4 (needle_p) << 32;
+    return value + s_get_number4 (needle_p);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Unpack a histogram from a frame made by zhistogram_pack. Returns NULL
+//  if the frame is not a valid histogram.
+
+zhistogram_t *
+zhistogram_unpack (zframe_t *frame)
+{
+    assert (frame);
+    //  Version, digits, highest, min, max, sum, number of buckets
+    size_t header_size = 1 + 1 + 8 + 8 + 8 + 8 + 4;
+    if (zframe_size (frame) < header_size)
+        return NULL;
+    byte *needle = zframe_data (frame);
+    byte *ceiling = needle + zframe_size (frame);
+    if (*needle++ != ZHISTOGRAM_VERSION)
+        return NULL;
+    int digits = *needle++;
+    uint64_t highest = s_get_number8 (&needle);
+    zhistogram_t *self = zhistogram_new (highest, digits);
+    if (!self)
+        return NULL;
+    self->min = s_get_number8 (&needle);
+    self->max = s_get_number8 (&needle);
+    uint64_t sum = s_get_number8 (&needle);
+    memcpy (&self->sum, &sum, sizeof (self->sum));
+
+    //  Each bucket that holds values comes as its index and count
+    size_t nbr_buckets = s_get_number4 (&needle);
+    if ((size_t) (ceiling - needle) != nbr_buckets * 12)
+        zhistogram_destroy (&self);
+    while (self && nbr_buckets--) {
+        size_t bucket = s_get_number4 (&needle);
+        uint64_t count = s_get_number8 (&needle);
+        if (bucket < self->nbr_buckets && self->buckets [bucket] == 0) {
+            self->buckets [bucket] = count;
+            self->count += count;
+        }
+        else
+            zhistogram_destroy (&self);
+    }
+    return self;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Destroy a histogram.
+
+void
+zhistogram_destroy (zhistogram_t **self_p)
+{
+    assert (self_p);
+    if (*self_p) {
+        zhistogram_t *self = *self_p;
+        freen (self->buckets);
+        freen (self);
+        *self_p = NULL;
+    }
+}
+
+
+//  --------------------------------------------------------------------------
+//  Record a value. Takes constant time, and never allocates memory.
+
+void
+zhistogram_record (zhistogram_t *self, uint64_t value)
+{
+    assert (self);
+    if (value > self->highest)
+        value = self->highest;
+    self->buckets [s_bucket (self, value)]++;
+    if (self->count == 0 || value < self->min)
+        self->min = value;
+    if (value > self->max)
+        self->max = value;
+    self->sum += (double) value;
+    self->count++;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Start timing an operation, on the monotonic clock.
+
+void
+zhistogram_start (zhistogram_t *self)
+{
+    assert (self);
+    self->started = zclock_usecs ();
+}
+
+
+//  --------------------------------------------------------------------------
+//  Stop timing the operation started by zhistogram_start, record its
+//  duration in microseconds, and return that.
+
+int64_t
+zhistogram_stop (zhistogram_t *self)
+{
+    assert (self);
+    int64_t elapsed = zclock_usecs () - self->started;
+    zhistogram_record (self, (uint64_t) elapsed);
+    return elapsed;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Add the values of another histogram to this one. Both must have the
+//  same highest value and digits. Returns 0 if OK, -1 if not.
+
+int
+zhistogram_merge (zhistogram_t *self, zhistogram_t *other)
+{
+    assert (self);
+    assert (other);
+    if (other->highest != self->highest || other->digits != self->digits)
+        return -1;
+    if (other->count == 0)
+        return 0;
+
+    size_t bucket;
+    for (bucket = 0; bucket < self->nbr_buckets; bucket++)
+        self->buckets [bucket] += other->buckets [bucket];
+    if (self->count == 0 || other->min < self->min)
+        self->min = other->min;
+    if (other->max > self->max)
+        self->max = other->max;
+    self->sum += other->sum;
+    self->count += other->count;
+    return 0;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Forget all recorded values.
+
+void
+zhistogram_reset (zhistogram_t *self)
+{
+    assert (self);
+    memset (self->buckets, 0, self->nbr_buckets * sizeof (uint64_t));
+    self->count = 0;
+    self->min = 0;
+    self->max = 0;
+    self->sum = 0;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return the number of values recorded.
+
+uint64_t
+zhistogram_count (zhistogram_t *self)
+{
+    assert (self);
+    return self->count;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return the smallest value recorded, or 0 if there are none.
+
+uint64_t
+zhistogram_min (zhistogram_t *self)
+{
+    assert (self);
+    return self->min;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return the largest value recorded, or 0 if there are none.
+
+uint64_t
+zhistogram_max (zhistogram_t *self)
+{
+    assert (self);
+    return self->max;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return the mean of the values recorded, or 0 if there are none.
+
+double
+zhistogram_mean (zhistogram_t *self)
+{
+    assert (self);
+    return self->count? self->sum / (double) self->count: 0;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return the value at the given percentile, from 0 to 100: the value
+//  that at least that percentage of recorded values are no larger than,
+//  to within the histogram's precision. Returns 0 if there are no values.
+
+uint64_t
+zhistogram_percentile (zhistogram_t *self, double percentile)
+{
+    assert (self);
+    if (self->count == 0)
+        return 0;
+
+    //  Find the bucket holding the value of this rank, counting from 1.
+    //  We round the rank up ourselves, so don't need libm for ceil.
+    double rank = percentile / 100 * (double) self->count;
+    uint64_t wanted = self->count;
+    if (!(rank >= 1))
+        wanted = 1;
+    else
+    if (rank < (double) self->count) {
+        wanted = (uint64_t) rank;
+        if ((double) wanted < rank)
+            wanted++;
+    }
+    uint64_t seen = 0;
+    size_t bucket;
+    for (bucket = 0; bucket < self->nbr_buckets; bucket++) {
+        seen += self->buckets [bucket];
+        if (seen >= wanted)
+            break;
+    }
+    //  Report the top of the bucket, but never beyond the values we saw
+    uint64_t value = s_bucket_top (self, bucket);
+    if (value > self->max)
+        value = self->max;
+    if (value < self->min)
+        value = self->min;
+    return value;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Serialize the histogram to a binary frame that can be sent in a
+//  message. Only buckets that hold values take space in the frame.
+
+zframe_t *
+zhistogram_pack (zhistogram_t *self)
+{
+    assert (self);
+    size_t nbr_buckets = 0;
+    size_t bucket;
+    for (bucket = 0; bucket < self->nbr_buckets; bucket++)
+        if (self->buckets [bucket])
+            nbr_buckets++;
+
+    zframe_t *frame = zframe_new (NULL, 38 + nbr_buckets * 12);
+    if (!frame)
+        return NULL;
+    byte *needle = zframe_data (frame);
+    *needle++ = ZHISTOGRAM_VERSION;
+    *needle++ = (byte) self->digits;
+    needle = s_put_number8 (needle, self->highest);
+    needle = s_put_number8 (needle, self->min);
+    needle = s_put_number8 (needle, self->max);
+    uint64_t sum;
+    memcpy (&sum, &self->sum, sizeof (sum));
+    needle = s_put_number8 (needle, sum);
+    needle = s_put_number4 (needle, (uint32_t) nbr_buckets);
+    for (bucket = 0; bucket < self->nbr_buckets; bucket++)
+        if (self->buckets [bucket]) {
+            needle = s_put_number4 (needle, (uint32_t) bucket);
+            needle = s_put_number8 (needle, self->buckets [bucket]);
+        }
+    assert (needle == zframe_data (frame) + zframe_size (frame));
+    return frame;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return a text summary of the histogram: count, minimum, mean, and
+//  maximum, then the values at the usual percentiles, one per line.
+
+char *
+zhistogram_str (zhistogram_t *self)
+{
+    assert (self);
+    return zsys_sprintf (
+        "count=%" PRIu64 " min=%" PRIu64 " mean=%.1f max=%" PRIu64 "\n"
+        "  50%%     %" PRIu64 "\n"
+        "  90%%     %" PRIu64 "\n"
+        "  99%%     %" PRIu64 "\n"
+        "  99.9%%   %" PRIu64 "\n"
+        "  99.99%%  %" PRIu64 "\n",
+        self->count, self->min, zhistogram_mean (self), self->max,
+        zhistogram_percentile (self, 50),
+        zhistogram_percentile (self, 90),
+        zhistogram_percentile (self, 99),
+        zhistogram_percentile (self, 99.9),
+        zhistogram_percentile (self, 99.99));
+}
+
+
+//  --------------------------------------------------------------------------
+//  Selftest
+
+void
+zhistogram_test (bool verbose)
+{
+    printf (" * zhistogram: ");
+    if (verbose)
+        printf ("\n");
+
+    //  @selftest
+    //  Track latencies up to one minute in usecs, to 3 significant digits
+    zhistogram_t *histogram = zhistogram_new (60 * 1000 * 1000, 3);
+    assert (histogram);
+    assert (zhistogram_new (1000, 0) == NULL);
+    assert (zhistogram_new (1000, 6) == NULL);
+    assert (zhistogram_count (histogram) == 0);
+    assert (zhistogram_percentile (histogram, 50) == 0);
+
+    uint64_t value;
+    for (value = 1; value <= 10000; value++)
+        zhistogram_record (histogram, value);
+    assert (zhistogram_count (histogram) == 10000);
+    assert (zhistogram_min (histogram) == 1);
+    assert (zhistogram_max (histogram) == 10000);
+    assert (zhistogram_mean (histogram) == 5000.5);
+    assert (zhistogram_percentile (histogram, 0) == 1);
+    assert (zhistogram_percentile (histogram, 100) == 10000);
+    //  Small values are exact, larger ones within 0.1%
+    assert (zhistogram_percentile (histogram, 10) == 1000);
+    uint64_t median = zhistogram_percentile (histogram, 50);
+    assert (median >= 5000 && median <= 5005);
+    uint64_t tail = zhistogram_percentile (histogram, 99.9);
+    assert (tail >= 9990 && tail <= 10000);
+
+    //  Values beyond the highest count as the highest
+    zhistogram_record (histogram, 3600ULL * 1000 * 1000);
+    assert (zhistogram_max (histogram) == 60 * 1000 * 1000);
+
+    //  Histograms from other threads merge, if they have the same shape
+    zhistogram_t *other = zhistogram_new (60 * 1000 * 1000, 3);
+    zhistogram_record (other, 0);
+    assert (zhistogram_merge (histogram, other) == 0);
+    assert (zhistogram_count (histogram) == 10002);
+    assert (zhistogram_min (histogram) == 0);
+    zhistogram_destroy (&other);
+    other = zhistogram_new (1000, 3);
+    assert (zhistogram_merge (histogram, other) == -1);
+    zhistogram_destroy (&other);
+
+    //  Histograms travel in frames
+    zframe_t *frame = zhistogram_pack (histogram);
+    assert (frame);
+    zhistogram_t *copy = zhistogram_unpack (frame);
+    assert (copy);
+    assert (zhistogram_count (copy) == 10002);
+    assert (zhistogram_min (copy) == 0);
+    assert (zhistogram_max (copy) == 60 * 1000 * 1000);
+    assert (zhistogram_mean (copy) == zhistogram_mean (histogram));
+    assert (zhistogram_percentile (copy, 50) == median);
+    char *text = zhistogram_str (histogram);
+    char *copy_text = zhistogram_str (copy);
+    assert (streq (text, copy_text));
+    if (verbose)
+        printf ("%s", text);
+    zstr_free (&text);
+    zstr_free (&copy_text);
+    zhistogram_destroy (&copy);
+    zframe_destroy (&frame);
+
+    frame = zframe_new ("garbage", 7);
+    assert (zhistogram_unpack (frame) == NULL);
+    zframe_destroy (&frame);
+
+    zhistogram_reset (histogram);
+    assert (zhistogram_count (histogram) == 0);
+    assert (zhistogram_max (histogram) == 0);
+
+    //  Time an operation
+    zhistogram_start (histogram);
+    zclock_sleep (2);
+    int64_t elapsed = zhistogram_stop (histogram);
+    assert (elapsed >= 2000);
+    assert (zhistogram_count (histogram) == 1);
+    assert (zhistogram_max (histogram) == (uint64_t) elapsed);
+    zhistogram_destroy (&histogram);
+    //  @end
+
+    //  Every value lands in a bucket no wider than its precision allows,
+    //  whose top is at or above the value
+    histogram = zhistogram_new (UINT64_MAX, 2);
+    assert (histogram);
+    int index;
+    for (index = 0; index < 64; index++) {
+        value = ((uint64_t) 1 << index) + randof (1000);
+        size_t bucket = s_bucket (histogram, value);
+        assert (bucket < histogram->nbr_buckets);
+        uint64_t top = s_bucket_top (histogram, bucket);
+        assert (top >= value);
+        assert ((double) (top - value) <= (double) value / 100);
+        assert (bucket == 0 || s_bucket_top (histogram, bucket - 1) < value);
+    }
+    assert (s_bucket (histogram, UINT64_MAX) == histogram->nbr_buckets - 1);
+    assert (s_bucket_top (histogram, histogram->nbr_buckets - 1) == UINT64_MAX);
+    zhistogram_destroy (&histogram);
+
+    //  Round trips over a socket pair, as a request/reply benchmark would
+    zsock_t *client = zsock_new_pair ("@inproc://zhistogram.test");
+    zsock_t *server = zsock_new_pair (">inproc://zhistogram.test");
+    assert (client && server);
+    histogram = zhistogram_new (1000 * 1000, 3);
+    for (index = 0; index < 1000; index++) {
+        zhistogram_start (histogram);
+        zstr_send (client, "ping");
+        char *string = zstr_recv (server);
+        zstr_send (server, string);
+        zstr_free (&string);
+        string = zstr_recv (client);
+        zstr_free (&string);
+        zhistogram_stop (histogram);
+    }
+    assert (zhistogram_count (histogram) == 1000);
+    if (verbose) {
+        text = zhistogram_str (histogram);
+        zsys_info ("zhistogram: round trip in usecs:");
+        printf ("%s", text);
+        zstr_free (&text);
+
+        //  Cost of recording a value
+        int64_t start = zclock_usecs ();
+        for (index = 0; index < 10000000; index++)
+            zhistogram_record (histogram, index & 0xFFFFF);
+        zsys_info ("zhistogram: %.1f ns per record",
+            (double) (zclock_usecs () - start) * 1000 / 10000000);
+    }
+    zhistogram_destroy (&histogram);
+    zsock_destroy (&client);
+    zsock_destroy (&server);
+
+#if defined (__WINDOWS__)
+    zsys_shutdown ();
+#endif
+
+    printf ("OK\n");
+}
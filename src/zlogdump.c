@@ -0,0 +1,40 @@
+/*
+    zlogdump [filename]
+
+    Decodes a binary log, as written by zsys_set_logbinary (), and prints
+    it as text, in the same form as the zsys log functions. Reads standard
+    input if no filename is given.
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "czmq_classes.h"
+
+int main (int argc, char *argv [])
+{
+    int argn = 1;
+    FILE *input = stdin;
+    const char *filename = "standard input";
+    if (argn < argc) {
+        filename = argv [argn++];
+        input = fopen (filename, "rb");
+        if (!input) {
+            zsys_error ("cannot open %s", filename);
+            return 1;
+        }
+    }
+    int events = zsys_log_decode (input, stdout);
+    if (input != stdin)
+        fclose (input);
+    if (events == -1) {
+        zsys_error ("%s is not a complete binary log", filename);
+        return 1;
+    }
+    return 0;
+}
@@ -18,6 +18,10 @@
     once-off or repeated timers. Its resolution is 1 msec. It uses a tickless
     timer to reduce CPU interrupts in inactive processes.
 @discuss
+    The class implements the reactor using the zmq_poller API if that exists,
+    so that registering and cancelling readers and pollers does not rebuild
+    the poll set, and only ready sockets are dispatched. Else it builds a
+    zmq_poll set itself.
 @end
 */
 
@@ -27,26 +31,62 @@ typedef struct _s_reader_t s_reader_t;
 typedef struct _s_poller_t s_poller_t;
 typedef struct _s_timer_t s_timer_t;
 typedef struct _s_ticket_t s_ticket_t;
+typedef struct _s_stats_t s_stats_t;
+#ifdef ZMQ_HAVE_POLLER
+typedef struct _s_pollitem_t s_pollitem_t;
+#endif
 
 //  Structure of our class
 
 struct _zloop_t {
     zlistx_t *readers;          //  List of socket readers
     zlistx_t *pollers;          //  List of poll items
-    zlistx_t *timers;           //  List of timers
+    zlistx_t *dead_readers;     //  Cancelled readers, to destroy later
+    zlistx_t *dead_pollers;     //  Cancelled pollers, to destroy later
+    s_timer_t **timers;         //  Timers, as binary heap on expiry time
+    size_t timers_size;         //  Number of timers in heap
+    size_t timers_limit;        //  Allocated size of heap
+    zhashx_t *timer_index;      //  Timers, indexed by timer_id
+    s_timer_t **expired;        //  Expired timers, while calling handlers
+    size_t expired_limit;       //  Allocated size of expired array
     zlistx_t *tickets;          //  List of tickets
     int last_timer_id;          //  Most recent timer id
     size_t max_timers;          //  Limit on number of timers
     size_t ticket_delay;        //  Ticket delay value
+#ifdef ZMQ_HAVE_POLLER
+    void *zmq_poller;           //  ZMQ poller structure
+    zhashx_t *socket_items;     //  Poll items, indexed by socket
+    zhashx_t *fd_items;         //  Poll items, indexed by FD
+    zmq_poller_event_t *events; //  Ready events from zmq_poller
+    size_t events_limit;        //  Allocated size of events array
+    bool need_rebuild;          //  True if poll items were cancelled
+#else
     size_t poll_size;           //  Size of poll set
     zmq_pollitem_t *pollset;    //  zmq_poll set
-    s_reader_t *readact;        //  Readers for this poll set
-    s_poller_t *pollact;        //  Pollers for this poll set
+    s_reader_t **readact;       //  Readers for this poll set
+    s_poller_t **pollact;       //  Pollers for this poll set
     bool need_rebuild;          //  True if pollset needs rebuilding
+#endif
     bool verbose;               //  True if verbose tracing wanted
     bool terminated;            //  True when stopped running
     bool nonstop;               //  Don't stop running on Ctrl-C
     zlistx_t *zombies;          //  List of timers to kill
+    uint64_t budget_exhausted;  //  Times a reader used its whole budget
+    bool stats;                 //  True if collecting statistics
+    size_t stats_interval;      //  Log statistics every so many msecs
+    int64_t stats_due;          //  Clock time for next statistics log
+    uint64_t polls;             //  Number of times we polled
+    int64_t wait;               //  Total time (usecs) waiting in poll
+    int64_t busy;               //  Total time (usecs) outside poll
+    int64_t woken;              //  Clock time (usecs) poll last returned
+};
+
+//  Handler statistics, collected if enabled with zloop_set_stats
+
+struct _s_stats_t {
+    uint64_t calls;             //  Number of times handler was called
+    int64_t busy;               //  Total time (usecs) spent in handler
+    int64_t busy_max;           //  Longest time (usecs) spent in handler
 };
 
 //  Reactor elements are held as structures of their own
@@ -58,6 +98,11 @@ struct _s_reader_t {
     void *arg;                  //  Application argument to poll item
     int errors;                 //  If too many errors, kill reader
     bool tolerant;              //  Unless configured as tolerant
+    size_t budget;              //  Max handler calls per poll
+    s_stats_t stats;            //  Handler statistics
+#ifdef ZMQ_HAVE_POLLER
+    s_reader_t *next;           //  Next reader on same socket
+#endif
 };
 
 struct _s_poller_t {
@@ -67,18 +112,44 @@ struct _s_poller_t {
     void *arg;                  //  Application argument to poll item
     int errors;                 //  If too many errors, kill poller
     bool tolerant;              //  Unless configured as tolerant
+    s_stats_t stats;            //  Handler statistics
+#ifdef ZMQ_HAVE_POLLER
+    s_poller_t *next;           //  Next poller on same socket or FD
+#endif
+};
+
+#ifdef ZMQ_HAVE_POLLER
+//  With zmq_poller we register each socket or FD once, and hang all the
+//  readers and pollers for that socket or FD off its poll item.
+
+struct _s_pollitem_t {
+    void *socket;               //  libzmq socket, or NULL for FD
+    SOCKET fd;                  //  File descriptor, if no socket
+    short events;               //  Events registered with zmq_poller
+    bool registered;            //  True when added to zmq_poller
+    s_reader_t *readers;        //  Readers on this socket
+    s_poller_t *pollers;        //  Pollers on this socket or FD
 };
+#endif
 
 struct _s_timer_t {
-    void *list_handle;          //  Handle into list
+    size_t heap_index;          //  Position in timer heap
     int timer_id;               //  Unique timer id, used to cancel timer
     zloop_timer_fn *handler;    //  Function to execute
     size_t delay;               //  Delay (ms) between executing
     size_t times;               //  Number of times to repeat, 0 for forever
     void *arg;                  //  Application argument to timer
     int64_t when;               //  Clock time when alarm goes off
+    bool deleted;               //  Flag as deleted (to clean up later)
+    s_stats_t stats;            //  Handler statistics
+    int64_t late;               //  Total time (usecs) fired after when
+    int64_t late_max;           //  Latest time (usecs) fired after when
 };
 
+//  Timer ids and FDs are held in our indexes as pointer-sized integer keys
+#define TIMER_KEY(id)           ((byte *) NULL + (id))
+#define FD_KEY(fd)              ((byte *) NULL + (fd) + 1)
+
 //  As we pass void * to/from the caller for working with tickets, we
 //  check validity using an object tag. This value is unique in CZMQ.
 #define TICKET_TAG              0xcafe0007
@@ -108,6 +179,7 @@ s_reader_new (zsock_t *sock, zloop_reader_fn handler, void *arg)
     self->handler = handler;
     self->arg = arg;
     self->tolerant = false;     //  By default, errors are bad
+    self->budget = 1;           //  By default, one call per poll
     return self;
 }
 
@@ -171,16 +243,74 @@ s_timer_destroy (s_timer_t **self_p)
     }
 }
 
+#ifdef ZMQ_HAVE_POLLER
+static s_pollitem_t *
+s_pollitem_new (void *socket, SOCKET fd)
+{
+    s_pollitem_t *self = (s_pollitem_t *) zmalloc (sizeof (s_pollitem_t));
+    assert (self);
+    self->socket = socket;
+    self->fd = fd;
+    return self;
+}
+
+static void
+s_pollitem_destroy (s_pollitem_t **self_p)
+{
+    assert (self_p);
+    s_pollitem_t *self = *self_p;
+    if (self) {
+        freen (self);
+        *self_p = NULL;
+    }
+}
+#endif
+
+//  Create index that uses pointers, or integers held as pointers, as keys
+
+static size_t
+s_index_key_hash (const void *key)
+{
+    return (size_t) ((byte *) key - (byte *) NULL);
+}
+
 static int
-s_timer_comparator (s_timer_t *first, s_timer_t *second)
+s_index_key_compare (const void *key1, const void *key2)
 {
-    if (first->when > second->when)
-        return 1;
-    else
-    if (first->when < second->when)
-        return -1;
-    else
-        return 0;
+    return key1 == key2? 0: 1;
+}
+
+static zhashx_t *
+s_index_new (zhashx_destructor_fn destructor)
+{
+    zhashx_t *index = zhashx_new ();
+    assert (index);
+    zhashx_set_destructor (index, destructor);
+    zhashx_set_key_destructor (index, NULL);
+    zhashx_set_key_duplicator (index, NULL);
+    zhashx_set_key_comparator (index, s_index_key_compare);
+    zhashx_set_key_hasher (index, s_index_key_hash);
+    return index;
+}
+
+//  Account for one handler call that started at the given time (usecs)
+
+static void
+s_stats_record (s_stats_t *stats, int64_t start)
+{
+    int64_t elapsed = zclock_usecs () - start;
+    stats->calls++;
+    stats->busy += elapsed;
+    if (stats->busy_max < elapsed)
+        stats->busy_max = elapsed;
+}
+
+static void
+s_stats_put (zconfig_t *config, s_stats_t *stats)
+{
+    zconfig_putf (config, "calls", "%" PRIu64, stats->calls);
+    zconfig_putf (config, "busy", "%" PRId64, stats->busy);
+    zconfig_putf (config, "busy_max", "%" PRId64, stats->busy_max);
 }
 
 static s_ticket_t *
@@ -220,25 +350,195 @@ s_ticket_comparator (s_ticket_t *first, s_ticket_t *second)
         return 0;
 }
 
+//  Timers are held in a binary min-heap ordered on expiry time, so the
+//  next timer to expire is always at the top. Insert and remove are
+//  O(log n), and finding the next expiry is O(1). Each timer tracks its
+//  position in the heap so we can remove it without searching.
+
+static void
+s_timer_heap_set (zloop_t *self, size_t index, s_timer_t *timer)
+{
+    self->timers [index] = timer;
+    timer->heap_index = index;
+}
+
+static void
+s_timer_sift_up (zloop_t *self, size_t index)
+{
+    s_timer_t *timer = self->timers [index];
+    while (index > 0) {
+        size_t parent = (index - 1) / 2;
+        if (self->timers [parent]->when <= timer->when)
+            break;
+        s_timer_heap_set (self, index, self->timers [parent]);
+        index = parent;
+    }
+    s_timer_heap_set (self, index, timer);
+}
+
+static void
+s_timer_sift_down (zloop_t *self, size_t index)
+{
+    s_timer_t *timer = self->timers [index];
+    while (true) {
+        size_t child = index * 2 + 1;
+        if (child >= self->timers_size)
+            break;
+        if (child + 1 < self->timers_size
+        &&  self->timers [child + 1]->when < self->timers [child]->when)
+            child++;
+        if (timer->when <= self->timers [child]->when)
+            break;
+        s_timer_heap_set (self, index, self->timers [child]);
+        index = child;
+    }
+    s_timer_heap_set (self, index, timer);
+}
+
+//  Add timer to heap, growing the heap as needed
+
+static void
+s_timer_heap_insert (zloop_t *self, s_timer_t *timer)
+{
+    if (self->timers_size == self->timers_limit) {
+        self->timers_limit = self->timers_limit? self->timers_limit * 2: 16;
+        self->timers = (s_timer_t **) realloc (self->timers,
+            self->timers_limit * sizeof (s_timer_t *));
+        assert (self->timers);
+    }
+    s_timer_heap_set (self, self->timers_size++, timer);
+    s_timer_sift_up (self, timer->heap_index);
+}
+
+//  Take timer off heap; the timer must be on the heap
+
+static void
+s_timer_heap_remove (zloop_t *self, s_timer_t *timer)
+{
+    size_t index = timer->heap_index;
+    assert (index < self->timers_size && self->timers [index] == timer);
+    s_timer_t *last = self->timers [--self->timers_size];
+    if (last != timer) {
+        s_timer_heap_set (self, index, last);
+        if (index > 0 && self->timers [(index - 1) / 2]->when > last->when)
+            s_timer_sift_up (self, index);
+        else
+            s_timer_sift_down (self, index);
+    }
+}
+
 //  Remove timer with specified id, if it exists
 
 static void
 s_timer_remove (zloop_t *self, int timer_id)
 {
-    s_timer_t *timer = (s_timer_t *) zlistx_first (self->timers);
-    while (timer) {
-        if (timer->timer_id == timer_id) {
-            zlistx_delete (self->timers, timer->list_handle);
-            break;
+    s_timer_t *timer = (s_timer_t *) zhashx_lookup (self->timer_index, TIMER_KEY (timer_id));
+    if (timer) {
+        s_timer_heap_remove (self, timer);
+        zhashx_delete (self->timer_index, TIMER_KEY (timer_id));
+    }
+}
+
+
+#ifdef ZMQ_HAVE_POLLER
+//  Return poll item for socket or FD, or NULL if there is none
+
+static s_pollitem_t *
+s_pollitem_lookup (zloop_t *self, void *socket, SOCKET fd)
+{
+    if (socket)
+        return (s_pollitem_t *) zhashx_lookup (self->socket_items, socket);
+    else
+        return (s_pollitem_t *) zhashx_lookup (self->fd_items, FD_KEY (fd));
+}
+
+//  Return poll item for socket or FD, creating it if needed
+
+static s_pollitem_t *
+s_pollitem_require (zloop_t *self, void *socket, SOCKET fd)
+{
+    s_pollitem_t *pollitem = s_pollitem_lookup (self, socket, fd);
+    if (!pollitem) {
+        pollitem = s_pollitem_new (socket, fd);
+        int rc = socket
+            ? zhashx_insert (self->socket_items, socket, pollitem)
+            : zhashx_insert (self->fd_items, FD_KEY (fd), pollitem);
+        assert (rc == 0);
+    }
+    return pollitem;
+}
+
+//  Bring the zmq_poller registration for a poll item into line with its
+//  readers and pollers, and destroy the poll item if it has none left.
+//  Returns 0 on success, -1 if zmq_poller refused the socket or FD.
+
+static int
+s_pollitem_update (zloop_t *self, s_pollitem_t *pollitem)
+{
+    if (!pollitem->readers && !pollitem->pollers) {
+        if (pollitem->registered) {
+            if (pollitem->socket)
+                zmq_poller_remove (self->zmq_poller, pollitem->socket);
+            else
+                zmq_poller_remove_fd (self->zmq_poller, pollitem->fd);
         }
-        timer = (s_timer_t *) zlistx_next (self->timers);
+        if (pollitem->socket)
+            zhashx_delete (self->socket_items, pollitem->socket);
+        else
+            zhashx_delete (self->fd_items, FD_KEY (pollitem->fd));
+        return 0;
+    }
+    short events = pollitem->readers? ZMQ_POLLIN: 0;
+    s_poller_t *poller;
+    for (poller = pollitem->pollers; poller; poller = poller->next)
+        events |= poller->item.events;
+
+    int rc = 0;
+    if (!pollitem->registered) {
+        if (pollitem->socket)
+            rc = zmq_poller_add (self->zmq_poller, pollitem->socket, pollitem, events);
+        else
+            rc = zmq_poller_add_fd (self->zmq_poller, pollitem->fd, pollitem, events);
+        pollitem->registered = (rc == 0);
     }
+    else
+    if (events != pollitem->events) {
+        if (pollitem->socket)
+            rc = zmq_poller_modify (self->zmq_poller, pollitem->socket, events);
+        else
+            rc = zmq_poller_modify_fd (self->zmq_poller, pollitem->fd, events);
+    }
+    if (rc == 0)
+        pollitem->events = events;
+    return rc;
 }
 
+//  Wait for events on the poll items, up to timeout msecs. Returns number
+//  of ready poll items, which are held in self->events, or -1 on error.
+
+static int
+s_poller_wait (zloop_t *self, long timeout)
+{
+    size_t poll_size = zhashx_size (self->socket_items) + zhashx_size (self->fd_items);
+    if (self->events_limit < poll_size) {
+        while (self->events_limit < poll_size)
+            self->events_limit *= 2;
+        freen (self->events);
+        self->events = (zmq_poller_event_t *) zmalloc (self->events_limit * sizeof (zmq_poller_event_t));
+        assert (self->events);
+    }
+    self->need_rebuild = false;
+    int rc = zmq_poller_wait_all (self->zmq_poller, self->events, (int) self->events_limit, timeout);
+    if (rc == -1 && (errno == EAGAIN || errno == ETIMEDOUT))
+        rc = 0;                 //  Timeout expired
+    return rc;
+}
 
-//  We hold an array of pollers that matches the pollset, so we can
-//  register/cancel pollers orthogonally to executing the pollset
-//  activity on pollers. Returns 0 on success, -1 on failure.
+#else
+//  We hold arrays of readers and pollers that match the pollset. As we
+//  only destroy cancelled readers and pollers before we poll again, these
+//  stay valid while we execute the pollset activity. Returns 0 on success,
+//  -1 on failure.
 
 static int
 s_rebuild_pollset (zloop_t *self)
@@ -250,11 +550,11 @@ s_rebuild_pollset (zloop_t *self)
     assert (self->pollset);
 
     freen (self->readact);
-    self->readact = (s_reader_t *) zmalloc (self->poll_size * sizeof (s_reader_t));
+    self->readact = (s_reader_t **) zmalloc (self->poll_size * sizeof (s_reader_t *));
     assert (self->readact);
 
     freen (self->pollact);
-    self->pollact = (s_poller_t *) zmalloc (self->poll_size * sizeof (s_poller_t));
+    self->pollact = (s_poller_t **) zmalloc (self->poll_size * sizeof (s_poller_t *));
     assert (self->pollact);
 
     s_reader_t *reader = (s_reader_t *) zlistx_first (self->readers);
@@ -262,20 +562,143 @@ s_rebuild_pollset (zloop_t *self)
     while (reader) {
         zmq_pollitem_t poll_item = { zsock_resolve (reader->sock), 0, ZMQ_POLLIN, 0 };
         self->pollset [item_nbr] = poll_item;
-        self->readact [item_nbr] = *reader;
+        self->readact [item_nbr] = reader;
         item_nbr++;
         reader = (s_reader_t *) zlistx_next (self->readers);
     }
     s_poller_t *poller = (s_poller_t *) zlistx_first (self->pollers);
     while (poller) {
         self->pollset [item_nbr] = poller->item;
-        self->pollact [item_nbr] = *poller;
+        self->pollact [item_nbr] = poller;
         item_nbr++;
         poller = (s_poller_t *) zlistx_next (self->pollers);
     }
     self->need_rebuild = false;
     return 0;
 }
+#endif
+
+//  Call the handler for a reader that has events. If the reader has an
+//  error it gets one chance to handle it, then we kill the reader, since
+//  it'll disrupt the reactor otherwise. If the reader has a budget, we keep
+//  calling the handler while the socket has input, up to the budget.
+//  Returns the handler's result.
+
+static int
+s_reader_handle (zloop_t *self, s_reader_t *reader, short revents)
+{
+    if ((revents & ZMQ_POLLERR) && !reader->tolerant) {
+        if (self->verbose)
+            zsys_warning ("zloop: can't read %s socket: %s",
+                          zsock_type_str (reader->sock),
+                          zmq_strerror (zmq_errno ()));
+        if (reader->errors++) {
+            zloop_reader_end (self, reader->sock);
+            return 0;
+        }
+    }
+    else
+        reader->errors = 0;     //  A non-error happened
+
+    int rc = 0;
+    if (revents) {
+        size_t calls = 0;
+        do {
+            if (self->verbose)
+                zsys_debug ("zloop: call %s socket handler",
+                            zsock_type_str (reader->sock));
+            int64_t start = self->stats? zclock_usecs (): 0;
+            rc = reader->handler (self, reader->sock, reader->arg);
+            if (self->stats)
+                s_stats_record (&reader->stats, start);
+            calls++;
+            //  If the handler cancelled any reader, stop and poll again
+            if (rc == -1 || self->need_rebuild)
+                break;
+            if (calls == reader->budget) {
+                //  Only count it if the budget left input waiting
+                if (calls > 1 && (zsock_events (reader->sock) & ZMQ_POLLIN))
+                    self->budget_exhausted++;
+                break;
+            }
+        } while (zsock_events (reader->sock) & ZMQ_POLLIN);
+    }
+    return rc;
+}
+
+//  Call the handler for a poller that has events, passing the poll item
+//  with its revents set. Error handling is as for readers.
+
+static int
+s_poller_handle (zloop_t *self, s_poller_t *poller, zmq_pollitem_t *item)
+{
+    if ((item->revents & ZMQ_POLLERR) && !poller->tolerant) {
+        if (self->verbose)
+            zsys_warning ("zloop: can't poll %s socket (%p, %d): %s",
+                          poller->item.socket?
+                          zsys_sockname (zsock_type (poller->item.socket)): "FD",
+                          poller->item.socket, poller->item.fd,
+                          zmq_strerror (zmq_errno ()));
+        if (poller->errors++) {
+            zloop_poller_end (self, &poller->item);
+            return 0;
+        }
+    }
+    else
+        poller->errors = 0;     //  A non-error happened
+
+    if (item->revents) {
+        if (self->verbose)
+            zsys_debug ("zloop: call %s socket handler (%p, %d)",
+                        poller->item.socket?
+                        zsys_sockname (zsock_type (poller->item.socket)): "FD",
+                        poller->item.socket, poller->item.fd);
+        int64_t start = self->stats? zclock_usecs (): 0;
+        int rc = poller->handler (self, item, poller->arg);
+        if (self->stats)
+            s_stats_record (&poller->stats, start);
+        return rc;
+    }
+    return 0;
+}
+
+//  Log a summary of statistics: one line for the loop, and one line for
+//  each handler that was called
+
+static void
+s_stats_log (zloop_t *self)
+{
+    int64_t total = self->wait + self->busy;
+    zsys_info ("zloop: polls=%" PRIu64 " wait=%" PRId64 "us busy=%" PRId64 "us (%d%%)"
+               " budget_exhausted=%" PRIu64, self->polls, self->wait, self->busy,
+               total? (int) (self->busy * 100 / total): 0, self->budget_exhausted);
+
+    s_reader_t *reader = (s_reader_t *) zlistx_first (self->readers);
+    while (reader) {
+        if (reader->stats.calls)
+            zsys_info ("zloop: - reader %s calls=%" PRIu64 " busy=%" PRId64 "us max=%" PRId64 "us",
+                       zsock_type_str (reader->sock), reader->stats.calls,
+                       reader->stats.busy, reader->stats.busy_max);
+        reader = (s_reader_t *) zlistx_next (self->readers);
+    }
+    s_poller_t *poller = (s_poller_t *) zlistx_first (self->pollers);
+    while (poller) {
+        if (poller->stats.calls)
+            zsys_info ("zloop: - poller %s calls=%" PRIu64 " busy=%" PRId64 "us max=%" PRId64 "us",
+                       poller->item.socket? "socket": "fd", poller->stats.calls,
+                       poller->stats.busy, poller->stats.busy_max);
+        poller = (s_poller_t *) zlistx_next (self->pollers);
+    }
+    size_t timer_nbr;
+    for (timer_nbr = 0; timer_nbr < self->timers_size; timer_nbr++) {
+        s_timer_t *timer = self->timers [timer_nbr];
+        if (timer->stats.calls && !timer->deleted)
+            zsys_info ("zloop: - timer id=%d calls=%" PRIu64 " busy=%" PRId64 "us max=%" PRId64 "us"
+                       " late=%" PRId64 "us max=%" PRId64 "us", timer->timer_id,
+                       timer->stats.calls, timer->stats.busy, timer->stats.busy_max,
+                       timer->late, timer->late_max);
+    }
+}
 
 static long
 s_tickless (zloop_t *self)
@@ -283,20 +706,19 @@ s_tickless (zloop_t *self)
     //  Calculate tickless timer, up to 1 hour
     int64_t tickless = zclock_mono () + 1000 * 3600;
 
-    //  Scan timers, which are not sorted
-    //  TODO: sort timers properly on insertion
-    s_timer_t *timer = (s_timer_t *) zlistx_first (self->timers);
-    while (timer) {
-        //  Find earliest timer
-        if (tickless > timer->when)
-            tickless = timer->when;
-        timer = (s_timer_t *) zlistx_next (self->timers);
-    }
+    //  Timers are sorted on a heap, so check first timer
+    if (self->timers_size && tickless > self->timers [0]->when)
+        tickless = self->timers [0]->when;
+
     //  Tickets are sorted, so check first ticket
     s_ticket_t *ticket = (s_ticket_t *) zlistx_first (self->tickets);
     if (ticket && tickless > ticket->when)
         tickless = ticket->when;
 
+    //  Wake up in time to log statistics, if asked to
+    if (self->stats_interval && tickless > self->stats_due)
+        tickless = self->stats_due;
+
     long timeout = (long) (tickless - zclock_mono ());
     if (timeout < 0)
         timeout = 0;
@@ -324,8 +746,13 @@ zloop_new (void)
     self->pollers = zlistx_new ();
     assert (self->pollers);
 
-    self->timers = zlistx_new ();
-    assert (self->timers);
+    self->dead_readers = zlistx_new ();
+    assert (self->dead_readers);
+
+    self->dead_pollers = zlistx_new ();
+    assert (self->dead_pollers);
+
+    self->timer_index = s_index_new ((zhashx_destructor_fn *) s_timer_destroy);
 
     self->zombies = zlistx_new ();
     assert (self->zombies);
@@ -336,8 +763,18 @@ zloop_new (void)
 
     zlistx_set_destructor (self->readers, (czmq_destructor *) s_reader_destroy);
     zlistx_set_destructor (self->pollers, (czmq_destructor *) s_poller_destroy);
-    zlistx_set_destructor (self->timers, (czmq_destructor *) s_timer_destroy);
-    zlistx_set_comparator (self->timers, (czmq_comparator *) s_timer_comparator);
+    zlistx_set_destructor (self->dead_readers, (czmq_destructor *) s_reader_destroy);
+    zlistx_set_destructor (self->dead_pollers, (czmq_destructor *) s_poller_destroy);
+
+#ifdef ZMQ_HAVE_POLLER
+    self->zmq_poller = zmq_poller_new ();
+    assert (self->zmq_poller);
+    self->socket_items = s_index_new ((zhashx_destructor_fn *) s_pollitem_destroy);
+    self->fd_items = s_index_new ((zhashx_destructor_fn *) s_pollitem_destroy);
+    self->events_limit = 16;
+    self->events = (zmq_poller_event_t *) zmalloc (self->events_limit * sizeof (zmq_poller_event_t));
+    assert (self->events);
+#endif
     zlistx_set_destructor (self->tickets, (czmq_destructor *) s_ticket_destroy);
     zlistx_set_comparator (self->tickets, (czmq_comparator *) s_ticket_comparator);
 
@@ -365,11 +802,22 @@ zloop_destroy (zloop_t **self_p)
         zlistx_destroy (&self->zombies);
         zlistx_destroy (&self->readers);
         zlistx_destroy (&self->pollers);
-        zlistx_destroy (&self->timers);
+        zlistx_destroy (&self->dead_readers);
+        zlistx_destroy (&self->dead_pollers);
+        zhashx_destroy (&self->timer_index);
+        freen (self->timers);
+        freen (self->expired);
         zlistx_destroy (&self->tickets);
+#ifdef ZMQ_HAVE_POLLER
+        zhashx_destroy (&self->socket_items);
+        zhashx_destroy (&self->fd_items);
+        zmq_poller_destroy (&self->zmq_poller);
+        freen (self->events);
+#else
         freen (self->pollset);
         freen (self->readact);
         freen (self->pollact);
+#endif
         freen (self);
         *self_p = NULL;
     }
@@ -392,7 +840,21 @@ zloop_reader (zloop_t *self, zsock_t *sock, zloop_reader_fn handler, void *arg)
     if (reader) {
         reader->list_handle = zlistx_add_end (self->readers, reader);
         assert (reader->list_handle);
+#ifdef ZMQ_HAVE_POLLER
+        s_pollitem_t *pollitem = s_pollitem_require (self, zsock_resolve (sock), 0);
+        s_reader_t **tail_p = &pollitem->readers;
+        while (*tail_p)
+            tail_p = &(*tail_p)->next;
+        *tail_p = reader;
+        if (s_pollitem_update (self, pollitem)) {
+            *tail_p = NULL;
+            s_pollitem_update (self, pollitem);
+            zlistx_delete (self->readers, reader->list_handle);
+            return -1;
+        }
+#else
         self->need_rebuild = true;
+#endif
         if (self->verbose)
             zsys_debug ("zloop: register %s reader", zsock_type_str (sock));
         return 0;
@@ -412,14 +874,34 @@ zloop_reader_end (zloop_t *self, zsock_t *sock)
     assert (self);
     assert (sock);
 
+#ifdef ZMQ_HAVE_POLLER
+    s_pollitem_t *pollitem = s_pollitem_lookup (self, zsock_resolve (sock), 0);
+    if (pollitem) {
+        s_reader_t **reader_p = &pollitem->readers;
+        while (*reader_p) {
+            s_reader_t *reader = *reader_p;
+            if (reader->sock == sock) {
+                *reader_p = reader->next;
+                zlistx_detach (self->readers, reader->list_handle);
+                zlistx_add_end (self->dead_readers, reader);
+                self->need_rebuild = true;
+            }
+            else
+                reader_p = &reader->next;
+        }
+        s_pollitem_update (self, pollitem);
+    }
+#else
     s_reader_t *reader = (s_reader_t *) zlistx_first (self->readers);
     while (reader) {
         if (reader->sock == sock) {
-            zlistx_delete (self->readers, reader->list_handle);
+            zlistx_detach (self->readers, reader->list_handle);
+            zlistx_add_end (self->dead_readers, reader);
             self->need_rebuild = true;
         }
         reader = (s_reader_t *) zlistx_next (self->readers);
     }
+#endif
     if (self->verbose)
         zsys_debug ("zloop: cancel %s reader", zsock_type_str (sock));
 }
@@ -444,6 +926,41 @@ zloop_reader_set_tolerant (zloop_t *self, zsock_t *sock)
 }
 
 
+//  --------------------------------------------------------------------------
+//  Set the number of times the reactor may call a reader's handler for each
+//  poll, while the socket still has input. This cuts the cost of polling for
+//  busy sockets, while the budget stops one socket from starving the others.
+//  The default budget is 1. Applies to all readers for the socket.
+
+void
+zloop_reader_set_budget (zloop_t *self, zsock_t *sock, size_t budget)
+{
+    assert (self);
+    assert (sock);
+    assert (budget > 0);
+
+    s_reader_t *reader = (s_reader_t *) zlistx_first (self->readers);
+    while (reader) {
+        if (reader->sock == sock)
+            reader->budget = budget;
+        reader = (s_reader_t *) zlistx_next (self->readers);
+    }
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return the number of times a reader's handler was called as often as its
+//  budget allows in one poll, since the reactor was created. If this grows
+//  quickly, the reader's budget may be too low for its traffic.
+
+uint64_t
+zloop_budget_exhausted (zloop_t *self)
+{
+    assert (self);
+    return self->budget_exhausted;
+}
+
+
 //  --------------------------------------------------------------------------
 //  Register low-level libzmq pollitem with the reactor. When the pollitem
 //  is ready, will call the handler, passing the arg. Returns 0 if OK, -1
@@ -465,7 +982,21 @@ zloop_poller (zloop_t *self, zmq_pollitem_t *item, zloop_fn handler, void *arg)
 
     poller->list_handle = zlistx_add_end (self->pollers, poller);
     assert (poller->list_handle);
+#ifdef ZMQ_HAVE_POLLER
+    s_pollitem_t *pollitem = s_pollitem_require (self, item->socket, item->fd);
+    s_poller_t **tail_p = &pollitem->pollers;
+    while (*tail_p)
+        tail_p = &(*tail_p)->next;
+    *tail_p = poller;
+    if (s_pollitem_update (self, pollitem)) {
+        *tail_p = NULL;
+        s_pollitem_update (self, pollitem);
+        zlistx_delete (self->pollers, poller->list_handle);
+        return -1;
+    }
+#else
     self->need_rebuild = true;
+#endif
     if (self->verbose)
         zsys_debug ("zloop: register %s poller (%p, %d)",
                     item->socket? zsys_sockname (zsock_type (item->socket)): "FD",
@@ -484,6 +1015,20 @@ zloop_poller_end (zloop_t *self, zmq_pollitem_t *item)
 {
     assert (self);
 
+#ifdef ZMQ_HAVE_POLLER
+    s_pollitem_t *pollitem = s_pollitem_lookup (self, item->socket, item->fd);
+    if (pollitem) {
+        s_poller_t **poller_p = &pollitem->pollers;
+        while (*poller_p) {
+            s_poller_t *poller = *poller_p;
+            *poller_p = poller->next;
+            zlistx_detach (self->pollers, poller->list_handle);
+            zlistx_add_end (self->dead_pollers, poller);
+            self->need_rebuild = true;
+        }
+        s_pollitem_update (self, pollitem);
+    }
+#else
     s_poller_t *poller = (s_poller_t *) zlistx_first (self->pollers);
     while (poller) {
         bool match = false;
@@ -496,12 +1041,13 @@ zloop_poller_end (zloop_t *self, zmq_pollitem_t *item)
                 match = true;
         }
         if (match) {
-            zlistx_delete (self->pollers, poller->list_handle);
-            //  Force rebuild to avoid reading from freed poller
+            zlistx_detach (self->pollers, poller->list_handle);
+            zlistx_add_end (self->dead_pollers, poller);
             self->need_rebuild = true;
         }
         poller = (s_poller_t *) zlistx_next (self->pollers);
     }
+#endif
     if (self->verbose)
         zsys_debug ("zloop: cancel %s poller (%p, %d)",
                     item->socket? zsys_sockname (zsock_type (item->socket)): "FD",
@@ -548,16 +1094,18 @@ int
 zloop_timer (zloop_t *self, size_t delay, size_t times, zloop_timer_fn handler, void *arg)
 {
     assert (self);
-    //  Catch excessive use of timers
-    if (self->max_timers && zlistx_size (self->timers) == self->max_timers) {
+    //  Catch excessive use of timers; count them by id, as a timer that
+    //  is firing is not on the heap
+    if (self->max_timers && zhashx_size (self->timer_index) >= self->max_timers) {
         zsys_error ("zloop: timer limit reached (max=%d)", self->max_timers);
         return -1;
     }
     int timer_id = s_next_timer_id (self);
     s_timer_t *timer = s_timer_new (timer_id, delay, times, handler, arg);
     if (timer) {
-        timer->list_handle = zlistx_add_end (self->timers, timer);
-        assert (timer->list_handle);
+        int rc = zhashx_insert (self->timer_index, TIMER_KEY (timer_id), timer);
+        assert (rc == 0);
+        s_timer_heap_insert (self, timer);
         if (self->verbose)
             zsys_debug ("zloop: register timer id=%d delay=%d times=%d",
                         timer_id, (int) delay, (int) times);
@@ -579,12 +1127,17 @@ zloop_timer_end (zloop_t *self, int timer_id)
 
     if (self->terminated)
         s_timer_remove (self, timer_id);
-    else
+    else {
         //  We cannot touch self->timers because we may be executing that
         //  from inside the poll loop. So, we hold the arg on the zombie
         //  list, and process that list when we're done executing timers.
         //  This hack lets us store an integer timer ID as a pointer
-        zlistx_add_end (self->zombies, (byte *) NULL + timer_id);
+        zlistx_add_end (self->zombies, TIMER_KEY (timer_id));
+        //  Make sure the timer does not fire again before it's removed
+        s_timer_t *timer = (s_timer_t *) zhashx_lookup (self->timer_index, TIMER_KEY (timer_id));
+        if (timer)
+            timer->deleted = true;
+    }
 
     if (self->verbose)
         zsys_debug ("zloop: cancel timer id=%d", timer_id);
@@ -670,6 +1223,91 @@ zloop_set_verbose (zloop_t *self, bool verbose)
     self->verbose = verbose;
 }
 
+
+//  --------------------------------------------------------------------------
+//  Set collection of reactor statistics on/off
+
+void
+zloop_set_stats (zloop_t *self, bool stats)
+{
+    assert (self);
+    self->stats = stats;
+    self->woken = 0;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Log a summary of reactor statistics every so many msecs
+
+void
+zloop_set_stats_interval (zloop_t *self, size_t stats_interval)
+{
+    assert (self);
+    if (stats_interval)
+        zloop_set_stats (self, true);
+    self->stats_interval = stats_interval;
+    self->stats_due = zclock_mono () + stats_interval;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return reactor statistics as a new zconfig tree, which the caller must
+//  destroy
+
+zconfig_t *
+zloop_stats (zloop_t *self)
+{
+    assert (self);
+    zconfig_t *root = zconfig_new ("root", NULL);
+    assert (root);
+    zconfig_t *loop = zconfig_new ("loop", root);
+    zconfig_putf (loop, "polls", "%" PRIu64, self->polls);
+    zconfig_putf (loop, "wait", "%" PRId64, self->wait);
+    zconfig_putf (loop, "busy", "%" PRId64, self->busy);
+    zconfig_putf (loop, "budget_exhausted", "%" PRIu64, self->budget_exhausted);
+
+    zconfig_t *readers = zconfig_new ("reader", root);
+    int item_nbr = 0;
+    s_reader_t *reader = (s_reader_t *) zlistx_first (self->readers);
+    while (reader) {
+        char name [16];
+        snprintf (name, sizeof (name), "%d", ++item_nbr);
+        zconfig_t *config = zconfig_new (name, readers);
+        zconfig_put (config, "type", zsock_type_str (reader->sock));
+        s_stats_put (config, &reader->stats);
+        reader = (s_reader_t *) zlistx_next (self->readers);
+    }
+    zconfig_t *pollers = zconfig_new ("poller", root);
+    item_nbr = 0;
+    s_poller_t *poller = (s_poller_t *) zlistx_first (self->pollers);
+    while (poller) {
+        char name [16];
+        snprintf (name, sizeof (name), "%d", ++item_nbr);
+        zconfig_t *config = zconfig_new (name, pollers);
+        if (poller->item.socket)
+            zconfig_putf (config, "socket", "%p", poller->item.socket);
+        else
+            zconfig_putf (config, "fd", "%d", (int) poller->item.fd);
+        s_stats_put (config, &poller->stats);
+        poller = (s_poller_t *) zlistx_next (self->pollers);
+    }
+    zconfig_t *timers = zconfig_new ("timer", root);
+    size_t timer_nbr;
+    for (timer_nbr = 0; timer_nbr < self->timers_size; timer_nbr++) {
+        s_timer_t *timer = self->timers [timer_nbr];
+        if (timer->deleted)
+            continue;
+        char name [16];
+        snprintf (name, sizeof (name), "%d", timer->timer_id);
+        zconfig_t *config = zconfig_new (name, timers);
+        zconfig_putf (config, "delay", "%d", (int) timer->delay);
+        s_stats_put (config, &timer->stats);
+        zconfig_putf (config, "late", "%" PRId64, timer->late);
+        zconfig_putf (config, "late_max", "%" PRId64, timer->late_max);
+    }
+    return root;
+}
+
 //  --------------------------------------------------------------------------
 //  By default the reactor stops if the process receives a SIGINT or SIGTERM
 //  signal. This makes it impossible to shut-down message based architectures
@@ -685,11 +1323,11 @@ zloop_set_nonstop (zloop_t *self, bool nonstop)
 
 
 //  --------------------------------------------------------------------------
-//  Set hard limit on number of timers allowed. Setting more than a small
-//  number of timers (10-100) can have a dramatic impact on the performance
-//  of the reactor. For high-volume cases, use ticket timers. If the hard
-//  limit is reached, the reactor stops creating new timers and logs an
-//  error.
+//  Set hard limit on number of timers allowed. Timers are held on a heap,
+//  so adding and cancelling timers costs O(log n), while finding the next
+//  timer to expire is constant time. For high-volume cases that constantly
+//  reset expiry timers, ticket timers are still cheaper. If the hard limit
+//  is reached, the reactor stops creating new timers and logs an error.
 
 void
 zloop_set_max_timers (zloop_t *self, size_t max_timers)
@@ -712,11 +1350,26 @@ zloop_start (zloop_t *self)
     assert (self);
     int rc = 0;
     self->terminated = false;
+    self->woken = 0;
 
     //  Main reactor loop
     while (!zsys_interrupted || self->nonstop) {
         if (rc == -1)      // somebody wanted us to quit
             break;
+        //  Nothing refers to cancelled readers and pollers any longer
+        zlistx_purge (self->dead_readers);
+        zlistx_purge (self->dead_pollers);
+
+        int64_t polled = 0;
+        if (self->stats) {
+            polled = zclock_usecs ();
+            if (self->woken)
+                self->busy += polled - self->woken;
+        }
+#ifdef ZMQ_HAVE_POLLER
+        rc = s_poller_wait (self, s_tickless (self));
+        int event_count = rc;
+#else
         if (self->need_rebuild) {
             //  If s_rebuild_pollset() fails, break out of the loop and
             //  return its error
@@ -725,6 +1378,14 @@ zloop_start (zloop_t *self)
                 break;
         }
         rc = zmq_poll (self->pollset, (int) self->poll_size, s_tickless (self));
+#endif
+        if (self->stats) {
+            self->woken = zclock_usecs ();
+            if (polled) {
+                self->wait += self->woken - polled;
+                self->polls++;
+            }
+        }
         if (rc == -1 || (zsys_interrupted && !self->nonstop)) {
             if (errno == EINTR && self->nonstop) {
                 rc = 0;
@@ -740,22 +1401,47 @@ zloop_start (zloop_t *self)
             break;              //  Context has been shut down
         }
 
-        //  Handle any timers that have now expired
+        //  Handle any timers that have now expired. We take expired timers
+        //  off the heap first, as handlers may create and cancel timers.
         int64_t time_now = zclock_mono ();
-        s_timer_t *timer = (s_timer_t *) zlistx_first (self->timers);
-        while (timer) {
-            if (time_now >= timer->when) {
+        size_t expired_size = 0;
+        while (self->timers_size && time_now >= self->timers [0]->when) {
+            if (expired_size == self->expired_limit) {
+                self->expired_limit = self->expired_limit? self->expired_limit * 2: 16;
+                self->expired = (s_timer_t **) realloc (self->expired,
+                    self->expired_limit * sizeof (s_timer_t *));
+                assert (self->expired);
+            }
+            self->expired [expired_size] = self->timers [0];
+            s_timer_heap_remove (self, self->expired [expired_size++]);
+        }
+        size_t expired_nbr;
+        for (expired_nbr = 0; expired_nbr < expired_size; expired_nbr++) {
+            s_timer_t *timer = self->expired [expired_nbr];
+            //  After a break, remaining timers go back on the heap unfired
+            if (rc != -1 && !timer->deleted) {
                 if (self->verbose)
                     zsys_debug ("zloop: call timer handler id=%d", timer->timer_id);
+                int64_t start = 0;
+                if (self->stats) {
+                    start = zclock_usecs ();
+                    int64_t late = start - timer->when * 1000;
+                    if (late > 0) {
+                        timer->late += late;
+                        if (timer->late_max < late)
+                            timer->late_max = late;
+                    }
+                }
                 rc = timer->handler (self, timer->timer_id, timer->arg);
-                if (timer->times && --timer->times == 0)
-                    zlistx_delete (self->timers, timer->list_handle);
-                else
-                    timer->when += timer->delay;
-                if (rc == -1)
-                    break;      //  Timer handler signaled break
+                if (self->stats)
+                    s_stats_record (&timer->stats, start);
+                if (timer->times && --timer->times == 0) {
+                    zhashx_delete (self->timer_index, TIMER_KEY (timer->timer_id));
+                    continue;
+                }
+                timer->when += timer->delay;
             }
-            timer = (s_timer_t *) zlistx_next (self->timers);
+            s_timer_heap_insert (self, timer);
         }
 
         //  Handle any tickets that have now expired
@@ -784,77 +1470,62 @@ zloop_start (zloop_t *self)
             continue;
 
         //  Handle any readers and pollers that are ready
+#ifdef ZMQ_HAVE_POLLER
+        //  We only get the poll items that are ready; any cancel makes the
+        //  remaining events stale, so we stop and poll again
+        int event_nbr;
+        for (event_nbr = 0; event_nbr < event_count && rc >= 0; event_nbr++) {
+            s_pollitem_t *pollitem = (s_pollitem_t *) self->events [event_nbr].user_data;
+            short revents = self->events [event_nbr].events;
+            s_reader_t *reader = pollitem->readers;
+            while (reader && rc >= 0) {
+                s_reader_t *next = reader->next;
+                rc = s_reader_handle (self, reader, revents & (ZMQ_POLLIN | ZMQ_POLLERR));
+                if (self->need_rebuild)
+                    break;
+                reader = next;
+            }
+            //  A cancel may have destroyed the poll item, so don't touch it
+            if (self->need_rebuild)
+                break;
+            s_poller_t *poller = pollitem->pollers;
+            while (poller && rc >= 0) {
+                s_poller_t *next = poller->next;
+                poller->item.revents = revents & (poller->item.events | ZMQ_POLLERR);
+                rc = s_poller_handle (self, poller, &poller->item);
+                if (self->need_rebuild)
+                    break;
+                poller = next;
+            }
+            if (self->need_rebuild)
+                break;
+        }
+#else
         size_t item_nbr;
         for (item_nbr = 0; item_nbr < self->poll_size && rc >= 0; item_nbr++) {
-            s_reader_t *reader = &self->readact [item_nbr];
-            if (reader->handler) {
-                if ((self->pollset [item_nbr].revents & ZMQ_POLLERR)
-                && !reader->tolerant) {
-                    if (self->verbose)
-                        zsys_warning ("zloop: can't read %s socket: %s",
-                                      zsock_type_str (reader->sock),
-                                      zmq_strerror (zmq_errno ()));
-                    //  Give handler one chance to handle error, then kill
-                    //  reader because it'll disrupt the reactor otherwise.
-                    if (reader->errors++) {
-                        zloop_reader_end (self, reader->sock);
-                        self->pollset [item_nbr].revents = 0;
-                    }
-                }
-                else
-                    reader->errors = 0;     //  A non-error happened
-
-                if (self->pollset [item_nbr].revents) {
-                    if (self->verbose)
-                        zsys_debug ("zloop: call %s socket handler",
-                                    zsock_type_str (reader->sock));
-                    rc = reader->handler (self, reader->sock, reader->arg);
-                    if (rc == -1 || self->need_rebuild)
-                        break;
-                }
-            }
+            s_reader_t *reader = self->readact [item_nbr];
+            if (reader)
+                rc = s_reader_handle (self, reader, self->pollset [item_nbr].revents);
             else {
-                s_poller_t *poller = &self->pollact [item_nbr];
+                s_poller_t *poller = self->pollact [item_nbr];
                 assert (self->pollset [item_nbr].socket == poller->item.socket);
-
-                if ((self->pollset [item_nbr].revents & ZMQ_POLLERR)
-                && !poller->tolerant) {
-                    if (self->verbose)
-                        zsys_warning ("zloop: can't poll %s socket (%p, %d): %s",
-                                      poller->item.socket?
-                                      zsys_sockname (zsock_type (poller->item.socket)): "FD",
-                                      poller->item.socket, poller->item.fd,
-                                      zmq_strerror (zmq_errno ()));
-                    //  Give handler one chance to handle error, then kill
-                    //  poller because it'll disrupt the reactor otherwise.
-                    if (poller->errors++) {
-                        zloop_poller_end (self, &poller->item);
-                        self->pollset [item_nbr].revents = 0;
-                    }
-                }
-                else
-                    poller->errors = 0;     //  A non-error happened
-
-                if (self->pollset [item_nbr].revents) {
-                    if (self->verbose)
-                        zsys_debug ("zloop: call %s socket handler (%p, %d)",
-                                    poller->item.socket?
-                                    zsys_sockname (zsock_type (poller->item.socket)): "FD",
-                                    poller->item.socket, poller->item.fd);
-                    rc = poller->handler (self, &self->pollset [item_nbr], poller->arg);
-                    if (rc == -1 || self->need_rebuild)
-                        break;
-                }
+                rc = s_poller_handle (self, poller, &self->pollset [item_nbr]);
             }
+            if (self->need_rebuild)
+                break;
         }
+#endif
         //  Now handle any timer zombies
-        //  This is going to be slow if we have many timers; we might use
-        //  a faster lookup on the timer list.
         while (zlistx_first (self->zombies)) {
             //  Get timer_id back from pointer
             ptrdiff_t timer_id = (byte *) zlistx_detach (self->zombies, NULL) - (byte *) NULL;
             s_timer_remove (self, (int) timer_id);
         }
+        //  Log statistics if it's time
+        if (self->stats_interval && zclock_mono () >= self->stats_due) {
+            s_stats_log (self);
+            self->stats_due = zclock_mono () + self->stats_interval;
+        }
     }
     self->terminated = true;
     return rc;
@@ -922,6 +1593,92 @@ s_timer_event5 (zloop_t *loop, int timer_id, void *arg)
     return 0;
 }
 
+static int
+s_socket_event_cancel (zloop_t *loop, zsock_t *reader, void *arg)
+{
+    //  Cancel ourselves, which destroys the socket's poll item
+    ++*((int *) arg);
+    zloop_reader_end (loop, reader);
+    return 0;
+}
+
+static int
+s_socket_event_count (zloop_t *loop, zsock_t *reader, void *arg)
+{
+    //  Leave message on socket, end the reactor on second call
+    return ++*((int *) arg) == 2? -1: 0;
+}
+
+static int
+s_socket_event_drain (zloop_t *loop, zsock_t *reader, void *arg)
+{
+    char *string = zstr_recv (reader);
+    freen (string);
+    //  End the reactor when told to
+    return ++*((int *) arg) == 10? -1: 0;
+}
+
+static int
+s_poller_event_count (zloop_t *loop, zmq_pollitem_t *item, void *arg)
+{
+    assert (item->revents & ZMQ_POLLIN);
+    ++*((int *) arg);
+    //  End the reactor
+    return -1;
+}
+
+//  Timers that the order test started, and those that fired
+
+#define ORDER_TIMERS 100
+
+typedef struct {
+    int timer_ids [ORDER_TIMERS];
+    bool cancelled [ORDER_TIMERS];
+    bool fired [ORDER_TIMERS];
+    int64_t last_when;          //  Deadline of the last timer that fired
+    int fired_count;
+} s_timer_order_t;
+
+static int
+s_timer_event_order (zloop_t *loop, int timer_id, void *arg)
+{
+    //  Timers must fire once each, in order of deadline, unless cancelled
+    s_timer_order_t *order = (s_timer_order_t *) arg;
+    s_timer_t *timer = (s_timer_t *) zhashx_lookup (loop->timer_index, TIMER_KEY (timer_id));
+    assert (timer);
+    assert (timer->when >= order->last_when);
+    order->last_when = timer->when;
+
+    int timer_nbr;
+    for (timer_nbr = 0; timer_nbr < ORDER_TIMERS; timer_nbr++)
+        if (order->timer_ids [timer_nbr] == timer_id)
+            break;
+    assert (timer_nbr < ORDER_TIMERS);
+    assert (!order->cancelled [timer_nbr]);
+    assert (!order->fired [timer_nbr]);
+    order->fired [timer_nbr] = true;
+    order->fired_count++;
+    return 0;
+}
+
+static int
+s_timer_event_limit (zloop_t *loop, int timer_id, void *arg)
+{
+    //  This timer is off the heap while it fires, but still counts
+    *((int *) arg) = zloop_timer (loop, 1000, 1, s_timer_event, NULL);
+    assert (*((int *) arg) != -1);
+    *((int *) arg) = zloop_timer (loop, 1000, 1, s_timer_event, NULL);
+    //  End the reactor
+    return -1;
+}
+
+static int
+s_timer_event_count (zloop_t *loop, int timer_id, void *arg)
+{
+    //  End the reactor after 100 calls
+    return ++*((int *) arg) == 100? -1: 0;
+}
+
 static void
 s_raise_sigint_actor (zsock_t *pipe, void *args)
 {
@@ -1040,6 +1797,149 @@ zloop_test (bool verbose)
     zloop_start (loop);
     assert (!socket_event_called);
 
+    //  Check that a reader can cancel itself from its handler
+    zloop_destroy (&loop);
+    loop = zloop_new ();
+    int cancel_calls = 0;
+    rc = zloop_reader (loop, output, s_socket_event_cancel, &cancel_calls);
+    assert (rc == 0);
+    zloop_timer (loop, 50, 1, s_timer_event4, NULL);
+    zstr_send (input, "PING");
+    zloop_start (loop);
+    assert (cancel_calls == 1);
+    char *ping = zstr_recv (output);
+    freen (ping);
+
+    //  Check that a reader and a poller on the same socket both get called,
+    //  and that cancelling the poller leaves the reader working
+    zloop_destroy (&loop);
+    loop = zloop_new ();
+    int reader_calls = 0;
+    int poller_calls = 0;
+    zmq_pollitem_t output_item = { zsock_resolve (output), 0, ZMQ_POLLIN, 0 };
+    rc = zloop_reader (loop, output, s_socket_event_count, &reader_calls);
+    assert (rc == 0);
+    rc = zloop_poller (loop, &output_item, s_poller_event_count, &poller_calls);
+    assert (rc == 0);
+    zstr_send (input, "PING");
+    zloop_start (loop);
+    assert (reader_calls == 1);
+    assert (poller_calls == 1);
+    zloop_poller_end (loop, &output_item);
+    zloop_start (loop);
+    assert (reader_calls == 2);
+    assert (poller_calls == 1);
+    zloop_reader_end (loop, output);
+    while (zsock_events (output) & ZMQ_POLLIN) {
+        char *string = zstr_recv (output);
+        freen (string);
+    }
+
+    //  Check that a reader with a budget drains several messages per poll
+    zloop_destroy (&loop);
+    loop = zloop_new ();
+    reader_calls = 0;
+    rc = zloop_reader (loop, output, s_socket_event_drain, &reader_calls);
+    assert (rc == 0);
+    zloop_reader_set_budget (loop, output, 4);
+    int msg_nbr;
+    for (msg_nbr = 0; msg_nbr < 10; msg_nbr++)
+        zstr_send (input, "PING");
+    zclock_sleep (10);
+    zloop_start (loop);
+    assert (reader_calls == 10);
+    //  10 messages with a budget of 4 per poll runs out the budget twice
+    assert (zloop_budget_exhausted (loop) == 2);
+
+    //  A budget that just drains the socket has not run out
+    zloop_destroy (&loop);
+    loop = zloop_new ();
+    reader_calls = 0;
+    rc = zloop_reader (loop, output, s_socket_event_drain, &reader_calls);
+    assert (rc == 0);
+    zloop_reader_set_budget (loop, output, 4);
+    for (msg_nbr = 0; msg_nbr < 4; msg_nbr++)
+        zstr_send (input, "PING");
+    zclock_sleep (10);
+    zloop_timer (loop, 20, 1, s_timer_event4, NULL);
+    zloop_start (loop);
+    assert (reader_calls == 4);
+    assert (zloop_budget_exhausted (loop) == 0);
+
+    //  Check that statistics count handler calls, once switched on
+    zloop_destroy (&loop);
+    loop = zloop_new ();
+    zloop_set_stats (loop, true);
+    reader_calls = 0;
+    rc = zloop_reader (loop, output, s_socket_event_drain, &reader_calls);
+    assert (rc == 0);
+    for (msg_nbr = 0; msg_nbr < 10; msg_nbr++)
+        zstr_send (input, "PING");
+    zloop_start (loop);
+    assert (reader_calls == 10);
+    int wakeups = 97;
+    timer_id = zloop_timer (loop, 1, 0, s_timer_event_count, &wakeups);
+    zloop_start (loop);
+    assert (wakeups == 100);
+
+    zconfig_t *stats = zloop_stats (loop);
+    assert (stats);
+    if (verbose)
+        zconfig_print (stats);
+    assert (atoi (zconfig_get (stats, "loop/polls", "0")) >= 13);
+    assert (streq (zconfig_get (stats, "reader/1/type", ""), "PAIR"));
+    assert (streq (zconfig_get (stats, "reader/1/calls", ""), "10"));
+    char path [32];
+    snprintf (path, sizeof (path), "timer/%d/calls", timer_id);
+    assert (streq (zconfig_get (stats, path, ""), "3"));
+    zconfig_destroy (&stats);
+
+    //  Check that many timers fire in order, and cancelled timers don't fire
+    zloop_destroy (&loop);
+    loop = zloop_new ();
+    s_timer_order_t order = { { 0 } };
+    int timer_nbr;
+    for (timer_nbr = 0; timer_nbr < ORDER_TIMERS; timer_nbr++) {
+        timer_id = zloop_timer (loop, 30 - timer_nbr % 30, 1, s_timer_event_order, &order);
+        order.timer_ids [timer_nbr] = timer_id;
+        if (timer_nbr % 3 == 0) {
+            zloop_timer_end (loop, timer_id);
+            order.cancelled [timer_nbr] = true;
+        }
+    }
+    zloop_timer (loop, 40, 1, s_timer_event4, NULL);
+    zloop_start (loop);
+    assert (order.fired_count == 66);
+
+    //  The timer limit counts timers that are firing
+    zloop_destroy (&loop);
+    loop = zloop_new ();
+    zloop_set_max_timers (loop, 2);
+    int limited_id = 0;
+    zloop_timer (loop, 0, 1, s_timer_event_limit, &limited_id);
+    zloop_start (loop);
+    assert (limited_id == -1);
+    zloop_set_max_timers (loop, 0);
+
+    //  Measure reactor overhead as the number of timers grows; the cost of
+    //  each wakeup should stay flat
+    size_t timer_count;
+    for (timer_count = 10; timer_count <= 100000; timer_count *= 100) {
+        zloop_destroy (&loop);
+        loop = zloop_new ();
+        size_t timer_index;
+        for (timer_index = 0; timer_index < timer_count; timer_index++)
+            zloop_timer (loop, 3600 * 1000, 0, s_timer_event, NULL);
+        wakeups = 0;
+        zloop_timer (loop, 0, 0, s_timer_event_count, &wakeups);
+        int64_t start = zclock_usecs ();
+        zloop_start (loop);
+        assert (wakeups == 100);
+        if (verbose)
+            zsys_debug ("zloop: %d timers, %d nsec per wakeup", (int) timer_count,
+                        (int) ((zclock_usecs () - start) * 1000 / wakeups));
+    }
+
     //  cleanup
     zloop_destroy (&loop);
     assert (loop == NULL);
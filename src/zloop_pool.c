@@ -0,0 +1,1113 @@
+/*  =========================================================================
+    zloop_pool - run reactors on a pool of threads
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+    =========================================================================
+*/
+
+/*
+@header
+    The zloop_pool class runs one zloop reactor on each of a fixed number of
+    threads, and spreads socket readers and timers across them. Handlers are
+    plain zloop handlers, so code written for one zloop moves to a pool by
+    replacing zloop_reader with zloop_pool_reader, and so on.
+@discuss
+    A reader is placed on the thread that has the fewest readers, and a timer
+    on the next thread in turn. Every so often, the pool measures how much
+    time each thread spent in handlers, and moves one reader from the busiest
+    thread to the least busy one. A reader is only ever moved between two
+    handler calls, so the handlers for one socket never run on two threads at
+    once, and the socket is handed over as 0MQ requires.
+
+    Handlers run on pool threads, so any state they share with other handlers
+    or with the caller must be thread safe. Once a socket is registered, only
+    its handler may use it, until you call zloop_pool_reader_end. Pool
+    methods must be called from the thread that created the pool, and never
+    from a handler. A handler that returns -1 cancels its own reader or
+    timer, rather than stopping the reactor. Timer handlers get the timer id
+    that zloop_pool_timer returned. On Linux, each thread is pinned to its
+    own CPU, where there are enough CPUs.
+@end
+*/
+
+#include "czmq_classes.h"
+
+//  Structure of our class
+
+struct _zloop_pool_t {
+    zactor_t *actor;            //  Pool controller
+    size_t size;                //  Number of reactor threads
+};
+
+typedef struct _worker_t worker_t;
+
+//  A reader registered with the pool. The reader belongs to the worker
+//  that runs it, and moves with it when we balance the pool.
+
+typedef struct {
+    worker_t *worker;           //  Worker that runs this reader
+    zsock_t *sock;              //  Socket to read from
+    zloop_reader_fn *handler;   //  Handler to call
+    void *arg;                  //  Application argument to handler
+    int64_t busy;               //  Usecs in handler since last measured
+    int64_t load;               //  Usecs in handler when last measured
+    bool actor;                 //  Socket is an actor pipe that we own
+    uint64_t id;                //  Registration, as the pool counts them
+} s_reader_t;
+
+//  A timer registered with the pool
+
+typedef struct {
+    int timer_id;               //  Timer id as the caller sees it
+    size_t delay;               //  Delay in msecs
+    size_t times;               //  Calls left, or 0 for forever
+    zloop_timer_fn *handler;    //  Handler to call
+    void *arg;                  //  Application argument to handler
+} s_timer_t;
+
+//  A worker thread, as the controller sees it
+
+typedef struct {
+    zactor_t *actor;            //  Worker thread
+    size_t readers;             //  Readers on this worker
+    int64_t load;               //  Usecs in handlers when last measured
+} s_worker_t;
+
+//  A socket registered with the pool, as the controller sees it
+
+typedef struct {
+    s_worker_t *worker;         //  Worker that runs its reader
+    uint64_t id;                //  Registration of its reader
+} s_socket_t;
+
+//  Arguments for starting a worker
+
+typedef struct {
+    size_t index;               //  Index of worker in pool
+    size_t size;                //  Number of workers in pool
+    const char *notices;        //  Endpoint for notices to the pool
+} s_worker_args_t;
+
+//  Sockets and timer ids are held as hash keys, compared by value
+
+#define TIMER_KEY(id) ((byte *) NULL + (id))
+
+static size_t
+s_index_key_hash (const void *key)
+{
+    return (size_t) ((byte *) key - (byte *) NULL);
+}
+
+static int
+s_index_key_compare (const void *key1, const void *key2)
+{
+    return key1 == key2? 0: 1;
+}
+
+static zhashx_t *
+s_index_new (zhashx_destructor_fn destructor)
+{
+    zhashx_t *index = zhashx_new ();
+    assert (index);
+    zhashx_set_destructor (index, destructor);
+    zhashx_set_duplicator (index, NULL);
+    zhashx_set_key_destructor (index, NULL);
+    zhashx_set_key_duplicator (index, NULL);
+    zhashx_set_key_comparator (index, s_index_key_compare);
+    zhashx_set_key_hasher (index, s_index_key_hash);
+    return index;
+}
+
+static void
+s_item_destroy (void **item_p)
+{
+    freen (*item_p);
+}
+
+
+//  --------------------------------------------------------------------------
+//  The worker_t structure holds the state for one worker thread
+
+struct _worker_t {
+    zsock_t *pipe;              //  Actor command pipe
+    zsock_t *notices;           //  Tells the pool of readers that end
+    zloop_t *loop;              //  Reactor for this thread
+    zhashx_t *readers;          //  Readers, indexed by socket
+    zhashx_t *timers;           //  Timers, indexed by local timer id
+    size_t index;               //  Index of worker in pool
+    size_t size;                //  Number of workers in pool
+    int64_t busy;               //  Usecs in handlers since last measured
+};
+
+//  Take a reader off this worker, and return it to the caller, who must
+//  destroy it or give it to another worker
+
+static s_reader_t *
+s_worker_detach (worker_t *self, zsock_t *sock)
+{
+    s_reader_t *reader = (s_reader_t *) zhashx_lookup (self->readers, sock);
+    if (reader) {
+        zloop_reader_end (self->loop, sock);
+        zhashx_delete (self->readers, sock);
+    }
+    return reader;
+}
+
+
+static int
+s_reader_proxy (zloop_t *loop, zsock_t *sock, void *arg)
+{
+    s_reader_t *reader = (s_reader_t *) arg;
+    worker_t *self = reader->worker;
+    int64_t start = zclock_usecs ();
+    int rc = reader->handler (loop, sock, reader->arg);
+    int64_t elapsed = zclock_usecs () - start;
+    reader->busy += elapsed;
+    self->busy += elapsed;
+    if (rc == -1) {
+        //  Tell the pool the reader has ended, before an actor's caller
+        //  can see that it has finished
+        s_worker_detach (self, sock);
+        zsock_send (self->notices, "p8i", sock, reader->id, (int) self->index);
+        if (reader->actor) {
+            //  Tell the caller the actor has finished, as a thread would
+            zsock_set_sndtimeo (sock, 0);
+            zsock_signal (sock, 0);
+            zsock_destroy (&sock);
+        }
+        freen (reader);
+    }
+    return 0;
+}
+
+static int
+s_timer_proxy (zloop_t *loop, int timer_id, void *arg)
+{
+    worker_t *self = (worker_t *) arg;
+    s_timer_t *timer = (s_timer_t *) zhashx_lookup (self->timers, TIMER_KEY (timer_id));
+    assert (timer);
+    int64_t start = zclock_usecs ();
+    int rc = timer->handler (loop, timer->timer_id, timer->arg);
+    self->busy += zclock_usecs () - start;
+    if (rc == -1) {
+        zloop_timer_end (loop, timer_id);
+        zhashx_delete (self->timers, TIMER_KEY (timer_id));
+    }
+    else
+    //  The reactor drops the timer itself after its last call
+    if (timer->times && --timer->times == 0)
+        zhashx_delete (self->timers, TIMER_KEY (timer_id));
+    return 0;
+}
+
+//  Pick the busiest reader that is no busier than the limit, and take it
+//  off this worker. Returns the reader, or NULL if none was suitable.
+
+static s_reader_t *
+s_worker_shed (worker_t *self, int64_t limit)
+{
+    s_reader_t *shed = NULL;
+    s_reader_t *reader = (s_reader_t *) zhashx_first (self->readers);
+    while (reader) {
+        //  Actors stay put, so their handlers all run on one thread
+        if (!reader->actor
+        &&  reader->load > 0 && reader->load <= limit
+        && (!shed || reader->load > shed->load))
+            shed = reader;
+        reader = (s_reader_t *) zhashx_next (self->readers);
+    }
+    if (shed)
+        s_worker_detach (self, shed->sock);
+    return shed;
+}
+
+static int
+s_worker_command (zloop_t *loop, zsock_t *pipe, void *arg)
+{
+    worker_t *self = (worker_t *) arg;
+    char *command;
+    void *pointer;
+    if (zsock_recv (pipe, "sp", &command, &pointer))
+        return -1;              //  Interrupted
+
+    int rc = 0;
+    bool terminated = false;
+    if (streq (command, "READER")) {
+        s_reader_t *reader = (s_reader_t *) pointer;
+        reader->worker = self;
+        if (zhashx_insert (self->readers, reader->sock, reader) == 0) {
+            rc = zloop_reader (self->loop, reader->sock, s_reader_proxy, reader);
+            if (rc == -1)
+                zhashx_delete (self->readers, reader->sock);
+        }
+        else
+            rc = -1;
+        if (rc == -1)
+            freen (reader);
+        zsock_send (pipe, "i", rc);
+    }
+    else
+    if (streq (command, "READER END")) {
+        //  The reader may have ended itself already
+        s_reader_t *reader = s_worker_detach (self, (zsock_t *) pointer);
+        zsock_send (pipe, "i", reader? 0: -1);
+        freen (reader);
+    }
+    else
+    if (streq (command, "TIMER")) {
+        s_timer_t *timer = (s_timer_t *) pointer;
+        int timer_id = zloop_timer (self->loop, timer->delay, timer->times, s_timer_proxy, self);
+        //  The id the caller sees must fit in an int
+        if (timer_id > (INT_MAX - (int) self->index) / (int) self->size) {
+            zloop_timer_end (self->loop, timer_id);
+            timer_id = -1;
+        }
+        if (timer_id == -1) {
+            freen (timer);
+            zsock_send (pipe, "i", -1);
+        }
+        else {
+            //  Encode our worker index in the timer id the caller sees
+            timer->timer_id = timer_id * (int) self->size + (int) self->index;
+            zhashx_insert (self->timers, TIMER_KEY (timer_id), timer);
+            zsock_send (pipe, "i", timer->timer_id);
+        }
+    }
+    else
+    if (streq (command, "TIMER END")) {
+        int timer_id = (int) ((byte *) pointer - (byte *) NULL) / (int) self->size;
+        if (zhashx_lookup (self->timers, TIMER_KEY (timer_id))) {
+            zloop_timer_end (self->loop, timer_id);
+            zhashx_delete (self->timers, TIMER_KEY (timer_id));
+            zsock_send (pipe, "i", 0);
+        }
+        else
+            zsock_send (pipe, "i", -1);
+    }
+    else
+    if (streq (command, "LOAD")) {
+        //  Report load since last measured, and start measuring again
+        s_reader_t *reader = (s_reader_t *) zhashx_first (self->readers);
+        while (reader) {
+            reader->load = reader->busy;
+            reader->busy = 0;
+            reader = (s_reader_t *) zhashx_next (self->readers);
+        }
+        zsock_send (pipe, "8", self->busy);
+        self->busy = 0;
+    }
+    else
+    if (streq (command, "SHED")) {
+        int64_t limit = (int64_t) ((byte *) pointer - (byte *) NULL);
+        zsock_send (pipe, "p", s_worker_shed (self, limit));
+    }
+    else
+    if (streq (command, "$TERM"))
+        terminated = true;
+    else {
+        zsys_error ("zloop_pool: invalid command '%s'", command);
+        assert (false);
+    }
+    freen (command);
+    return terminated? -1: 0;
+}
+
+static void
+s_worker_actor (zsock_t *pipe, void *args)
+{
+    worker_t self = { 0 };
+    self.pipe = pipe;
+    self.index = ((s_worker_args_t *) args)->index;
+    self.size = ((s_worker_args_t *) args)->size;
+    self.notices = zsock_new (ZMQ_PUSH);
+    assert (self.notices);
+    //  Never block a worker on notices, as the pool may be waiting for it
+    zsock_set_sndhwm (self.notices, 0);
+    int rc = zsock_connect (self.notices, "%s", ((s_worker_args_t *) args)->notices);
+    assert (rc == 0);
+    self.readers = s_index_new (NULL);
+    self.timers = s_index_new (s_item_destroy);
+    self.loop = zloop_new ();
+    assert (self.loop);
+    zloop_set_nonstop (self.loop, true);
+    zloop_reader (self.loop, pipe, s_worker_command, &self);
+
+#if defined (__UTYPE_LINUX) && defined (CPU_SET)
+    //  Pin each worker to its own CPU, if there are enough to go round, out
+    //  of those the process may run on
+    cpu_set_t allowed;
+    if (pthread_getaffinity_np (pthread_self (), sizeof (allowed), &allowed) == 0
+    &&  self.size <= (size_t) CPU_COUNT (&allowed)) {
+        int cpu = -1;
+        size_t found = 0;
+        while (found <= self.index)
+            if (CPU_ISSET (++cpu, &allowed))
+                found++;
+        cpu_set_t cpuset;
+        CPU_ZERO (&cpuset);
+        CPU_SET (cpu, &cpuset);
+        if (pthread_setaffinity_np (pthread_self (), sizeof (cpuset), &cpuset))
+            zsys_warning ("zloop_pool: cannot pin worker to CPU %d", cpu);
+    }
+#endif
+    //  Signal actor successfully initiated
+    zsock_signal (pipe, 0);
+    zloop_start (self.loop);
+
+    zloop_destroy (&self.loop);
+    s_reader_t *reader = (s_reader_t *) zhashx_first (self.readers);
+    while (reader) {
+        if (reader->actor)
+            zsock_destroy (&reader->sock);
+        freen (reader);
+        reader = (s_reader_t *) zhashx_next (self.readers);
+    }
+    zhashx_destroy (&self.readers);
+    zhashx_destroy (&self.timers);
+    zsock_destroy (&self.notices);
+}
+
+
+//  --------------------------------------------------------------------------
+//  The pool_t structure holds the state for the pool controller, which owns
+//  the workers and moves readers between them.
+
+typedef struct {
+    zsock_t *pipe;              //  Actor command pipe
+    zsock_t *notices;           //  Notices from workers
+    zloop_t *loop;              //  Reactor for controller
+    s_worker_t *workers;        //  Array of workers
+    size_t size;                //  Number of workers
+    zhashx_t *sockets;          //  Registration for each socket
+    uint64_t reader_ids;        //  Registrations so far
+    size_t next_timer;          //  Worker to get the next timer
+    int balance_timer;          //  Timer id for balancing, if any
+    int64_t measured;           //  Clock time (usecs) we last measured
+} pool_t;
+
+
+//  Measure how busy each worker was since we last looked, and move one
+//  reader from the busiest worker to the least busy, if that narrows the
+//  gap between them. Returns the number of readers moved.
+
+static int
+s_pool_balance (pool_t *self)
+{
+    s_worker_t *busiest = NULL;
+    s_worker_t *idlest = NULL;
+    size_t worker_nbr;
+    for (worker_nbr = 0; worker_nbr < self->size; worker_nbr++) {
+        s_worker_t *worker = &self->workers [worker_nbr];
+        zsock_send (worker->actor, "sp", "LOAD", NULL);
+        zsock_recv (worker->actor, "8", &worker->load);
+        if (!busiest || worker->load > busiest->load)
+            busiest = worker;
+        if (!idlest || worker->load < idlest->load)
+            idlest = worker;
+    }
+    int64_t now = zclock_usecs ();
+    int64_t window = now - self->measured;
+    self->measured = now;
+
+    //  Leave the pool alone unless the gap is worth a tenth of one CPU
+    int64_t gap = busiest->load - idlest->load;
+    if (busiest == idlest || gap * 10 < window)
+        return 0;
+
+    //  A reader as busy as half the gap, or less, brings them closer
+    s_reader_t *reader;
+    zsock_send (busiest->actor, "sp", "SHED", (byte *) NULL + gap / 2);
+    zsock_recv (busiest->actor, "p", &reader);
+    if (!reader)
+        return 0;
+    busiest->readers--;
+
+    zsock_t *sock = reader->sock;
+    int rc;
+    zsock_send (idlest->actor, "sp", "READER", reader);
+    zsock_recv (idlest->actor, "i", &rc);
+    if (rc == 0) {
+        s_socket_t *socket = (s_socket_t *) zhashx_lookup (self->sockets, sock);
+        assert (socket);
+        socket->worker = idlest;
+        idlest->readers++;
+        return 1;
+    }
+    zhashx_delete (self->sockets, sock);
+    return 0;
+}
+
+//  Handle a notice from a worker that a reader has ended itself. Another
+//  reader may have taken the socket since, if the caller saw the first
+//  end, so only forget the socket if it is the same registration.
+
+static int
+s_pool_notice (zloop_t *loop, zsock_t *notices, void *arg)
+{
+    pool_t *self = (pool_t *) arg;
+    void *sock;
+    uint64_t id;
+    int worker_nbr;
+    //  We may have taken the notice already, while handling a command
+    if (!(zsock_events (notices) & ZMQ_POLLIN)
+    ||  zsock_recv (notices, "p8i", &sock, &id, &worker_nbr))
+        return 0;
+    assert (worker_nbr >= 0 && (size_t) worker_nbr < self->size);
+    s_worker_t *worker = &self->workers [worker_nbr];
+    if (worker->readers)
+        worker->readers--;
+    s_socket_t *socket = (s_socket_t *) zhashx_lookup (self->sockets, sock);
+    if (socket && socket->id == id)
+        zhashx_delete (self->sockets, sock);
+    return 0;
+}
+
+static int
+s_pool_balance_event (zloop_t *loop, int timer_id, void *arg)
+{
+    s_pool_balance ((pool_t *) arg);
+    return 0;
+}
+
+static int
+s_pool_command (zloop_t *loop, zsock_t *pipe, void *arg)
+{
+    pool_t *self = (pool_t *) arg;
+    char *command;
+    void *pointer;
+    if (zsock_recv (pipe, "sp", &command, &pointer))
+        return -1;              //  Interrupted
+
+    //  Catch up with readers that ended themselves, so we place readers
+    //  by what the workers really have
+    while (zsock_events (self->notices) & ZMQ_POLLIN)
+        s_pool_notice (loop, self->notices, self);
+
+    int rc = 0;
+    bool terminated = false;
+    if (streq (command, "READER")) {
+        //  All readers for a socket stay on the same worker; new sockets
+        //  go to the worker with the fewest readers. Actors never move, and
+        //  their pipes go away by themselves, so we only count them.
+        s_reader_t *reader = (s_reader_t *) pointer;
+        zsock_t *sock = reader->sock;
+        bool actor = reader->actor;
+        reader->id = ++self->reader_ids;
+        s_socket_t *socket = actor? NULL:
+            (s_socket_t *) zhashx_lookup (self->sockets, sock);
+        s_worker_t *worker = socket? socket->worker: NULL;
+        if (!worker) {
+            worker = &self->workers [0];
+            size_t worker_nbr;
+            for (worker_nbr = 1; worker_nbr < self->size; worker_nbr++)
+                if (self->workers [worker_nbr].readers < worker->readers)
+                    worker = &self->workers [worker_nbr];
+        }
+        //  The worker sends back the id of the reader, which may be gone
+        //  by the time we look at it
+        uint64_t id = reader->id;
+        zsock_send (worker->actor, "sp", "READER", reader);
+        zsock_recv (worker->actor, "i", &rc);
+        if (rc == 0) {
+            worker->readers++;
+            //  A socket whose reader ended itself may still be here, until
+            //  we get the notice
+            if (socket)
+                socket->id = id;
+            else
+            if (!actor) {
+                socket = (s_socket_t *) zmalloc (sizeof (s_socket_t));
+                assert (socket);
+                socket->worker = worker;
+                socket->id = id;
+                zhashx_insert (self->sockets, sock, socket);
+            }
+        }
+        zsock_send (pipe, "i", rc);
+    }
+    else
+    if (streq (command, "READER END")) {
+        s_socket_t *socket = (s_socket_t *) zhashx_lookup (self->sockets, pointer);
+        if (socket) {
+            s_worker_t *worker = socket->worker;
+            zsock_send (worker->actor, "sp", "READER END", pointer);
+            zsock_recv (worker->actor, "i", &rc);
+            zhashx_delete (self->sockets, pointer);
+            //  If the reader ended itself, its notice counts it
+            if (rc == 0 && worker->readers)
+                worker->readers--;
+        }
+        zsock_send (pipe, "i", 0);
+    }
+    else
+    if (streq (command, "TIMER")) {
+        s_worker_t *worker = &self->workers [self->next_timer];
+        self->next_timer = (self->next_timer + 1) % self->size;
+        zsock_send (worker->actor, "sp", "TIMER", pointer);
+        zsock_recv (worker->actor, "i", &rc);
+        zsock_send (pipe, "i", rc);
+    }
+    else
+    if (streq (command, "TIMER END")) {
+        //  Timer ids encode the worker index
+        int timer_id = (int) ((byte *) pointer - (byte *) NULL);
+        s_worker_t *worker = &self->workers [timer_id % self->size];
+        zsock_send (worker->actor, "sp", "TIMER END", pointer);
+        zsock_recv (worker->actor, "i", &rc);
+        zsock_send (pipe, "i", rc);
+    }
+    else
+    if (streq (command, "BALANCE"))
+        zsock_send (pipe, "i", s_pool_balance (self));
+    else
+    if (streq (command, "BALANCE IVL")) {
+        size_t balance_ivl = (size_t) ((byte *) pointer - (byte *) NULL);
+        if (self->balance_timer != -1)
+            zloop_timer_end (self->loop, self->balance_timer);
+        self->balance_timer = balance_ivl
+            ? zloop_timer (self->loop, balance_ivl, 0, s_pool_balance_event, self)
+            : -1;
+        zsock_send (pipe, "i", 0);
+    }
+    else
+    if (streq (command, "READERS")) {
+        //  For the selftest: readers counted, and sockets known
+        size_t readers = 0;
+        size_t worker_nbr;
+        for (worker_nbr = 0; worker_nbr < self->size; worker_nbr++)
+            readers += self->workers [worker_nbr].readers;
+        zsock_send (pipe, "ii", (int) readers, (int) zhashx_size (self->sockets));
+    }
+    else
+    if (streq (command, "$TERM"))
+        terminated = true;
+    else {
+        zsys_error ("zloop_pool: invalid command '%s'", command);
+        assert (false);
+    }
+    freen (command);
+    return terminated? -1: 0;
+}
+
+static void
+s_pool_actor (zsock_t *pipe, void *args)
+{
+    pool_t self = { 0 };
+    self.pipe = pipe;
+    self.size = *((size_t *) args);
+    self.workers = (s_worker_t *) zmalloc (self.size * sizeof (s_worker_t));
+    assert (self.workers);
+    char *endpoint = zsys_sprintf ("inproc://zloop_pool-%p", (void *) &self);
+    assert (endpoint);
+    self.notices = zsock_new (ZMQ_PULL);
+    assert (self.notices);
+    zsock_set_rcvhwm (self.notices, 0);
+    int rc = zsock_bind (self.notices, "%s", endpoint);
+    assert (rc == 0);
+    size_t worker_nbr;
+    for (worker_nbr = 0; worker_nbr < self.size; worker_nbr++) {
+        s_worker_args_t worker_args = { worker_nbr, self.size, endpoint };
+        self.workers [worker_nbr].actor = zactor_new (s_worker_actor, &worker_args);
+        assert (self.workers [worker_nbr].actor);
+    }
+    zstr_free (&endpoint);
+    self.sockets = s_index_new (s_item_destroy);
+    self.loop = zloop_new ();
+    assert (self.loop);
+    zloop_set_nonstop (self.loop, true);
+    zloop_reader (self.loop, pipe, s_pool_command, &self);
+    zloop_reader (self.loop, self.notices, s_pool_notice, &self);
+    self.balance_timer = zloop_timer (self.loop, 100, 0, s_pool_balance_event, &self);
+    self.measured = zclock_usecs ();
+
+    //  Signal actor successfully initiated
+    zsock_signal (pipe, 0);
+    zloop_start (self.loop);
+
+    zloop_destroy (&self.loop);
+    for (worker_nbr = 0; worker_nbr < self.size; worker_nbr++)
+        zactor_destroy (&self.workers [worker_nbr].actor);
+    freen (self.workers);
+    zhashx_destroy (&self.sockets);
+    zsock_destroy (&self.notices);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Create a new pool of reactors, running on the given number of threads.
+//  Returns NULL if size is zero.
+
+zloop_pool_t *
+zloop_pool_new (size_t size)
+{
+    if (size == 0)
+        return NULL;
+
+    zloop_pool_t *self = (zloop_pool_t *) zmalloc (sizeof (zloop_pool_t));
+    assert (self);
+    self->size = size;
+    self->actor = zactor_new (s_pool_actor, &size);
+    if (!self->actor)
+        zloop_pool_destroy (&self);
+    return self;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Destroy the pool. Stops all threads and cancels all readers and timers;
+//  does not destroy the registered sockets.
+
+void
+zloop_pool_destroy (zloop_pool_t **self_p)
+{
+    assert (self_p);
+    if (*self_p) {
+        zloop_pool_t *self = *self_p;
+        zactor_destroy (&self->actor);
+        freen (self);
+        *self_p = NULL;
+    }
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return the number of reactor threads in the pool
+
+size_t
+zloop_pool_size (zloop_pool_t *self)
+{
+    assert (self);
+    return self->size;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Register socket reader with the pool. Returns 0 if OK, -1 if there was
+//  an error, or if the socket already has a reader in the pool.
+
+int
+zloop_pool_reader (zloop_pool_t *self, zsock_t *sock, zloop_reader_fn handler, void *arg)
+{
+    assert (self);
+    assert (sock);
+    assert (handler);
+    s_reader_t *reader = (s_reader_t *) zmalloc (sizeof (s_reader_t));
+    assert (reader);
+    reader->sock = sock;
+    reader->handler = handler;
+    reader->arg = arg;
+
+    int rc;
+    zsock_send (self->actor, "sp", "READER", reader);
+    zsock_recv (self->actor, "i", &rc);
+    return rc;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Cancel a socket reader. When this returns, the handler is no longer
+//  running, and the calling thread may use the socket again.
+
+void
+zloop_pool_reader_end (zloop_pool_t *self, zsock_t *sock)
+{
+    assert (self);
+    assert (sock);
+    int rc;
+    zsock_send (self->actor, "sp", "READER END", sock);
+    zsock_recv (self->actor, "i", &rc);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Create an actor that runs on the pool instead of on a thread of its own;
+//  to the caller it is a normal zactor. A pool thread calls the handler,
+//  passing the actor's end of the pipe and the arg, each time the pipe has
+//  input. The handler returns -1 when the actor has finished, and must do so
+//  on $TERM. The actor never changes thread, so the handler may add readers
+//  and timers for its own sockets to the zloop it is passed, if it removes
+//  them before finishing. Destroy all actors before the pool. Returns NULL
+//  if there was an error.
+
+zactor_t *
+zloop_pool_actor (zloop_pool_t *self, zloop_reader_fn handler, void *arg)
+{
+    assert (self);
+    assert (handler);
+    zsock_t *pipe;
+    zsock_t *frontend = zsys_create_pipe (&pipe);
+    assert (frontend);
+    s_reader_t *reader = (s_reader_t *) zmalloc (sizeof (s_reader_t));
+    assert (reader);
+    reader->sock = pipe;
+    reader->handler = handler;
+    reader->arg = arg;
+    reader->actor = true;
+
+    int rc;
+    zsock_send (self->actor, "sp", "READER", reader);
+    zsock_recv (self->actor, "i", &rc);
+    if (rc == -1) {
+        zsock_destroy (&frontend);
+        zsock_destroy (&pipe);
+        return NULL;
+    }
+    return zactor_new_for_pipe (frontend);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Register a timer that expires after some delay and repeats some number
+//  of times. Returns a timer_id that is used to cancel the timer in the
+//  future. Returns -1 if there was an error.
+
+int
+zloop_pool_timer (zloop_pool_t *self, size_t delay, size_t times, zloop_timer_fn handler, void *arg)
+{
+    assert (self);
+    assert (handler);
+    s_timer_t *timer = (s_timer_t *) zmalloc (sizeof (s_timer_t));
+    assert (timer);
+    timer->delay = delay;
+    timer->times = times;
+    timer->handler = handler;
+    timer->arg = arg;
+
+    int timer_id;
+    zsock_send (self->actor, "sp", "TIMER", timer);
+    zsock_recv (self->actor, "i", &timer_id);
+    return timer_id;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Cancel a timer by its timer_id. Returns 0 if OK, -1 if there was no such
+//  timer, or it had already expired.
+
+int
+zloop_pool_timer_end (zloop_pool_t *self, int timer_id)
+{
+    assert (self);
+    if (timer_id < 0)
+        return -1;
+    int rc;
+    zsock_send (self->actor, "sp", "TIMER END", (byte *) NULL + timer_id);
+    zsock_recv (self->actor, "i", &rc);
+    return rc;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Set how often the pool balances readers across threads, in msecs
+
+void
+zloop_pool_set_balance_ivl (zloop_pool_t *self, size_t balance_ivl)
+{
+    assert (self);
+    int rc;
+    zsock_send (self->actor, "sp", "BALANCE IVL", (byte *) NULL + balance_ivl);
+    zsock_recv (self->actor, "i", &rc);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Balance readers across threads now
+
+int
+zloop_pool_balance (zloop_pool_t *self)
+{
+    assert (self);
+    int moved;
+    zsock_send (self->actor, "sp", "BALANCE", NULL);
+    zsock_recv (self->actor, "i", &moved);
+    return moved;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Selftest
+
+static int
+s_echo_event (zloop_t *loop, zsock_t *reader, void *arg)
+{
+    char *string = zstr_recv (reader);
+    //  Pretend to do some work
+    zclock_sleep (1);
+    zstr_send (reader, string);
+    freen (string);
+    ++*((int *) arg);
+    return 0;
+}
+
+static int
+s_echo_once_event (zloop_t *loop, zsock_t *reader, void *arg)
+{
+    s_echo_event (loop, reader, arg);
+    //  Cancel this reader
+    return -1;
+}
+
+static int
+s_tick_event (zloop_t *loop, int timer_id, void *arg)
+{
+    zstr_sendf (arg, "%d", timer_id);
+    return 0;
+}
+
+//  A pooled actor that sends back whatever it gets, until told to stop
+
+static int
+s_actor_event (zloop_t *loop, zsock_t *pipe, void *arg)
+{
+    zmsg_t *msg = zmsg_recv (pipe);
+    if (!msg)
+        return -1;              //  Interrupted
+    char *command = zmsg_popstr (msg);
+    int rc = 0;
+    if (streq (command, "$TERM"))
+        rc = -1;
+    else
+    if (streq (command, "ECHO"))
+        zmsg_send (&msg, pipe);
+    freen (command);
+    zmsg_destroy (&msg);
+    return rc;
+}
+
+static void
+s_echo_actor (zsock_t *pipe, void *args)
+{
+    zsock_signal (pipe, 0);
+    while (s_actor_event (NULL, pipe, NULL) == 0) {}
+}
+
+//  Check how many readers the pool counts, and how many sockets it knows
+
+static void
+s_assert_readers (zloop_pool_t *pool, int readers, int sockets)
+{
+    int pool_readers, pool_sockets;
+    zsock_send (pool->actor, "sp", "READERS", NULL);
+    zsock_recv (pool->actor, "ii", &pool_readers, &pool_sockets);
+    assert (pool_readers == readers);
+    assert (pool_sockets == sockets);
+}
+
+//  Compare pooled and threaded actors: time to start them, to pass a
+//  message through each of them, and to stop them
+
+static void
+s_actor_benchmark (zloop_pool_t *pool, size_t count)
+{
+    zactor_t **actors = (zactor_t **) zmalloc (count * sizeof (zactor_t *));
+    assert (actors);
+    int pass;
+    for (pass = 0; pass < 2; pass++) {
+        int64_t start = zclock_usecs ();
+        size_t actor_nbr;
+        for (actor_nbr = 0; actor_nbr < count; actor_nbr++) {
+            actors [actor_nbr] = pass == 0
+                ? zloop_pool_actor (pool, s_actor_event, NULL)
+                : zactor_new (s_echo_actor, NULL);
+            assert (actors [actor_nbr]);
+        }
+        int64_t started = zclock_usecs ();
+        int round;
+        for (round = 0; round < 10; round++) {
+            for (actor_nbr = 0; actor_nbr < count; actor_nbr++)
+                zstr_sendx (actors [actor_nbr], "ECHO", "Hello", NULL);
+            for (actor_nbr = 0; actor_nbr < count; actor_nbr++) {
+                char *string = zstr_recv (actors [actor_nbr]);
+                freen (string);
+            }
+        }
+        int64_t echoed = zclock_usecs ();
+        for (actor_nbr = 0; actor_nbr < count; actor_nbr++)
+            zactor_destroy (&actors [actor_nbr]);
+        zsys_info ("zloop_pool: %d %s actors: start %d usecs, echo %d usecs, stop %d usecs each",
+                   (int) count, pass == 0? "pooled": "threaded",
+                   (int) ((started - start) / count),
+                   (int) ((echoed - started) / (count * 10)),
+                   (int) ((zclock_usecs () - echoed) / count));
+    }
+    freen (actors);
+}
+
+void
+zloop_pool_test (bool verbose)
+{
+    printf (" * zloop_pool: ");
+
+    //  @selftest
+    zloop_pool_t *pool = zloop_pool_new (2);
+    assert (pool);
+    assert (zloop_pool_size (pool) == 2);
+    assert (zloop_pool_new (0) == NULL);
+    //  Balance by hand so the test can check the outcome
+    zloop_pool_set_balance_ivl (pool, 0);
+
+    //  Servers are registered in the pool, clients stay on this thread
+    zsock_t *server [3];
+    zsock_t *client [3];
+    int calls [3] = { 0, 0, 0 };
+    int sock_nbr;
+    for (sock_nbr = 0; sock_nbr < 3; sock_nbr++) {
+        char *endpoint = zsys_sprintf ("inproc://zloop_pool.test.%d", sock_nbr);
+        server [sock_nbr] = zsock_new (ZMQ_PAIR);
+        assert (server [sock_nbr]);
+        int rc = zsock_bind (server [sock_nbr], "%s", endpoint);
+        assert (rc == 0);
+        client [sock_nbr] = zsock_new (ZMQ_PAIR);
+        assert (client [sock_nbr]);
+        rc = zsock_connect (client [sock_nbr], "%s", endpoint);
+        assert (rc == 0);
+        zstr_free (&endpoint);
+        rc = zloop_pool_reader (pool, server [sock_nbr], s_echo_event, &calls [sock_nbr]);
+        assert (rc == 0);
+    }
+    //  A socket can only have one reader in the pool
+    int rc = zloop_pool_reader (pool, server [0], s_echo_event, &calls [0]);
+    assert (rc == -1);
+
+    s_assert_readers (pool, 3, 3);
+
+    //  Servers 0 and 2 share the first thread; keep them busy, and the
+    //  pool should move one of them to the second thread. The pool only
+    //  moves readers when the load is worth it, over the time since it
+    //  last measured, so we measure first, and load the servers again if
+    //  this thread was too slow to keep them busy.
+    zloop_pool_balance (pool);
+    int pings = 0;
+    int moved = 0;
+    while (!moved && pings < 200) {
+        int msg_nbr;
+        for (msg_nbr = 0; msg_nbr < 20; msg_nbr++) {
+            zstr_send (client [0], "PING");
+            zstr_send (client [2], "PING");
+        }
+        for (msg_nbr = 0; msg_nbr < 20; msg_nbr++) {
+            char *string = zstr_recv (client [0]);
+            assert (streq (string, "PING"));
+            freen (string);
+            string = zstr_recv (client [2]);
+            assert (streq (string, "PING"));
+            freen (string);
+        }
+        pings += 20;
+        moved = zloop_pool_balance (pool);
+    }
+    assert (moved == 1);
+    s_assert_readers (pool, 3, 3);
+
+    //  Readers keep working after they have moved
+    for (sock_nbr = 0; sock_nbr < 3; sock_nbr++) {
+        zstr_send (client [sock_nbr], "PING");
+        char *string = zstr_recv (client [sock_nbr]);
+        assert (streq (string, "PING"));
+        freen (string);
+    }
+    for (sock_nbr = 0; sock_nbr < 3; sock_nbr++)
+        zloop_pool_reader_end (pool, server [sock_nbr]);
+    assert (calls [0] == pings + 1);
+    assert (calls [1] == 1);
+    assert (calls [2] == pings + 1);
+    s_assert_readers (pool, 0, 0);
+
+    //  A handler that returns -1 cancels its reader, after which the socket
+    //  can be registered again
+    rc = zloop_pool_reader (pool, server [1], s_echo_once_event, &calls [1]);
+    assert (rc == 0);
+    zstr_send (client [1], "PING");
+    zstr_send (client [1], "PONG");
+    char *string = zstr_recv (client [1]);
+    assert (streq (string, "PING"));
+    freen (string);
+    rc = zloop_pool_reader (pool, server [1], s_echo_event, &calls [1]);
+    assert (rc == 0);
+    string = zstr_recv (client [1]);
+    assert (streq (string, "PONG"));
+    freen (string);
+    zloop_pool_reader_end (pool, server [1]);
+    assert (calls [1] == 3);
+    s_assert_readers (pool, 0, 0);
+
+    //  A reader that ended itself is forgotten, even if no one registers
+    //  its socket again
+    rc = zloop_pool_reader (pool, server [1], s_echo_once_event, &calls [1]);
+    assert (rc == 0);
+    zstr_send (client [1], "PING");
+    string = zstr_recv (client [1]);
+    freen (string);
+    zloop_pool_reader_end (pool, server [1]);
+    s_assert_readers (pool, 0, 0);
+
+    //  Timers run on pool threads too; each timer owns its own socket
+    zsock_t *sink = zsock_new_pull ("@inproc://zloop_pool.sink");
+    assert (sink);
+    zsock_t *ticker = zsock_new_push (">inproc://zloop_pool.sink");
+    assert (ticker);
+    int timer_id = zloop_pool_timer (pool, 5, 3, s_tick_event, ticker);
+    assert (timer_id != -1);
+    int tick_nbr;
+    for (tick_nbr = 0; tick_nbr < 3; tick_nbr++) {
+        string = zstr_recv (sink);
+        assert (atoi (string) == timer_id);
+        freen (string);
+    }
+    //  The timer is gone after its last call
+    zclock_sleep (10);
+    assert (zloop_pool_timer_end (pool, timer_id) == -1);
+
+    zsock_t *forever = zsock_new_push (">inproc://zloop_pool.sink");
+    assert (forever);
+    timer_id = zloop_pool_timer (pool, 1, 0, s_tick_event, forever);
+    assert (timer_id != -1);
+    string = zstr_recv (sink);
+    freen (string);
+    assert (zloop_pool_timer_end (pool, timer_id) == 0);
+
+    //  Many actors can share the pool's threads; to callers they are just
+    //  actors, and zactor_destroy stops them
+    #define ACTORS 250
+    zactor_t *actors [ACTORS];
+    int actor_nbr;
+    for (actor_nbr = 0; actor_nbr < ACTORS; actor_nbr++) {
+        actors [actor_nbr] = zloop_pool_actor (pool, s_actor_event, NULL);
+        assert (actors [actor_nbr]);
+        assert (zactor_is (actors [actor_nbr]));
+    }
+    for (actor_nbr = 0; actor_nbr < ACTORS; actor_nbr++)
+        zstr_sendx (actors [actor_nbr], "ECHO", "Hello", NULL);
+    for (actor_nbr = 0; actor_nbr < ACTORS; actor_nbr++) {
+        string = zstr_recv (actors [actor_nbr]);
+        assert (streq (string, "Hello"));
+        freen (string);
+    }
+    s_assert_readers (pool, ACTORS, 0);
+    for (actor_nbr = 0; actor_nbr < ACTORS; actor_nbr++)
+        zactor_destroy (&actors [actor_nbr]);
+    s_assert_readers (pool, 0, 0);
+
+    if (verbose)
+        s_actor_benchmark (pool, 250);
+
+    zloop_pool_destroy (&pool);
+    assert (pool == NULL);
+
+    for (sock_nbr = 0; sock_nbr < 3; sock_nbr++) {
+        zsock_destroy (&server [sock_nbr]);
+        zsock_destroy (&client [sock_nbr]);
+    }
+    zsock_destroy (&ticker);
+    zsock_destroy (&forever);
+    zsock_destroy (&sink);
+    //  @end
+
+    printf ("OK\n");
+}
@@ -0,0 +1,973 @@
+/*  =========================================================================
+    zmetrics - registry of counters, gauges and histograms
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+    =========================================================================
+*/
+
+/*
+@header
+    The zmetrics class holds named counters, gauges and histograms that any
+    thread can update without taking a lock, and renders them in the
+    Prometheus text exposition format, either as a string or over HTTP.
+@discuss
+    You register each metric once, and get back an id that you pass to the
+    update methods. Counters and histograms are sharded per thread: each
+    thread that updates a registry gets its own block of counts, which only
+    it writes, so an update is a plain load and store with no contention.
+    Reading a metric adds up the shards of all threads. When a thread exits,
+    its shard keeps its counts and passes to the next new thread. A gauge
+    holds a single value, which we set or adjust atomically.
+
+    Names follow the Prometheus rules, and may end in a set of labels, for
+    instance 'zproxy_messages_total{direction="frontend"}'. Metrics with the
+    same name and different labels are rendered as one family; register
+    them one after the other, so they come out together.
+
+    To let Prometheus scrape a registry, serve it on a port:
+
+        zactor_t *server = zmetrics_serve (metrics, 9100);
+        ...
+        zactor_destroy (&server);
+
+    Serving needs CZMQ built with libmicrohttpd. Not available on Windows,
+    where zmetrics_new returns NULL.
+@end
+*/
+
+#include "czmq_classes.h"
+
+#define METRICS_MAX     1024        //  Metrics per registry
+#define BUCKETS_MAX     64          //  Buckets per histogram
+#define CHUNK_SLOTS     256         //  Counts per shard chunk
+#define CHUNKS_MAX      64          //  Chunks per shard
+
+typedef enum {
+    METRIC_COUNTER,
+    METRIC_GAUGE,
+    METRIC_HISTOGRAM
+} s_metric_type_t;
+
+//  One registered metric. Counters and histograms keep their counts in
+//  the shards, starting at slot; a histogram has one slot per bucket plus
+//  one for the sum of its values.
+
+typedef struct {
+    s_metric_type_t type;
+    char *name;                 //  Name, including any labels
+    size_t base_size;           //  Length of the name without labels
+    char *help;                 //  Help text, or NULL
+    size_t slot;                //  First slot in shards
+    size_t buckets;             //  Histogram buckets, not counting +Inf
+    double *bounds;             //  Histogram bucket upper bounds
+    uint64_t gauge;             //  Gauge value, as the bits of a double
+} s_metric_t;
+
+//  A shard holds the counts of one thread, in chunks that the thread
+//  allocates as it first touches them. Only that thread writes to it.
+
+typedef struct _s_shard_t s_shard_t;
+struct _s_shard_t {
+    zmetrics_t *owner;          //  Registry, or NULL once it's destroyed
+    s_shard_t *next;            //  Next shard of the registry
+    s_shard_t *thread_next;     //  Next shard of the thread
+    bool retired;               //  Its thread has exited
+    uint64_t *chunks [CHUNKS_MAX];
+};
+
+//  Structure of our class
+
+struct _zmetrics_t {
+    s_metric_t *metrics [METRICS_MAX];
+    size_t nbr_metrics;         //  Metrics registered so far
+    size_t nbr_slots;           //  Shard slots used so far
+    s_shard_t *shards;          //  All shards, live and retired
+};
+
+#if defined (__UNIX__)
+//  Each thread keeps a list of its shards, one per registry it has updated.
+//  One mutex covers registration and the lists of shards, which we only
+//  change when a thread first updates a registry, or exits, or when a
+//  registry is destroyed. A shard is freed by whichever comes last of its
+//  thread's exit and its registry's destruction.
+
+static CZMQ_THREADLS s_shard_t *s_shards = NULL;
+static pthread_key_t s_shards_key;
+static pthread_once_t s_shards_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t s_metrics_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void
+s_shard_destroy (s_shard_t **self_p)
+{
+    s_shard_t *self = *self_p;
+    size_t index;
+    for (index = 0; index < CHUNKS_MAX; index++)
+        freen (self->chunks [index]);
+    freen (self);
+    *self_p = NULL;
+}
+
+//  Called when a thread exits, to retire its shards
+
+static void
+s_shards_free (void *arg)
+{
+    pthread_mutex_lock (&s_metrics_mutex);
+    s_shard_t *shard = (s_shard_t *) arg;
+    while (shard) {
+        s_shard_t *next = shard->thread_next;
+        if (shard->owner)
+            shard->retired = true;
+        else
+            s_shard_destroy (&shard);
+        shard = next;
+    }
+    pthread_mutex_unlock (&s_metrics_mutex);
+    s_shards = NULL;
+}
+
+static void
+s_shards_init (void)
+{
+    int rc = pthread_key_create (&s_shards_key, s_shards_free);
+    assert (rc == 0);
+}
+
+//  Return the calling thread's shard of a registry, taking one over or
+//  creating one if needed. Only this thread changes its list of shards,
+//  so we can look through it without a lock.
+
+static s_shard_t *
+s_shard_get (zmetrics_t *self)
+{
+    s_shard_t *shard;
+    for (shard = s_shards; shard; shard = shard->thread_next)
+        if (__atomic_load_n (&shard->owner, __ATOMIC_RELAXED) == self)
+            return shard;
+
+    pthread_once (&s_shards_once, s_shards_init);
+    pthread_mutex_lock (&s_metrics_mutex);
+    //  Drop the shards of registries destroyed since we last looked
+    s_shard_t **link = &s_shards;
+    while (*link) {
+        shard = *link;
+        if (shard->owner)
+            link = &shard->thread_next;
+        else {
+            *link = shard->thread_next;
+            s_shard_destroy (&shard);
+        }
+    }
+    for (shard = self->shards; shard; shard = shard->next)
+        if (shard->retired)
+            break;
+    if (shard)
+        shard->retired = false;
+    else {
+        shard = (s_shard_t *) zmalloc (sizeof (s_shard_t));
+        assert (shard);
+        shard->owner = self;
+        shard->next = self->shards;
+        self->shards = shard;
+    }
+    shard->thread_next = s_shards;
+    s_shards = shard;
+    pthread_setspecific (s_shards_key, s_shards);
+    pthread_mutex_unlock (&s_metrics_mutex);
+    return shard;
+}
+
+//  Return the calling thread's count in a slot
+
+static uint64_t *
+s_slot (zmetrics_t *self, size_t slot)
+{
+    s_shard_t *shard = s_shard_get (self);
+    uint64_t **chunk_p = &shard->chunks [slot / CHUNK_SLOTS];
+    uint64_t *chunk = __atomic_load_n (chunk_p, __ATOMIC_RELAXED);
+    if (!chunk) {
+        chunk = (uint64_t *) zmalloc (CHUNK_SLOTS * sizeof (uint64_t));
+        assert (chunk);
+        __atomic_store_n (chunk_p, chunk, __ATOMIC_RELEASE);
+    }
+    return chunk + slot % CHUNK_SLOTS;
+}
+
+//  Add up a slot over all shards; call with the mutex held
+
+static uint64_t
+s_slot_total (zmetrics_t *self, size_t slot)
+{
+    uint64_t total = 0;
+    s_shard_t *shard;
+    for (shard = self->shards; shard; shard = shard->next) {
+        uint64_t *chunk = __atomic_load_n (
+            &shard->chunks [slot / CHUNK_SLOTS], __ATOMIC_ACQUIRE);
+        if (chunk)
+            total += __atomic_load_n (chunk + slot % CHUNK_SLOTS, __ATOMIC_RELAXED);
+    }
+    return total;
+}
+#endif
+
+//  Doubles travel through our slots as their bits
+
+static uint64_t
+s_real_bits (double value)
+{
+    uint64_t bits;
+    memcpy (&bits, &value, sizeof (bits));
+    return bits;
+}
+
+static double
+s_bits_real (uint64_t bits)
+{
+    double value;
+    memcpy (&value, &bits, sizeof (value));
+    return value;
+}
+
+#if defined (__UNIX__)
+//  Add up a slot that holds doubles over all shards; call with the mutex
+//  held. Each shard's bits must become a double before we add them.
+
+static double
+s_slot_real_total (zmetrics_t *self, size_t slot)
+{
+    double total = 0;
+    s_shard_t *shard;
+    for (shard = self->shards; shard; shard = shard->next) {
+        uint64_t *chunk = __atomic_load_n (
+            &shard->chunks [slot / CHUNK_SLOTS], __ATOMIC_ACQUIRE);
+        if (chunk)
+            total += s_bits_real (
+                __atomic_load_n (chunk + slot % CHUNK_SLOTS, __ATOMIC_RELAXED));
+    }
+    return total;
+}
+#endif
+
+
+//  --------------------------------------------------------------------------
+//  Create a new, empty metrics registry. Returns NULL on platforms
+//  without POSIX threads.
+
+zmetrics_t *
+zmetrics_new (void)
+{
+#if defined (__UNIX__)
+    zmetrics_t *self = (zmetrics_t *) zmalloc (sizeof (zmetrics_t));
+    assert (self);
+    return self;
+#else
+    zsys_error ("zmetrics: not supported on this platform");
+    return NULL;
+#endif
+}
+
+
+//  --------------------------------------------------------------------------
+//  Destroy a metrics registry. No thread may still be updating it.
+
+void
+zmetrics_destroy (zmetrics_t **self_p)
+{
+    assert (self_p);
+    if (*self_p) {
+        zmetrics_t *self = *self_p;
+#if defined (__UNIX__)
+        //  Free the shards of exited threads, and leave the others for
+        //  their threads to free
+        pthread_mutex_lock (&s_metrics_mutex);
+        s_shard_t *shard = self->shards;
+        while (shard) {
+            s_shard_t *next = shard->next;
+            if (shard->retired)
+                s_shard_destroy (&shard);
+            else
+                __atomic_store_n (&shard->owner, NULL, __ATOMIC_RELAXED);
+            shard = next;
+        }
+        pthread_mutex_unlock (&s_metrics_mutex);
+#endif
+        size_t index;
+        for (index = 0; index < self->nbr_metrics; index++) {
+            s_metric_t *metric = self->metrics [index];
+            freen (metric->name);
+            freen (metric->help);
+            freen (metric->bounds);
+            freen (metric);
+        }
+        freen (self);
+        *self_p = NULL;
+    }
+}
+
+
+//  --------------------------------------------------------------------------
+//  Check a metric name, and return the length of its base name without
+//  labels, or 0 if it is not valid
+
+static size_t
+s_name_base_size (const char *name)
+{
+    const char *scan = name;
+    if (!(isalpha ((byte) *scan) || *scan == '_' || *scan == ':'))
+        return 0;
+    while (isalnum ((byte) *scan) || *scan == '_' || *scan == ':')
+        scan++;
+    size_t base_size = scan - name;
+    if (*scan == '{') {
+        //  Labels run to the end of the name, on a single line
+        size_t size = strlen (scan);
+        if (scan [size - 1] != '}' || strchr (scan, '\n'))
+            return 0;
+    }
+    else
+    if (*scan)
+        return 0;
+    return base_size;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Register a metric of any type, and return its id or -1
+
+static int
+s_metrics_register (zmetrics_t *self, s_metric_type_t type, const char *name,
+                    const char *help, double start, double factor, size_t buckets)
+{
+    assert (self);
+    assert (name);
+#if defined (__UNIX__)
+    size_t base_size = s_name_base_size (name);
+    if (base_size == 0)
+        return -1;
+    size_t nbr_slots = type == METRIC_COUNTER? 1:
+                       type == METRIC_HISTOGRAM? buckets + 2: 0;
+
+    int id = -1;
+    pthread_mutex_lock (&s_metrics_mutex);
+    if (self->nbr_metrics < METRICS_MAX
+    &&  self->nbr_slots + nbr_slots <= CHUNK_SLOTS * CHUNKS_MAX) {
+        //  Names must be unique, and a family must have just one type
+        size_t index;
+        for (index = 0; index < self->nbr_metrics; index++) {
+            s_metric_t *metric = self->metrics [index];
+            if (streq (metric->name, name)
+            || (metric->base_size == base_size
+            &&  memcmp (metric->name, name, base_size) == 0
+            &&  metric->type != type))
+                break;
+        }
+        if (index == self->nbr_metrics)
+            id = (int) self->nbr_metrics;
+    }
+    if (id != -1) {
+        s_metric_t *metric = (s_metric_t *) zmalloc (sizeof (s_metric_t));
+        assert (metric);
+        metric->type = type;
+        metric->name = strdup (name);
+        metric->base_size = base_size;
+        metric->help = help? strdup (help): NULL;
+        metric->slot = self->nbr_slots;
+        metric->gauge = s_real_bits (0);
+        if (type == METRIC_HISTOGRAM) {
+            metric->buckets = buckets;
+            metric->bounds = (double *) zmalloc (buckets * sizeof (double));
+            assert (metric->bounds);
+            size_t bucket;
+            for (bucket = 0; bucket < buckets; bucket++) {
+                metric->bounds [bucket] = start;
+                start *= factor;
+            }
+        }
+        self->metrics [id] = metric;
+        self->nbr_metrics++;
+        self->nbr_slots += nbr_slots;
+    }
+    pthread_mutex_unlock (&s_metrics_mutex);
+    return id;
+#else
+    return -1;
+#endif
+}
+
+
+//  --------------------------------------------------------------------------
+//  Register a counter, which only goes up. The name follows Prometheus
+//  rules, and may end in labels, e.g. 'requests_total{method="get"}'.
+//  The help text may be NULL. Returns the metric's id, or -1 if the name
+//  is invalid or already taken, or the registry is full.
+
+int
+zmetrics_counter (zmetrics_t *self, const char *name, const char *help)
+{
+    return s_metrics_register (self, METRIC_COUNTER, name, help, 0, 0, 0);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Register a gauge, which can go up and down. Arguments and return
+//  value are as for counter.
+
+int
+zmetrics_gauge (zmetrics_t *self, const char *name, const char *help)
+{
+    return s_metrics_register (self, METRIC_GAUGE, name, help, 0, 0, 0);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Register a histogram with exponential buckets: the first bucket
+//  holds values up to start, and each next bucket's upper bound is
+//  factor times the one before. There is always a final bucket for
+//  larger values. Returns -1 if start is not positive, factor is not
+//  above 1, or buckets is zero or over 64; otherwise as for counter.
+
+int
+zmetrics_histogram (zmetrics_t *self, const char *name, const char *help,
+                    double start, double factor, size_t buckets)
+{
+    if (!(start > 0) || !(factor > 1) || buckets == 0 || buckets > BUCKETS_MAX)
+        return -1;
+    return s_metrics_register (
+        self, METRIC_HISTOGRAM, name, help, start, factor, buckets);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return a registered metric, checking its type
+
+static s_metric_t *
+s_metric (zmetrics_t *self, int id, s_metric_type_t type)
+{
+    assert (self);
+    assert (id >= 0 && (size_t) id < METRICS_MAX);
+    s_metric_t *metric = self->metrics [id];
+    assert (metric);
+    assert (metric->type == type);
+    return metric;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Add a value to a counter. Lock-free; each thread counts on its own
+//  shard of the registry.
+
+void
+zmetrics_add (zmetrics_t *self, int id, uint64_t value)
+{
+    s_metric_t *metric = s_metric (self, id, METRIC_COUNTER);
+#if defined (__UNIX__)
+    //  We are the only writer, but other threads may read the count
+    uint64_t *count = s_slot (self, metric->slot);
+    __atomic_store_n (count,
+        __atomic_load_n (count, __ATOMIC_RELAXED) + value, __ATOMIC_RELAXED);
+#else
+    (void) metric;
+#endif
+}
+
+
+//  --------------------------------------------------------------------------
+//  Set a gauge to a value. Lock-free.
+
+void
+zmetrics_set (zmetrics_t *self, int id, double value)
+{
+    s_metric_t *metric = s_metric (self, id, METRIC_GAUGE);
+    __atomic_store_n (&metric->gauge, s_real_bits (value), __ATOMIC_RELAXED);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Add a positive or negative value to a gauge. Lock-free.
+
+void
+zmetrics_adjust (zmetrics_t *self, int id, double delta)
+{
+    s_metric_t *metric = s_metric (self, id, METRIC_GAUGE);
+    uint64_t bits = __atomic_load_n (&metric->gauge, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n (&metric->gauge, &bits,
+        s_real_bits (s_bits_real (bits) + delta),
+        true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) ;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Record a value in a histogram. Lock-free, and on the thread's own
+//  shard, like counters.
+
+void
+zmetrics_observe (zmetrics_t *self, int id, double value)
+{
+    s_metric_t *metric = s_metric (self, id, METRIC_HISTOGRAM);
+#if defined (__UNIX__)
+    //  Find the first bucket whose bound is not below the value; a value
+    //  above all bounds, or NaN, goes in the last bucket
+    size_t low = 0;
+    size_t high = metric->buckets;
+    while (low < high) {
+        size_t middle = (low + high) / 2;
+        if (value <= metric->bounds [middle])
+            high = middle;
+        else
+            low = middle + 1;
+    }
+    uint64_t *count = s_slot (self, metric->slot + low);
+    __atomic_store_n (count,
+        __atomic_load_n (count, __ATOMIC_RELAXED) + 1, __ATOMIC_RELAXED);
+    uint64_t *sum = s_slot (self, metric->slot + metric->buckets + 1);
+    __atomic_store_n (sum, s_real_bits (
+        s_bits_real (__atomic_load_n (sum, __ATOMIC_RELAXED)) + value),
+        __ATOMIC_RELAXED);
+#else
+    (void) metric;
+#endif
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return the current value of a metric: the total over all threads for
+//  a counter, the value of a gauge, or the number of observations in a
+//  histogram.
+
+double
+zmetrics_value (zmetrics_t *self, int id)
+{
+    assert (self);
+    assert (id >= 0 && (size_t) id < METRICS_MAX);
+    s_metric_t *metric = self->metrics [id];
+    assert (metric);
+    if (metric->type == METRIC_GAUGE)
+        return s_bits_real (__atomic_load_n (&metric->gauge, __ATOMIC_RELAXED));
+
+    uint64_t total = 0;
+#if defined (__UNIX__)
+    pthread_mutex_lock (&s_metrics_mutex);
+    size_t nbr_slots = metric->type == METRIC_COUNTER? 1: metric->buckets + 1;
+    size_t slot;
+    for (slot = 0; slot < nbr_slots; slot++)
+        total += s_slot_total (self, metric->slot + slot);
+    pthread_mutex_unlock (&s_metrics_mutex);
+#endif
+    return (double) total;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Append formatted text to a chunk
+
+static void
+s_emit (zchunk_t *chunk, const char *format, ...)
+{
+    va_list argptr;
+    va_start (argptr, format);
+    char *string = zsys_vprintf (format, argptr);
+    va_end (argptr);
+    assert (string);
+    zchunk_extend (chunk, string, strlen (string));
+    freen (string);
+}
+
+//  Format a real the way Prometheus writes it, into the buffer if needed
+
+static const char *
+s_real_str (double value, char *buffer, size_t size)
+{
+    if (isnan (value))
+        return "NaN";
+    else
+    if (isinf (value))
+        return value > 0? "+Inf": "-Inf";
+    snprintf (buffer, size, "%.15g", value);
+    return buffer;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return all metrics in the Prometheus text exposition format, as a
+//  fresh string.
+
+char *
+zmetrics_render (zmetrics_t *self)
+{
+    assert (self);
+    zchunk_t *chunk = zchunk_new (NULL, 4096);
+    assert (chunk);
+    char real [32];
+#if defined (__UNIX__)
+    pthread_mutex_lock (&s_metrics_mutex);
+#endif
+    size_t index;
+    for (index = 0; index < self->nbr_metrics; index++) {
+        s_metric_t *metric = self->metrics [index];
+        int base_size = (int) metric->base_size;
+        const char *labels = metric->name + base_size;
+
+        //  The first metric of a family carries its help and type
+        s_metric_t *previous = index? self->metrics [index - 1]: NULL;
+        if (!previous
+        ||  previous->base_size != metric->base_size
+        ||  memcmp (previous->name, metric->name, base_size)) {
+            if (metric->help) {
+                s_emit (chunk, "# HELP %.*s ", base_size, metric->name);
+                const char *scan;
+                for (scan = metric->help; *scan; scan++)
+                    if (*scan == '\\')
+                        zchunk_extend (chunk, "\\\\", 2);
+                    else
+                    if (*scan == '\n')
+                        zchunk_extend (chunk, "\\n", 2);
+                    else
+                        zchunk_extend (chunk, scan, 1);
+                zchunk_extend (chunk, "\n", 1);
+            }
+            s_emit (chunk, "# TYPE %.*s %s\n", base_size, metric->name,
+                metric->type == METRIC_COUNTER? "counter":
+                metric->type == METRIC_GAUGE? "gauge": "histogram");
+        }
+        if (metric->type == METRIC_GAUGE)
+            s_emit (chunk, "%s %s\n", metric->name, s_real_str (s_bits_real (
+                __atomic_load_n (&metric->gauge, __ATOMIC_RELAXED)),
+                real, sizeof (real)));
+#if defined (__UNIX__)
+        else
+        if (metric->type == METRIC_COUNTER)
+            s_emit (chunk, "%s %" PRIu64 "\n", metric->name,
+                s_slot_total (self, metric->slot));
+        else {
+            //  Histogram buckets are cumulative, and le joins any labels
+            //  the metric already has
+            int labels_size = *labels? (int) strlen (labels) - 1: 0;
+            const char *separator = *labels? ",": "{";
+            uint64_t count = 0;
+            size_t bucket;
+            for (bucket = 0; bucket <= metric->buckets; bucket++) {
+                count += s_slot_total (self, metric->slot + bucket);
+                s_emit (chunk, "%.*s_bucket%.*s%sle=\"%s\"} %" PRIu64 "\n",
+                    base_size, metric->name, labels_size, labels, separator,
+                    bucket < metric->buckets
+                        ? s_real_str (metric->bounds [bucket], real, sizeof (real))
+                        : "+Inf",
+                    count);
+            }
+            double sum = s_slot_real_total (self, metric->slot + metric->buckets + 1);
+            s_emit (chunk, "%.*s_sum%s %s\n", base_size, metric->name,
+                labels, s_real_str (sum, real, sizeof (real)));
+            s_emit (chunk, "%.*s_count%s %" PRIu64 "\n", base_size, metric->name,
+                labels, count);
+        }
+#endif
+    }
+#if defined (__UNIX__)
+    pthread_mutex_unlock (&s_metrics_mutex);
+#endif
+    char *text = zchunk_strdup (chunk);
+    zchunk_destroy (&chunk);
+    return text;
+}
+
+
+//  --------------------------------------------------------------------------
+//  The actor that serves a registry over HTTP
+
+#ifdef HAVE_LIBMICROHTTPD
+typedef struct {
+    zmetrics_t *metrics;
+    int port;
+} s_server_args_t;
+
+static void
+s_server_actor (zsock_t *pipe, void *args)
+{
+    //  The arguments live on the caller's stack until we signal
+    zmetrics_t *metrics = ((s_server_args_t *) args)->metrics;
+    zhttp_server_options_t *options = zhttp_server_options_new ();
+    assert (options);
+    zhttp_server_options_set_port (options, ((s_server_args_t *) args)->port);
+    zhttp_server_t *server = zhttp_server_new (options);
+    assert (server);
+    zsock_t *worker = zsock_new_dealer (zhttp_server_options_backend_address (options));
+    assert (worker);
+    zpoller_t *poller = zpoller_new (pipe, worker, NULL);
+    assert (poller);
+    zsock_signal (pipe, 0);
+
+    zhttp_request_t *request = zhttp_request_new ();
+    zhttp_response_t *response = zhttp_response_new ();
+    while (!zsys_interrupted) {
+        zsock_t *which = (zsock_t *) zpoller_wait (poller, -1);
+        if (which == pipe) {
+            char *command = zstr_recv (pipe);
+            bool terminate = !command || streq (command, "$TERM");
+            zstr_free (&command);
+            if (terminate)
+                break;
+        }
+        else
+        if (which == worker) {
+            void *connection = zhttp_request_recv (request, worker);
+            if (!connection)
+                continue;
+            if (streq (zhttp_request_method (request), "GET")
+            &&  streq (zhttp_request_url (request), "/metrics")) {
+                char *text = zmetrics_render (metrics);
+                zhttp_response_set_content (response, &text);
+                zhttp_response_set_content_type (response,
+                    "text/plain; version=0.0.4; charset=utf-8");
+                zhttp_response_set_status_code (response, 200);
+            }
+            else {
+                zhttp_response_set_content_const (response, "Not found\n");
+                zhttp_response_set_content_type (response, "text/plain");
+                zhttp_response_set_status_code (response, 404);
+            }
+            zhttp_response_send (response, worker, &connection);
+        }
+        else
+            break;              //  Interrupted
+    }
+    zhttp_request_destroy (&request);
+    zhttp_response_destroy (&response);
+    zpoller_destroy (&poller);
+    zsock_destroy (&worker);
+    zhttp_server_destroy (&server);
+    zhttp_server_options_destroy (&options);
+}
+#endif
+
+
+//  --------------------------------------------------------------------------
+//  Serve the metrics over HTTP on the given port, in the Prometheus text
+//  format, at the /metrics path. Returns an actor that runs the server;
+//  destroy it to stop serving. Returns NULL if CZMQ was built without
+//  libmicrohttpd.
+
+zactor_t *
+zmetrics_serve (zmetrics_t *self, int port)
+{
+    assert (self);
+#ifdef HAVE_LIBMICROHTTPD
+    s_server_args_t args = { self, port };
+    return zactor_new (s_server_actor, &args);
+#else
+    (void) port;
+    return NULL;
+#endif
+}
+
+
+//  --------------------------------------------------------------------------
+//  Selftest
+
+#if defined (__UNIX__)
+#define TEST_THREADS    4
+#define TEST_UPDATES    100000
+
+//  Updates each metric TEST_UPDATES times, then exits
+
+static void
+s_test_updater (zsock_t *pipe, void *args)
+{
+    zmetrics_t *metrics = (zmetrics_t *) args;
+    zsock_signal (pipe, 0);
+    int index;
+    for (index = 0; index < TEST_UPDATES; index++) {
+        zmetrics_add (metrics, 0, 1);
+        zmetrics_observe (metrics, 2, index % 10);
+        zmetrics_adjust (metrics, 1, 1);
+    }
+}
+#endif
+
+void
+zmetrics_test (bool verbose)
+{
+    printf (" * zmetrics: ");
+    if (verbose)
+        printf ("\n");
+
+#if defined (__UNIX__)
+    //  @selftest
+    zmetrics_t *metrics = zmetrics_new ();
+    assert (metrics);
+    int requests = zmetrics_counter (metrics, "requests_total", "Requests handled");
+    assert (requests == 0);
+    int sessions = zmetrics_gauge (metrics, "sessions", NULL);
+    assert (sessions == 1);
+    int latency = zmetrics_histogram (metrics, "latency_seconds",
+        "Time to handle a request.\nIn seconds", 0.001, 10, 3);
+    assert (latency == 2);
+
+    //  Names must be valid and unique, and histograms sensible
+    assert (zmetrics_counter (metrics, "requests_total", NULL) == -1);
+    assert (zmetrics_gauge (metrics, "requests_total{method=\"get\"}", NULL) == -1);
+    assert (zmetrics_counter (metrics, "9lives", NULL) == -1);
+    assert (zmetrics_counter (metrics, "bad-name", NULL) == -1);
+    assert (zmetrics_counter (metrics, "open{label=\"x\"", NULL) == -1);
+    assert (zmetrics_histogram (metrics, "spread", NULL, 0, 2, 4) == -1);
+    assert (zmetrics_histogram (metrics, "spread", NULL, 1, 1, 4) == -1);
+    assert (zmetrics_histogram (metrics, "spread", NULL, 1, 2, 65) == -1);
+
+    zmetrics_add (metrics, requests, 3);
+    zmetrics_add (metrics, requests, 4);
+    zmetrics_set (metrics, sessions, 10);
+    zmetrics_adjust (metrics, sessions, -2.5);
+    zmetrics_observe (metrics, latency, 0.0005);
+    zmetrics_observe (metrics, latency, 0.001);
+    zmetrics_observe (metrics, latency, 0.05);
+    zmetrics_observe (metrics, latency, 7);
+    assert (zmetrics_value (metrics, requests) == 7);
+    assert (zmetrics_value (metrics, sessions) == 7.5);
+    assert (zmetrics_value (metrics, latency) == 4);
+
+    //  Labelled metrics of one family render under one header
+    int get = zmetrics_counter (metrics, "calls_total{method=\"get\"}", "Calls");
+    int put = zmetrics_counter (metrics, "calls_total{method=\"put\"}", "Calls");
+    int size = zmetrics_histogram (metrics, "size_bytes{queue=\"in\"}", NULL, 100, 2, 1);
+    assert (get == 3 && put == 4 && size == 5);
+    zmetrics_add (metrics, put, 1);
+    zmetrics_observe (metrics, size, 150);
+
+    char *text = zmetrics_render (metrics);
+    assert (text);
+    if (verbose)
+        printf ("%s", text);
+    assert (streq (text,
+        "# HELP requests_total Requests handled\n"
+        "# TYPE requests_total counter\n"
+        "requests_total 7\n"
+        "# TYPE sessions gauge\n"
+        "sessions 7.5\n"
+        "# HELP latency_seconds Time to handle a request.\\nIn seconds\n"
+        "# TYPE latency_seconds histogram\n"
+        "latency_seconds_bucket{le=\"0.001\"} 2\n"
+        "latency_seconds_bucket{le=\"0.01\"} 2\n"
+        "latency_seconds_bucket{le=\"0.1\"} 3\n"
+        "latency_seconds_bucket{le=\"+Inf\"} 4\n"
+        "latency_seconds_sum 7.0515\n"
+        "latency_seconds_count 4\n"
+        "# HELP calls_total Calls\n"
+        "# TYPE calls_total counter\n"
+        "calls_total{method=\"get\"} 0\n"
+        "calls_total{method=\"put\"} 1\n"
+        "# TYPE size_bytes histogram\n"
+        "size_bytes_bucket{queue=\"in\",le=\"100\"} 0\n"
+        "size_bytes_bucket{queue=\"in\",le=\"+Inf\"} 1\n"
+        "size_bytes_sum{queue=\"in\"} 150\n"
+        "size_bytes_count{queue=\"in\"} 1\n"));
+    zstr_free (&text);
+    zmetrics_destroy (&metrics);
+    //  @end
+
+    //  Updates from many threads, some of which have exited, add up
+    metrics = zmetrics_new ();
+    assert (metrics);
+    zmetrics_counter (metrics, "updates_total", NULL);
+    zmetrics_gauge (metrics, "adjustments", NULL);
+    zmetrics_histogram (metrics, "digits", NULL, 1, 2, 4);
+    zactor_t *updaters [TEST_THREADS];
+    int index;
+    for (index = 0; index < TEST_THREADS; index++)
+        updaters [index] = zactor_new (s_test_updater, metrics);
+    for (index = 0; index < TEST_THREADS; index++)
+        zactor_destroy (&updaters [index]);
+    //  Later threads take over the shards that these leave, though a
+    //  thread may still be exiting when the next one starts
+    for (index = 0; index < TEST_THREADS; index++) {
+        zactor_t *updater = zactor_new (s_test_updater, metrics);
+        zactor_destroy (&updater);
+    }
+    size_t shards = 0;
+    s_shard_t *shard;
+    for (shard = metrics->shards; shard; shard = shard->next)
+        shards++;
+    assert (shards <= TEST_THREADS + 1);
+    assert (zmetrics_value (metrics, 0) == 2 * TEST_THREADS * TEST_UPDATES);
+    assert (zmetrics_value (metrics, 1) == 2 * TEST_THREADS * TEST_UPDATES);
+    assert (zmetrics_value (metrics, 2) == 2 * TEST_THREADS * TEST_UPDATES);
+    //  Each thread observes 0 to 9 in turn, so sums to 45 every 10 updates
+    text = zmetrics_render (metrics);
+    char line [64];
+    snprintf (line, sizeof (line), "\ndigits_sum %d\n",
+        2 * TEST_THREADS * TEST_UPDATES / 10 * 45);
+    assert (strstr (text, line));
+    snprintf (line, sizeof (line), "\ndigits_count %d\n",
+        2 * TEST_THREADS * TEST_UPDATES);
+    assert (strstr (text, line));
+    zstr_free (&text);
+
+    //  Our own shard outlives the registry until we next need one
+    zmetrics_add (metrics, 0, 1);
+    assert (s_shards && s_shards->owner == metrics);
+    zmetrics_destroy (&metrics);
+    assert (s_shards && s_shards->owner == NULL);
+    metrics = zmetrics_new ();
+    zmetrics_counter (metrics, "updates_total", NULL);
+    zmetrics_add (metrics, 0, 1);
+    assert (zmetrics_value (metrics, 0) == 1);
+    assert (s_shards->owner == metrics && s_shards->thread_next == NULL);
+
+    if (verbose) {
+        int64_t start = zclock_usecs ();
+        for (index = 0; index < 10000000; index++)
+            zmetrics_add (metrics, 0, 1);
+        int64_t elapsed = zclock_usecs () - start;
+        zsys_info ("zmetrics: %.1f ns per counter update",
+            (double) elapsed * 1000 / 10000000);
+    }
+    zmetrics_destroy (&metrics);
+
+#if defined (HAVE_LIBCURL) && defined (HAVE_LIBMICROHTTPD)
+    //  @selftest
+    //  Serve the metrics to a Prometheus scraper
+    metrics = zmetrics_new ();
+    zmetrics_counter (metrics, "scrapes_total", NULL);
+    zmetrics_add (metrics, 0, 1);
+    int port = 40000 + randof (10000);
+    zactor_t *server = zmetrics_serve (metrics, port);
+    assert (server);
+    //  @end
+
+    char url [256];
+    snprintf (url, sizeof (url), "http://127.0.0.1:%d/metrics", port);
+    zhttp_client_t *client = zhttp_client_new (verbose);
+    assert (client);
+    zhttp_request_t *request = zhttp_request_new ();
+    zhttp_request_set_url (request, url);
+    zhttp_request_set_method (request, "GET");
+    int rc = zhttp_request_send (request, client, 10000, NULL, NULL);
+    assert (rc == 0);
+    zhttp_response_t *response = zhttp_response_new ();
+    void *user_arg, *user_arg2;
+    rc = zhttp_response_recv (response, client, &user_arg, &user_arg2);
+    assert (rc == 0);
+    assert (zhttp_response_status_code (response) == 200);
+    assert (streq (zhttp_response_content (response),
+        "# TYPE scrapes_total counter\nscrapes_total 1\n"));
+    zhttp_response_destroy (&response);
+    zhttp_request_destroy (&request);
+    zhttp_client_destroy (&client);
+
+    //  @selftest
+    zactor_destroy (&server);
+    zmetrics_destroy (&metrics);
+    //  @end
+#endif
+#endif
+
+#if defined (__WINDOWS__)
+    zsys_shutdown ();
+#endif
+
+    printf ("OK\n");
+}
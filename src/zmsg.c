@@ -27,15 +27,196 @@
 //  their data, which lets us do runtime object typing & validation.
 #define ZMSG_TAG            0xcafe0003
 
+//  Number of frames we hold inside the message itself; larger messages
+//  move their frames to a heap array. Must be a power of two.
+#define ZMSG_INLINE_FRAMES  8
+
 //  Structure of our class
 
 struct _zmsg_t {
     uint32_t tag;               //  Object tag for runtime detection
-    zlist_t *frames;            //  List of frames
+    zframe_t **frames;          //  Ring of frames, inline or on heap
+    size_t limit;               //  Size of ring, a power of two
+    size_t head;                //  Index of first frame in ring
+    size_t count;               //  Number of frames in ring
+    size_t cursor;              //  Current frame plus one, or zero
     size_t content_size;        //  Total content size
     uint32_t routing_id;        //  Routing ID back to sender, if any
+    zframe_t *inline_frames [ZMSG_INLINE_FRAMES];
 };
 
+//  Each thread keeps a pool of free messages for reuse. All the pools together
+//  hold no more than the size set by zsys_set_pool_size. Freeing the pool
+//  when a thread exits needs a thread-specific destructor, which we have
+//  only with POSIX threads.
+
+#if defined (__UNIX__)
+#   define ZMSG_POOL
+
+typedef struct {
+    zmsg_t *free;               //  Free messages, linked via frames
+    size_t size;                //  Number of free messages
+    uint64_t hits;              //  Messages taken from pool
+    uint64_t misses;            //  Messages allocated while pooling
+} s_pool_t;
+
+static CZMQ_THREADLS s_pool_t *s_pool = NULL;
+static pthread_key_t s_pool_key;
+static pthread_once_t s_pool_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t s_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t s_pool_hits = 0;        //  Totals from exited threads
+static uint64_t s_pool_misses = 0;
+static size_t s_pooled = 0;             //  Objects in all pools, for the cap
+
+static void
+s_pool_free (void *arg)
+{
+    s_pool_t *pool = (s_pool_t *) arg;
+    while (pool->free) {
+        zmsg_t *self = pool->free;
+        pool->free = (zmsg_t *) self->frames;
+        freen (self);
+    }
+    __atomic_sub_fetch (&s_pooled, pool->size, __ATOMIC_RELAXED);
+    pthread_mutex_lock (&s_pool_mutex);
+    s_pool_hits += pool->hits;
+    s_pool_misses += pool->misses;
+    pthread_mutex_unlock (&s_pool_mutex);
+    freen (pool);
+    s_pool = NULL;
+}
+
+static void
+s_pool_init (void)
+{
+    int rc = pthread_key_create (&s_pool_key, s_pool_free);
+    assert (rc == 0);
+}
+
+static s_pool_t *
+s_pool_get (void)
+{
+    if (!s_pool) {
+        pthread_once (&s_pool_once, s_pool_init);
+        s_pool = (s_pool_t *) zmalloc (sizeof (s_pool_t));
+        assert (s_pool);
+        pthread_setspecific (s_pool_key, s_pool);
+    }
+    return s_pool;
+}
+#endif
+
+//  Allocate a message, from the pool if we can. Returns zeroed memory.
+
+static zmsg_t *
+s_msg_alloc (void)
+{
+#if defined (ZMSG_POOL)
+    if (zsys_pool_size ()) {
+        s_pool_t *pool = s_pool_get ();
+        zmsg_t *self = pool->free;
+        if (self) {
+            pool->free = (zmsg_t *) self->frames;
+            pool->size--;
+            __atomic_sub_fetch (&s_pooled, 1, __ATOMIC_RELAXED);
+            pool->hits++;
+            memset (self, 0, sizeof (zmsg_t));
+            return self;
+        }
+        pool->misses++;
+    }
+#endif
+    zmsg_t *self = (zmsg_t *) zmalloc (sizeof (zmsg_t));
+    assert (self);
+    return self;
+}
+
+//  Free a message, to the pool if it has room
+
+static void
+s_msg_free (zmsg_t *self)
+{
+#if defined (ZMSG_POOL)
+    //  The cap is on objects pooled by all threads together
+    if (zsys_pool_size ()) {
+        if (__atomic_add_fetch (&s_pooled, 1, __ATOMIC_RELAXED) <= zsys_pool_size ()) {
+            s_pool_t *pool = s_pool_get ();
+            self->frames = (zframe_t **) pool->free;
+            pool->free = self;
+            pool->size++;
+            return;
+        }
+        __atomic_sub_fetch (&s_pooled, 1, __ATOMIC_RELAXED);
+    }
+#endif
+    freen (self);
+}
+
+//  The frames work like a zlist, and the cursor follows zlist's rules: it
+//  is cleared by adding or popping a frame, and moves back to the previous
+//  frame if its own frame is removed. Index is relative to the first frame.
+
+static zframe_t **
+s_frame_at (zmsg_t *self, size_t index)
+{
+    return &self->frames [(self->head + index) & (self->limit - 1)];
+}
+
+static void
+s_frames_grow (zmsg_t *self)
+{
+    zframe_t **frames = (zframe_t **) zmalloc (self->limit * 2 * sizeof (zframe_t *));
+    assert (frames);
+    size_t index;
+    for (index = 0; index < self->count; index++)
+        frames [index] = *s_frame_at (self, index);
+    if (self->frames != self->inline_frames)
+        freen (self->frames);
+    self->frames = frames;
+    self->limit *= 2;
+    self->head = 0;
+}
+
+static void
+s_frame_push (zmsg_t *self, zframe_t *frame)
+{
+    if (self->count == self->limit)
+        s_frames_grow (self);
+    self->head = (self->head - 1) & (self->limit - 1);
+    self->frames [self->head] = frame;
+    self->count++;
+    self->cursor = 0;
+}
+
+static void
+s_frame_append (zmsg_t *self, zframe_t *frame)
+{
+    if (self->count == self->limit)
+        s_frames_grow (self);
+    *s_frame_at (self, self->count) = frame;
+    self->count++;
+    self->cursor = 0;
+}
+
+static zframe_t *
+s_frame_pop (zmsg_t *self)
+{
+    zframe_t *frame = NULL;
+    if (self->count) {
+        frame = self->frames [self->head];
+        self->head = (self->head + 1) & (self->limit - 1);
+        self->count--;
+    }
+    self->cursor = 0;
+    return frame;
+}
+
+static zframe_t *
+s_frame_head (zmsg_t *self)
+{
+    return self->count? self->frames [self->head]: NULL;
+}
+
 
 //  --------------------------------------------------------------------------
 //  Constructor
@@ -43,11 +224,10 @@ struct _zmsg_t {
 zmsg_t *
 zmsg_new (void)
 {
-    zmsg_t *self = (zmsg_t *) zmalloc (sizeof (zmsg_t));
-    assert (self);
+    zmsg_t *self = s_msg_alloc ();
     self->tag = ZMSG_TAG;
-    self->frames = zlist_new ();
-    assert (self->frames);
+    self->frames = self->inline_frames;
+    self->limit = ZMSG_INLINE_FRAMES;
     return self;
 }
 
@@ -63,11 +243,12 @@ zmsg_destroy (zmsg_t **self_p)
         zmsg_t *self = *self_p;
         assert (zmsg_is (self));
         zframe_t *frame;
-        while ((frame = (zframe_t *) zlist_pop (self->frames)))
+        while ((frame = s_frame_pop (self)))
             zframe_destroy (&frame);
-        zlist_destroy (&self->frames);
+        if (self->frames != self->inline_frames)
+            freen (self->frames);
         self->tag = 0xDeadBeef;
-        freen (self);
+        s_msg_free (self);
         *self_p = NULL;
     }
 }
@@ -91,7 +272,7 @@ zmsg_recv (void *source)
     while (true) {
         zframe_t *frame = zframe_recv (source);
         if (!frame) {
-            if (errno == EINTR && zlist_head (self->frames))
+            if (errno == EINTR && self->count)
                 continue;
             else {
                 zmsg_destroy (&self);
@@ -133,10 +314,10 @@ zmsg_send (zmsg_t **self_p, void *dest)
         assert (zmsg_is (self));
         bool sent_some = false;
         zframe_t *frame;
-        while ((frame = (zframe_t *) zlist_head (self->frames))) {
+        while ((frame = s_frame_head (self))) {
             zframe_set_routing_id (frame, self->routing_id);
             rc = zframe_send (&frame, dest,
-                              zlist_size (self->frames) > 1? ZFRAME_MORE: 0);
+                              self->count > 1? ZFRAME_MORE: 0);
             if (rc != 0) {
                 if (errno == EINTR && sent_some)
                     continue;
@@ -144,7 +325,7 @@ zmsg_send (zmsg_t **self_p, void *dest)
                     break;
             }
             sent_some = true;
-            (void) zlist_pop (self->frames);
+            (void) s_frame_pop (self);
         }
         if (rc == 0)
             zmsg_destroy (self_p);
@@ -173,7 +354,7 @@ zmsg_sendm (zmsg_t **self_p, void *dest)
         assert (zmsg_is (self));
         bool sent_some = false;
         zframe_t *frame;
-        while ((frame = (zframe_t *) zlist_head (self->frames))) {
+        while ((frame = s_frame_head (self))) {
             zframe_set_routing_id (frame, self->routing_id);
             rc = zframe_send (&frame, dest, ZFRAME_MORE);
             if (rc != 0) {
@@ -183,7 +364,7 @@ zmsg_sendm (zmsg_t **self_p, void *dest)
                     break;
             }
             sent_some = true;
-            (void) zlist_pop (self->frames);
+            (void) s_frame_pop (self);
         }
         if (rc == 0)
             zmsg_destroy (self_p);
@@ -191,6 +372,119 @@ zmsg_sendm (zmsg_t **self_p, void *dest)
     return rc;
 }
 
+//  --------------------------------------------------------------------------
+//  Receive up to max messages from socket into the msgs array. Waits up to
+//  timeout msecs for the first message, or forever if timeout is -1, and
+//  then takes only the messages that are ready, without waiting. This costs
+//  less per message than calling zmsg_recv, as it reads all the frames that
+//  are ready with one call to zframe_recv_batch. Returns the number of
+//  messages received, which is zero if the timeout expired or the call was
+//  interrupted. Caller owns the messages and must destroy them when done.
+
+int
+zmsg_recv_batch (void *source, zmsg_t **msgs, size_t max, int timeout)
+{
+    assert (source);
+    assert (msgs);
+
+    //  Every message has at least one frame, so asking for as many frames
+    //  as we have messages left can never give us too many messages
+    zframe_t **frames = (zframe_t **) zmalloc ((max + 1) * sizeof (zframe_t *));
+    assert (frames);
+    size_t count = 0;
+    zmsg_t *self = NULL;        //  Message we are reading, if any
+    while (count < max) {
+        size_t wanted = max - count;
+        int received = zframe_recv_batch (source, frames, wanted, count || self? 0: timeout);
+        if (received == 0) {
+            //  Keep retrying if interrupted in the middle of a message
+            if (self && errno == EINTR)
+                continue;
+            break;
+        }
+        int frame_nbr;
+        for (frame_nbr = 0; frame_nbr < received; frame_nbr++) {
+            zframe_t *frame = frames [frame_nbr];
+            if (!self)
+                self = zmsg_new ();
+            uint32_t routing_id = zframe_routing_id (frame);
+            if (routing_id)
+                self->routing_id = routing_id;
+            bool more = zframe_more (frame) != 0;
+            zmsg_append (self, &frame);
+            if (!more) {
+                msgs [count++] = self;
+                self = NULL;
+            }
+        }
+        //  We have taken all that was ready, unless we got as many frames
+        //  as we asked for, or we're in the middle of a message
+        if ((size_t) received < wanted && !self)
+            break;
+    }
+    //  A partial message means the socket failed, so we discard it
+    zmsg_destroy (&self);
+    freen (frames);
+    return (int) count;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Send count messages from the msgs array to socket, using one call to
+//  zframe_send_batch for all their frames. Destroys each message after
+//  sending it, and nullifies its reference in the array. Returns the number
+//  of messages sent; if that is less than count, the send failed and errno
+//  says why. The first unsent message keeps any frames that were not sent.
+
+int
+zmsg_send_batch (void *dest, zmsg_t **msgs, size_t count)
+{
+    assert (dest);
+    assert (msgs);
+
+    //  Collect frames from all messages, marking the end of each message
+    size_t frames_total = 0;
+    size_t msg_nbr;
+    for (msg_nbr = 0; msg_nbr < count; msg_nbr++) {
+        assert (zmsg_is (msgs [msg_nbr]));
+        frames_total += msgs [msg_nbr]->count;
+    }
+    zframe_t **frames = (zframe_t **) zmalloc ((frames_total + 1) * sizeof (zframe_t *));
+    assert (frames);
+    size_t frame_nbr = 0;
+    for (msg_nbr = 0; msg_nbr < count; msg_nbr++) {
+        zmsg_t *self = msgs [msg_nbr];
+        size_t index;
+        for (index = 0; index < self->count; index++) {
+            zframe_t *frame = *s_frame_at (self, index);
+            zframe_set_more (frame, index + 1 < self->count);
+            zframe_set_routing_id (frame, self->routing_id);
+            frames [frame_nbr++] = frame;
+        }
+    }
+    size_t sent = zframe_send_batch (dest, frames, frames_total);
+    freen (frames);
+
+    //  Sent frames are already destroyed, so we drop them from messages
+    for (msg_nbr = 0; msg_nbr < count; msg_nbr++) {
+        zmsg_t *self = msgs [msg_nbr];
+        if (self->count > sent) {
+            while (sent--)
+                (void) s_frame_pop (self);
+            self->content_size = 0;
+            size_t index;
+            for (index = 0; index < self->count; index++)
+                self->content_size += zframe_size (*s_frame_at (self, index));
+            break;
+        }
+        sent -= self->count;
+        self->count = 0;
+        zmsg_destroy (&msgs [msg_nbr]);
+    }
+    return (int) msg_nbr;
+}
+
+
 //  --------------------------------------------------------------------------
 //  Return size of message, i.e. number of frames (0 or more).
 
@@ -200,7 +494,7 @@ zmsg_size (zmsg_t *self)
     assert (self);
     assert (zmsg_is (self));
 
-    return zlist_size (self->frames);
+    return self->count;
 }
 
 
@@ -258,7 +552,7 @@ zmsg_prepend (zmsg_t *self, zframe_t **frame_p)
     zframe_t *frame = *frame_p;
     *frame_p = NULL;            //  We now own frame
     self->content_size += zframe_size (frame);
-    zlist_push (self->frames, frame);
+    s_frame_push (self, frame);
     return 0;
 }
 
@@ -278,7 +572,7 @@ zmsg_append (zmsg_t *self, zframe_t **frame_p)
     zframe_t *frame = *frame_p;
     *frame_p = NULL;            //  We now own frame
     self->content_size += zframe_size (frame);
-    zlist_append (self->frames, frame);
+    s_frame_append (self, frame);
     return 0;
 }
 
@@ -293,7 +587,7 @@ zmsg_pop (zmsg_t *self)
     assert (self);
     assert (zmsg_is (self));
 
-    zframe_t *frame = (zframe_t *) zlist_pop (self->frames);
+    zframe_t *frame = s_frame_pop (self);
     if (frame)
         self->content_size -= zframe_size (frame);
 
@@ -314,7 +608,7 @@ zmsg_pushmem (zmsg_t *self, const void *data, size_t size)
     zframe_t *frame = zframe_new (data, size);
     assert (frame);
     self->content_size += size;
-    zlist_push (self->frames, frame);
+    s_frame_push (self, frame);
     return 0;
 }
 
@@ -331,7 +625,7 @@ zmsg_addmem (zmsg_t *self, const void *data, size_t size)
     zframe_t *frame = zframe_new (data, size);
     assert (frame);
     self->content_size += size;
-    zlist_append (self->frames, frame);
+    s_frame_append (self, frame);
     return 0;
 }
 
@@ -351,7 +645,7 @@ zmsg_pushstr (zmsg_t *self, const char *string)
     zframe_t *frame = zframe_new (string, len);
     assert (frame);
     self->content_size += len;
-    zlist_push (self->frames, frame);
+    s_frame_push (self, frame);
     return 0;
 }
 
@@ -371,7 +665,7 @@ zmsg_addstr (zmsg_t *self, const char *string)
     zframe_t *frame = zframe_new (string, len);
     assert (frame);
     self->content_size += len;
-    zlist_append (self->frames, frame);
+    s_frame_append (self, frame);
     return 0;
 }
 
@@ -398,7 +692,7 @@ zmsg_pushstrf (zmsg_t *self, const char *format, ...)
     zframe_t *frame = zframe_new (string, len);
     assert (frame);
     self->content_size += len;
-    zlist_push (self->frames, frame);
+    s_frame_push (self, frame);
     zstr_free (&string);
     return 0;
 }
@@ -426,7 +720,7 @@ zmsg_addstrf (zmsg_t *self, const char *format, ...)
     zframe_t *frame = zframe_new (string, len);
     assert (frame);
     self->content_size += len;
-    zlist_append (self->frames, frame);
+    s_frame_append (self, frame);
     zstr_free (&string);
     return 0;
 }
@@ -442,7 +736,7 @@ zmsg_popstr (zmsg_t *self)
     assert (self);
     assert (zmsg_is (self));
 
-    zframe_t *frame = (zframe_t *) zlist_pop (self->frames);
+    zframe_t *frame = s_frame_pop (self);
     char *string = NULL;
     if (frame) {
         self->content_size -= zframe_size (frame);
@@ -501,17 +795,27 @@ zmsg_remove (zmsg_t *self, zframe_t *frame)
     assert (self);
     assert (zmsg_is (self));
 
-    //  zlist_remove does not give feedback on whether an element was actually
-    //  removed or not. To avoid wrongly decreasing the size in case the frame
-    //  is not actually part of the zmsg, check the size before and after.
-    //  We could do a search but that's a full scan, while the size is saved
-    //  by zlist so checking it is much cheaper.
-    size_t num_frames_before = zlist_size (self->frames);
-    zlist_remove (self->frames, frame);
-    size_t num_frames_after = zlist_size (self->frames);
-
-    if (num_frames_before > num_frames_after)
-        self->content_size -= zframe_size (frame);
+    size_t found;
+    for (found = 0; found < self->count; found++)
+        if (*s_frame_at (self, found) == frame)
+            break;
+    if (found == self->count)
+        return;                 //  Frame is not part of this message
+
+    //  Close the gap from whichever end of the ring is nearer
+    size_t index;
+    if (found < self->count / 2) {
+        for (index = found; index > 0; index--)
+            *s_frame_at (self, index) = *s_frame_at (self, index - 1);
+        self->head = (self->head + 1) & (self->limit - 1);
+    }
+    else
+        for (index = found; index + 1 < self->count; index++)
+            *s_frame_at (self, index) = *s_frame_at (self, index + 1);
+    self->count--;
+    self->content_size -= zframe_size (frame);
+    if (self->cursor > found)
+        self->cursor--;
 }
 
 
@@ -524,7 +828,8 @@ zmsg_first (zmsg_t *self)
 {
     assert (self);
     assert (zmsg_is (self));
-    return (zframe_t *) zlist_first (self->frames);
+    self->cursor = self->count? 1: 0;
+    return s_frame_head (self);
 }
 
 
@@ -537,7 +842,11 @@ zmsg_next (zmsg_t *self)
 {
     assert (self);
     assert (zmsg_is (self));
-    return (zframe_t *) zlist_next (self->frames);
+    if (++self->cursor > self->count) {
+        self->cursor = 0;
+        return NULL;
+    }
+    return *s_frame_at (self, self->cursor - 1);
 }
 
 
@@ -549,7 +858,8 @@ zmsg_last (zmsg_t *self)
 {
     assert (self);
     assert (zmsg_is (self));
-    return (zframe_t *) zlist_last (self->frames);
+    self->cursor = self->count;
+    return self->count? *s_frame_at (self, self->count - 1): NULL;
 }
 
 
@@ -612,70 +922,145 @@ zmsg_load (FILE *file)
 }
 
 
-//  --------------------------------------------------------------------------
-//  Serialize multipart message to a single message frame. Use this method
-//  to send structured messages across transports that do not support
-//  multipart data. Allocates and returns a new frame containing the
-//  serialized message. To decode a serialized message frame, use
-//  zmsg_decode ().
-//
-//  Frame lengths are encoded as 1 or 1+4 bytes
-//  0..254 bytes        octet + data
-//  255..4Gb-1 bytes    0xFF + 4octet + data
+//  Return the size of the message when encoded, as zmsg_encode does it
 
-zframe_t *
-zmsg_encode (zmsg_t *self)
+static size_t
+s_encoded_size (zmsg_t *self)
 {
-    assert (self);
-    assert (zmsg_is (self));
-
-    //  Calculate real size of frame
     size_t total_size = 0;
-    zframe_t *frame = zmsg_first (self);
-    while (frame) {
-        size_t frame_size = zframe_size (frame);
+    size_t index;
+    for (index = 0; index < self->count; index++) {
+        size_t frame_size = zframe_size (*s_frame_at (self, index));
         if (frame_size < 255)
             total_size += frame_size + 1;
         else
             total_size += frame_size + 1 + 4;
-        frame = zmsg_next (self);
     }
-    zframe_t *encoded = zframe_new (NULL, total_size);
-    assert (encoded);
+    return total_size;
+}
 
-    //  Encode message into frame
-    byte *dest = zframe_data (encoded);
-    frame = zmsg_first (self);
-    while (frame) {
+//  Encode the message into a buffer that is large enough for it, return
+//  the end of the encoded data
+
+static byte *
+s_encode (zmsg_t *self, byte *dest)
+{
+    size_t index;
+    for (index = 0; index < self->count; index++) {
+        zframe_t *frame = *s_frame_at (self, index);
         size_t frame_size = zframe_size (frame);
-        if (frame_size < 255) {
+        if (frame_size < 255)
             *dest++ = (byte) frame_size;
-            memcpy (dest, zframe_data (frame), frame_size);
-            dest += frame_size;
-        }
         else {
             *dest++ = 0xFF;
             *dest++ = (frame_size >> 24) & 255;
             *dest++ = (frame_size >> 16) & 255;
             *dest++ = (frame_size >>  8) & 255;
             *dest++ =  frame_size        & 255;
-            memcpy (dest, zframe_data (frame), frame_size);
-            dest += frame_size;
         }
-        frame = zmsg_next (self);
+        memcpy (dest, zframe_data (frame), frame_size);
+        dest += frame_size;
     }
+    return dest;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Serialize multipart message to a single message frame. Use this method
+//  to send structured messages across transports that do not support
+//  multipart data. Allocates and returns a new frame containing the
+//  serialized message. To decode a serialized message frame, use
+//  zmsg_decode ().
+//
+//  Frame lengths are encoded as 1 or 1+4 bytes
+//  0..254 bytes        octet + data
+//  255..4Gb-1 bytes    0xFF + 4octet + data
+
+zframe_t *
+zmsg_encode (zmsg_t *self)
+{
+    assert (self);
+    assert (zmsg_is (self));
+
+    size_t total_size = s_encoded_size (self);
+    zframe_t *encoded = zframe_new (NULL, total_size);
+    assert (encoded);
+    byte *dest = s_encode (self, zframe_data (encoded));
     assert ((size_t) (dest - zframe_data (encoded)) == total_size);
     return encoded;
 }
 
 
 //  --------------------------------------------------------------------------
-//  Decodes a serialized message frame created by zmsg_encode () and returns
-//  a new zmsg_t object. Returns NULL if the frame was badly formatted or
-//  there was insufficient memory to work.
+//  Serialize multipart message into a buffer provided by the caller, in the
+//  same format as zmsg_encode, without allocating a frame. Returns the
+//  encoded size. If that is more than the buffer size, writes nothing, so
+//  you can call this with a null buffer and zero size to find out how large
+//  a buffer you need.
 
-zmsg_t *
-zmsg_decode (zframe_t *frame)
+size_t
+zmsg_encode_buffer (zmsg_t *self, byte *buffer, size_t size)
+{
+    assert (self);
+    assert (zmsg_is (self));
+
+    size_t total_size = s_encoded_size (self);
+    if (total_size <= size) {
+        assert (buffer || total_size == 0);
+        byte *dest = s_encode (self, buffer);
+        assert ((size_t) (dest - buffer) == total_size);
+    }
+    return total_size;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Serialize multipart message and append it to the chunk, in the same
+//  format as zmsg_encode. The chunk must have room for the encoded message,
+//  which is the size that zmsg_encode_buffer returns. Returns 0 if OK, or
+//  -1 if the chunk was too small, in which case it is left unchanged.
+
+int
+zmsg_encode_chunk (zmsg_t *self, zchunk_t *chunk)
+{
+    assert (self);
+    assert (zmsg_is (self));
+    assert (chunk);
+
+    size_t total_size = s_encoded_size (self);
+    size_t chunk_size = zchunk_size (chunk);
+    if (total_size > zchunk_max_size (chunk) - chunk_size)
+        return -1;
+    if (total_size) {
+        //  An empty chunk returns no data, so set the size first; with no
+        //  data to copy, zchunk_set does not touch the chunk contents
+        zchunk_set (chunk, NULL, chunk_size + total_size);
+        byte *dest = s_encode (self, zchunk_data (chunk) + chunk_size);
+        assert ((size_t) (dest - zchunk_data (chunk)) == chunk_size + total_size);
+    }
+    return 0;
+}
+
+
+//  Decode a serialized message frame. If shared, decoded frames refer to
+//  the content of the serialized frame rather than copying it, except for
+//  small frames, where copying is cheaper than sharing.
+
+#define ZMSG_SHARE_MIN      256
+
+//  libzmq calls this from whichever thread drops the last reference to the
+//  slice, often one of its I/O threads, so the share must not go to that
+//  thread's pool
+
+static void
+s_slice_free (void **hint)
+{
+    zframe_t *share = (zframe_t *) *hint;
+    zframe_destroy_unpooled (&share);
+}
+
+static zmsg_t *
+s_decode (zframe_t *frame, bool shared)
 {
     assert (frame);
     zmsg_t *self = zmsg_new ();
@@ -700,7 +1085,21 @@ zmsg_decode (zframe_t *frame)
             zmsg_destroy (&self);
             break;
         }
-        zframe_t *decoded = zframe_new (source, frame_size);
+        zframe_t *decoded = NULL;
+        if (shared && frame_size >= ZMSG_SHARE_MIN) {
+            //  Each slice holds a share of the serialized frame, so its data
+            //  lives as long as the slice does. We take the slice from the
+            //  share, as small frames do not share their data.
+            zframe_t *share = zframe_share (frame);
+            if (share) {
+                byte *slice = zframe_data (share) + (source - zframe_data (frame));
+                decoded = zframe_frommem (slice, frame_size, s_slice_free, share);
+                if (!decoded)
+                    zframe_destroy (&share);
+            }
+        }
+        else
+            decoded = zframe_new (source, frame_size);
         if (!decoded) {
             zmsg_destroy (&self);
             break;
@@ -712,6 +1111,33 @@ zmsg_decode (zframe_t *frame)
 }
 
 
+//  --------------------------------------------------------------------------
+//  Decodes a serialized message frame created by zmsg_encode () and returns
+//  a new zmsg_t object. Returns NULL if the frame was badly formatted or
+//  there was insufficient memory to work.
+
+zmsg_t *
+zmsg_decode (zframe_t *frame)
+{
+    return s_decode (frame, false);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Decodes a serialized message frame created by zmsg_encode () like
+//  zmsg_decode, except that larger frames of the new message refer to the
+//  content of the serialized frame, rather than copying it. The content
+//  lives until the last frame that refers to it is destroyed, so you may
+//  destroy the serialized frame at once. You must not modify the content
+//  of the serialized frame or the new message.
+
+zmsg_t *
+zmsg_decode_shared (zframe_t *frame)
+{
+    return s_decode (frame, true);
+}
+
+
 //  --------------------------------------------------------------------------
 //  Create copy of message, as new message object. Returns a fresh zmsg_t
 //  object. If message is null, or memory was exhausted, returns null.
@@ -735,6 +1161,74 @@ zmsg_dup (zmsg_t *self)
 }
 
 
+//  --------------------------------------------------------------------------
+//  Create a new message whose frames share the content of an existing
+//  message, rather than copying it, as zframe_share does. You must not
+//  modify the content of either message afterwards. If message is null, or
+//  memory was exhausted, returns null.
+
+zmsg_t *
+zmsg_share (zmsg_t *self)
+{
+    if (self) {
+        assert (zmsg_is (self));
+        zmsg_t *share = zmsg_new ();
+        assert (share);
+        zframe_t *frame = zmsg_first (self);
+        while (frame) {
+            zframe_t *shared = zframe_share (frame);
+            if (!shared) {
+                zmsg_destroy (&share);
+                return NULL;
+            }
+            zmsg_append (share, &shared);
+            frame = zmsg_next (self);
+        }
+        return share;
+    }
+    else
+        return NULL;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return the number of messages taken from the thread pools, rather than
+//  allocated, by threads that have exited and by the calling thread. Returns
+//  zero if pooling is not available.
+
+uint64_t
+zmsg_pool_hits (void)
+{
+#if defined (ZMSG_POOL)
+    pthread_mutex_lock (&s_pool_mutex);
+    uint64_t hits = s_pool_hits + (s_pool? s_pool->hits: 0);
+    pthread_mutex_unlock (&s_pool_mutex);
+    return hits;
+#else
+    return 0;
+#endif
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return the number of messages allocated while pooling was on, because
+//  the thread pool was empty, by threads that have exited and by the calling
+//  thread. Returns zero if pooling is not available.
+
+uint64_t
+zmsg_pool_misses (void)
+{
+#if defined (ZMSG_POOL)
+    pthread_mutex_lock (&s_pool_mutex);
+    uint64_t misses = s_pool_misses + (s_pool? s_pool->misses: 0);
+    pthread_mutex_unlock (&s_pool_mutex);
+    return misses;
+#else
+    return 0;
+#endif
+}
+
+
 //  --------------------------------------------------------------------------
 //  Send message to zsys log sink (may be stdout, or system facility as
 //  configured by zsys_set_logstream).
@@ -774,17 +1268,13 @@ zmsg_eq (zmsg_t *self, zmsg_t *other)
     if (!self || !other)
         return false;
 
-    if (zlist_size (self->frames) != zlist_size (other->frames))
+    if (self->count != other->count)
         return false;
 
-    zframe_t *self_frame = (zframe_t *) zlist_first (self->frames);
-    zframe_t *other_frame = (zframe_t *) zlist_first (other->frames);
-    while (self_frame && other_frame) {
-        if (!zframe_eq (self_frame, other_frame))
+    size_t index;
+    for (index = 0; index < self->count; index++)
+        if (!zframe_eq (*s_frame_at (self, index), *s_frame_at (other, index)))
             return false;
-        self_frame = (zframe_t *) zlist_next (self->frames);
-        other_frame = (zframe_t *) zlist_next (other->frames);
-    }
     return true;
 }
 
@@ -867,7 +1357,7 @@ zmsg_recv_nowait (void *source)
     while (true) {
         zframe_t *frame = zframe_recv_nowait (source);
         if (!frame) {
-            if (errno == EINTR && zlist_head (self->frames))
+            if (errno == EINTR && self->count)
                 continue;
             else {
                 zmsg_destroy (&self);
@@ -917,7 +1407,7 @@ zmsg_push (zmsg_t *self, zframe_t *frame)
     assert (self);
     assert (frame);
     self->content_size += zframe_size (frame);
-    zlist_push (self->frames, frame);
+    s_frame_push (self, frame);
     return 0;
 }
 
@@ -934,7 +1424,7 @@ zmsg_add (zmsg_t *self, zframe_t *frame)
     assert (self);
     assert (frame);
     self->content_size += zframe_size (frame);
-    zlist_append (self->frames, frame);
+    s_frame_append (self, frame);
     return 0;
 }
 
@@ -968,6 +1458,61 @@ zmsg_fprint (zmsg_t *self, FILE *file)
 //  --------------------------------------------------------------------------
 //  Selftest
 
+//  Runs in its own thread so its message pool is freed when it exits
+
+static void
+s_pool_test_actor (zsock_t *pipe, void *args)
+{
+    bool verbose = *(bool *) args;
+#if defined (ZMSG_POOL)
+    //  Count this thread's pool only, as threads that exit add to the totals
+    s_pool_t *pool = s_pool_get ();
+    uint64_t hits = pool->hits;
+#else
+    uint64_t hits = zmsg_pool_hits ();
+#endif
+    zmsg_t *msg = zmsg_new ();
+    assert (msg);
+    zmsg_addstr (msg, "Hello");
+    void *stale = msg;
+    zmsg_destroy (&msg);
+    msg = zmsg_new ();
+    assert (msg);
+    assert (zmsg_size (msg) == 0);
+    assert (zmsg_content_size (msg) == 0);
+    zmsg_destroy (&msg);
+#if defined (ZMSG_POOL)
+    assert (pool->hits == hits + 1);
+    assert (!zmsg_is (stale));
+#else
+    assert (zmsg_pool_hits () == hits);
+#endif
+    if (verbose) {
+        //  Compare the cost of messages with and without pooling
+        size_t pool_size = zsys_pool_size ();
+        int pooled;
+        for (pooled = 0; pooled < 2; pooled++) {
+            zsys_set_pool_size (pooled? 100: 0);
+            int64_t start = zclock_usecs ();
+            int msg_nbr;
+            for (msg_nbr = 0; msg_nbr < 1000000; msg_nbr++) {
+                msg = zmsg_new ();
+                zmsg_addstr (msg, "Body");
+                zmsg_pushmem (msg, "", 0);
+                zmsg_pushstr (msg, "Client");
+                zmsg_destroy (&msg);
+            }
+            zsys_debug ("zmsg: 3-frame message, pool %s: %d nsec",
+                        pooled? "on": "off",
+                        (int) ((zclock_usecs () - start) / 1000));
+        }
+        zsys_set_pool_size (pool_size);
+    }
+    zsock_signal (pipe, 0);
+    char *command = zstr_recv (pipe);
+    zstr_free (&command);
+}
+
 void
 zmsg_test (bool verbose)
 {
@@ -1029,6 +1574,21 @@ zmsg_test (bool verbose)
     rc = zmsg_send (&msg, output);
     assert (rc == 0);
 
+    copy = zmsg_recv (input);
+    assert (copy);
+    assert (zmsg_size (copy) == 10);
+    assert (zmsg_content_size (copy) == 60);
+
+    //  Shared messages have the same content, without copying it
+    zmsg_t *share = zmsg_share (copy);
+    assert (share);
+    assert (zmsg_size (share) == 10);
+    assert (zmsg_content_size (share) == 60);
+    assert (zframe_eq (zmsg_first (share), zmsg_first (copy)));
+    assert (zmsg_share (NULL) == NULL);
+    zmsg_destroy (&copy);
+    rc = zmsg_send (&share, output);
+    assert (rc == 0);
     copy = zmsg_recv (input);
     assert (copy);
     assert (zmsg_size (copy) == 10);
@@ -1115,10 +1675,52 @@ zmsg_test (bool verbose)
     freen (blank);
     assert (zmsg_size (msg) == 9);
     frame = zmsg_encode (msg);
+
+    //  Encoding into a buffer or chunk gives the same result
+    size_t encoded_size = zmsg_encode_buffer (msg, NULL, 0);
+    assert (encoded_size == zframe_size (frame));
+    byte *buffer = (byte *) zmalloc (encoded_size);
+    assert (buffer);
+    assert (zmsg_encode_buffer (msg, buffer, encoded_size - 1) == encoded_size);
+    assert (zmsg_encode_buffer (msg, buffer, encoded_size) == encoded_size);
+    assert (memcmp (buffer, zframe_data (frame), encoded_size) == 0);
+    freen (buffer);
+    zchunk_t *chunk = zchunk_new (NULL, encoded_size);
+    assert (chunk);
+    zchunk_append (chunk, "Header", 6);
+    rc = zmsg_encode_chunk (msg, chunk);
+    assert (rc == -1);
+    assert (zchunk_size (chunk) == 6);
+    zchunk_set (chunk, NULL, 0);
+    rc = zmsg_encode_chunk (msg, chunk);
+    assert (rc == 0);
+    assert (zchunk_size (chunk) == encoded_size);
+    assert (memcmp (zchunk_data (chunk), zframe_data (frame), encoded_size) == 0);
+    zchunk_destroy (&chunk);
+
+    zmsg_t *decoded = zmsg_decode (frame);
+    assert (decoded);
+    assert (zmsg_eq (msg, decoded));
+    zmsg_destroy (&decoded);
+
+    //  A shared decode refers to larger frames, and copies smaller ones
+    decoded = zmsg_decode_shared (frame);
+    assert (decoded);
+    assert (zmsg_eq (msg, decoded));
+    zframe_t *part = zmsg_last (decoded);
+    assert (zframe_size (part) == 65537);
+    assert (zframe_data (part) > zframe_data (frame));
+    assert (zframe_data (part) < zframe_data (frame) + zframe_size (frame));
+    part = zmsg_first (decoded);
+    assert (zframe_size (part) == 0);
+    zframe_destroy (&frame);
+    assert (zmsg_eq (msg, decoded));
     zmsg_destroy (&msg);
-    msg = zmsg_decode (frame);
-    assert (msg);
-    zmsg_destroy (&msg);
+    zmsg_destroy (&decoded);
+
+    //  Bad encodings are refused
+    frame = zframe_new ("\xFF\x00\x00", 3);
+    assert (zmsg_decode_shared (frame) == NULL);
     zframe_destroy (&frame);
 
     //  Test submessages
@@ -1187,6 +1789,35 @@ zmsg_test (bool verbose)
     assert (zmsg_send (&msg, output) == 0);
     assert (!msg);
 
+    //  Send and receive messages in batches, including an empty message
+    //  which is not sent at all
+    zmsg_t *batch [10];
+    int msg_nbr;
+    for (msg_nbr = 0; msg_nbr < 5; msg_nbr++) {
+        batch [msg_nbr] = zmsg_new ();
+        assert (batch [msg_nbr]);
+        if (msg_nbr != 2) {
+            zmsg_addstrf (batch [msg_nbr], "%d", msg_nbr);
+            zmsg_addstr (batch [msg_nbr], "Body");
+        }
+    }
+    rc = zmsg_send_batch (output, batch, 5);
+    assert (rc == 5);
+    assert (batch [0] == NULL && batch [4] == NULL);
+    rc = zmsg_recv_batch (input, batch, 3, 1000);
+    assert (rc == 3);
+    rc = zmsg_recv_batch (input, batch + 3, 7, 0);
+    assert (rc == 1);
+    for (msg_nbr = 0; msg_nbr < 4; msg_nbr++) {
+        assert (zmsg_size (batch [msg_nbr]) == 2);
+        char *string = zmsg_popstr (batch [msg_nbr]);
+        assert (atoi (string) == (msg_nbr < 2? msg_nbr: msg_nbr + 1));
+        freen (string);
+        zmsg_destroy (&batch [msg_nbr]);
+    }
+    rc = zmsg_recv_batch (input, batch, 10, 10);
+    assert (rc == 0);
+
     zsock_destroy (&input);
     zsock_destroy (&output);
 
@@ -1258,6 +1889,115 @@ zmsg_test (bool verbose)
     zframe_destroy (&frame);
     zmsg_destroy (&msg);
 
+    //  Test messages that outgrow the inline frame storage, with frames
+    //  added at both ends and removed while iterating
+    msg = zmsg_new ();
+    for (frame_nbr = 0; frame_nbr < 20; frame_nbr++) {
+        if (frame_nbr % 2)
+            zmsg_addstrf (msg, "%d", 100 + frame_nbr);
+        else
+            zmsg_pushstrf (msg, "%d", 100 - frame_nbr);
+    }
+    assert (zmsg_size (msg) == 20);
+    assert (zmsg_content_size (msg) == 51);
+    frame = zmsg_first (msg);
+    assert (zframe_streq (frame, "82"));
+    frame = zmsg_last (msg);
+    assert (zframe_streq (frame, "119"));
+    //  Frames run 82, 84 .. 100, then 101, 103 .. 119; drop multiples of 4
+    frame = zmsg_first (msg);
+    while (frame) {
+        char *string = zframe_strdup (frame);
+        if (atoi (string) % 4 == 0) {
+            zmsg_remove (msg, frame);
+            zframe_destroy (&frame);
+        }
+        freen (string);
+        frame = zmsg_next (msg);
+    }
+    assert (zmsg_size (msg) == 15);
+    int previous = 0;
+    frame = zmsg_first (msg);
+    while (frame) {
+        char *string = zframe_strdup (frame);
+        int value = atoi (string);
+        assert (value > previous && value % 4 != 0);
+        previous = value;
+        freen (string);
+        frame = zmsg_next (msg);
+    }
+    assert (previous == 119);
+    zmsg_destroy (&msg);
+
+    if (verbose) {
+        //  Typical envelope: two routing frames, empty delimiter, three body
+        //  frames. When messages held their frames on a zlist, this took 14
+        //  allocations (message, list, and a node and a frame per part), as
+        //  counted by an allocator that interposed malloc; we count 7 below.
+        int64_t start = zclock_usecs ();
+        for (frame_nbr = 0; frame_nbr < 1000000; frame_nbr++) {
+            msg = zmsg_new ();
+            zmsg_addstr (msg, "Body");
+            zmsg_addstr (msg, "More");
+            zmsg_addstr (msg, "Last");
+            zmsg_pushmem (msg, "", 0);
+            zmsg_pushstr (msg, "Router");
+            zmsg_pushstr (msg, "Client");
+            frame = zmsg_first (msg);
+            while (frame)
+                frame = zmsg_next (msg);
+            zmsg_destroy (&msg);
+        }
+        zsys_debug ("zmsg: 6-frame message build and destroy: %d nsec",
+                    (int) ((zclock_usecs () - start) / 1000));
+
+#if defined (ZMSG_POOL)
+        //  Count what each envelope takes on each path: the message, its
+        //  frames, and frame storage beyond the inline ring. The pools
+        //  count every message and frame they hand out, and those they
+        //  had to allocate; short frame data lives in the zmq_msg_t.
+        size_t pool_size = zsys_pool_size ();
+        zsys_set_pool_size (100);
+        uint64_t msg_hits = zmsg_pool_hits ();
+        uint64_t msg_misses = zmsg_pool_misses ();
+        uint64_t frame_hits = zframe_pool_hits ();
+        uint64_t frame_misses = zframe_pool_misses ();
+        size_t spilled = 0;
+        for (frame_nbr = 0; frame_nbr < 1000; frame_nbr++) {
+            msg = zmsg_new ();
+            zmsg_addstr (msg, "Body");
+            zmsg_addstr (msg, "More");
+            zmsg_addstr (msg, "Last");
+            zmsg_pushmem (msg, "", 0);
+            zmsg_pushstr (msg, "Router");
+            zmsg_pushstr (msg, "Client");
+            if (msg->frames != msg->inline_frames)
+                spilled++;
+            zmsg_destroy (&msg);
+        }
+        msg_misses = zmsg_pool_misses () - msg_misses;
+        msg_hits = zmsg_pool_hits () - msg_hits;
+        frame_misses = zframe_pool_misses () - frame_misses;
+        frame_hits = zframe_pool_hits () - frame_hits;
+        zsys_set_pool_size (pool_size);
+        assert (msg_hits + msg_misses == 1000);
+        assert (frame_hits + frame_misses == 6000);
+        assert (spilled == 0);
+        zsys_debug ("zmsg: 6-frame message allocations: %.3f messages, %.3f frames, "
+                    "%.3f frame arrays; %.3f from heap with pooling",
+                    (msg_hits + msg_misses) / 1000.0, (frame_hits + frame_misses) / 1000.0,
+                    spilled / 1000.0, (msg_misses + frame_misses) / 1000.0);
+#endif
+    }
+
+    //  Test message pooling
+    size_t pool_size = zsys_pool_size ();
+    zsys_set_pool_size (10);
+    zactor_t *actor = zactor_new (s_pool_test_actor, &verbose);
+    assert (actor);
+    zactor_destroy (&actor);
+    zsys_set_pool_size (pool_size);
+
 #if defined (__WINDOWS__)
     zsys_shutdown();
 #endif
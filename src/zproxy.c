@@ -42,6 +42,36 @@ typedef struct {
 #define AUTH_PLAIN 1
 #define AUTH_CURVE 2
 
+//  Default number of messages we switch in each direction before we go back
+//  to the poller, so a flood on one side cannot starve the other side or
+//  the command pipe
+#define SWITCH_BUDGET 100
+
+//  Traffic counters for one direction, as reported by STATISTICS
+typedef struct {
+    uint64_t msgs;              //  Messages switched
+    uint64_t bytes;             //  Bytes switched
+    uint64_t drops;             //  Messages the output socket refused
+    uint64_t stalls;            //  Sends that hit the output's HWM
+} zproxy_stats_t;
+
+//  A backend peer (worker) when the proxy is load balancing
+typedef struct {
+    zframe_t *routing_id;       //  Routing id of the peer
+    bool delimiter;             //  Peer uses an empty delimiter, like REQ
+    int outstanding;            //  Requests sent and not yet answered
+    bool skipped;               //  Pipe was full for the current request
+    void *handle;               //  Our position in the peers list
+} zproxy_peer_t;
+
+//  The last message we saw on one topic, in last value cache mode
+typedef struct {
+    char *topic;                //  First frame of the message
+    zmsg_t *msg;                //  The whole message
+    size_t size;                //  Size of the message content
+    void *handle;               //  Our position in the cache order
+} zproxy_cached_t;
+
 //  --------------------------------------------------------------------------
 //  The self_t structure holds the state for one actor instance
 
@@ -51,10 +81,25 @@ typedef struct {
     zsock_t *frontend;          //  Frontend socket
     zsock_t *backend;           //  Backend socket
     zsock_t *capture;           //  Capture socket
+    int capture_sample;         //  Capture one message in this many
+    char *capture_prefix;       //  Capture messages starting with this
+    size_t capture_truncate;    //  Truncate captured frames to this size
+    uint64_t capture_seen;      //  Messages matched, for sampling
     int auth_type [SOCKETS];    //  Auth type for sockets
     char *domain [SOCKETS];     //  Auth domains for sockets
     char *public_key [SOCKETS]; //  Public keys for sockets
     char *secret_key [SOCKETS]; //  Secret keys for sockets
+    zproxy_stats_t stats [SOCKETS]; //  Traffic read from each socket
+    int budget;                 //  Messages per direction per batch
+    zactor_t **workers;         //  Switching workers, if any
+    int nbr_workers;            //  Number of switching workers
+    int queue_depth;            //  Requests per peer when balancing
+    zlistx_t *peers;            //  Backend peers, least recently used first
+    bool polling_frontend;      //  Frontend is in the poller
+    zhashx_t *cache;            //  Last value per topic, if caching
+    zlistx_t *cache_order;      //  Cached values, least recent first
+    size_t cache_size;          //  Content size of cached values
+    size_t cache_limit;         //  Maximum content size we cache
     bool terminated;            //  Did caller ask us to quit?
     bool verbose;               //  Verbose logging enabled?
 } self_t;
@@ -66,6 +111,7 @@ s_self_new (zsock_t *pipe)
     self_t *self = (self_t *) zmalloc (sizeof (self_t));
     assert (self);
     self->pipe = pipe;
+    self->budget = SWITCH_BUDGET;
     self->poller = zpoller_new (self->pipe, NULL);
     assert (self->poller);
     return self;
@@ -78,10 +124,17 @@ s_self_destroy (self_t **self_p)
     if (*self_p) {
         self_t *self = *self_p;
         zpoller_destroy (&self->poller);
+        int index;
+        for (index = 0; index < self->nbr_workers; index++)
+            zactor_destroy (&self->workers [index]);
+        freen (self->workers);
+        zlistx_destroy (&self->peers);
+        zlistx_destroy (&self->cache_order);
+        zhashx_destroy (&self->cache);
         zsock_destroy (&self->frontend);
         zsock_destroy (&self->backend);
         zsock_destroy (&self->capture);
-        int index;
+        zstr_free (&self->capture_prefix);
         for (index = 0; index < SOCKETS; index++) {
             zstr_free (&self->domain [index]);
             zstr_free (&self->public_key [index]);
@@ -227,6 +280,36 @@ s_parse_heartbeat_command (zmsg_t *request, zproxy_heartbeat_t *heartbeat) {
     }
 }
 
+static void
+s_parse_capture_command (self_t *self, zmsg_t *request)
+{
+    self->capture_sample = 1;
+    zstr_free (&self->capture_prefix);
+    self->capture_truncate = 0;
+    self->capture_seen = 0;
+
+    char *setting = zmsg_popstr (request);
+    while (setting != NULL) {
+        if (streq (setting, "SAMPLE")) {
+            self->capture_sample = s_get_int_value (request);
+            assert (self->capture_sample > 0);
+        }
+        else
+        if (streq (setting, "PREFIX")) {
+            self->capture_prefix = zmsg_popstr (request);
+            assert (self->capture_prefix);
+        }
+        else
+        if (streq (setting, "TRUNCATE")) {
+            int truncate = s_get_int_value (request);
+            assert (truncate > 0);
+            self->capture_truncate = (size_t) truncate;
+        }
+        zstr_free (&setting);
+        setting = zmsg_popstr (request);
+    }
+}
+
 static void
 s_self_configure (self_t *self, zsock_t **sock_p, zmsg_t *request, proxy_socket selected_socket)
 {
@@ -260,12 +343,169 @@ s_self_configure (self_t *self, zsock_t **sock_p, zmsg_t *request, proxy_socket
     zstr_free (&endpoints);
 }
 
+static void
+s_peer_destroy (zproxy_peer_t **self_p)
+{
+    assert (self_p);
+    if (*self_p) {
+        zproxy_peer_t *self = *self_p;
+        zframe_destroy (&self->routing_id);
+        freen (self);
+        *self_p = NULL;
+    }
+}
+
+//  Return the peer that has room for another request and the fewest
+//  requests outstanding, preferring the one that we used least recently,
+//  or NULL if every peer is full. A REQ peer only ever has room for one
+//  request, as libzmq discards anything queued when it sends its reply. We
+//  expect tens of peers, not thousands, so a scan of the list is fine.
+
+static zproxy_peer_t *
+s_self_least_loaded (self_t *self)
+{
+    zproxy_peer_t *best = NULL;
+    zproxy_peer_t *peer = (zproxy_peer_t *) zlistx_first (self->peers);
+    while (peer) {
+        int queue_depth = peer->delimiter? 1: self->queue_depth;
+        if (peer->outstanding < queue_depth && !peer->skipped
+        && (!best || peer->outstanding < best->outstanding))
+            best = peer;
+        peer = (zproxy_peer_t *) zlistx_next (self->peers);
+    }
+    return best;
+}
+
+static zproxy_peer_t *
+s_self_lookup_peer (self_t *self, zframe_t *routing_id)
+{
+    zproxy_peer_t *peer = (zproxy_peer_t *) zlistx_first (self->peers);
+    while (peer) {
+        if (zframe_eq (peer->routing_id, routing_id))
+            return peer;
+        peer = (zproxy_peer_t *) zlistx_next (self->peers);
+    }
+    return NULL;
+}
+
+//  When load balancing, we only read requests from the frontend while some
+//  peer can take them. Otherwise they wait in the frontend socket.
+
+static void
+s_self_balance_poller (self_t *self)
+{
+    if (!self->queue_depth || !self->polling_frontend == !s_self_least_loaded (self))
+        return;
+    if (self->polling_frontend)
+        zpoller_remove (self->poller, self->frontend);
+    else
+        zpoller_add (self->poller, self->frontend);
+    self->polling_frontend = !self->polling_frontend;
+}
+
+static void
+s_cached_destroy (zproxy_cached_t **self_p)
+{
+    assert (self_p);
+    if (*self_p) {
+        zproxy_cached_t *self = *self_p;
+        zstr_free (&self->topic);
+        zmsg_destroy (&self->msg);
+        freen (self);
+        *self_p = NULL;
+    }
+}
+
 static void
 s_self_add_to_poller_when_configured (self_t *self)
 {
     if (self->frontend && self->backend) {
-        zpoller_add(self->poller, self->frontend);
-        zpoller_add(self->poller, self->backend);
+        if (self->cache) {
+            assert (zsock_type (self->frontend) == ZMQ_XSUB);
+            assert (zsock_type (self->backend) == ZMQ_XPUB);
+            //  We cache every topic, and need to see every subscription,
+            //  not just the first one for each topic
+            zframe_t *subscribe_all = zframe_new ("\x01", 1);
+            zframe_send (&subscribe_all, self->frontend, 0);
+            zsock_set_xpub_verbose (self->backend, 1);
+        }
+        if (self->queue_depth) {
+            assert (zsock_type (self->frontend) == ZMQ_ROUTER);
+            assert (zsock_type (self->backend) == ZMQ_ROUTER);
+            //  So that we hear about peers that went away
+            zsock_set_router_mandatory (self->backend, 1);
+            zpoller_add (self->poller, self->backend);
+            s_self_balance_poller (self);
+        }
+        else {
+            zpoller_add(self->poller, self->frontend);
+            zpoller_add(self->poller, self->backend);
+        }
+    }
+}
+
+//  --------------------------------------------------------------------------
+//  Start the switching workers. Each worker is a zproxy actor with its own
+//  frontend and backend sockets, and gets a copy of every configuration
+//  command we get after this.
+
+static void
+s_self_start_workers (self_t *self, int nbr_workers)
+{
+    assert (nbr_workers > 0);
+    assert (!self->workers);
+    assert (!self->frontend && !self->backend);
+    self->workers = (zactor_t **) zmalloc (nbr_workers * sizeof (zactor_t *));
+    assert (self->workers);
+    self->nbr_workers = nbr_workers;
+    int index;
+    for (index = 0; index < nbr_workers; index++) {
+        self->workers [index] = zactor_new (zproxy, NULL);
+        assert (self->workers [index]);
+        if (self->verbose) {
+            zstr_send (self->workers [index], "VERBOSE");
+            zsock_wait (self->workers [index]);
+        }
+    }
+}
+
+//  Pass a command on to every worker and wait for each one to take it
+
+static void
+s_self_forward (self_t *self, const char *command, zmsg_t *request)
+{
+    int index;
+    for (index = 0; index < self->nbr_workers; index++) {
+        zmsg_t *copy = zmsg_dup (request);
+        assert (copy);
+        zmsg_pushstr (copy, command);
+        zmsg_send (&copy, self->workers [index]);
+        zsock_wait (self->workers [index]);
+    }
+}
+
+//  Add up our own traffic counters and those of every worker
+
+static void
+s_self_statistics (self_t *self, zproxy_stats_t *stats)
+{
+    memcpy (stats, self->stats, SOCKETS * sizeof (zproxy_stats_t));
+    int index;
+    for (index = 0; index < self->nbr_workers; index++) {
+        zproxy_stats_t worker [SOCKETS];
+        zstr_send (self->workers [index], "STATISTICS");
+        zsock_recv (self->workers [index], "88888888",
+            &worker [FRONTEND].msgs, &worker [FRONTEND].bytes,
+            &worker [FRONTEND].drops, &worker [FRONTEND].stalls,
+            &worker [BACKEND].msgs, &worker [BACKEND].bytes,
+            &worker [BACKEND].drops, &worker [BACKEND].stalls);
+        int socket;
+        for (socket = 0; socket < SOCKETS; socket++) {
+            stats [socket].msgs += worker [socket].msgs;
+            stats [socket].bytes += worker [socket].bytes;
+            stats [socket].drops += worker [socket].drops;
+            stats [socket].stalls += worker [socket].stalls;
+        }
     }
 }
 
@@ -285,6 +525,21 @@ s_self_handle_pipe (self_t *self)
     if (self->verbose)
         zsys_info ("zproxy: API command=%s", command);
 
+    if (self->workers
+    &&  strneq (command, "STATISTICS")
+    &&  strneq (command, "$TERM")) {
+        //  The workers do all the switching, so they get all the commands
+        if (streq (command, "VERBOSE"))
+            self->verbose = true;
+        s_self_forward (self, command, request);
+        zsock_signal (self->pipe, 0);
+    }
+    else
+    if (streq (command, "WORKERS")) {
+        s_self_start_workers (self, s_get_int_value (request));
+        zsock_signal (self->pipe, 0);
+    }
+    else
     if (streq (command, "FRONTEND")) {
         s_self_configure (self, &self->frontend, request, FRONTEND);
         s_self_add_to_poller_when_configured (self);
@@ -298,6 +553,7 @@ s_self_handle_pipe (self_t *self)
     }
     else
     if (streq (command, "CAPTURE")) {
+        zsock_destroy (&self->capture);
         self->capture = zsock_new (ZMQ_PUSH);
         assert (self->capture);
         char *endpoint = zmsg_popstr (request);
@@ -305,6 +561,12 @@ s_self_handle_pipe (self_t *self)
         int rc = zsock_connect (self->capture, "%s", endpoint);
         assert (rc == 0);
         zstr_free (&endpoint);
+        s_parse_capture_command (self, request);
+        if (self->verbose)
+            zsys_info ("zproxy: - capture sample=%d prefix=%s truncate=%zu",
+                self->capture_sample,
+                self->capture_prefix? self->capture_prefix: "",
+                self->capture_truncate);
         zsock_signal (self->pipe, 0);
     }
     else
@@ -312,13 +574,44 @@ s_self_handle_pipe (self_t *self)
         zpoller_destroy (&self->poller);
         self->poller = zpoller_new (self->pipe, NULL);
         assert (self->poller);
+        self->polling_frontend = false;
         zsock_signal (self->pipe, 0);
     }
     else
     if (streq (command, "RESUME")) {
         zpoller_destroy (&self->poller);
-        self->poller = zpoller_new (self->pipe, self->frontend, self->backend, NULL);
-        assert (self->poller);
+        if (self->queue_depth) {
+            self->poller = zpoller_new (self->pipe, self->backend, NULL);
+            assert (self->poller);
+            s_self_balance_poller (self);
+        }
+        else {
+            self->poller = zpoller_new (self->pipe, self->frontend, self->backend, NULL);
+            assert (self->poller);
+        }
+        zsock_signal (self->pipe, 0);
+    }
+    else
+    if (streq (command, "LVC")) {
+        assert (!self->frontend && !self->backend);
+        int cache_limit = s_get_int_value (request);
+        assert (cache_limit > 0);
+        self->cache_limit = (size_t) cache_limit;
+        self->cache = zhashx_new ();
+        assert (self->cache);
+        zhashx_set_destructor (self->cache, (zhashx_destructor_fn *) s_cached_destroy);
+        self->cache_order = zlistx_new ();
+        assert (self->cache_order);
+        zsock_signal (self->pipe, 0);
+    }
+    else
+    if (streq (command, "BALANCE")) {
+        assert (!self->frontend && !self->backend);
+        self->queue_depth = s_get_int_value (request);
+        assert (self->queue_depth > 0);
+        self->peers = zlistx_new ();
+        assert (self->peers);
+        zlistx_set_destructor (self->peers, (zlistx_destructor_fn *) s_peer_destroy);
         zsock_signal (self->pipe, 0);
     }
     else
@@ -356,6 +649,22 @@ s_self_handle_pipe (self_t *self)
         zsock_signal (self->pipe, 0);
     }
     else
+    if (streq (command, "BUDGET")) {
+        self->budget = s_get_int_value (request);
+        assert (self->budget > 0);
+        zsock_signal (self->pipe, 0);
+    }
+    else
+    if (streq (command, "STATISTICS")) {
+        zproxy_stats_t stats [SOCKETS];
+        s_self_statistics (self, stats);
+        zproxy_stats_t *forward = &stats [FRONTEND];
+        zproxy_stats_t *reverse = &stats [BACKEND];
+        zsock_send (self->pipe, "88888888",
+            forward->msgs, forward->bytes, forward->drops, forward->stalls,
+            reverse->msgs, reverse->bytes, reverse->drops, reverse->stalls);
+    }
+    else
     if (streq (command, "$TERM"))
         self->terminated = true;
     else {
@@ -369,13 +678,38 @@ s_self_handle_pipe (self_t *self)
 
 
 //  --------------------------------------------------------------------------
-//  Switch messages from an input socket to an output socket until there are
-//  no messages left waiting. We use this loop rather than zmq_poll, to reduce
-//  the cost of polling, which is non-trivial on some boxes (OS/X, mainly).
+//  Decide whether to capture the message that starts with this frame. We
+//  decide once per message, so the capture socket always gets whole
+//  messages.
+
+static bool
+s_self_capture_wanted (self_t *self, zmq_msg_t *msg)
+{
+    if (self->capture_prefix) {
+        size_t prefix_size = strlen (self->capture_prefix);
+        if (zmq_msg_size (msg) < prefix_size
+        ||  memcmp (zmq_msg_data (msg), self->capture_prefix, prefix_size))
+            return false;
+    }
+    return self->capture_seen++ % self->capture_sample == 0;
+}
+
+//  --------------------------------------------------------------------------
+//  Switch messages from the selected socket to the other one until there are
+//  no messages left waiting, or we have switched our budget of messages. We
+//  use this loop rather than zmq_poll, to reduce the cost of polling, which
+//  is non-trivial on some boxes (OS/X, mainly). A message that the output
+//  socket refuses is counted as a drop, and the rest of its frames are read
+//  and discarded. When the output is at its high-water mark we count a stall
+//  and block on it, as the proxy has always done.
 
 static void
-s_self_switch (self_t *self, zsock_t *input, zsock_t *output)
+s_self_switch (self_t *self, proxy_socket selected_socket)
 {
+    zsock_t *input = selected_socket == FRONTEND? self->frontend: self->backend;
+    zsock_t *output = selected_socket == FRONTEND? self->backend: self->frontend;
+    zproxy_stats_t *stats = &self->stats [selected_socket];
+
     //  We use the low-level libzmq API for best performance
     void *zmq_input = zsock_resolve (input);
     void *zmq_output = zsock_resolve (output);
@@ -383,21 +717,273 @@ s_self_switch (self_t *self, zsock_t *input, zsock_t *output)
 
     zmq_msg_t msg;
     zmq_msg_init (&msg);
-    while (true) {
+    int count;
+    for (count = 0; count < self->budget; count++) {
         if (zmq_recvmsg (zmq_input, &msg, ZMQ_DONTWAIT) == -1)
             break;      //  Presumably EAGAIN
-        int send_flags = zsock_rcvmore (input)? ZMQ_SNDMORE: 0;
-        if (zmq_capture) {
-            zmq_msg_t dup;
-            zmq_msg_init (&dup);
-            zmq_msg_copy (&dup, &msg);
-            if (zmq_sendmsg (zmq_capture, &dup, send_flags) == -1)
-                zmq_msg_close (&dup);
-        }
-        if (zmq_sendmsg (zmq_output, &msg, send_flags) == -1) {
-            zmq_msg_close (&msg);
+        bool dropped = false;
+        bool captured = zmq_capture && s_self_capture_wanted (self, &msg);
+        while (true) {
+            bool more = zmq_msg_more (&msg) != 0;
+            int send_flags = more? ZMQ_SNDMORE: 0;
+            if (captured) {
+                zmq_msg_t dup;
+                size_t size = zmq_msg_size (&msg);
+                if (self->capture_truncate && size > self->capture_truncate) {
+                    zmq_msg_init_size (&dup, self->capture_truncate);
+                    memcpy (zmq_msg_data (&dup), zmq_msg_data (&msg),
+                            self->capture_truncate);
+                }
+                else {
+                    zmq_msg_init (&dup);
+                    zmq_msg_copy (&dup, &msg);
+                }
+                if (zmq_sendmsg (zmq_capture, &dup, send_flags) == -1) {
+                    zmq_msg_close (&dup);
+                    captured = false;
+                }
+            }
+            if (!dropped) {
+                size_t size = zmq_msg_size (&msg);
+                int rc = zmq_sendmsg (zmq_output, &msg, send_flags | ZMQ_DONTWAIT);
+                if (rc == -1 && zmq_errno () == EAGAIN) {
+                    stats->stalls++;
+                    rc = zmq_sendmsg (zmq_output, &msg, send_flags);
+                }
+                if (rc == -1)
+                    dropped = true;
+                else
+                    stats->bytes += size;
+            }
+            if (dropped) {
+                zmq_msg_close (&msg);
+                zmq_msg_init (&msg);
+            }
+            //  The rest of a multipart message is already here, so we can
+            //  wait for it
+            if (!more || zmq_recvmsg (zmq_input, &msg, 0) == -1)
+                break;
+        }
+        if (dropped)
+            stats->drops++;
+        else
+            stats->msgs++;
+    }
+    zmq_msg_close (&msg);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Load balancing: pass requests from the frontend to the least loaded
+//  peer, until our budget runs out or every peer is full. Requests go out
+//  with the peer's routing id, and an empty delimiter if the peer wants one.
+//  The routing id goes first without blocking, as that is where libzmq
+//  refuses the request: if the peer has gone away, we forget it, and if its
+//  pipe is full, we pass over it for this request. Either way we try the
+//  next peer.
+
+static void
+s_self_balance_requests (self_t *self)
+{
+    zproxy_stats_t *stats = &self->stats [FRONTEND];
+    int count;
+    for (count = 0; count < self->budget; count++) {
+        zproxy_peer_t *peer = s_self_least_loaded (self);
+        if (!peer || !(zsock_events (self->frontend) & ZMQ_POLLIN))
+            break;
+        zmsg_t *request = zmsg_recv (self->frontend);
+        if (!request)
+            break;          //  Interrupted
+        size_t size = zmsg_content_size (request);
+        bool skipped = false;
+        while (peer) {
+            if (zframe_send (&peer->routing_id, self->backend,
+                             ZFRAME_MORE + ZFRAME_REUSE + ZFRAME_DONTWAIT) == 0)
+                break;
+            if (zmq_errno () == EHOSTUNREACH) {
+                if (self->verbose)
+                    zsys_info ("zproxy: - peer went away, %d requests lost",
+                        peer->outstanding);
+                zlistx_delete (self->peers, peer->handle);
+            }
+            else {
+                peer->skipped = true;
+                skipped = true;
+            }
+            peer = s_self_least_loaded (self);
+        }
+        if (skipped) {
+            zproxy_peer_t *other = (zproxy_peer_t *) zlistx_first (self->peers);
+            while (other) {
+                other->skipped = false;
+                other = (zproxy_peer_t *) zlistx_next (self->peers);
+            }
+        }
+        if (peer) {
+            if (peer->delimiter)
+                zmsg_pushmem (request, NULL, 0);
+            zmsg_send (&request, self->backend);
+            zmsg_destroy (&request);
+            peer->outstanding++;
+            zlistx_move_end (self->peers, peer->handle);
+            stats->msgs++;
+            stats->bytes += size;
+        }
+        else {
+            zmsg_destroy (&request);
+            stats->drops++;
+        }
+    }
+}
+
+//  Load balancing: take replies from peers and pass them back to the
+//  frontend. The first message from a new peer says that it is ready, and
+//  tells us whether it uses an empty delimiter.
+
+static void
+s_self_balance_replies (self_t *self)
+{
+    zproxy_stats_t *stats = &self->stats [BACKEND];
+    int count;
+    for (count = 0; count < self->budget; count++) {
+        if (!(zsock_events (self->backend) & ZMQ_POLLIN))
+            break;
+        zmsg_t *reply = zmsg_recv (self->backend);
+        if (!reply)
+            break;          //  Interrupted
+        zframe_t *routing_id = zmsg_pop (reply);
+        zproxy_peer_t *peer = s_self_lookup_peer (self, routing_id);
+        if (!peer) {
+            peer = (zproxy_peer_t *) zmalloc (sizeof (zproxy_peer_t));
+            assert (peer);
+            peer->routing_id = routing_id;
+            zframe_t *first = zmsg_first (reply);
+            peer->delimiter = first && zframe_size (first) == 0;
+            peer->handle = zlistx_add_start (self->peers, peer);
+            assert (peer->handle);
+            zmsg_destroy (&reply);
+            continue;
+        }
+        zframe_destroy (&routing_id);
+        if (peer->delimiter) {
+            zframe_t *delimiter = zmsg_pop (reply);
+            zframe_destroy (&delimiter);
+        }
+        if (peer->outstanding > 0)
+            peer->outstanding--;
+        size_t size = zmsg_content_size (reply);
+        if (zmsg_send (&reply, self->frontend) == 0) {
+            stats->msgs++;
+            stats->bytes += size;
+        }
+        else {
+            zmsg_destroy (&reply);
+            stats->drops++;
+        }
+    }
+}
+
+
+//  --------------------------------------------------------------------------
+//  Last value cache: store a message as the last value for its topic, then
+//  drop the least recently updated topics until we're within our limit.
+
+static void
+s_self_cache_store (self_t *self, zmsg_t **msg_p)
+{
+    char *topic = zframe_strdup (zmsg_first (*msg_p));
+    assert (topic);
+    zproxy_cached_t *cached = (zproxy_cached_t *) zhashx_lookup (self->cache, topic);
+    if (cached) {
+        zstr_free (&topic);
+        self->cache_size -= cached->size;
+        zmsg_destroy (&cached->msg);
+        zlistx_move_end (self->cache_order, cached->handle);
+    }
+    else {
+        cached = (zproxy_cached_t *) zmalloc (sizeof (zproxy_cached_t));
+        assert (cached);
+        cached->topic = topic;
+        zhashx_insert (self->cache, topic, cached);
+        cached->handle = zlistx_add_end (self->cache_order, cached);
+        assert (cached->handle);
+    }
+    cached->msg = *msg_p;
+    cached->size = zmsg_content_size (cached->msg);
+    self->cache_size += cached->size;
+    *msg_p = NULL;
+
+    while (self->cache_size > self->cache_limit) {
+        cached = (zproxy_cached_t *) zlistx_first (self->cache_order);
+        self->cache_size -= cached->size;
+        zlistx_delete (self->cache_order, cached->handle);
+        zhashx_delete (self->cache, cached->topic);
+    }
+}
+
+//  Last value cache: pass messages from the frontend to the backend, and
+//  keep the last one on each topic. The topic is the first frame.
+
+static void
+s_self_cache_publish (self_t *self)
+{
+    zproxy_stats_t *stats = &self->stats [FRONTEND];
+    int count;
+    for (count = 0; count < self->budget; count++) {
+        if (!(zsock_events (self->frontend) & ZMQ_POLLIN))
+            break;
+        zmsg_t *msg = zmsg_recv (self->frontend);
+        if (!msg)
+            break;          //  Interrupted
+        zmsg_t *copy = zmsg_dup (msg);
+        assert (copy);
+        size_t size = zmsg_content_size (msg);
+        if (zmsg_send (&copy, self->backend) == 0) {
+            stats->msgs++;
+            stats->bytes += size;
+        }
+        else {
+            zmsg_destroy (&copy);
+            stats->drops++;
+        }
+        s_self_cache_store (self, &msg);
+    }
+}
+
+//  Last value cache: when a subscriber subscribes, send it the cached value
+//  of every topic that matches. As the XPUB socket sends to every matching
+//  subscriber, those that already had the topic get the value again. We
+//  subscribed to everything upstream, so we don't pass subscriptions on.
+
+static void
+s_self_cache_replay (self_t *self)
+{
+    zproxy_stats_t *stats = &self->stats [BACKEND];
+    int count;
+    for (count = 0; count < self->budget; count++) {
+        if (!(zsock_events (self->backend) & ZMQ_POLLIN))
             break;
+        zframe_t *frame = zframe_recv (self->backend);
+        if (!frame)
+            break;          //  Interrupted
+        stats->msgs++;
+        stats->bytes += zframe_size (frame);
+        byte *data = zframe_data (frame);
+        size_t size = zframe_size (frame);
+        if (size > 0 && data [0] == 1) {
+            zproxy_cached_t *cached = (zproxy_cached_t *) zlistx_first (self->cache_order);
+            while (cached) {
+                if (strlen (cached->topic) >= size - 1
+                &&  memcmp (cached->topic, data + 1, size - 1) == 0) {
+                    zmsg_t *copy = zmsg_dup (cached->msg);
+                    assert (copy);
+                    if (zmsg_send (&copy, self->backend))
+                        zmsg_destroy (&copy);
+                }
+                cached = (zproxy_cached_t *) zlistx_next (self->cache_order);
+            }
         }
+        zframe_destroy (&frame);
     }
 }
 
@@ -421,11 +1007,25 @@ zproxy (zsock_t *pipe, void *unused)
         if (which == self->pipe)
             s_self_handle_pipe (self);
         else
-        if (which == self->frontend)
-            s_self_switch (self, self->frontend, self->backend);
+        if (self->cache && (which == self->frontend || which == self->backend)) {
+            s_self_cache_replay (self);
+            s_self_cache_publish (self);
+        }
+        else
+        if (self->queue_depth && (which == self->frontend || which == self->backend)) {
+            //  Replies first, as they make room for more requests
+            s_self_balance_replies (self);
+            s_self_balance_requests (self);
+            s_self_balance_poller (self);
+        }
         else
-        if (which == self->backend)
-            s_self_switch (self, self->backend, self->frontend);
+        if (which == self->frontend || which == self->backend) {
+            //  Give each direction one batch, starting with the socket that
+            //  woke us; the poller then checks the pipe before the next batch
+            proxy_socket selected_socket = which == self->frontend? FRONTEND: BACKEND;
+            s_self_switch (self, selected_socket);
+            s_self_switch (self, selected_socket == FRONTEND? BACKEND: FRONTEND);
+        }
     }
     s_self_destroy (&self);
 }
@@ -540,6 +1140,141 @@ s_bind_test_sockets (zactor_t *proxy, char **frontend, char **backend)
 }
 #endif
 
+//  Measure switching throughput through a proxy with the given number of
+//  workers. Each worker gets a producer and a consumer of its own, in their
+//  own threads, so neither end holds the workers up; as the workers connect
+//  to every producer and consumer, libzmq spreads the traffic over all of
+//  them. Each run uses its own endpoints, as libzmq releases inproc names
+//  lazily.
+
+#define BENCHMARK_MSGS 200000
+
+static void
+s_benchmark_faucet (zsock_t *pipe, void *args)
+{
+    zsock_t *faucet = zsock_new_push ((char *) args);
+    assert (faucet);
+    zsock_signal (pipe, 0);
+    int nbr_msgs;
+    zsock_recv (pipe, "i", &nbr_msgs);
+    int index;
+    for (index = 0; index < nbr_msgs; index++)
+        zstr_send (faucet, "Hello");
+    zsock_wait (pipe);
+    zsock_destroy (&faucet);
+}
+
+//  Count the messages we get, and report the count whenever asked
+
+static void
+s_benchmark_sink (zsock_t *pipe, void *args)
+{
+    zsock_t *sink = zsock_new_pull ((char *) args);
+    assert (sink);
+    zpoller_t *poller = zpoller_new (pipe, sink, NULL);
+    assert (poller);
+    zsock_signal (pipe, 0);
+    int received = 0;
+    while (true) {
+        void *which = zpoller_wait (poller, -1);
+        if (which == sink) {
+            //  Take all that is waiting before we poll again
+            do {
+                zframe_t *frame = zframe_recv (sink);
+                assert (frame);
+                zframe_destroy (&frame);
+                received++;
+            } while (zsock_events (sink) & ZMQ_POLLIN);
+        }
+        else {
+            char *command = zstr_recv (pipe);
+            if (!command || streq (command, "$TERM")) {
+                zstr_free (&command);
+                break;
+            }
+            zsock_send (pipe, "i", received);
+            zstr_free (&command);
+        }
+    }
+    zpoller_destroy (&poller);
+    zsock_destroy (&sink);
+}
+
+static int
+s_workers_benchmark (int nbr_workers)
+{
+    zactor_t **faucets = (zactor_t **) zmalloc (nbr_workers * sizeof (zactor_t *));
+    assert (faucets);
+    zactor_t **sinks = (zactor_t **) zmalloc (nbr_workers * sizeof (zactor_t *));
+    assert (sinks);
+    char *frontend = strdup ("");
+    char *backend = strdup ("");
+    int index;
+    for (index = 0; index < nbr_workers; index++) {
+        char *endpoint = zsys_sprintf ("@inproc://benchmark-frontend-%d-%d",
+                                       nbr_workers, index);
+        faucets [index] = zactor_new (s_benchmark_faucet, endpoint);
+        assert (faucets [index]);
+        char *endpoints = zsys_sprintf ("%s%s>%s",
+            frontend, index? ",": "", endpoint + 1);
+        zstr_free (&frontend);
+        frontend = endpoints;
+        zstr_free (&endpoint);
+
+        endpoint = zsys_sprintf ("@inproc://benchmark-backend-%d-%d",
+                                 nbr_workers, index);
+        sinks [index] = zactor_new (s_benchmark_sink, endpoint);
+        assert (sinks [index]);
+        endpoints = zsys_sprintf ("%s%s>%s",
+            backend, index? ",": "", endpoint + 1);
+        zstr_free (&backend);
+        backend = endpoints;
+        zstr_free (&endpoint);
+    }
+    char *workers = zsys_sprintf ("%d", nbr_workers);
+    zactor_t *proxy = zactor_new (zproxy, NULL);
+    assert (proxy);
+    zstr_sendx (proxy, "WORKERS", workers, NULL);
+    zsock_wait (proxy);
+    zstr_sendx (proxy, "FRONTEND", "PULL", frontend, NULL);
+    zsock_wait (proxy);
+    zstr_sendx (proxy, "BACKEND", "PUSH", backend, NULL);
+    zsock_wait (proxy);
+
+    //  Poll the sinks for their counts, which costs them little next to
+    //  the traffic they handle
+    int nbr_msgs = BENCHMARK_MSGS / nbr_workers * nbr_workers;
+    int64_t start = zclock_usecs ();
+    for (index = 0; index < nbr_workers; index++)
+        zsock_send (faucets [index], "i", BENCHMARK_MSGS / nbr_workers);
+    int received = 0;
+    while (received < nbr_msgs) {
+        zclock_sleep (1);
+        received = 0;
+        for (index = 0; index < nbr_workers; index++) {
+            int count;
+            zstr_send (sinks [index], "COUNT");
+            zsock_recv (sinks [index], "i", &count);
+            received += count;
+        }
+    }
+    int64_t elapsed = zclock_usecs () - start;
+    assert (received == nbr_msgs);
+
+    zactor_destroy (&proxy);
+    for (index = 0; index < nbr_workers; index++) {
+        zsock_signal (faucets [index], 0);
+        zactor_destroy (&faucets [index]);
+        zactor_destroy (&sinks [index]);
+    }
+    freen (faucets);
+    freen (sinks);
+    zstr_free (&frontend);
+    zstr_free (&backend);
+    zstr_free (&workers);
+    return (int) (nbr_msgs * 1000000LL / (elapsed? elapsed: 1));
+}
+
 void
 zproxy_test (bool verbose)
 {
@@ -611,11 +1346,286 @@ zproxy_test (bool verbose)
     zstr_free (&hello);
     zstr_free (&world);
 
+    //  Check the traffic counters; nothing came back from the backend
+    uint64_t msgs, bytes, drops, stalls;
+    uint64_t back_msgs, back_bytes, back_drops, back_stalls;
+    zstr_sendx (proxy, "STATISTICS", NULL);
+    zsock_recv (proxy, "88888888", &msgs, &bytes, &drops, &stalls,
+        &back_msgs, &back_bytes, &back_drops, &back_stalls);
+    assert (msgs == 3);
+    assert (bytes == 30);
+    assert (drops == 0);
+    assert (back_msgs == 0 && back_bytes == 0);
+    assert (back_drops == 0 && back_stalls == 0);
+
+    //  A small budget makes the proxy go back to its pipe more often, but
+    //  still switches everything
+    zstr_sendx (proxy, "BUDGET", "1", NULL);
+    zsock_wait (proxy);
+    int index;
+    for (index = 0; index < 10; index++)
+        zstr_sendx (faucet, "Hello", "World", NULL);
+    for (index = 0; index < 10; index++) {
+        zstr_recvx (sink, &hello, &world, NULL);
+        assert (streq (hello, "Hello"));
+        assert (streq (world, "World"));
+        zstr_free (&hello);
+        zstr_free (&world);
+        zstr_recvx (capture, &hello, &world, NULL);
+        zstr_free (&hello);
+        zstr_free (&world);
+    }
+    zstr_sendx (proxy, "STATISTICS", NULL);
+    zsock_recv (proxy, "88888888", &msgs, &bytes, &drops, &stalls,
+        &back_msgs, &back_bytes, &back_drops, &back_stalls);
+    assert (msgs == 13);
+
+    //  Capture every second message that starts with "Hel", and only the
+    //  first two bytes of each frame
+    zstr_sendx (proxy, "CAPTURE", "inproc://capture",
+        "SAMPLE", "2", "PREFIX", "Hel", "TRUNCATE", "2", NULL);
+    zsock_wait (proxy);
+    for (index = 0; index < 6; index++) {
+        zstr_sendx (faucet, index % 3? "Hello": "Bye", "World", NULL);
+        zstr_recvx (sink, &hello, &world, NULL);
+        zstr_free (&hello);
+        zstr_free (&world);
+    }
+    for (index = 0; index < 2; index++) {
+        zstr_recvx (capture, &hello, &world, NULL);
+        assert (streq (hello, "He"));
+        assert (streq (world, "Wo"));
+        zstr_free (&hello);
+        zstr_free (&world);
+    }
+    zsock_set_rcvtimeo (capture, 100);
+    hello = zstr_recv (capture);
+    assert (hello == NULL);
+
     zsock_destroy (&faucet);
     zsock_destroy (&sink);
     zsock_destroy (&capture);
     zactor_destroy (&proxy);
 
+    //  A backend with no peers holds the proxy up, which counts as a stall
+    proxy = zactor_new (zproxy, NULL);
+    assert (proxy);
+    zstr_sendx (proxy, "FRONTEND", "PULL", "inproc://frontend", NULL);
+    zsock_wait (proxy);
+    zstr_sendx (proxy, "BACKEND", "PUSH", "inproc://backend", NULL);
+    zsock_wait (proxy);
+    faucet = zsock_new_push (">inproc://frontend");
+    assert (faucet);
+    zstr_send (faucet, "Hello");
+    zclock_sleep (100);
+    sink = zsock_new_pull (">inproc://backend");
+    assert (sink);
+    hello = zstr_recv (sink);
+    assert (streq (hello, "Hello"));
+    zstr_free (&hello);
+    zstr_sendx (proxy, "STATISTICS", NULL);
+    zsock_recv (proxy, "88888888", &msgs, &bytes, &drops, &stalls,
+        &back_msgs, &back_bytes, &back_drops, &back_stalls);
+    assert (msgs == 1);
+    assert (stalls == 1);
+
+    zsock_destroy (&faucet);
+    zsock_destroy (&sink);
+    zactor_destroy (&proxy);
+
+    //  Test switching workers; with more than one worker, the application
+    //  binds and the proxy sockets connect
+    faucet = zsock_new_push ("@inproc://workers-frontend");
+    assert (faucet);
+    sink = zsock_new_pull ("@inproc://workers-backend");
+    assert (sink);
+    proxy = zactor_new (zproxy, NULL);
+    assert (proxy);
+    zstr_sendx (proxy, "WORKERS", "3", NULL);
+    zsock_wait (proxy);
+    if (verbose) {
+        zstr_sendx (proxy, "VERBOSE", NULL);
+        zsock_wait (proxy);
+    }
+    zstr_sendx (proxy, "FRONTEND", "PULL", ">inproc://workers-frontend", NULL);
+    zsock_wait (proxy);
+    zstr_sendx (proxy, "BACKEND", "PUSH", ">inproc://workers-backend", NULL);
+    zsock_wait (proxy);
+    for (index = 0; index < 30; index++)
+        zstr_sendx (faucet, "Hello", "World", NULL);
+    for (index = 0; index < 30; index++) {
+        zstr_recvx (sink, &hello, &world, NULL);
+        assert (streq (hello, "Hello"));
+        assert (streq (world, "World"));
+        zstr_free (&hello);
+        zstr_free (&world);
+    }
+    zstr_sendx (proxy, "STATISTICS", NULL);
+    zsock_recv (proxy, "88888888", &msgs, &bytes, &drops, &stalls,
+        &back_msgs, &back_bytes, &back_drops, &back_stalls);
+    assert (msgs == 30);
+    assert (bytes == 300);
+
+    //  PAUSE and RESUME go to every worker
+    zstr_sendx (proxy, "PAUSE", NULL);
+    zsock_wait (proxy);
+    for (index = 0; index < 3; index++)
+        zstr_send (faucet, "Hello");
+    zsock_set_rcvtimeo (sink, 100);
+    hello = zstr_recv (sink);
+    assert (hello == NULL);
+    zstr_sendx (proxy, "RESUME", NULL);
+    zsock_wait (proxy);
+    for (index = 0; index < 3; index++) {
+        hello = zstr_recv (sink);
+        assert (streq (hello, "Hello"));
+        zstr_free (&hello);
+    }
+    zactor_destroy (&proxy);
+    zsock_destroy (&faucet);
+    zsock_destroy (&sink);
+
+    //  Test load balancing: each peer takes at most two requests at once,
+    //  and the rest wait in the proxy's frontend socket
+    proxy = zactor_new (zproxy, NULL);
+    assert (proxy);
+    if (verbose) {
+        zstr_sendx (proxy, "VERBOSE", NULL);
+        zsock_wait (proxy);
+    }
+    zstr_sendx (proxy, "BALANCE", "2", NULL);
+    zsock_wait (proxy);
+    zstr_sendx (proxy, "FRONTEND", "ROUTER", "inproc://balance-frontend", NULL);
+    zsock_wait (proxy);
+    zstr_sendx (proxy, "BACKEND", "ROUTER", "inproc://balance-backend", NULL);
+    zsock_wait (proxy);
+
+    zsock_t *client = zsock_new_dealer (">inproc://balance-frontend");
+    assert (client);
+    zsock_t *dealer_peer = zsock_new_dealer (">inproc://balance-backend");
+    assert (dealer_peer);
+    zsock_t *req_peer = zsock_new_req (">inproc://balance-backend");
+    assert (req_peer);
+    zstr_send (dealer_peer, "READY");
+    zstr_send (req_peer, "READY");
+    for (index = 0; index < 5; index++)
+        zstr_sendx (client, "", "Hello", NULL);
+
+    //  The DEALER peer gets two requests, and the REQ peer, which can only
+    //  handle one request at a time, gets one
+    zmsg_t *dealer_requests [2];
+    for (index = 0; index < 2; index++) {
+        dealer_requests [index] = zmsg_recv (dealer_peer);
+        assert (zmsg_size (dealer_requests [index]) == 3);
+    }
+    zmsg_t *request = zmsg_recv (req_peer);
+    assert (zmsg_size (request) == 3);
+    zsock_set_rcvtimeo (dealer_peer, 100);
+    zmsg_t *waiting = zmsg_recv (dealer_peer);
+    assert (waiting == NULL);
+
+    //  Once the DEALER peer answers, it is the least loaded and gets the
+    //  last two requests
+    for (index = 0; index < 2; index++)
+        zmsg_send (&dealer_requests [index], dealer_peer);
+    for (index = 0; index < 2; index++) {
+        dealer_requests [index] = zmsg_recv (dealer_peer);
+        assert (dealer_requests [index]);
+        zmsg_send (&dealer_requests [index], dealer_peer);
+    }
+    zmsg_send (&request, req_peer);
+
+    for (index = 0; index < 5; index++) {
+        char *empty;
+        zstr_recvx (client, &empty, &hello, NULL);
+        assert (streq (empty, ""));
+        assert (streq (hello, "Hello"));
+        zstr_free (&empty);
+        zstr_free (&hello);
+    }
+    zstr_sendx (proxy, "STATISTICS", NULL);
+    zsock_recv (proxy, "88888888", &msgs, &bytes, &drops, &stalls,
+        &back_msgs, &back_bytes, &back_drops, &back_stalls);
+    assert (msgs == 5);
+    assert (back_msgs == 5);
+    assert (drops == 0 && back_drops == 0);
+
+    zactor_destroy (&proxy);
+    zsock_destroy (&client);
+    zsock_destroy (&dealer_peer);
+    zsock_destroy (&req_peer);
+
+    //  Test the last value cache. The cache holds 20 bytes of content, so
+    //  it keeps the weather, but not the sports
+    proxy = zactor_new (zproxy, NULL);
+    assert (proxy);
+    if (verbose) {
+        zstr_sendx (proxy, "VERBOSE", NULL);
+        zsock_wait (proxy);
+    }
+    zstr_sendx (proxy, "LVC", "20", NULL);
+    zsock_wait (proxy);
+    zstr_sendx (proxy, "FRONTEND", "XSUB", "inproc://lvc-frontend", NULL);
+    zsock_wait (proxy);
+    zstr_sendx (proxy, "BACKEND", "XPUB", "inproc://lvc-backend", NULL);
+    zsock_wait (proxy);
+
+    //  Publish until the proxy's subscription reaches the publisher
+    zsock_t *publisher = zsock_new_pub (">inproc://lvc-frontend");
+    assert (publisher);
+    do {
+        zstr_send (publisher, "sync");
+        zclock_sleep (10);
+        zstr_sendx (proxy, "STATISTICS", NULL);
+        zsock_recv (proxy, "88888888", &msgs, &bytes, &drops, &stalls,
+            &back_msgs, &back_bytes, &back_drops, &back_stalls);
+    } while (msgs == 0);
+    uint64_t published = msgs + 3;
+    zstr_sendx (publisher, "sports", "win", NULL);
+    zstr_sendx (publisher, "weather", "sunny", NULL);
+    zstr_sendx (publisher, "weather", "rainy", NULL);
+    while (msgs < published) {
+        zclock_sleep (10);
+        zstr_sendx (proxy, "STATISTICS", NULL);
+        zsock_recv (proxy, "88888888", &msgs, &bytes, &drops, &stalls,
+            &back_msgs, &back_bytes, &back_drops, &back_stalls);
+    }
+    //  A new subscriber gets the last weather at once
+    zsock_t *subscriber = zsock_new_sub (">inproc://lvc-backend", "weather");
+    assert (subscriber);
+    zsock_set_rcvtimeo (subscriber, 1000);
+    zstr_recvx (subscriber, &hello, &world, NULL);
+    assert (streq (hello, "weather"));
+    assert (streq (world, "rainy"));
+    zstr_free (&hello);
+    zstr_free (&world);
+    zsock_set_subscribe (subscriber, "sp");
+    zsock_set_rcvtimeo (subscriber, 100);
+    hello = zstr_recv (subscriber);
+    assert (hello == NULL);
+
+    //  So does a second subscriber to the same topic
+    zsock_t *latecomer = zsock_new_sub (">inproc://lvc-backend", "weather");
+    assert (latecomer);
+    zsock_set_rcvtimeo (latecomer, 1000);
+    zstr_recvx (latecomer, &hello, &world, NULL);
+    assert (streq (hello, "weather"));
+    assert (streq (world, "rainy"));
+    zstr_free (&hello);
+    zstr_free (&world);
+
+    zactor_destroy (&proxy);
+    zsock_destroy (&publisher);
+    zsock_destroy (&subscriber);
+    zsock_destroy (&latecomer);
+
+    if (verbose) {
+        int nbr_workers;
+        for (nbr_workers = 1; nbr_workers <= 4; nbr_workers *= 2)
+            zsys_info ("zproxy: %d worker(s) switched %d msgs/sec",
+                nbr_workers, s_workers_benchmark (nbr_workers));
+    }
+
     //  Test socket creation dependency
     proxy = zactor_new (zproxy, NULL);
     assert (proxy);
@@ -39,6 +39,23 @@
 
 //  Structure of our class
 
+//  Traffic statistics for one socket
+
+typedef struct {
+    uint64_t msgs_sent;         //  Messages sent
+    uint64_t frames_sent;       //  Frames sent
+    uint64_t bytes_sent;        //  Bytes sent, in frame data
+    uint64_t send_failed;       //  Send attempts that failed
+    uint64_t send_again;        //  Of which, failed with EAGAIN
+    uint64_t send_retries;      //  Sends retried after EINTR
+    uint64_t msgs_recv;         //  Messages received
+    uint64_t frames_recv;       //  Frames received
+    uint64_t bytes_recv;        //  Bytes received, in frame data
+    size_t msg_max;             //  Largest message sent or received
+    size_t send_size;           //  Size of message being sent
+    size_t recv_size;           //  Size of message being received
+} s_stats_t;
+
 struct _zsock_t {
     uint32_t tag;               //  Object tag for runtime detection
     void *handle;               //  The libzmq socket handle
@@ -47,8 +64,14 @@ struct _zsock_t {
     int type;                   //  Socket type
     size_t cache_size;          //  Current size of cache
     uint32_t routing_id;        //  Routing ID for server sockets
+    s_stats_t *stats;           //  Traffic statistics, if switched on
 };
 
+//  Set once any socket has had statistics switched on; until then, the
+//  send and receive paths skip counting with a single test
+
+bool zsock_stats_flag = false;
+
 #ifndef CZMQ_BUILD_DRAFT_API
 CZMQ_PRIVATE zsock_t *
     zsock_new_server_checked (const char *endpoint, const char *filename, size_t line_nbr);
@@ -112,6 +135,7 @@ zsock_destroy_checked (zsock_t **self_p, const char *filename, size_t line_nbr)
         assert (rc == 0);
         freen (self->endpoint);
         freen (self->cache);
+        freen (self->stats);
         freen (self);
         *self_p = NULL;
     }
@@ -1491,6 +1515,8 @@ zsock_bsend (void *self, const char *picture, ...)
     //  Now send the data frame
     void *handle = zsock_resolve (self);
     int rc = zmq_msg_send (&msg, handle, nbr_frames? ZMQ_SNDMORE: 0);
+    if (zsock_stats_used ())
+        zsock_stats_sent (self, rc, nbr_frames > 0);
     if (rc >= 0) {
         //  Now send any additional frames
         unsigned int frame_nbr;
@@ -1536,8 +1562,11 @@ zsock_brecv (void *selfish, const char *picture, ...)
 
     zmq_msg_t msg;
     zmq_msg_init (&msg);
-    if (zmq_msg_recv (&msg, zsock_resolve (selfish), 0) == -1)
+    int rc = zmq_msg_recv (&msg, zsock_resolve (selfish), 0);
+    if (rc == -1)
         return -1;              //  Interrupted
+    if (zsock_stats_used ())
+        zsock_stats_received (selfish, rc, zmq_msg_more (&msg) != 0);
 
     //  If we don't have a string cache, create one now with arbitrary
     //  value; this will grow if needed. Do not use an initial size less
@@ -1885,6 +1914,158 @@ zsock_has_in (void *self) {
 }
 
 
+//  --------------------------------------------------------------------------
+//  Set collection of traffic statistics on/off. When on, the socket counts
+//  the messages, frames and bytes sent and received through zframe, zmsg,
+//  zstr and zsock calls, along with failed and retried sends, and notes the
+//  largest message. Switching off drops the counters. The default stats
+//  setting is off (false).
+
+void
+zsock_set_stats (zsock_t *self, bool stats)
+{
+    assert (self);
+    assert (zsock_is (self));
+    if (stats && !self->stats) {
+        self->stats = (s_stats_t *) zmalloc (sizeof (s_stats_t));
+        assert (self->stats);
+#if defined (__UNIX__)
+        __atomic_store_n (&zsock_stats_flag, true, __ATOMIC_RELAXED);
+#else
+        *(volatile bool *) &zsock_stats_flag = true;
+#endif
+    }
+    else
+    if (!stats)
+        freen (self->stats);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return traffic statistics collected since they were switched on or last
+//  reset, as a zconfig tree, or NULL if statistics are off. The tree holds
+//  sent/msgs, sent/frames, sent/bytes, sent/failed, sent/again (failed with
+//  EAGAIN, usually at the high-water mark), sent/retries, recv/msgs,
+//  recv/frames, recv/bytes, and msg_max, the largest message in bytes.
+//  Caller owns return value and must destroy it when done.
+
+zconfig_t *
+zsock_stats (zsock_t *self)
+{
+    assert (self);
+    assert (zsock_is (self));
+    s_stats_t *stats = self->stats;
+    if (!stats)
+        return NULL;
+
+    zconfig_t *root = zconfig_new ("root", NULL);
+    assert (root);
+    zconfig_t *sent = zconfig_new ("sent", root);
+    zconfig_putf (sent, "msgs", "%" PRIu64, stats->msgs_sent);
+    zconfig_putf (sent, "frames", "%" PRIu64, stats->frames_sent);
+    zconfig_putf (sent, "bytes", "%" PRIu64, stats->bytes_sent);
+    zconfig_putf (sent, "failed", "%" PRIu64, stats->send_failed);
+    zconfig_putf (sent, "again", "%" PRIu64, stats->send_again);
+    zconfig_putf (sent, "retries", "%" PRIu64, stats->send_retries);
+    zconfig_t *recv = zconfig_new ("recv", root);
+    zconfig_putf (recv, "msgs", "%" PRIu64, stats->msgs_recv);
+    zconfig_putf (recv, "frames", "%" PRIu64, stats->frames_recv);
+    zconfig_putf (recv, "bytes", "%" PRIu64, stats->bytes_recv);
+    zconfig_putf (root, "msg_max", "%zu", stats->msg_max);
+    return root;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Reset traffic statistics to zero, if they are on.
+
+void
+zsock_stats_reset (zsock_t *self)
+{
+    assert (self);
+    assert (zsock_is (self));
+    if (self->stats)
+        memset (self->stats, 0, sizeof (s_stats_t));
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return the statistics of a socket or actor, or NULL if it has none
+
+static s_stats_t *
+s_stats (void *self)
+{
+    if (zactor_is (self))
+        self = zactor_sock ((zactor_t *) self);
+    return zsock_is (self)? ((zsock_t *) self)->stats: NULL;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Count a frame sent on a socket or actor, where rc is what zmq_msg_send
+//  returned: the frame size, or -1 if the send failed. Only call this if
+//  zsock_stats_used () is true.
+
+void
+zsock_stats_sent (void *self, int rc, bool more)
+{
+    s_stats_t *stats = s_stats (self);
+    if (!stats)
+        return;
+    if (rc == -1) {
+        stats->send_failed++;
+        if (errno == EAGAIN)
+            stats->send_again++;
+        return;
+    }
+    stats->frames_sent++;
+    stats->bytes_sent += rc;
+    stats->send_size += rc;
+    if (!more) {
+        stats->msgs_sent++;
+        if (stats->msg_max < stats->send_size)
+            stats->msg_max = stats->send_size;
+        stats->send_size = 0;
+    }
+}
+
+
+//  --------------------------------------------------------------------------
+//  Count a frame received on a socket or actor, where rc is what
+//  zmq_msg_recv returned: the frame size. Only call this if
+//  zsock_stats_used () is true.
+
+void
+zsock_stats_received (void *self, int rc, bool more)
+{
+    s_stats_t *stats = s_stats (self);
+    if (!stats)
+        return;
+    stats->frames_recv++;
+    stats->bytes_recv += rc;
+    stats->recv_size += rc;
+    if (!more) {
+        stats->msgs_recv++;
+        if (stats->msg_max < stats->recv_size)
+            stats->msg_max = stats->recv_size;
+        stats->recv_size = 0;
+    }
+}
+
+
+//  --------------------------------------------------------------------------
+//  Count a send retried after EINTR on a socket or actor. Only call this if
+//  zsock_stats_used () is true.
+
+void
+zsock_stats_retried (void *self)
+{
+    s_stats_t *stats = s_stats (self);
+    if (stats)
+        stats->send_retries++;
+}
+
+
 //  We use the gossip messages for some test cases
 #include "zgossip_msg.h"
 
@@ -2451,6 +2632,72 @@ zsock_test (bool verbose)
     zsock_destroy (&reader);
     zsock_destroy (&writer);
 
+#ifdef CZMQ_BUILD_DRAFT_API
+    //  Count traffic on sockets that have statistics switched on
+    zsock_t *sender = zsock_new_pair ("@inproc://zsock.stats");
+    assert (sender);
+    zsock_t *receiver = zsock_new_pair (">inproc://zsock.stats");
+    assert (receiver);
+    assert (zsock_stats (sender) == NULL);
+    zsock_set_stats (sender, true);
+    zsock_set_stats (receiver, true);
+
+    zstr_send (sender, "Hello");
+    zstr_sendx (sender, "A", "BC", NULL);
+    zframe_t *stats_frame = zframe_new ("12345678", 8);
+    zframe_send (&stats_frame, sender, 0);
+    zsock_bsend (sender, "4", 1234);
+
+    char *stats_string = zstr_recv (receiver);
+    zstr_free (&stats_string);
+    zmsg_t *stats_msg = zmsg_recv (receiver);
+    assert (zmsg_size (stats_msg) == 2);
+    zmsg_destroy (&stats_msg);
+    stats_frame = zframe_recv (receiver);
+    zframe_destroy (&stats_frame);
+    uint32_t stats_number;
+    zsock_brecv (receiver, "4", &stats_number);
+
+    zconfig_t *stats = zsock_stats (sender);
+    assert (stats);
+    assert (streq (zconfig_get (stats, "sent/msgs", NULL), "4"));
+    assert (streq (zconfig_get (stats, "sent/frames", NULL), "5"));
+    assert (streq (zconfig_get (stats, "sent/bytes", NULL), "20"));
+    assert (streq (zconfig_get (stats, "sent/failed", NULL), "0"));
+    assert (streq (zconfig_get (stats, "recv/msgs", NULL), "0"));
+    assert (streq (zconfig_get (stats, "msg_max", NULL), "8"));
+    zconfig_destroy (&stats);
+    stats = zsock_stats (receiver);
+    assert (streq (zconfig_get (stats, "recv/msgs", NULL), "4"));
+    assert (streq (zconfig_get (stats, "recv/frames", NULL), "5"));
+    assert (streq (zconfig_get (stats, "recv/bytes", NULL), "20"));
+    assert (streq (zconfig_get (stats, "msg_max", NULL), "8"));
+    zconfig_destroy (&stats);
+
+    zsock_stats_reset (receiver);
+    stats = zsock_stats (receiver);
+    assert (streq (zconfig_get (stats, "recv/msgs", NULL), "0"));
+    zconfig_destroy (&stats);
+    zsock_set_stats (receiver, false);
+    assert (zsock_stats (receiver) == NULL);
+    zsock_destroy (&receiver);
+    zsock_destroy (&sender);
+
+    //  Sends that fail at the high-water mark count as failed and again
+    sender = zsock_new (ZMQ_PUSH);
+    assert (sender);
+    zsock_set_sndtimeo (sender, 0);
+    zsock_set_stats (sender, true);
+    rc = zstr_send (sender, "Lost");
+    assert (rc == -1);
+    stats = zsock_stats (sender);
+    assert (streq (zconfig_get (stats, "sent/msgs", NULL), "0"));
+    assert (streq (zconfig_get (stats, "sent/failed", NULL), "1"));
+    assert (streq (zconfig_get (stats, "sent/again", NULL), "1"));
+    zconfig_destroy (&stats);
+    zsock_destroy (&sender);
+#endif
+
 #ifdef ZMQ_DGRAM
     // ZMQ_DGRAM ipv4 unicast test
     zsock_t* dgramr = zsock_new_dgram ("udp://*:7777");
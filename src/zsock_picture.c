@@ -0,0 +1,1201 @@
+/*  =========================================================================
+    zsock_picture - precompiled picture messages
+
+    Copyright (c) the Contributors as noted in the AUTHORS file.
+    This file is part of CZMQ, the high-level C binding for 0MQ:
+    http://czmq.zeromq.org.
+
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+    =========================================================================
+*/
+
+/*
+@header
+    The zsock_picture class compiles a picture, as used by zsock_send,
+    zsock_recv, zsock_bsend and zsock_brecv, once, and then sends and
+    receives messages with it. Messages are the same on the wire as those
+    that zsock sends, so either end may use compiled or plain pictures.
+@discuss
+    Compiling checks the picture once, rather than on every call, and works
+    out the size of the fixed-size part of a binary data frame. Text sends
+    build and send one frame at a time, rather than building a zmsg first,
+    and format numbers without printf. Text receives parse numbers straight
+    from the frame, rather than from a copy of it. Binary sends only walk
+    the arguments twice if the picture holds strings or chunks.
+
+    A compiled picture may be shared between threads, except for brecv,
+    which keeps 's' strings in the picture.
+@end
+*/
+
+#include "czmq_classes.h"
+
+//  Elements we accept in each format
+#define TEXT_ELEMENTS       "i1248sbcfUphlmz"
+#define BINARY_ELEMENTS     "1248sScfupm"
+
+//  Most frames we send or receive after the binary data frame
+#define ZSOCK_PICTURE_MAX_FRAMES 32
+
+//  This is the largest size we allow for an incoming longstr or chunk (1M)
+#define MAX_ALLOC_SIZE      1024 * 1024
+
+//  Structure of our class
+
+struct _zsock_picture_t {
+    char *picture;              //  Picture as given
+    bool text;                  //  Valid for send and recv
+    bool binary;                //  Valid for bsend and brecv
+    size_t fixed_size;          //  Binary data frame size, without content
+    bool variable;              //  Picture has 's', 'S' or 'c' content
+    char *cache;                //  Last received 's' strings
+};
+
+
+//  --------------------------------------------------------------------------
+//  Compile a picture, as used by zsock_send and zsock_bsend, for sending
+//  and receiving many messages. Returns NULL and logs an error if the
+//  picture is valid for neither format.
+
+zsock_picture_t *
+zsock_picture_new (const char *picture)
+{
+    assert (picture);
+    zsock_picture_t *self = (zsock_picture_t *) zmalloc (sizeof (zsock_picture_t));
+    assert (self);
+    self->picture = strdup (picture);
+    assert (self->picture);
+    self->text = true;
+    self->binary = true;
+
+    size_t strings = 0;
+    size_t frames = 0;
+    const char *picptr;
+    for (picptr = picture; *picptr; picptr++) {
+        if (!strchr (TEXT_ELEMENTS, *picptr))
+            self->text = false;
+        if (!strchr (BINARY_ELEMENTS, *picptr))
+            self->binary = false;
+        else
+        if (*picptr == '1')
+            self->fixed_size += 1;
+        else
+        if (*picptr == '2')
+            self->fixed_size += 2;
+        else
+        if (*picptr == '4')
+            self->fixed_size += 4;
+        else
+        if (*picptr == '8')
+            self->fixed_size += 8;
+        else
+        if (*picptr == 'p')
+            self->fixed_size += sizeof (void *);
+        else
+        if (*picptr == 'u')
+            self->fixed_size += ZUUID_LEN;
+        else
+        if (*picptr == 's') {
+            self->fixed_size += 1;
+            self->variable = true;
+            strings++;
+        }
+        else
+        if (*picptr == 'S' || *picptr == 'c') {
+            self->fixed_size += 4;
+            self->variable = true;
+        }
+        else
+        if (*picptr == 'f')
+            frames++;
+        else
+        if (*picptr == 'm' && picptr [1])
+            self->binary = false;       //  'm' only valid at end
+    }
+    if (frames >= ZSOCK_PICTURE_MAX_FRAMES)
+        self->binary = false;
+
+    if (!self->text && !self->binary) {
+        zsys_error ("zsock_picture: invalid picture '%s'", picture);
+        zsock_picture_destroy (&self);
+        return NULL;
+    }
+    //  Each received 's' string takes at most 256 bytes, so the cache never
+    //  has to grow under strings we already handed out
+    if (self->binary && strings) {
+        self->cache = (char *) malloc (strings * 256);
+        assert (self->cache);
+    }
+    return self;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Destroy a compiled picture.
+
+void
+zsock_picture_destroy (zsock_picture_t **self_p)
+{
+    assert (self_p);
+    if (*self_p) {
+        zsock_picture_t *self = *self_p;
+        freen (self->picture);
+        freen (self->cache);
+        freen (self);
+        *self_p = NULL;
+    }
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return the picture string the picture was compiled from.
+
+const char *
+zsock_picture_picture (zsock_picture_t *self)
+{
+    assert (self);
+    return self->picture;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Format a number as decimal text, the same as printf does, into a buffer
+//  of at least 21 bytes. Returns the length of the text, which is not
+//  null-terminated.
+
+static size_t
+s_number_format (char *buffer, uint64_t number, bool negative)
+{
+    char digits [20];
+    size_t nbr_digits = 0;
+    do {
+        digits [nbr_digits++] = (char) ('0' + number % 10);
+        number /= 10;
+    } while (number);
+
+    size_t length = 0;
+    if (negative)
+        buffer [length++] = '-';
+    while (nbr_digits)
+        buffer [length++] = digits [--nbr_digits];
+    return length;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Parse a number from frame text, the same way as strtoull does, and
+//  return it; a negative number wraps around. Returns 0 if there is no
+//  frame.
+
+static uint64_t
+s_number_parse (zframe_t *frame)
+{
+    if (!frame)
+        return 0;
+    const char *needle = (const char *) zframe_data (frame);
+    const char *ceiling = needle + zframe_size (frame);
+    while (needle < ceiling && isspace ((byte) *needle))
+        needle++;
+    bool negative = false;
+    if (needle < ceiling && (*needle == '-' || *needle == '+'))
+        negative = *needle++ == '-';
+
+    uint64_t number = 0;
+    while (needle < ceiling && isdigit ((byte) *needle))
+        number = number * 10 + (uint64_t) (*needle++ - '0');
+    return negative? 0 - number: number;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Send the frame we're holding back with the MORE flag, as another frame
+//  follows it, and hold back the new frame instead. We always hold back one
+//  frame, so the last frame of the message goes without MORE. Returns 0 if
+//  OK, else destroys both frames and returns -1.
+
+static int
+s_send_part (zframe_t **pending_p, zframe_t *frame, void *dest)
+{
+    assert (frame);
+    if (*pending_p
+    &&  zframe_send (pending_p, dest, ZFRAME_MORE) == -1) {
+        zframe_destroy (pending_p);
+        zframe_destroy (&frame);
+        return -1;
+    }
+    *pending_p = frame;
+    return 0;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Send a message to the socket (or actor), like zsock_send with the
+//  compiled picture. The picture must be valid for the text format.
+//  Returns 0 if successful, -1 if sending failed for any reason.
+
+int
+zsock_picture_send (zsock_picture_t *self, void *dest, ...)
+{
+    assert (self);
+    assert (self->text);
+    assert (dest);
+
+    zframe_t *pending = NULL;
+    char number [21];
+    int rc = 0;
+    va_list argptr;
+    va_start (argptr, dest);
+    const char *picptr;
+    for (picptr = self->picture; *picptr && rc == 0; picptr++) {
+        zframe_t *frame = NULL;
+        if (*picptr == 'i') {
+            int value = va_arg (argptr, int);
+            frame = zframe_new (number, s_number_format (number,
+                value < 0? 0 - (uint64_t) value: (uint64_t) value, value < 0));
+        }
+        else
+        if (*picptr == '1') {
+            uint8_t value = (uint8_t) va_arg (argptr, int);
+            frame = zframe_new (number, s_number_format (number, value, false));
+        }
+        else
+        if (*picptr == '2') {
+            uint16_t value = (uint16_t) va_arg (argptr, int);
+            frame = zframe_new (number, s_number_format (number, value, false));
+        }
+        else
+        if (*picptr == '4') {
+            uint32_t value = va_arg (argptr, uint32_t);
+            frame = zframe_new (number, s_number_format (number, value, false));
+        }
+        else
+        if (*picptr == '8') {
+            uint64_t value = va_arg (argptr, uint64_t);
+            frame = zframe_new (number, s_number_format (number, value, false));
+        }
+        else
+        if (*picptr == 's') {
+            char *string = va_arg (argptr, char *);
+            assert (string);
+            frame = zframe_new (string, strlen (string));
+        }
+        else
+        if (*picptr == 'b') {
+            //  Function arguments may be expanded in reverse order, so we
+            //  cannot use va_arg macro twice in a single call
+            byte *data = va_arg (argptr, byte *);
+            frame = zframe_new (data, va_arg (argptr, int));
+        }
+        else
+        if (*picptr == 'c') {
+            zchunk_t *chunk = va_arg (argptr, zchunk_t *);
+            assert (zchunk_is (chunk));
+            frame = zframe_new (zchunk_data (chunk), zchunk_size (chunk));
+        }
+        else
+        if (*picptr == 'f') {
+            zframe_t *source = va_arg (argptr, zframe_t *);
+            assert (zframe_is (source));
+            frame = zframe_new (zframe_data (source), zframe_size (source));
+        }
+        else
+        if (*picptr == 'U') {
+            zuuid_t *uuid = va_arg (argptr, zuuid_t *);
+            frame = zframe_new (zuuid_data (uuid), zuuid_size (uuid));
+        }
+        else
+        if (*picptr == 'p') {
+            void *pointer = va_arg (argptr, void *);
+            frame = zframe_new (&pointer, sizeof (void *));
+        }
+        else
+        if (*picptr == 'h')
+            frame = zhashx_pack (va_arg (argptr, zhashx_t *));
+        else
+        if (*picptr == 'l')
+            frame = zlistx_pack (va_arg (argptr, zlistx_t *));
+        else
+        if (*picptr == 'm') {
+            zmsg_t *msg = va_arg (argptr, zmsg_t *);
+            zframe_t *source;
+            for (source = zmsg_first (msg); source && rc == 0;
+                 source = zmsg_next (msg))
+                rc = s_send_part (&pending, zframe_new (zframe_data (source),
+                                  zframe_size (source)), dest);
+        }
+        else
+        if (*picptr == 'z')
+            frame = zframe_new_empty ();
+
+        if (frame)
+            rc = s_send_part (&pending, frame, dest);
+    }
+    va_end (argptr);
+
+    if (pending) {
+        if (rc == 0)
+            rc = zframe_send (&pending, dest, 0);
+        zframe_destroy (&pending);
+    }
+    return rc;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Receive a message from the socket (or actor), like zsock_recv with the
+//  compiled picture. Returns 0 if successful, or -1 if it failed to recv a
+//  message or the message was a signal.
+
+int
+zsock_picture_recv (zsock_picture_t *self, void *source, ...)
+{
+    assert (self);
+    assert (self->text);
+    assert (source);
+
+    zframe_t *frame = zframe_recv (source);
+    if (!frame)
+        return -1;              //  Interrupted
+
+    //  Filter a signal that may come from a dying actor
+    if (!zframe_more (frame) && zframe_size (frame) == 8) {
+        int64_t signal_value;
+        memcpy (&signal_value, zframe_data (frame), 8);
+        if ((signal_value & 0xFFFFFFFFFFFFFF00L) == 0x7766554433221100L) {
+            zframe_destroy (&frame);
+            return -1;
+        }
+    }
+    //  Now parse message according to picture; each element takes one
+    //  frame, or NULL when the message is short
+    int rc = 0;
+    va_list argptr;
+    va_start (argptr, source);
+    const char *picptr;
+    for (picptr = self->picture; *picptr; picptr++) {
+        bool more = frame && zframe_more (frame);
+        if (*picptr == 'i') {
+            int *int_p = va_arg (argptr, int *);
+            if (int_p)
+                *int_p = (int) s_number_parse (frame);
+        }
+        else
+        if (*picptr == '1') {
+            uint8_t *uint8_p = va_arg (argptr, uint8_t *);
+            if (uint8_p)
+                *uint8_p = (uint8_t) s_number_parse (frame);
+        }
+        else
+        if (*picptr == '2') {
+            uint16_t *uint16_p = va_arg (argptr, uint16_t *);
+            if (uint16_p)
+                *uint16_p = (uint16_t) s_number_parse (frame);
+        }
+        else
+        if (*picptr == '4') {
+            uint32_t *uint32_p = va_arg (argptr, uint32_t *);
+            if (uint32_p)
+                *uint32_p = (uint32_t) s_number_parse (frame);
+        }
+        else
+        if (*picptr == '8') {
+            uint64_t *uint64_p = va_arg (argptr, uint64_t *);
+            if (uint64_p)
+                *uint64_p = s_number_parse (frame);
+        }
+        else
+        if (*picptr == 's') {
+            char **string_p = va_arg (argptr, char **);
+            if (string_p)
+                *string_p = frame? zframe_strdup (frame): NULL;
+        }
+        else
+        if (*picptr == 'b') {
+            byte **data_p = va_arg (argptr, byte **);
+            size_t *size = va_arg (argptr, size_t *);
+            if (data_p) {
+                if (frame) {
+                    *size = zframe_size (frame);
+                    *data_p = (byte *) malloc (*size);
+                    memcpy (*data_p, zframe_data (frame), *size);
+                }
+                else {
+                    *data_p = NULL;
+                    *size = 0;
+                }
+            }
+        }
+        else
+        if (*picptr == 'c') {
+            zchunk_t **chunk_p = va_arg (argptr, zchunk_t **);
+            if (chunk_p)
+                *chunk_p = frame?
+                    zchunk_new (zframe_data (frame), zframe_size (frame)): NULL;
+        }
+        else
+        if (*picptr == 'f') {
+            zframe_t **frame_p = va_arg (argptr, zframe_t **);
+            if (frame_p) {
+                *frame_p = frame;
+                frame = NULL;
+            }
+        }
+        else
+        if (*picptr == 'U') {
+            zuuid_t **uuid_p = va_arg (argptr, zuuid_t **);
+            if (uuid_p) {
+                if (frame) {
+                    *uuid_p = zuuid_new ();
+                    zuuid_set (*uuid_p, zframe_data (frame));
+                }
+                else
+                    *uuid_p = NULL;
+            }
+        }
+        else
+        if (*picptr == 'p') {
+            void **pointer_p = va_arg (argptr, void **);
+            if (pointer_p) {
+                if (frame) {
+                    if (zframe_size (frame) == sizeof (void *))
+                        memcpy (pointer_p, zframe_data (frame), sizeof (void *));
+                    else
+                        rc = -1;
+                }
+                else
+                    *pointer_p = NULL;
+            }
+        }
+        else
+        if (*picptr == 'h') {
+            zhashx_t **hash_p = va_arg (argptr, zhashx_t **);
+            if (hash_p)
+                *hash_p = frame? zhashx_unpack (frame): NULL;
+        }
+        else
+        if (*picptr == 'l') {
+            zlistx_t **list_p = va_arg (argptr, zlistx_t **);
+            if (list_p)
+                *list_p = frame? zlistx_unpack (frame): NULL;
+        }
+        else
+        if (*picptr == 'm') {
+            //  Take this and all remaining frames
+            zmsg_t **zmsg_p = va_arg (argptr, zmsg_t **);
+            zmsg_t *zmsg = zmsg_p? zmsg_new (): NULL;
+            while (frame) {
+                more = zframe_more (frame);
+                if (zmsg)
+                    zmsg_append (zmsg, &frame);
+                else
+                    zframe_destroy (&frame);
+                frame = more? zframe_recv (source): NULL;
+            }
+            if (zmsg_p)
+                *zmsg_p = zmsg;
+        }
+        else
+        if (*picptr == 'z') {
+            if (frame && zframe_size (frame) != 0)
+                rc = -1;
+        }
+        zframe_destroy (&frame);
+        frame = more? zframe_recv (source): NULL;
+    }
+    va_end (argptr);
+
+    //  Discard any frames the picture did not ask for
+    while (frame) {
+        bool more = zframe_more (frame);
+        zframe_destroy (&frame);
+        frame = more? zframe_recv (source): NULL;
+    }
+    return rc;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Network data encoding macros, the same as zsock uses in bsend/brecv
+
+//  Put a 1-byte number to the frame
+#define PUT_NUMBER1(host) { \
+    *(byte *) needle = (host); \
+    needle++; \
+}
+
+//  Put a 2-byte number to the frame
+#define PUT_NUMBER2(host) { \
+    needle [0] = (byte) (((host) >> 8)  & 255); \
+    needle [1] = (byte) (((host))       & 255); \
+    needle += 2; \
+}
+
+//  Put a 4-byte number to the frame
+#define PUT_NUMBER4(host) { \
+    needle [0] = (byte) (((host) >> 24) & 255); \
+    needle [1] = (byte) (((host) >> 16) & 255); \
+    needle [2] = (byte) (((host) >> 8)  & 255); \
+    needle [3] = (byte) (((host))       & 255); \
+    needle += 4; \
+}
+
+//  Put a 8-byte number to the frame
+#define PUT_NUMBER8(host) { \
+    needle [0] = (byte) (((host) >> 56) & 255); \
+    needle [1] = (byte) (((host) >> 48) & 255); \
+    needle [2] = (byte) (((host) >> 40) & 255); \
+    needle [3] = (byte) (((host) >> 32) & 255); \
+    needle [4] = (byte) (((host) >> 24) & 255); \
+    needle [5] = (byte) (((host) >> 16) & 255); \
+    needle [6] = (byte) (((host) >> 8)  & 255); \
+    needle [7] = (byte) (((host))       & 255); \
+    needle += 8; \
+}
+
+//  Get a 1-byte number from the frame
+#define GET_NUMBER1(host) { \
+    if (needle + 1 > ceiling) \
+        goto malformed; \
+    (host) = *(byte *) needle; \
+    needle++; \
+}
+
+//  Get a 2-byte number from the frame
+#define GET_NUMBER2(host) { \
+    if (needle + 2 > ceiling) \
+        goto malformed; \
+    (host) = ((uint16_t) (needle [0]) << 8) \
+           +  (uint16_t) (needle [1]); \
+    needle += 2; \
+}
+
+//  Get a 4-byte number from the frame
+#define GET_NUMBER4(host) { \
+    if (needle + 4 > ceiling) \
+        goto malformed; \
+    (host) = ((uint32_t) (needle [0]) << 24) \
+           + ((uint32_t) (needle [1]) << 16) \
+           + ((uint32_t) (needle [2]) << 8) \
+           +  (uint32_t) (needle [3]); \
+    needle += 4; \
+}
+
+//  Get a 8-byte number from the frame
+#define GET_NUMBER8(host) { \
+    if (needle + 8 > ceiling) \
+        goto malformed; \
+    (host) = ((uint64_t) (needle [0]) << 56) \
+           + ((uint64_t) (needle [1]) << 48) \
+           + ((uint64_t) (needle [2]) << 40) \
+           + ((uint64_t) (needle [3]) << 32) \
+           + ((uint64_t) (needle [4]) << 24) \
+           + ((uint64_t) (needle [5]) << 16) \
+           + ((uint64_t) (needle [6]) << 8) \
+           +  (uint64_t) (needle [7]); \
+    needle += 8; \
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return the size of the string and chunk content that the arguments add
+//  to the binary data frame. Consumes all the arguments.
+
+static size_t
+s_content_size (zsock_picture_t *self, va_list argptr)
+{
+    size_t content_size = 0;
+    const char *picptr;
+    for (picptr = self->picture; *picptr; picptr++) {
+        if (*picptr == '1' || *picptr == '2')
+            va_arg (argptr, int);
+        else
+        if (*picptr == '4')
+            va_arg (argptr, uint32_t);
+        else
+        if (*picptr == '8')
+            va_arg (argptr, uint64_t);
+        else
+        if (*picptr == 's') {
+            char *string = va_arg (argptr, char *);
+            content_size += string? strlen (string): 0;
+        }
+        else
+        if (*picptr == 'S') {
+            char *string = va_arg (argptr, char *);
+            content_size += string? strlen (string): 0;
+        }
+        else
+        if (*picptr == 'c') {
+            zchunk_t *chunk = va_arg (argptr, zchunk_t *);
+            content_size += chunk? zchunk_size (chunk): 0;
+        }
+        else
+            va_arg (argptr, void *);    //  'p', 'f', 'u', 'm'
+    }
+    return content_size;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Send a binary encoded message to the socket (or actor), like zsock_bsend
+//  with the compiled picture. The picture must be valid for the binary
+//  format. Returns 0 if successful, -1 if sending failed for any reason.
+
+int
+zsock_picture_bsend (zsock_picture_t *self, void *dest, ...)
+{
+    assert (self);
+    assert (self->binary);
+    assert (dest);
+
+    va_list argptr;
+    va_start (argptr, dest);
+    size_t frame_size = self->fixed_size;
+    if (self->variable) {
+        va_list sizeptr;
+        va_copy (sizeptr, argptr);
+        frame_size += s_content_size (self, sizeptr);
+        va_end (sizeptr);
+    }
+    zmq_msg_t msg;
+    zmq_msg_init_size (&msg, frame_size);
+    byte *needle = (byte *) zmq_msg_data (&msg);
+
+    //  Set routing id if dest is zsock
+#if defined ZMQ_SERVER
+    if (zsock_is (dest) && zsock_routing_id ((zsock_t *) dest) != 0)
+        zmq_msg_set_routing_id (&msg, zsock_routing_id ((zsock_t *) dest));
+#endif
+
+    //  Encode the data frame, and collect the frames that follow it
+    zframe_t *frames [ZSOCK_PICTURE_MAX_FRAMES];
+    size_t nbr_frames = 0;
+    zframe_t *empty = NULL;
+    const char *picptr;
+    for (picptr = self->picture; *picptr; picptr++) {
+        if (*picptr == '1') {
+            int number1 = va_arg (argptr, int);
+            PUT_NUMBER1 (number1);
+        }
+        else
+        if (*picptr == '2') {
+            int number2 = va_arg (argptr, int);
+            PUT_NUMBER2 (number2);
+        }
+        else
+        if (*picptr == '4') {
+            uint32_t number4 = va_arg (argptr, uint32_t);
+            PUT_NUMBER4 (number4);
+        }
+        else
+        if (*picptr == '8') {
+            uint64_t number8 = va_arg (argptr, uint64_t);
+            PUT_NUMBER8 (number8);
+        }
+        else
+        if (*picptr == 'p') {
+            void *pointer = va_arg (argptr, void *);
+            memcpy (needle, &pointer, sizeof (void *));
+            needle += sizeof (void *);
+        }
+        else
+        if (*picptr == 's') {
+            char *string = va_arg (argptr, char *);
+            size_t string_size = string? strlen (string): 0;
+            assert (string_size < 256);
+            PUT_NUMBER1 ((byte) string_size);
+            memcpy (needle, string, string_size);
+            needle += string_size;
+        }
+        else
+        if (*picptr == 'S') {
+            char *string = va_arg (argptr, char *);
+            size_t string_size = string? strlen (string): 0;
+            PUT_NUMBER4 (string_size);
+            memcpy (needle, string, string_size);
+            needle += string_size;
+        }
+        else
+        if (*picptr == 'c') {
+            zchunk_t *chunk = va_arg (argptr, zchunk_t *);
+            size_t chunk_size = chunk? zchunk_size (chunk): 0;
+            PUT_NUMBER4 (chunk_size);
+            if (chunk_size)
+                memcpy (needle, zchunk_data (chunk), chunk_size);
+            needle += chunk_size;
+        }
+        else
+        if (*picptr == 'u') {
+            zuuid_t *uuid = va_arg (argptr, zuuid_t *);
+            if (uuid)
+                memcpy (needle, zuuid_data (uuid), ZUUID_LEN);
+            else
+                memset (needle, 0, ZUUID_LEN);
+            needle += ZUUID_LEN;
+        }
+        else
+        if (*picptr == 'f')
+            frames [nbr_frames++] = va_arg (argptr, zframe_t *);
+        else
+        if (*picptr == 'm') {
+            zmsg_t *zmsg = va_arg (argptr, zmsg_t *);
+            if (zmsg) {
+                zframe_t *frame = zmsg_first (zmsg);
+                while (frame) {
+                    assert (nbr_frames < ZSOCK_PICTURE_MAX_FRAMES);
+                    frames [nbr_frames++] = frame;
+                    frame = zmsg_next (zmsg);
+                }
+            }
+            else {
+                empty = zframe_new_empty ();
+                frames [nbr_frames++] = empty;
+            }
+        }
+    }
+    va_end (argptr);
+
+    //  Now send the data frame, then any additional frames
+    int rc = zmq_msg_send (&msg, zsock_resolve (dest), nbr_frames? ZMQ_SNDMORE: 0);
+    if (zsock_stats_used ())
+        zsock_stats_sent (dest, rc, nbr_frames > 0);
+    if (rc == -1)
+        zmq_msg_close (&msg);
+    else {
+        size_t frame_nbr;
+        for (frame_nbr = 0; frame_nbr < nbr_frames; frame_nbr++) {
+            bool more = frame_nbr < nbr_frames - 1;
+            rc = zframe_send (&frames [frame_nbr], dest,
+                              ZFRAME_REUSE + (more? ZFRAME_MORE: 0));
+            if (rc == -1)
+                break;
+        }
+    }
+    zframe_destroy (&empty);
+    return rc >= 0? 0: -1;
+}
+
+
+//  --------------------------------------------------------------------------
+//  Receive a binary encoded message from the socket (or actor), like
+//  zsock_brecv with the compiled picture. Returns 0 if successful, -1 if it
+//  failed to recv a message or the message was malformed.
+
+int
+zsock_picture_brecv (zsock_picture_t *self, void *source, ...)
+{
+    assert (self);
+    assert (self->binary);
+    assert (source);
+
+    zmq_msg_t msg;
+    zmq_msg_init (&msg);
+    int rc = zmq_msg_recv (&msg, zsock_resolve (source), 0);
+    if (rc == -1) {
+        zmq_msg_close (&msg);
+        return -1;              //  Interrupted
+    }
+    bool more = zmq_msg_more (&msg) != 0;
+    if (zsock_stats_used ())
+        zsock_stats_received (source, rc, more);
+
+    //  If source is zsock get routing id from msg
+#if defined ZMQ_SERVER
+    if (zsock_is (source) && zsock_type (source) == ZMQ_SERVER)
+        zsock_set_routing_id ((zsock_t *) source, zmq_msg_routing_id (&msg));
+#endif
+
+    size_t cache_used = 0;
+    byte *needle = (byte *) zmq_msg_data (&msg);
+    byte *ceiling = needle + zmq_msg_size (&msg);
+    va_list argptr;
+    va_start (argptr, source);
+    const char *picptr;
+    for (picptr = self->picture; *picptr; picptr++) {
+        if (*picptr == '1') {
+            uint8_t *number1_p = va_arg (argptr, uint8_t *);
+            GET_NUMBER1 (*number1_p);
+        }
+        else
+        if (*picptr == '2') {
+            uint16_t *number2_p = va_arg (argptr, uint16_t *);
+            GET_NUMBER2 (*number2_p);
+        }
+        else
+        if (*picptr == '4') {
+            uint32_t *number4_p = va_arg (argptr, uint32_t *);
+            GET_NUMBER4 (*number4_p);
+        }
+        else
+        if (*picptr == '8') {
+            uint64_t *number8_p = va_arg (argptr, uint64_t *);
+            GET_NUMBER8 (*number8_p);
+        }
+        else
+        if (*picptr == 'p') {
+            void **pointer_p = va_arg (argptr, void **);
+            if (needle + sizeof (void *) > ceiling)
+                goto malformed;
+            memcpy (pointer_p, needle, sizeof (void *));
+            needle += sizeof (void *);
+        }
+        else
+        if (*picptr == 's') {
+            char **string_p = va_arg (argptr, char **);
+            size_t string_size;
+            GET_NUMBER1 (string_size);
+            if (needle + string_size > ceiling)
+                goto malformed;
+            *string_p = self->cache + cache_used;
+            memcpy (*string_p, needle, string_size);
+            cache_used += string_size;
+            self->cache [cache_used++] = 0;
+            needle += string_size;
+        }
+        else
+        if (*picptr == 'S') {
+            char **string_p = va_arg (argptr, char **);
+            size_t string_size;
+            GET_NUMBER4 (string_size);
+            if (string_size > MAX_ALLOC_SIZE
+            ||  needle + string_size > ceiling)
+                goto malformed;
+            *string_p = (char *) malloc (string_size + 1);
+            assert (*string_p);
+            memcpy (*string_p, needle, string_size);
+            (*string_p) [string_size] = 0;
+            needle += string_size;
+        }
+        else
+        if (*picptr == 'c') {
+            zchunk_t **chunk_p = va_arg (argptr, zchunk_t **);
+            size_t chunk_size;
+            GET_NUMBER4 (chunk_size);
+            if (chunk_size > MAX_ALLOC_SIZE
+            ||  needle + chunk_size > ceiling)
+                goto malformed;
+            *chunk_p = zchunk_new (needle, chunk_size);
+            needle += chunk_size;
+        }
+        else
+        if (*picptr == 'u') {
+            zuuid_t **uuid_p = va_arg (argptr, zuuid_t **);
+            if (needle + ZUUID_LEN > ceiling)
+                goto malformed;
+            *uuid_p = zuuid_new_from (needle);
+            needle += ZUUID_LEN;
+        }
+        else
+        if (*picptr == 'f') {
+            zframe_t **frame_p = va_arg (argptr, zframe_t **);
+            if (!more)
+                goto malformed;
+            *frame_p = zframe_recv (source);
+            if (!*frame_p)
+                goto malformed;
+            more = zframe_more (*frame_p);
+        }
+        else
+        if (*picptr == 'm') {
+            zmsg_t **msg_p = va_arg (argptr, zmsg_t **);
+            if (!more)
+                goto malformed;
+            *msg_p = zmsg_recv (source);
+            more = false;
+        }
+    }
+    va_end (argptr);
+    zmq_msg_close (&msg);
+    return 0;
+
+    //  Error return; discard the rest of the message
+    malformed:
+        va_end (argptr);
+        zmq_msg_close (&msg);
+        while (more) {
+            zframe_t *frame = zframe_recv (source);
+            more = frame && zframe_more (frame);
+            zframe_destroy (&frame);
+        }
+        return -1;              //  Invalid message
+}
+
+
+//  --------------------------------------------------------------------------
+//  Selftest
+
+void
+zsock_picture_test (bool verbose)
+{
+    printf (" * zsock_picture: ");
+    //  @selftest
+    zsock_t *writer = zsock_new_pair ("@inproc://zsock_picture.test");
+    assert (writer);
+    zsock_t *reader = zsock_new_pair (">inproc://zsock_picture.test");
+    assert (reader);
+
+    //  Pictures must be valid for at least one format
+    zsock_picture_t *picture = zsock_picture_new ("X");
+    assert (picture == NULL);
+    picture = zsock_picture_new ("mS");
+    assert (picture == NULL);
+    picture = zsock_picture_new ("i4sp");
+    assert (picture);
+    assert (streq (zsock_picture_picture (picture), "i4sp"));
+    zsock_picture_destroy (&picture);
+    assert (picture == NULL);
+
+    //  Text messages match zsock_send and zsock_recv both ways
+    zsock_picture_t *text = zsock_picture_new ("i1248sbcfUphlzm");
+    assert (text);
+    zchunk_t *chunk = zchunk_new ("HELLO", 5);
+    zframe_t *frame = zframe_new ("WORLD", 5);
+    zuuid_t *uuid = zuuid_new ();
+    zhashx_t *hash = zhashx_new ();
+    zhashx_insert (hash, "1", "value A");
+    zlistx_t *list = zlistx_new ();
+    zlistx_add_end (list, "1");
+    zmsg_t *msg = zmsg_new ();
+    zmsg_addstr (msg, "Hello");
+    zmsg_addstr (msg, "World");
+    int rc = zsock_picture_send (text, writer, -12345, 200, 40000,
+        4000000000UL, (uint64_t) 18000000000000000000ULL, "This is a string",
+        "ABCDE", 5, chunk, frame, uuid, chunk, hash, list, msg);
+    assert (rc == 0);
+
+    int integer;
+    uint8_t number1;
+    uint16_t number2;
+    uint32_t number4;
+    uint64_t number8;
+    char *string;
+    byte *data;
+    size_t size;
+    zchunk_t *chunk_r;
+    zframe_t *frame_r;
+    zuuid_t *uuid_r;
+    void *pointer;
+    zhashx_t *hash_r;
+    zlistx_t *list_r;
+    zmsg_t *msg_r;
+    rc = zsock_recv (reader, "i1248sbcfUphlzm", &integer, &number1, &number2,
+        &number4, &number8, &string, &data, &size, &chunk_r, &frame_r, &uuid_r,
+        &pointer, &hash_r, &list_r, &msg_r);
+    assert (rc == 0);
+    assert (integer == -12345);
+    assert (number1 == 200);
+    assert (number2 == 40000);
+    assert (number4 == 4000000000UL);
+    assert (number8 == 18000000000000000000ULL);
+    assert (streq (string, "This is a string"));
+    assert (size == 5 && memcmp (data, "ABCDE", 5) == 0);
+    assert (zchunk_size (chunk_r) == 5);
+    assert (zframe_streq (frame_r, "WORLD"));
+    assert (zuuid_eq (uuid, zuuid_data (uuid_r)));
+    assert (pointer == chunk);
+    assert (streq ((char *) zhashx_lookup (hash_r, "1"), "value A"));
+    assert (streq ((char *) zlistx_first (list_r), "1"));
+    assert (zmsg_size (msg_r) == 2);
+    freen (string);
+    freen (data);
+    zchunk_destroy (&chunk_r);
+    zframe_destroy (&frame_r);
+    zuuid_destroy (&uuid_r);
+    zhashx_destroy (&hash_r);
+    zlistx_destroy (&list_r);
+    zmsg_destroy (&msg_r);
+
+    rc = zsock_send (writer, "i1248sbcfUphlzm", -12345, 200, 40000,
+        4000000000UL, (uint64_t) 18000000000000000000ULL, "This is a string",
+        "ABCDE", 5, chunk, frame, uuid, chunk, hash, list, msg);
+    assert (rc == 0);
+    rc = zsock_picture_recv (text, reader, &integer, &number1, &number2,
+        &number4, &number8, &string, &data, &size, &chunk_r, &frame_r, &uuid_r,
+        &pointer, &hash_r, &list_r, &msg_r);
+    assert (rc == 0);
+    assert (integer == -12345);
+    assert (number1 == 200);
+    assert (number2 == 40000);
+    assert (number4 == 4000000000UL);
+    assert (number8 == 18000000000000000000ULL);
+    assert (streq (string, "This is a string"));
+    assert (size == 5 && memcmp (data, "ABCDE", 5) == 0);
+    assert (zchunk_size (chunk_r) == 5);
+    assert (zframe_streq (frame_r, "WORLD"));
+    assert (zuuid_eq (uuid, zuuid_data (uuid_r)));
+    assert (pointer == chunk);
+    assert (streq ((char *) zhashx_lookup (hash_r, "1"), "value A"));
+    assert (streq ((char *) zlistx_first (list_r), "1"));
+    assert (zmsg_size (msg_r) == 2);
+    freen (string);
+    freen (data);
+    zchunk_destroy (&chunk_r);
+    zframe_destroy (&frame_r);
+    zuuid_destroy (&uuid_r);
+    zhashx_destroy (&hash_r);
+    zlistx_destroy (&list_r);
+    zmsg_destroy (&msg_r);
+    zsock_picture_destroy (&text);
+
+    //  Short messages give zero values, extra frames are discarded, and
+    //  signals are filtered
+    zsock_picture_t *numbers = zsock_picture_new ("4s8");
+    assert (numbers);
+    zsock_send (writer, "4", 123);
+    rc = zsock_picture_recv (numbers, reader, &number4, &string, &number8);
+    assert (rc == 0);
+    assert (number4 == 123);
+    assert (string == NULL);
+    assert (number8 == 0);
+    zsock_send (writer, "4s8ss", 1, "two", (uint64_t) 3, "four", "five");
+    zsock_send (writer, "4s8", 6, "seven", (uint64_t) 8);
+    rc = zsock_picture_recv (numbers, reader, &number4, &string, &number8);
+    assert (rc == 0);
+    assert (number4 == 1 && number8 == 3);
+    assert (streq (string, "two"));
+    freen (string);
+    rc = zsock_picture_recv (numbers, reader, &number4, NULL, &number8);
+    assert (rc == 0);
+    assert (number4 == 6 && number8 == 8);
+    zsock_signal (writer, 0);
+    rc = zsock_picture_recv (numbers, reader, &number4, &string, &number8);
+    assert (rc == -1);
+    zsock_picture_destroy (&numbers);
+
+    //  Binary messages match zsock_bsend and zsock_brecv both ways
+    zsock_picture_t *binary = zsock_picture_new ("1248psScufm");
+    assert (binary);
+    char *longstr;
+    rc = zsock_picture_bsend (binary, writer, 200, 40000, 4000000000UL,
+        (uint64_t) 18000000000000000000ULL, chunk, "short", "long string",
+        chunk, uuid, frame, msg);
+    assert (rc == 0);
+    rc = zsock_brecv (reader, "1248psScufm", &number1, &number2, &number4,
+        &number8, &pointer, &string, &longstr, &chunk_r, &uuid_r, &frame_r,
+        &msg_r);
+    assert (rc == 0);
+    assert (number1 == 200);
+    assert (number2 == 40000);
+    assert (number4 == 4000000000UL);
+    assert (number8 == 18000000000000000000ULL);
+    assert (pointer == chunk);
+    assert (streq (string, "short"));
+    assert (streq (longstr, "long string"));
+    assert (zchunk_size (chunk_r) == 5);
+    assert (zuuid_eq (uuid, zuuid_data (uuid_r)));
+    assert (zframe_streq (frame_r, "WORLD"));
+    assert (zmsg_size (msg_r) == 2);
+    freen (longstr);
+    zchunk_destroy (&chunk_r);
+    zuuid_destroy (&uuid_r);
+    zframe_destroy (&frame_r);
+    zmsg_destroy (&msg_r);
+
+    rc = zsock_bsend (writer, "1248psScufm", 200, 40000, 4000000000UL,
+        (uint64_t) 18000000000000000000ULL, chunk, "short", "long string",
+        chunk, uuid, frame, msg);
+    assert (rc == 0);
+    rc = zsock_picture_brecv (binary, reader, &number1, &number2, &number4,
+        &number8, &pointer, &string, &longstr, &chunk_r, &uuid_r, &frame_r,
+        &msg_r);
+    assert (rc == 0);
+    assert (number1 == 200);
+    assert (number2 == 40000);
+    assert (number4 == 4000000000UL);
+    assert (number8 == 18000000000000000000ULL);
+    assert (pointer == chunk);
+    assert (streq (string, "short"));
+    assert (streq (longstr, "long string"));
+    assert (zchunk_size (chunk_r) == 5);
+    assert (zuuid_eq (uuid, zuuid_data (uuid_r)));
+    assert (zframe_streq (frame_r, "WORLD"));
+    assert (zmsg_size (msg_r) == 2);
+    freen (longstr);
+    zchunk_destroy (&chunk_r);
+    zuuid_destroy (&uuid_r);
+    zframe_destroy (&frame_r);
+    zmsg_destroy (&msg_r);
+
+    //  A short binary message is malformed, and is discarded whole
+    zsock_bsend (writer, "1f", 1, frame);
+    rc = zsock_picture_brecv (binary, reader, &number1, &number2, &number4,
+        &number8, &pointer, &string, &longstr, &chunk_r, &uuid_r, &frame_r,
+        &msg_r);
+    assert (rc == -1);
+    zsock_picture_destroy (&binary);
+
+    //  Pictures valid in both formats, with fixed-size binary data frames
+    zsock_picture_t *fixed = zsock_picture_new ("48p");
+    assert (fixed);
+    rc = zsock_picture_bsend (fixed, writer, 1, (uint64_t) 2, chunk);
+    assert (rc == 0);
+    rc = zsock_picture_brecv (fixed, reader, &number4, &number8, &pointer);
+    assert (rc == 0);
+    assert (number4 == 1 && number8 == 2 && pointer == chunk);
+    rc = zsock_picture_send (fixed, writer, 3, (uint64_t) 4, frame);
+    assert (rc == 0);
+    rc = zsock_picture_recv (fixed, reader, &number4, &number8, &pointer);
+    assert (rc == 0);
+    assert (number4 == 3 && number8 == 4 && pointer == frame);
+    zsock_picture_destroy (&fixed);
+
+    if (verbose) {
+        //  Compare the cost of plain and compiled pictures, for the kind of
+        //  control message that actors send
+        zsock_picture_t *control = zsock_picture_new ("i4sp");
+        assert (control);
+        const int rounds = 100000;
+        int round;
+        int64_t start = zclock_usecs ();
+        for (round = 0; round < rounds; round++) {
+            zsock_send (writer, "i4sp", round, 4, "COMMAND", writer);
+            zsock_recv (reader, "i4sp", &integer, &number4, &string, &pointer);
+            freen (string);
+        }
+        int64_t plain = zclock_usecs () - start;
+        start = zclock_usecs ();
+        for (round = 0; round < rounds; round++) {
+            zsock_picture_send (control, writer, round, 4, "COMMAND", writer);
+            zsock_picture_recv (control, reader, &integer, &number4, &string, &pointer);
+            freen (string);
+        }
+        int64_t compiled = zclock_usecs () - start;
+        zsys_info ("zsock_picture: text send/recv %d ns plain, %d ns compiled",
+                   (int) (plain * 1000 / rounds), (int) (compiled * 1000 / rounds));
+
+        start = zclock_usecs ();
+        for (round = 0; round < rounds; round++) {
+            zsock_bsend (writer, "4sp", 4, "COMMAND", writer);
+            zsock_brecv (reader, "4sp", &number4, &string, &pointer);
+        }
+        plain = zclock_usecs () - start;
+        zsock_picture_t *bcontrol = zsock_picture_new ("4sp");
+        assert (bcontrol);
+        start = zclock_usecs ();
+        for (round = 0; round < rounds; round++) {
+            zsock_picture_bsend (bcontrol, writer, 4, "COMMAND", writer);
+            zsock_picture_brecv (bcontrol, reader, &number4, &string, &pointer);
+        }
+        compiled = zclock_usecs () - start;
+        zsys_info ("zsock_picture: binary send/recv %d ns plain, %d ns compiled",
+                   (int) (plain * 1000 / rounds), (int) (compiled * 1000 / rounds));
+        zsock_picture_destroy (&control);
+        zsock_picture_destroy (&bcontrol);
+    }
+    zchunk_destroy (&chunk);
+    zframe_destroy (&frame);
+    zuuid_destroy (&uuid);
+    zhashx_destroy (&hash);
+    zlistx_destroy (&list);
+    zmsg_destroy (&msg);
+    zsock_destroy (&reader);
+    zsock_destroy (&writer);
+
+#if defined (__WINDOWS__)
+    zsys_shutdown();
+#endif
+    //  @end
+    printf ("OK\n");
+}
@@ -81,7 +81,10 @@ s_send_string (void *dest, bool more, char *string, bool compress)
         if (zsock_is (dest) && zsock_type (dest) == ZMQ_SERVER)
             zmq_msg_set_routing_id (&size_frame, zsock_routing_id ((zsock_t *) dest));
 #endif
-        if (zmq_sendmsg (handle, &size_frame, ZMQ_SNDMORE) == -1) {
+        int sent = zmq_sendmsg (handle, &size_frame, ZMQ_SNDMORE);
+        if (zsock_stats_used ())
+            zsock_stats_sent (dest, sent, true);
+        if (sent == -1) {
             free (buffer);
             zmq_msg_close (&size_frame);
             return -1;
@@ -107,7 +110,10 @@ s_send_string (void *dest, bool more, char *string, bool compress)
     if (zsock_is (dest) && zsock_type (dest) == ZMQ_SERVER)
         zmq_msg_set_routing_id (&message, zsock_routing_id ((zsock_t *) dest));
 #endif
-    if (zmq_sendmsg (handle, &message, more? ZMQ_SNDMORE: 0) == -1) {
+    int rc = zmq_sendmsg (handle, &message, more? ZMQ_SNDMORE: 0);
+    if (zsock_stats_used ())
+        zsock_stats_sent (dest, rc, more);
+    if (rc == -1) {
         zmq_msg_close (&message);
         return -1;
     }
@@ -129,8 +135,11 @@ zstr_recv (void *source)
 
     zmq_msg_t message;
     zmq_msg_init (&message);
-    if (zmq_recvmsg (handle, &message, 0) < 0)
+    int rc = zmq_recvmsg (handle, &message, 0);
+    if (rc < 0)
         return NULL;
+    if (zsock_stats_used ())
+        zsock_stats_received (source, rc, zmq_msg_more (&message) != 0);
 
 #if defined (ZMQ_SERVER)
     //  Grab routing ID if we're reading from a SERVER socket (ZMQ 4.2 and later)
@@ -161,9 +170,7 @@ int
 zstr_recvx (void *source, char **string_p, ...)
 {
     assert (source);
-    void *handle = zsock_resolve (source);
-
-    zmsg_t *msg = zmsg_recv (handle);
+    zmsg_t *msg = zmsg_recv (source);
     if (!msg)
         return -1;
 
@@ -206,9 +213,7 @@ zstr_recv_compress (void *source)
     return NULL;
 #else
 
-    void *handle = zsock_resolve (source);
-
-    zmsg_t *msg = zmsg_recv (handle);
+    zmsg_t *msg = zmsg_recv (source);
     if (!msg)
         return NULL;
 
@@ -420,8 +425,11 @@ zstr_recv_nowait (void *dest)
 
     zmq_msg_t message;
     zmq_msg_init (&message);
-    if (zmq_recvmsg (handle, &message, ZMQ_DONTWAIT) < 0)
+    int rc = zmq_recvmsg (handle, &message, ZMQ_DONTWAIT);
+    if (rc < 0)
         return NULL;
+    if (zsock_stats_used ())
+        zsock_stats_received (dest, rc, zmq_msg_more (&message) != 0);
 
     size_t size = zmq_msg_size (&message);
     char *string = (char *) malloc (size + 1);
@@ -105,24 +105,12 @@ static char *s_logident = NULL;     //  ZSYS_LOGIDENT=
 static FILE *s_logstream = NULL;    //  ZSYS_LOGSTREAM=stdout/stderr
 static bool s_logsystem = false;    //  ZSYS_LOGSYSTEM=true/false
 static zsock_t *s_logsender = NULL;    //  ZSYS_LOGSENDER=
+static bool s_logasync = false;     //  ZSYS_LOGASYNC=true/false
 static int s_zero_copy_recv = 1;    // ZSYS_ZERO_COPY_RECV=1
+static size_t s_pool_size = 0;      //  ZSYS_POOL_SIZE=0
 static char *s_ipv4_mcast_address = NULL; //  ZSYS_IPV4_MCAST_ADDRESS=
 static unsigned char s_mcast_ttl = 1;     //  ZSYS_MCAST_TTL=1
 
-//  Track number of open sockets so we can zmq_term() safely
-static size_t s_open_sockets = 0;
-
-//  We keep a list of open sockets to report leaks to developers
-static zlist_t *s_sockref_list = NULL;
-
-//  This defines a single zsock_new() caller instance
-typedef struct {
-    void *handle;
-    int type;
-    const char *filename;
-    size_t line_nbr;
-} s_sockref_t;
-
 //  Mutex macros
 #if defined (__UNIX__)
 typedef pthread_mutex_t zsys_mutex_t;
@@ -138,12 +126,156 @@ typedef CRITICAL_SECTION zsys_mutex_t;
 #   define ZMUTEX_DESTROY(m) DeleteCriticalSection (&m);
 #endif
 
-//  Mutex to guard socket counter
+//  Mutex to guard global settings
 static zsys_mutex_t s_mutex;
+
+//  This defines a single zsock_new() caller instance
+typedef struct {
+    void *handle;
+    int type;
+    const char *filename;
+    size_t line_nbr;
+} s_sockref_t;
+
+//  We track open sockets so we can zmq_term() safely, and report leaks to
+//  developers. Sockets are spread over shards by handle, each with its own
+//  lock and hash table, so threads that create and destroy sockets at the
+//  same time seldom wait for each other, and closing a socket costs the
+//  same however many are open.
+#define SOCKREF_SHARDS 16
+
+typedef struct {
+    zsys_mutex_t mutex;         //  Guards this shard
+    zhashx_t *sockrefs;         //  Socket references, by handle
+    size_t open_sockets;        //  Open sockets in this shard
+} s_sockref_shard_t;
+
+static s_sockref_shard_t s_sockref_shards [SOCKREF_SHARDS];
+
+//  Sockets that zsys_socket has taken the settings for, but not yet put
+//  into a shard. Guarded by s_mutex, so that the settings which are only
+//  valid before creating sockets see them as open.
+static size_t s_opening_sockets = 0;
 #if defined (__UNIX__)
 // Mutex to guard the multiple zsys_init() - to make it threadsafe
 static zsys_mutex_t s_init_mutex;
 #endif
+//  Handles are compared and hashed by value
+static size_t
+s_sockref_hash (const void *key)
+{
+    return (size_t) (uintptr_t) key;
+}
+
+static int
+s_sockref_compare (const void *key1, const void *key2)
+{
+    return key1 == key2? 0: 1;
+}
+
+static void
+s_sockref_destroy (void **item_p)
+{
+    freen (*item_p);
+}
+
+//  Return the shard that tracks a socket handle. Handles are allocated
+//  objects, so we skip the low bits, which are always the same.
+static s_sockref_shard_t *
+s_sockref_shard (void *handle)
+{
+    size_t key = s_sockref_hash (handle);
+    return &s_sockref_shards [((key >> 6) ^ (key >> 12)) % SOCKREF_SHARDS];
+}
+
+static void
+s_sockref_shards_init (void)
+{
+    size_t shard_nbr;
+    for (shard_nbr = 0; shard_nbr < SOCKREF_SHARDS; shard_nbr++)
+        ZMUTEX_INIT (s_sockref_shards [shard_nbr].mutex);
+}
+
+static void
+s_sockref_shards_destroy (void)
+{
+    size_t shard_nbr;
+    for (shard_nbr = 0; shard_nbr < SOCKREF_SHARDS; shard_nbr++)
+        ZMUTEX_DESTROY (s_sockref_shards [shard_nbr].mutex);
+}
+
+//  Return the number of open sockets, over all shards, including those
+//  still being created. Caller must hold s_mutex.
+static size_t
+s_open_sockets (void)
+{
+    size_t open_sockets = s_opening_sockets;
+    size_t shard_nbr;
+    for (shard_nbr = 0; shard_nbr < SOCKREF_SHARDS; shard_nbr++) {
+        s_sockref_shard_t *shard = &s_sockref_shards [shard_nbr];
+        ZMUTEX_LOCK (shard->mutex);
+        open_sockets += shard->open_sockets;
+        ZMUTEX_UNLOCK (shard->mutex);
+    }
+    return open_sockets;
+}
+
+//  With asynchronous logging, each thread that logs formats its records
+//  into a ring of its own, and a writer thread drains all the rings and
+//  writes out the records in batches. Only the thread that owns a ring moves
+//  its head, and only the writer moves its tail, so logging takes no lock.
+//  Freeing the ring when a thread exits needs a thread-specific destructor,
+//  which we have only with POSIX threads.
+
+#if defined (__UNIX__)
+#   define ZSYS_LOGASYNC
+#   define LOG_RING_SIZE   128      //  Records per thread, a power of two
+#   define LOG_TEXT_MAX    496      //  Longest text in a record, with null
+#   define LOG_BATCH_SIZE  64       //  Records that the writer takes at once
+
+typedef struct {
+    time_t time;                //  Time the record was logged
+    char loglevel;              //  E, W, N, I or D
+    const char *format;         //  Event format, if not yet formatted
+    size_t size;                //  Size of event arguments in text
+    char text [LOG_TEXT_MAX];   //  Formatted message, or event arguments
+} s_log_record_t;
+
+typedef struct _s_log_ring_t {
+    struct _s_log_ring_t *next; //  Next ring in s_log_rings
+    size_t head;                //  Next record to write, moved by owner
+    size_t tail;                //  Next record to read, moved by writer
+    bool orphan;                //  Owner has exited; free once empty
+    s_log_record_t records [LOG_RING_SIZE];
+} s_log_ring_t;
+
+static CZMQ_THREADLS s_log_ring_t *s_log_ring = NULL;
+static pthread_key_t s_log_key;
+static pthread_once_t s_log_once = PTHREAD_ONCE_INIT;
+//  Guards the list of rings, and the writer state
+static pthread_mutex_t s_log_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t s_log_wakeup = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t s_log_flushed = PTHREAD_COND_INITIALIZER;
+static s_log_ring_t *s_log_rings = NULL;
+static pthread_t s_log_writer;
+static bool s_log_running = false;      //  Writer thread is running
+static bool s_log_stopping = false;     //  Writer should stop when drained
+static bool s_log_flushing = false;     //  Someone waits for a flush
+static int s_log_sleeping = 0;          //  Writer waits for records
+static uint64_t s_log_dropped = 0;      //  Records lost as ring was full
+static uint64_t s_log_truncated = 0;    //  Records cut to LOG_TEXT_MAX
+static FILE *s_logbinary = NULL;        //  Stream for binary log events
+static int s_logbinary_changes = 0;     //  Times the stream was set
+static void s_log_stop (void);
+static void s_log_drain (void);
+#endif
+
+//  Binary logs start with "ZLOG" and this version number
+#define ZSYS_LOG_VERSION 1
+//  Format ids in a binary log are below this; the writer starts a new
+//  header, and so new ids, before it runs out
+#define ZSYS_LOG_FORMATS_MAX 0x100000
+
 //  Implementation for the zsys_vprintf() which is known from legacy
 //  and poses as a stable interface now.
 static inline
@@ -164,12 +296,14 @@ static pthread_once_t init_all_mutex_var = PTHREAD_ONCE_INIT;
 // handler to destroy s_mutex
 static void zsys_destroy_mutex() {
     ZMUTEX_DESTROY(s_mutex);
+    s_sockref_shards_destroy ();
 }
 
 // handler to initialize mutexes one time in multi threaded env
 static void zsys_initialize_mutex() {
     ZMUTEX_INIT (s_mutex);
     ZMUTEX_INIT (s_init_mutex);
+    s_sockref_shards_init ();
     atexit (zsys_destroy_mutex);
 }
 
@@ -178,6 +312,15 @@ static void zsys_pthread_at_fork_handler(void) {
     // re-initialize mutexes
     ZMUTEX_INIT (s_init_mutex);
     ZMUTEX_INIT (s_mutex);
+    s_sockref_shards_init ();
+    //  The log writer did not survive the fork
+    pthread_mutex_init (&s_log_mutex, NULL);
+    pthread_cond_init (&s_log_wakeup, NULL);
+    pthread_cond_init (&s_log_flushed, NULL);
+    s_log_running = false;
+    s_log_stopping = false;
+    s_log_flushing = false;
+    s_log_sleeping = 0;
     // call cleanup
     zsys_cleanup();
 }
@@ -229,6 +372,9 @@ zsys_init (void)
     if (getenv ("ZSYS_ZERO_COPY_RECV"))
         s_zero_copy_recv = atoi (getenv ("ZSYS_ZERO_COPY_RECV"));
 
+    if (getenv ("ZSYS_POOL_SIZE"))
+        s_pool_size = atoi (getenv ("ZSYS_POOL_SIZE"));
+
     if (getenv ("ZSYS_FILE_STABLE_AGE_MSEC"))
         s_file_stable_age_msec = atoi (getenv ("ZSYS_FILE_STABLE_AGE_MSEC"));
 
@@ -272,14 +418,24 @@ zsys_init (void)
 
 #if defined (__WINDOWS__)
     ZMUTEX_INIT (s_mutex);
+    s_sockref_shards_init ();
 #endif
-    s_sockref_list = zlist_new ();
-    if (!s_sockref_list) {
-        zsys_shutdown ();
+    size_t shard_nbr;
+    for (shard_nbr = 0; shard_nbr < SOCKREF_SHARDS; shard_nbr++) {
+        zhashx_t *sockrefs = zhashx_new ();
+        if (!sockrefs) {
+            zsys_shutdown ();
 #if defined (__UNIX__)
-        ZMUTEX_UNLOCK(s_init_mutex);
+            ZMUTEX_UNLOCK(s_init_mutex);
 #endif
-        return NULL;
+            return NULL;
+        }
+        zhashx_set_destructor (sockrefs, s_sockref_destroy);
+        zhashx_set_key_destructor (sockrefs, NULL);
+        zhashx_set_key_duplicator (sockrefs, NULL);
+        zhashx_set_key_comparator (sockrefs, s_sockref_compare);
+        zhashx_set_key_hasher (sockrefs, s_sockref_hash);
+        s_sockref_shards [shard_nbr].sockrefs = sockrefs;
     }
     srandom ((unsigned) time (NULL));
 
@@ -323,6 +479,9 @@ zsys_init (void)
     if (getenv ("ZSYS_LOGSENDER"))
         zsys_set_logsender (getenv ("ZSYS_LOGSENDER"));
 
+    if (getenv ("ZSYS_LOGASYNC"))
+        zsys_set_logasync (streq (getenv ("ZSYS_LOGASYNC"), "true"));
+
     zsys_set_max_msgsz (s_max_msgsz);
 
 #if defined ZMQ_ZERO_COPY_RECV
@@ -364,39 +523,53 @@ zsys_shutdown (void)
     //  The atexit handler is called when the main function exits;
     //  however we may have zactor threads shutting down and still
     //  trying to close their sockets. So if we suspect there are
-    //  actors busy (s_open_sockets > 0), then we sleep for a few
+    //  actors busy (s_open_sockets () > 0), then we sleep for a few
     //  hundred milliseconds to allow the actors, if any, to get in
     //  and close their sockets.
     ZMUTEX_LOCK (s_mutex);
-    size_t busy = s_open_sockets;
+    size_t open_sockets = s_open_sockets ();
     ZMUTEX_UNLOCK (s_mutex);
-    if (busy)
+    if (open_sockets)
         zclock_sleep (200);
 
     //  No matter, we are now going to shut down
     //  Print the source reference for any sockets the app did not
     //  destroy properly.
-    ZMUTEX_LOCK (s_mutex);
-    s_sockref_t *sockref = (s_sockref_t *) zlist_pop (s_sockref_list);
-    while (sockref) {
-        assert (sockref->filename);
-        zsys_error ("[%d]dangling '%s' socket created at %s:%d",
-                    getpid (),
-                    zsys_sockname (sockref->type),
-                    sockref->filename, (int) sockref->line_nbr);
-        zmq_close (sockref->handle);
-        freen (sockref);
-        sockref = (s_sockref_t *) zlist_pop (s_sockref_list);
-        --s_open_sockets;
-    }
-    zlist_destroy (&s_sockref_list);
-    ZMUTEX_UNLOCK (s_mutex);
+    size_t shard_nbr;
+    for (shard_nbr = 0; shard_nbr < SOCKREF_SHARDS; shard_nbr++) {
+        s_sockref_shard_t *shard = &s_sockref_shards [shard_nbr];
+        ZMUTEX_LOCK (shard->mutex);
+        if (shard->sockrefs) {
+            s_sockref_t *sockref = (s_sockref_t *) zhashx_first (shard->sockrefs);
+            while (sockref) {
+                assert (sockref->filename);
+                zsys_error ("[%d]dangling '%s' socket created at %s:%d",
+                            getpid (),
+                            zsys_sockname (sockref->type),
+                            sockref->filename, (int) sockref->line_nbr);
+                zmq_close (sockref->handle);
+                --shard->open_sockets;
+                sockref = (s_sockref_t *) zhashx_next (shard->sockrefs);
+            }
+            zhashx_destroy (&shard->sockrefs);
+        }
+        ZMUTEX_UNLOCK (shard->mutex);
+    }
+
+#if defined (ZSYS_LOGASYNC)
+    //  Write out any queued log records, as the writer uses the logsender
+    __atomic_store_n (&s_logasync, false, __ATOMIC_SEQ_CST);
+    s_log_stop ();
+#endif
 
     //  Close logsender socket if opened (don't do this in critical section)
     if (s_logsender)
         zsock_destroy (&s_logsender);
 
-    if (s_open_sockets == 0)
+    ZMUTEX_LOCK (s_mutex);
+    open_sockets = s_open_sockets ();
+    ZMUTEX_UNLOCK (s_mutex);
+    if (open_sockets == 0)
     {
       zmq_term(s_process_ctx);
       s_process_ctx = NULL;
@@ -422,6 +595,7 @@ zsys_shutdown (void)
 
 #if !defined (__UNIX__)
     ZMUTEX_DESTROY (s_mutex);
+    s_sockref_shards_destroy ();
 #endif
 
     //  Free dynamically allocated properties
@@ -474,8 +648,13 @@ zsys_cleanup (void)
     s_logstream = NULL;
     s_logsystem = false;
     s_logsender = NULL;
+    s_logasync = false;
 
-    s_open_sockets = 0;
+    size_t shard_nbr;
+    for (shard_nbr = 0; shard_nbr < SOCKREF_SHARDS; shard_nbr++) {
+        zhashx_destroy (&s_sockref_shards [shard_nbr].sockrefs);
+        s_sockref_shards [shard_nbr].open_sockets = 0;
+    }
     ZMUTEX_UNLOCK (s_init_mutex);
 }
 #endif
@@ -497,49 +676,70 @@ zsys_socket (int type, const char *filename, size_t line_nbr)
     //  starting any threads. If the app uses zactor for its threads
     //  then we can guarantee this to always be safe.
     zsys_init ();
+    //  Take the process defaults as one snapshot, as another thread may be
+    //  changing them, but don't hold the lock while we create the socket.
+    //  Until the socket is in its shard, we count it as being opened, so
+    //  the settings that need no open sockets refuse to change meanwhile.
     ZMUTEX_LOCK (s_mutex);
-    void *handle = zmq_socket (s_process_ctx, type);
+    void *ctx = s_process_ctx;
+    size_t linger = s_linger;
+    size_t sndhwm = s_sndhwm;
+    size_t rcvhwm = s_rcvhwm;
+    int ipv6 = s_ipv6;
+    s_opening_sockets++;
+    ZMUTEX_UNLOCK (s_mutex);
+
+    void *handle = zmq_socket (ctx, type);
     if (handle) {
         //  Configure socket with process defaults
-        zsock_set_linger (handle, (int) s_linger);
+        zsock_set_linger (handle, (int) linger);
 #if (ZMQ_VERSION_MAJOR == 2)
         // TODO: v2/v3 socket api in zsock_option.inc are not public (not
         // added to include/zsock.h) so we have to use zmq_setsockopt directly
         // This should be fixed and zsock_set_hwm should be used instead
 #       if defined (ZMQ_HWM)
-        uint64_t value = s_sndhwm;
+        uint64_t value = sndhwm;
         int rc = zmq_setsockopt (handle, ZMQ_HWM, &value, sizeof (uint64_t));
         assert (rc == 0 || zmq_errno () == ETERM);
 #       endif
 #else
         //  For later versions we use separate SNDHWM and RCVHWM
-        zsock_set_sndhwm (handle, (int) s_sndhwm);
-        zsock_set_rcvhwm (handle, (int) s_rcvhwm);
+        zsock_set_sndhwm (handle, (int) sndhwm);
+        zsock_set_rcvhwm (handle, (int) rcvhwm);
 #   if defined (ZMQ_IPV6)
-        zsock_set_ipv6 (handle, s_ipv6);
+        zsock_set_ipv6 (handle, ipv6);
 #   else
-        zsock_set_ipv4only (handle, s_ipv6? 0: 1);
+        zsock_set_ipv4only (handle, ipv6? 0: 1);
 #   endif
 #endif
         //  Add socket to reference tracker so we can report leaks; this is
         //  done only when the caller passes a filename/line_nbr
+        s_sockref_t *sockref = NULL;
         if (filename) {
-            s_sockref_t *sockref = (s_sockref_t *) zmalloc (sizeof (s_sockref_t));
-            if (sockref) {
+            sockref = (s_sockref_t *) zmalloc (sizeof (s_sockref_t));
+            if (!sockref) {
+                zmq_close (handle);
+                handle = NULL;
+            }
+            else {
                 sockref->handle = handle;
                 sockref->type = type;
                 sockref->filename = filename;
                 sockref->line_nbr = line_nbr;
-                zlist_append (s_sockref_list, sockref);
-            }
-            else {
-                zmq_close (handle);
-                ZMUTEX_UNLOCK (s_mutex);
-                return NULL;
             }
         }
-        s_open_sockets++;
+        if (handle) {
+            s_sockref_shard_t *shard = s_sockref_shard (handle);
+            ZMUTEX_LOCK (shard->mutex);
+            if (!sockref || !shard->sockrefs
+            ||  zhashx_insert (shard->sockrefs, handle, sockref))
+                freen (sockref);
+            shard->open_sockets++;
+            ZMUTEX_UNLOCK (shard->mutex);
+        }
     }
+    ZMUTEX_LOCK (s_mutex);
+    s_opening_sockets--;
     ZMUTEX_UNLOCK (s_mutex);
     return handle;
 }
@@ -551,23 +751,15 @@ zsys_socket (int type, const char *filename, size_t line_nbr)
 int
 zsys_close (void *handle, const char *filename, size_t line_nbr)
 {
-    ZMUTEX_LOCK (s_mutex);
+    s_sockref_shard_t *shard = s_sockref_shard (handle);
+    ZMUTEX_LOCK (shard->mutex);
     //  It's possible atexit() has already happened if we're running under
     //  a debugger that redirects the main thread exit.
-    if (s_sockref_list) {
-        s_sockref_t *sockref = (s_sockref_t *) zlist_first (s_sockref_list);
-        while (sockref) {
-            if (sockref->handle == handle) {
-                zlist_remove (s_sockref_list, sockref);
-                freen (sockref);
-                break;
-            }
-            sockref = (s_sockref_t *) zlist_next (s_sockref_list);
-        }
-    }
-    s_open_sockets--;
+    if (shard->sockrefs)
+        zhashx_delete (shard->sockrefs, handle);
+    shard->open_sockets--;
+    ZMUTEX_UNLOCK (shard->mutex);
     zmq_close (handle);
-    ZMUTEX_UNLOCK (s_mutex);
     return 0;
 }
 
@@ -1560,9 +1752,9 @@ zsys_set_io_threads (size_t io_threads)
 {
     zsys_init ();
     ZMUTEX_LOCK (s_mutex);
-    if (s_open_sockets)
+    if (s_open_sockets ())
         zsys_error ("zsys_io_threads() is not valid after creating sockets");
-    assert (s_open_sockets == 0);
+    assert (s_open_sockets () == 0);
 
     s_io_threads = io_threads;
 #if ZMQ_VERSION < ZMQ_MAKE_VERSION(3, 2, 0)
@@ -1599,10 +1791,10 @@ zsys_set_thread_sched_policy (int policy)
     zsys_init ();
     ZMUTEX_LOCK (s_mutex);
     //  If the app is misusing this method, burn it with fire
-    if (s_open_sockets)
+    if (s_open_sockets ())
         zsys_error ("zsys_set_thread_sched_policy() is not valid after"
                 " creating sockets");
-    assert (s_open_sockets == 0);
+    assert (s_open_sockets () == 0);
     s_thread_sched_policy = policy;
 #if defined (ZMQ_THREAD_SCHED_POLICY)
     zmq_ctx_set (s_process_ctx, ZMQ_THREAD_SCHED_POLICY, s_thread_sched_policy);
@@ -1627,10 +1819,10 @@ zsys_set_thread_name_prefix (int prefix)
     zsys_init ();
     ZMUTEX_LOCK (s_mutex);
     //  If the app is misusing this method, burn it with fire
-    if (s_open_sockets)
+    if (s_open_sockets ())
         zsys_error ("zsys_set_thread_name_prefix() is not valid after"
                 " creating sockets");
-    assert (s_open_sockets == 0);
+    assert (s_open_sockets () == 0);
     s_thread_name_prefix = prefix;
 #if defined (ZMQ_THREAD_NAME_PREFIX)
     zmq_ctx_set (s_process_ctx, ZMQ_THREAD_NAME_PREFIX, s_thread_name_prefix);
@@ -1674,10 +1866,10 @@ zsys_set_thread_name_prefix_str (const char *prefix)
     zsys_init ();
     ZMUTEX_LOCK (s_mutex);
     //  If the app is misusing this method, burn it with fire
-    if (s_open_sockets)
+    if (s_open_sockets ())
         zsys_error ("zsys_set_thread_name_prefix() is not valid after"
                 " creating sockets");
-    assert (s_open_sockets == 0);
+    assert (s_open_sockets () == 0);
     strcpy(s_thread_name_prefix_str, prefix);
 #if defined (ZMQ_THREAD_NAME_PREFIX) && defined (ZMQ_BUILD_DRAFT_API) && \
     ((ZMQ_VERSION_MAJOR > 4) || \
@@ -1724,10 +1916,10 @@ zsys_thread_affinity_cpu_add (int cpu)
     zsys_init ();
     ZMUTEX_LOCK (s_mutex);
     //  If the app is misusing this method, burn it with fire
-    if (s_open_sockets)
+    if (s_open_sockets ())
         zsys_error ("zsys_set_thread_sched_policy() is not valid after"
                 " creating sockets");
-    assert (s_open_sockets == 0);
+    assert (s_open_sockets () == 0);
 #if defined (ZMQ_THREAD_AFFINITY_CPU_ADD)
     zmq_ctx_set (s_process_ctx, ZMQ_THREAD_AFFINITY_CPU_ADD, cpu);
 #endif
@@ -1749,10 +1941,10 @@ zsys_thread_affinity_cpu_remove (int cpu)
     zsys_init ();
     ZMUTEX_LOCK (s_mutex);
     //  If the app is misusing this method, burn it with fire
-    if (s_open_sockets)
+    if (s_open_sockets ())
         zsys_error ("zsys_set_thread_sched_policy() is not valid after"
                 " creating sockets");
-    assert (s_open_sockets == 0);
+    assert (s_open_sockets () == 0);
 #if defined (ZMQ_THREAD_AFFINITY_CPU_REMOVE)
     zmq_ctx_set (s_process_ctx, ZMQ_THREAD_AFFINITY_CPU_REMOVE, cpu);
 #endif
@@ -1776,10 +1968,10 @@ zsys_set_thread_priority (int priority)
     zsys_init ();
     ZMUTEX_LOCK (s_mutex);
     //  If the app is misusing this method, burn it with fire
-    if (s_open_sockets)
+    if (s_open_sockets ())
         zsys_error ("zsys_set_thread_priority() is not valid after"
                 " creating sockets");
-    assert (s_open_sockets == 0);
+    assert (s_open_sockets () == 0);
     s_thread_priority = priority;
 #if defined (ZMQ_THREAD_PRIORITY)
     zmq_ctx_set (s_process_ctx, ZMQ_THREAD_PRIORITY, s_thread_priority);
@@ -1800,9 +1992,9 @@ zsys_set_max_sockets (size_t max_sockets)
     zsys_init ();
     ZMUTEX_LOCK (s_mutex);
     //  If the app is misusing this method, burn it with fire
-    if (s_open_sockets)
+    if (s_open_sockets ())
         zsys_error ("zsys_max_sockets() is not valid after creating sockets");
-    assert (s_open_sockets == 0);
+    assert (s_open_sockets () == 0);
     s_max_sockets = max_sockets? max_sockets: zsys_socket_limit ();
 #if defined (ZMQ_MAX_SOCKETS)
     zmq_ctx_set (s_process_ctx, ZMQ_MAX_SOCKETS, (int) s_max_sockets);
@@ -1889,6 +2081,39 @@ zsys_zero_copy_recv()
 }
 
 
+//  --------------------------------------------------------------------------
+//  Configure the number of zframe_t and zmsg_t objects that threads keep
+//  for reuse, rather than freeing them. This saves a malloc and free per
+//  frame and message for code that handles many messages. Each thread has
+//  its own pool, and the limit applies to all of them together, for frames
+//  and for messages. Threads free their pooled objects when they exit. Set this before starting threads
+//  that send or receive messages. If the environment variable ZSYS_POOL_SIZE
+//  is defined, that provides the default. Otherwise the default is 0, which
+//  switches pooling off. Pooling needs POSIX threads, and is not available
+//  on other platforms.
+
+void
+zsys_set_pool_size (size_t pool_size)
+{
+    zsys_init ();
+    ZMUTEX_LOCK (s_mutex);
+    s_pool_size = pool_size;
+    ZMUTEX_UNLOCK (s_mutex);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return the number of zframe_t and zmsg_t objects that threads keep for
+//  reuse; 0 means pooling is off.
+
+size_t
+zsys_pool_size (void)
+{
+    //  Called for every frame and message, so we don't lock or initialize
+    return s_pool_size;
+}
+
+
 //  --------------------------------------------------------------------------
 //  Return maximum message size.
 
@@ -2487,7 +2712,10 @@ void
 zsys_set_logstream (FILE *stream)
 {
     zsys_init ();
+    //  Make sure that the log writer is done with the old stream
+    zsys_log_flush ();
     s_logstream = stream;
+    zsys_log_flush ();
 }
 
 
@@ -2539,12 +2767,12 @@ zsys_set_logsystem (bool logsystem)
 }
 
 
-static void
-s_log (char loglevel, char *string)
-{
-    if (!s_initialized)
-        zsys_init ();
+//  Send a log message to the system facility, if that is enabled. Returns
+//  true if it did, in which case the message goes nowhere else.
 
+static bool
+s_log_system (char loglevel, const char *string)
+{
 #if defined (__UNIX__)
 #   if defined (__UTYPE_ANDROID)
     int priority = ANDROID_LOG_INFO;
@@ -2564,6 +2792,7 @@ s_log (char loglevel, char *string)
         priority = ANDROID_LOG_DEBUG;
 
     __android_log_print(priority, "zsys", "%s", string);
+    return true;
 #   else
     if (s_logsystem) {
         int priority = LOG_INFO;
@@ -2583,46 +2812,1077 @@ s_log (char loglevel, char *string)
             priority = LOG_DEBUG;
 
         syslog (priority, "%s", string);
+        return true;
     }
-    else
 #   endif
 #endif
+    return false;
+}
+
+//  Send a log message to the log stream and log sender, with the given
+//  date. Does not flush the stream.
+
+static void
+s_log_text (char loglevel, const char *date, const char *string)
+{
+    char log_text [1024];
+    if (s_logident)
+        snprintf (log_text, 1024, "%c: (%s) %s %s", loglevel, s_logident, date, string);
+    else
+        snprintf (log_text, 1024, "%c: %s %s", loglevel, date, string);
+
+    if (s_logstream)
+        fprintf (s_logstream, "%s\n", log_text);
+    if (s_logsender)
+        zstr_send (s_logsender, log_text);
+}
+
+static void
+s_log (char loglevel, char *string)
+{
+    if (!s_initialized)
+        zsys_init ();
+
+    if (s_log_system (loglevel, string))
+        return;
+
     if (s_logstream || s_logsender) {
         time_t curtime = time (NULL);
         struct tm *loctime = localtime (&curtime);
         char date [20];
         strftime (date, 20, "%y-%m-%d %H:%M:%S", loctime);
-        char log_text [1024];
-        if (s_logident)
-            snprintf (log_text, 1024, "%c: (%s) %s %s", loglevel, s_logident, date, string);
+        s_log_text (loglevel, date, string);
+        if (s_logstream)
+            fflush (s_logstream);
+    }
+}
+
+
+//  Log events keep their format, and a copy of their arguments, so they can
+//  be formatted later, by the writer thread or by zsys_log_decode (). Each
+//  argument is a one-byte type and a value: 'i' for an integer, 'f' for a
+//  floating point number, and 'p' for a pointer, all eight bytes, and 's'
+//  for a string, as a two-byte size and that many bytes. All numbers are in
+//  the byte order of the machine that logged them.
+
+typedef struct {
+    const char *start;          //  The '%' that starts the conversion
+    size_t size;                //  Size of the conversion text
+    int stars;                  //  Width and precision passed as arguments
+    char length;                //  Length modifier; H for hh, q for ll
+    char conversion;            //  Conversion character
+} s_log_spec_t;
+
+//  Find the next conversion in a format, and return the format text after
+//  it, or NULL if there are no more conversions. A conversion can take its
+//  width and precision as arguments, but no more; if it asks for more, we
+//  treat it as a conversion we do not know.
+
+static const char *
+s_log_spec_next (const char *format, s_log_spec_t *spec)
+{
+    format = strchr (format, '%');
+    if (!format)
+        return NULL;
+    spec->start = format++;
+    spec->stars = 0;
+    spec->length = 0;
+    while (*format && strchr ("-+ #0'", *format))
+        format++;
+    while (isdigit ((unsigned char) *format) || *format == '.' || *format == '*')
+        if (*format++ == '*')
+            spec->stars++;
+    if (*format == 'h' || *format == 'l') {
+        spec->length = *format++;
+        if (*format == spec->length) {
+            spec->length = spec->length == 'h'? 'H': 'q';
+            format++;
+        }
+    }
+    else
+    if (*format && strchr ("jztL", *format))
+        spec->length = *format++;
+    spec->conversion = spec->stars > 2? 0: *format;
+    if (*format)
+        format++;
+    spec->size = format - spec->start;
+    return format;
+}
+
+//  Append one argument to a buffer; returns false if there is no room
+
+static bool
+s_log_put (byte **needle_p, byte *ceiling, char type, const void *value, size_t size)
+{
+    if (*needle_p + 1 + size > ceiling)
+        return false;
+    **needle_p = (byte) type;
+    memcpy (*needle_p + 1, value, size);
+    *needle_p += 1 + size;
+    return true;
+}
+
+//  Copy the arguments for a format into a buffer, to format them later.
+//  Returns the number of bytes used, or -1 if the format has a conversion
+//  that we cannot defer, or if the arguments do not fit. Cuts strings short
+//  to make them fit, and sets truncated if it did.
+
+static int
+s_log_pack (byte *buffer, size_t limit, const char *format, va_list argptr, bool *truncated)
+{
+    byte *needle = buffer;
+    byte *ceiling = buffer + limit;
+    s_log_spec_t spec;
+    while ((format = s_log_spec_next (format, &spec))) {
+        int64_t integer;
+        int star;
+        for (star = 0; star < spec.stars; star++) {
+            integer = va_arg (argptr, int);
+            if (!s_log_put (&needle, ceiling, 'i', &integer, 8))
+                return -1;
+        }
+        switch (spec.conversion) {
+            case 'd':
+            case 'i':
+                if (spec.length == 'l')
+                    integer = va_arg (argptr, long);
+                else
+                if (spec.length == 'q')
+                    integer = va_arg (argptr, long long);
+                else
+                if (spec.length == 'j')
+                    integer = va_arg (argptr, intmax_t);
+                else
+                if (spec.length == 'z')
+                    integer = (int64_t) va_arg (argptr, size_t);
+                else
+                if (spec.length == 't')
+                    integer = va_arg (argptr, ptrdiff_t);
+                else
+                if (spec.length == 'H')
+                    integer = (signed char) va_arg (argptr, int);
+                else
+                if (spec.length == 'h')
+                    integer = (short) va_arg (argptr, int);
+                else
+                    integer = va_arg (argptr, int);
+                if (!s_log_put (&needle, ceiling, 'i', &integer, 8))
+                    return -1;
+                break;
+            case 'o':
+            case 'u':
+            case 'x':
+            case 'X':
+                if (spec.length == 'l')
+                    integer = (int64_t) va_arg (argptr, unsigned long);
+                else
+                if (spec.length == 'q')
+                    integer = (int64_t) va_arg (argptr, unsigned long long);
+                else
+                if (spec.length == 'j')
+                    integer = (int64_t) va_arg (argptr, uintmax_t);
+                else
+                if (spec.length == 'z')
+                    integer = (int64_t) va_arg (argptr, size_t);
+                else
+                if (spec.length == 't')
+                    integer = (int64_t) va_arg (argptr, ptrdiff_t);
+                else
+                if (spec.length == 'H')
+                    integer = (unsigned char) va_arg (argptr, unsigned int);
+                else
+                if (spec.length == 'h')
+                    integer = (unsigned short) va_arg (argptr, unsigned int);
+                else
+                    integer = va_arg (argptr, unsigned int);
+                if (!s_log_put (&needle, ceiling, 'i', &integer, 8))
+                    return -1;
+                break;
+            case 'c':
+                if (spec.length)
+                    return -1;      //  No wide characters
+                integer = va_arg (argptr, int);
+                if (!s_log_put (&needle, ceiling, 'i', &integer, 8))
+                    return -1;
+                break;
+            case 'e':
+            case 'E':
+            case 'f':
+            case 'F':
+            case 'g':
+            case 'G':
+            case 'a':
+            case 'A': {
+                double number = spec.length == 'L'
+                    ? (double) va_arg (argptr, long double)
+                    : va_arg (argptr, double);
+                if (!s_log_put (&needle, ceiling, 'f', &number, 8))
+                    return -1;
+                break;
+            }
+            case 'p': {
+                uint64_t pointer = (uint64_t) (uintptr_t) va_arg (argptr, void *);
+                if (!s_log_put (&needle, ceiling, 'p', &pointer, 8))
+                    return -1;
+                break;
+            }
+            case 's': {
+                if (spec.length)
+                    return -1;      //  No wide strings
+                const char *string = va_arg (argptr, const char *);
+                if (!string)
+                    string = "(null)";
+                size_t size = strlen (string);
+                if (needle + 3 > ceiling)
+                    return -1;
+                if (size > (size_t) (ceiling - needle - 3)) {
+                    size = ceiling - needle - 3;
+                    *truncated = true;
+                }
+                uint16_t size16 = (uint16_t) size;
+                *needle = 's';
+                memcpy (needle + 1, &size16, 2);
+                memcpy (needle + 3, string, size);
+                needle += 3 + size;
+                break;
+            }
+            case '%':
+                break;
+            default:
+                return -1;          //  %n, or not a conversion we know
+        }
+    }
+    return (int) (needle - buffer);
+}
+
+//  Take the next argument of the given type from a buffer; returns NULL
+//  if the buffer has no such argument
+
+static const byte *
+s_log_get (const byte **needle_p, const byte *ceiling, char type, size_t size)
+{
+    const byte *needle = *needle_p;
+    if (needle + 1 + size > ceiling || *needle != (byte) type)
+        return NULL;
+    *needle_p = needle + 1 + size;
+    return needle + 1;
+}
+
+//  Format a message from a format and the arguments that s_log_pack copied,
+//  into text, which has room for limit bytes including the null. Returns
+//  false if the arguments do not match the format.
+
+static bool
+s_log_unpack (char *text, size_t limit, const char *format, const byte *args, size_t size)
+{
+    const byte *needle = args;
+    const byte *ceiling = args + size;
+    size_t length = 0;
+    text [0] = 0;
+    s_log_spec_t spec;
+    const char *next;
+    while ((next = s_log_spec_next (format, &spec))) {
+        //  Copy the text up to the conversion
+        size_t literal = spec.start - format;
+        if (literal > limit - 1 - length)
+            literal = limit - 1 - length;
+        memcpy (text + length, format, literal);
+        length += literal;
+        text [length] = 0;
+        format = next;
+
+        //  Rebuild the conversion with the width and precision filled in,
+        //  and with a length modifier that suits the value we kept
+        char conversion [64];
+        size_t used = 0;
+        size_t char_nbr;
+        if (spec.size > 32 || !spec.conversion)
+            return false;
+        for (char_nbr = 0; char_nbr < spec.size - 1; char_nbr++) {
+            char current = spec.start [char_nbr];
+            if (current == '*') {
+                int64_t star;
+                const byte *value = s_log_get (&needle, ceiling, 'i', 8);
+                if (!value)
+                    return false;
+                memcpy (&star, value, 8);
+                if (used + 12 > sizeof (conversion))
+                    return false;
+                used += snprintf (conversion + used, 12, "%d", (int) star);
+            }
+            else
+            if (!strchr ("hljztL", current)) {
+                if (used + 1 > sizeof (conversion))
+                    return false;
+                conversion [used++] = current;
+            }
+        }
+        //  Leave room for "ll", the conversion character, and the null
+        if (used + 4 > sizeof (conversion))
+            return false;
+        if (strchr ("diouxX", spec.conversion)) {
+            conversion [used++] = 'l';
+            conversion [used++] = 'l';
+        }
+        conversion [used++] = spec.conversion;
+        conversion [used] = 0;
+
+        int written = 0;
+        const byte *value = NULL;
+        switch (spec.conversion) {
+            case 'd':
+            case 'i':
+            case 'o':
+            case 'u':
+            case 'x':
+            case 'X':
+            case 'c': {
+                int64_t integer;
+                value = s_log_get (&needle, ceiling, 'i', 8);
+                if (!value)
+                    return false;
+                memcpy (&integer, value, 8);
+                if (spec.conversion == 'c')
+                    written = snprintf (text + length, limit - length, conversion, (int) integer);
+                else
+                    written = snprintf (text + length, limit - length, conversion, (long long) integer);
+                break;
+            }
+            case 'e':
+            case 'E':
+            case 'f':
+            case 'F':
+            case 'g':
+            case 'G':
+            case 'a':
+            case 'A': {
+                double number;
+                value = s_log_get (&needle, ceiling, 'f', 8);
+                if (!value)
+                    return false;
+                memcpy (&number, value, 8);
+                written = snprintf (text + length, limit - length, conversion, number);
+                break;
+            }
+            case 'p': {
+                uint64_t pointer;
+                value = s_log_get (&needle, ceiling, 'p', 8);
+                if (!value)
+                    return false;
+                memcpy (&pointer, value, 8);
+                written = snprintf (text + length, limit - length, conversion, (void *) (uintptr_t) pointer);
+                break;
+            }
+            case 's': {
+                uint16_t string_size;
+                value = s_log_get (&needle, ceiling, 's', 2);
+                if (!value)
+                    return false;
+                memcpy (&string_size, value, 2);
+                if (needle + string_size > ceiling)
+                    return false;
+                char string [1024];
+                if (string_size > sizeof (string) - 1)
+                    string_size = sizeof (string) - 1;
+                memcpy (string, needle, string_size);
+                string [string_size] = 0;
+                needle += string_size;
+                written = snprintf (text + length, limit - length, conversion, string);
+                break;
+            }
+            case '%':
+                written = snprintf (text + length, limit - length, "%%");
+                break;
+            default:
+                return false;
+        }
+        if (written > 0)
+            length += (size_t) written < limit - length? (size_t) written: limit - 1 - length;
+    }
+    //  Copy the text after the last conversion
+    size_t literal = strlen (format);
+    if (literal > limit - 1 - length)
+        literal = limit - 1 - length;
+    memcpy (text + length, format, literal);
+    text [length + literal] = 0;
+    return needle == ceiling;
+}
+
+
+#if defined (ZSYS_LOGASYNC)
+//  Free a thread's ring when the thread exits. If the writer is running, it
+//  may still have records to write, so we leave the ring for it to free.
+
+static void
+s_log_ring_free (void *arg)
+{
+    s_log_ring_t *ring = (s_log_ring_t *) arg;
+    pthread_mutex_lock (&s_log_mutex);
+    if (s_log_running)
+        ring->orphan = true;
+    else {
+        s_log_ring_t **ring_p = &s_log_rings;
+        while (*ring_p != ring)
+            ring_p = &(*ring_p)->next;
+        *ring_p = ring->next;
+        freen (ring);
+    }
+    pthread_mutex_unlock (&s_log_mutex);
+    s_log_ring = NULL;
+}
+
+static void
+s_log_init (void)
+{
+    int rc = pthread_key_create (&s_log_key, s_log_ring_free);
+    assert (rc == 0);
+}
+
+static s_log_ring_t *
+s_log_ring_get (void)
+{
+    if (!s_log_ring) {
+        pthread_once (&s_log_once, s_log_init);
+        s_log_ring = (s_log_ring_t *) zmalloc (sizeof (s_log_ring_t));
+        assert (s_log_ring);
+        pthread_setspecific (s_log_key, s_log_ring);
+        pthread_mutex_lock (&s_log_mutex);
+        s_log_ring->next = s_log_rings;
+        s_log_rings = s_log_ring;
+        pthread_mutex_unlock (&s_log_mutex);
+    }
+    return s_log_ring;
+}
+
+//  Return the next free record in this thread's ring, or NULL if the ring
+//  is full, in which case we drop the message.
+
+static s_log_record_t *
+s_log_reserve (s_log_ring_t *ring, char loglevel)
+{
+    size_t head = ring->head;
+    if (head - __atomic_load_n (&ring->tail, __ATOMIC_ACQUIRE) == LOG_RING_SIZE) {
+        __atomic_fetch_add (&s_log_dropped, 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+    s_log_record_t *record = &ring->records [head & (LOG_RING_SIZE - 1)];
+    record->time = time (NULL);
+    record->loglevel = loglevel;
+    record->format = NULL;
+    return record;
+}
+
+//  Pass the record we reserved to the writer, and wake it if it is waiting
+
+static void
+s_log_publish (s_log_ring_t *ring)
+{
+    __atomic_store_n (&ring->head, ring->head + 1, __ATOMIC_RELEASE);
+
+    //  Pairs with the fence in the writer, so either we see that it is
+    //  sleeping, or it sees our record before it sleeps
+    __atomic_thread_fence (__ATOMIC_SEQ_CST);
+    if (__atomic_load_n (&s_log_sleeping, __ATOMIC_RELAXED)
+    &&  __atomic_exchange_n (&s_log_sleeping, 0, __ATOMIC_ACQ_REL)) {
+        pthread_mutex_lock (&s_log_mutex);
+        pthread_cond_signal (&s_log_wakeup);
+        pthread_mutex_unlock (&s_log_mutex);
+    }
+    //  If logging stopped being asynchronous since we looked, the writer
+    //  may have made its last pass before our record went in. Pairs with
+    //  the store before s_log_stop, through the fence above.
+    if (!__atomic_load_n (&s_logasync, __ATOMIC_RELAXED))
+        s_log_drain ();
+}
+
+//  Format a log message into this thread's ring
+
+static void
+s_log_async (char loglevel, const char *format, va_list argptr)
+{
+    s_log_ring_t *ring = s_log_ring_get ();
+    s_log_record_t *record = s_log_reserve (ring, loglevel);
+    if (!record)
+        return;
+    if (vsnprintf (record->text, LOG_TEXT_MAX, format, argptr) >= LOG_TEXT_MAX)
+        __atomic_fetch_add (&s_log_truncated, 1, __ATOMIC_RELAXED);
+    s_log_publish (ring);
+}
+
+//  Copy a log event into this thread's ring, without formatting it. Returns
+//  false if the event's arguments cannot be deferred, so the caller must
+//  format it now.
+
+static bool
+s_log_event_async (char loglevel, const char *format, va_list argptr)
+{
+    s_log_ring_t *ring = s_log_ring_get ();
+    s_log_record_t *record = s_log_reserve (ring, loglevel);
+    if (!record)
+        return true;
+    bool truncated = false;
+    int size = s_log_pack ((byte *) record->text, LOG_TEXT_MAX, format, argptr, &truncated);
+    if (size == -1)
+        return false;
+    if (truncated)
+        __atomic_fetch_add (&s_log_truncated, 1, __ATOMIC_RELAXED);
+    record->format = format;
+    record->size = (size_t) size;
+    s_log_publish (ring);
+    return true;
+}
+
+//  Take up to LOG_BATCH_SIZE records from the rings, and free the rings of
+//  exited threads once they are empty. Returns the number of records taken.
+//  Caller holds s_log_mutex.
+
+static size_t
+s_log_collect (s_log_record_t *batch)
+{
+    size_t count = 0;
+    s_log_ring_t **ring_p = &s_log_rings;
+    while (*ring_p) {
+        s_log_ring_t *ring = *ring_p;
+        size_t head = __atomic_load_n (&ring->head, __ATOMIC_ACQUIRE);
+        size_t tail = ring->tail;
+        while (tail != head && count < LOG_BATCH_SIZE) {
+            s_log_record_t *record = &ring->records [tail & (LOG_RING_SIZE - 1)];
+            batch [count].time = record->time;
+            batch [count].loglevel = record->loglevel;
+            batch [count].format = record->format;
+            batch [count].size = record->size;
+            if (record->format)
+                memcpy (batch [count].text, record->text, record->size);
+            else
+                strcpy (batch [count].text, record->text);
+            count++;
+            tail++;
+        }
+        __atomic_store_n (&ring->tail, tail, __ATOMIC_RELEASE);
+        if (ring->orphan && tail == head) {
+            *ring_p = ring->next;
+            freen (ring);
+        }
         else
-            snprintf (log_text, 1024, "%c: %s %s", loglevel, date, string);
+            ring_p = &ring->next;
+    }
+    return count;
+}
 
-        if (s_logstream) {
-            fprintf (s_logstream, "%s\n", log_text);
-            fflush (s_logstream);
+//  Return true if any ring has records. Caller holds s_log_mutex.
+
+static bool
+s_log_pending (void)
+{
+    s_log_ring_t *ring;
+    for (ring = s_log_rings; ring; ring = ring->next)
+        if (__atomic_load_n (&ring->head, __ATOMIC_ACQUIRE) != ring->tail)
+            return true;
+    return false;
+}
+
+//  Write the header that starts a binary log: "ZLOG", the version, a byte
+//  order mark, and the log identity
+
+static void
+s_log_binary_header (FILE *stream)
+{
+    const char *ident = s_logident? s_logident: "";
+    uint16_t ident_size = (uint16_t) strnlen (ident, 255);
+    uint32_t byte_order = 0x01020304;
+    fwrite ("ZLOG", 1, 4, stream);
+    fputc (ZSYS_LOG_VERSION, stream);
+    fwrite (&byte_order, 4, 1, stream);
+    fwrite (&ident_size, 2, 1, stream);
+    fwrite (ident, 1, ident_size, stream);
+}
+
+//  What the writer knows about the binary log stream
+
+typedef struct {
+    FILE *stream;               //  Stream for this batch
+    int changes;                //  Times it was set, for this batch
+    int header_changes;         //  Times it was set, at our last header
+    bool written;               //  We wrote events in this batch
+    zhashx_t *formats;          //  Format ids, by format address
+    uint32_t next_id;           //  Id for the next new format
+} s_log_binary_t;
+
+//  Write a log event to the binary log stream. The first event with each
+//  format writes the format too, as an 'F' record, with an id that later
+//  'E' records refer to.
+
+static void
+s_log_binary_write (s_log_binary_t *self, s_log_record_t *record)
+{
+    FILE *stream = self->stream;
+    if (self->header_changes != self->changes
+    ||  self->next_id == ZSYS_LOG_FORMATS_MAX) {
+        s_log_binary_header (stream);
+        zhashx_purge (self->formats);
+        self->next_id = 1;
+        self->header_changes = self->changes;
+    }
+    self->written = true;
+    uint32_t id = (uint32_t) (uintptr_t) zhashx_lookup (self->formats, record->format);
+    if (!id) {
+        id = self->next_id++;
+        zhashx_insert (self->formats, record->format, (void *) (uintptr_t) id);
+        uint16_t format_size = (uint16_t) strnlen (record->format, 65535);
+        fputc ('F', stream);
+        fwrite (&id, 4, 1, stream);
+        fwrite (&format_size, 2, 1, stream);
+        fwrite (record->format, 1, format_size, stream);
+    }
+    int64_t time = (int64_t) record->time;
+    uint16_t size = (uint16_t) record->size;
+    fputc ('E', stream);
+    fwrite (&id, 4, 1, stream);
+    fwrite (&time, 8, 1, stream);
+    fputc (record->loglevel, stream);
+    fwrite (&size, 2, 1, stream);
+    fwrite (record->text, 1, size, stream);
+}
+
+//  Write out queued records. It formats the date once per second, and
+//  flushes the log stream once per batch, not once per record. It formats
+//  log events here, unless they go to the binary log stream. The writer
+//  thread runs this until it is told to stop; with drain set, it returns
+//  as soon as the rings are empty.
+
+static void
+s_log_write (bool drain)
+{
+    s_log_record_t *batch = (s_log_record_t *) zmalloc (LOG_BATCH_SIZE * sizeof (s_log_record_t));
+    assert (batch);
+    time_t date_time = 0;
+    char date [20] = "";
+    char event_text [LOG_TEXT_MAX * 2];
+    s_log_binary_t binary = { NULL, 0, 0, false, NULL, 0 };
+    binary.formats = zhashx_new ();
+    assert (binary.formats);
+    zhashx_set_key_destructor (binary.formats, NULL);
+    zhashx_set_key_duplicator (binary.formats, NULL);
+    zhashx_set_key_comparator (binary.formats, s_sockref_compare);
+    zhashx_set_key_hasher (binary.formats, s_sockref_hash);
+
+    pthread_mutex_lock (&s_log_mutex);
+    while (true) {
+        bool flushing = s_log_flushing;
+        bool stopping = s_log_stopping || drain;
+        size_t count = s_log_collect (batch);
+        binary.stream = s_logbinary;
+        binary.changes = s_logbinary_changes;
+        if (count) {
+            pthread_mutex_unlock (&s_log_mutex);
+            size_t record_nbr;
+            for (record_nbr = 0; record_nbr < count; record_nbr++) {
+                s_log_record_t *record = &batch [record_nbr];
+                const char *text = record->text;
+                if (record->format) {
+                    if (binary.stream) {
+                        s_log_binary_write (&binary, record);
+                        continue;
+                    }
+                    s_log_unpack (event_text, sizeof (event_text),
+                                  record->format, (byte *) record->text, record->size);
+                    text = event_text;
+                }
+                if (s_log_system (record->loglevel, text))
+                    continue;
+                if (record->time != date_time) {
+                    struct tm loctime;
+                    localtime_r (&record->time, &loctime);
+                    strftime (date, 20, "%y-%m-%d %H:%M:%S", &loctime);
+                    date_time = record->time;
+                }
+                s_log_text (record->loglevel, date, text);
+            }
+            if (s_logstream)
+                fflush (s_logstream);
+            if (binary.written)
+                fflush (binary.stream);
+            binary.written = false;
+            pthread_mutex_lock (&s_log_mutex);
+        }
+        if (count == LOG_BATCH_SIZE)
+            continue;           //  There may be more
+
+        //  We have now written every record queued before this pass
+        if (flushing) {
+            s_log_flushing = false;
+            pthread_cond_broadcast (&s_log_flushed);
+        }
+        if (stopping)
+            break;
+
+        //  Pairs with the fence in s_log_async
+        __atomic_store_n (&s_log_sleeping, 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence (__ATOMIC_SEQ_CST);
+        if (!s_log_pending () && !s_log_flushing && !s_log_stopping)
+            pthread_cond_wait (&s_log_wakeup, &s_log_mutex);
+        __atomic_store_n (&s_log_sleeping, 0, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock (&s_log_mutex);
+    zhashx_destroy (&binary.formats);
+    freen (batch);
+}
+
+static void *
+s_log_writer_thread (void *args)
+{
+    s_log_write (false);
+    return NULL;
+}
+
+//  Write out all queued records, and stop the writer, if it is running
+
+static void
+s_log_stop (void)
+{
+    //  Pairs with the fence in s_log_publish, so either a thread that logs
+    //  sees that logging is no longer asynchronous, or we see its record
+    __atomic_thread_fence (__ATOMIC_SEQ_CST);
+    pthread_mutex_lock (&s_log_mutex);
+    bool running = s_log_running;
+    if (running) {
+        s_log_stopping = true;
+        pthread_cond_signal (&s_log_wakeup);
+    }
+    pthread_mutex_unlock (&s_log_mutex);
+    if (!running)
+        return;
+
+    pthread_join (s_log_writer, NULL);
+    pthread_mutex_lock (&s_log_mutex);
+    s_log_running = false;
+    s_log_stopping = false;
+    pthread_mutex_unlock (&s_log_mutex);
+    //  A thread that still saw logging as asynchronous may have queued
+    //  records after the writer's last pass; write them out here, rather
+    //  than leave them in the rings. Any that come later, the thread will
+    //  write itself, as it sees the writer is no longer running.
+    s_log_write (true);
+    pthread_mutex_lock (&s_log_mutex);
+    //  Free the rings of threads that exited while the writer was running
+    s_log_ring_t **ring_p = &s_log_rings;
+    while (*ring_p) {
+        s_log_ring_t *ring = *ring_p;
+        if (ring->orphan) {
+            *ring_p = ring->next;
+            freen (ring);
+        }
+        else
+            ring_p = &ring->next;
+    }
+    pthread_mutex_unlock (&s_log_mutex);
+}
+
+//  Write out records queued after the writer stopped, on the calling
+//  thread. If the writer is still running, s_log_stop will do this.
+
+static void
+s_log_drain (void)
+{
+    pthread_mutex_lock (&s_log_mutex);
+    bool stopped = !s_log_running && s_log_pending ();
+    pthread_mutex_unlock (&s_log_mutex);
+    if (stopped)
+        s_log_write (true);
+}
+#endif
+
+
+//  --------------------------------------------------------------------------
+//  Enable or disable asynchronous logging. When enabled, the zsys log
+//  functions format each message into a ring kept by the calling thread,
+//  and return without waiting for I/O; a background thread writes out the
+//  messages in batches, to the same log stream, log sender, and system
+//  facility. Messages from one thread keep their order. If a thread logs
+//  faster than the writer can keep up, its ring fills, and further messages
+//  are dropped, see zsys_log_dropped (). Messages longer than 495 bytes are
+//  truncated, see zsys_log_truncated (). If the environment variable
+//  ZSYS_LOGASYNC is "true", that enables it by default. Asynchronous logging
+//  needs POSIX threads; on other platforms, logging stays synchronous.
+
+void
+zsys_set_logasync (bool logasync)
+{
+    zsys_init ();
+#if defined (ZSYS_LOGASYNC)
+    if (logasync) {
+        pthread_mutex_lock (&s_log_mutex);
+        if (!s_log_running) {
+            s_log_stopping = false;
+            s_log_running = pthread_create (&s_log_writer, NULL, s_log_writer_thread, NULL) == 0;
         }
-        if (s_logsender)
-            zstr_send (s_logsender, log_text);
+        __atomic_store_n (&s_logasync, s_log_running, __ATOMIC_SEQ_CST);
+        pthread_mutex_unlock (&s_log_mutex);
     }
+    else {
+        __atomic_store_n (&s_logasync, false, __ATOMIC_SEQ_CST);
+        s_log_stop ();
+    }
+#endif
 }
 
 
 //  --------------------------------------------------------------------------
-//  Log error condition - highest priority
+//  Return true if logging is asynchronous.
+
+bool
+zsys_logasync (void)
+{
+#if defined (ZSYS_LOGASYNC)
+    return __atomic_load_n (&s_logasync, __ATOMIC_RELAXED);
+#else
+    return s_logasync;
+#endif
+}
+
+
+//  --------------------------------------------------------------------------
+//  Wait until the background writer has written out all messages logged
+//  so far. Does nothing unless logging is asynchronous.
 
 void
-zsys_error (const char *format, ...)
+zsys_log_flush (void)
+{
+#if defined (ZSYS_LOGASYNC)
+    pthread_mutex_lock (&s_log_mutex);
+    if (s_log_running) {
+        s_log_flushing = true;
+        pthread_cond_signal (&s_log_wakeup);
+        while (s_log_flushing && s_log_running)
+            pthread_cond_wait (&s_log_flushed, &s_log_mutex);
+    }
+    pthread_mutex_unlock (&s_log_mutex);
+#endif
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return the number of log messages dropped since the process started,
+//  because a thread's log ring was full.
+
+uint64_t
+zsys_log_dropped (void)
+{
+#if defined (ZSYS_LOGASYNC)
+    return __atomic_load_n (&s_log_dropped, __ATOMIC_RELAXED);
+#else
+    return 0;
+#endif
+}
+
+
+//  --------------------------------------------------------------------------
+//  Return the number of log messages truncated since the process started,
+//  because they did not fit into a log record.
+
+uint64_t
+zsys_log_truncated (void)
+{
+#if defined (ZSYS_LOGASYNC)
+    return __atomic_load_n (&s_log_truncated, __ATOMIC_RELAXED);
+#else
+    return 0;
+#endif
+}
+
+
+//  --------------------------------------------------------------------------
+//  Set a stream to receive log events in binary form, instead of as text.
+//  Events are written as they are recorded, with their format and their
+//  arguments, and not formatted; use zsys_log_decode () or the zlogdump tool
+//  to read them. The stream should be open in binary mode. When this returns,
+//  the log writer no longer uses the previous stream. Set the stream to NULL
+//  to format log events as text again. This needs asynchronous logging.
+
+void
+zsys_set_logbinary (FILE *stream)
+{
+    zsys_init ();
+#if defined (ZSYS_LOGASYNC)
+    //  Events logged so far go to the previous stream, and once we return,
+    //  the writer has finished with that stream
+    zsys_log_flush ();
+    pthread_mutex_lock (&s_log_mutex);
+    s_logbinary = stream;
+    s_logbinary_changes++;
+    pthread_mutex_unlock (&s_log_mutex);
+    zsys_log_flush ();
+#endif
+}
+
+
+//  --------------------------------------------------------------------------
+//  Log a debug-level event. With asynchronous logging, this copies the
+//  format and arguments into the calling thread's log ring, and the log
+//  writer formats them later, or writes them to the binary log stream, if
+//  one is set. So the format must be a string constant, and be there for
+//  as long as the process runs. Events support the printf conversions,
+//  except %n and wide characters; if the format uses those, or without
+//  asynchronous logging, this works like zsys_debug ().
+
+void
+zsys_log_event (const char *format, ...)
 {
     va_list argptr;
     va_start (argptr, format);
+#if defined (ZSYS_LOGASYNC)
+    if (__atomic_load_n (&s_logasync, __ATOMIC_RELAXED)) {
+        va_list args;
+        va_copy (args, argptr);
+        bool deferred = s_log_event_async ('D', format, args);
+        va_end (args);
+        if (deferred) {
+            va_end (argptr);
+            return;
+        }
+    }
+#endif
     char *string = zsys_vprintf (format, argptr);
     va_end (argptr);
-    s_log ('E', string);
+    s_log ('D', string);
+    zstr_free (&string);
+}
+
+
+//  --------------------------------------------------------------------------
+//  Read a binary log written via zsys_set_logbinary () from the input, and
+//  write it to the output as text, in the same form as the zsys log
+//  functions. Returns the number of events decoded, or -1 if the input is
+//  not a binary log, was written by a newer version of CZMQ, or by a machine
+//  with a different byte order, or is cut short.
+
+int
+zsys_log_decode (FILE *input, FILE *output)
+{
+    assert (input);
+    assert (output);
+    char **formats = NULL;          //  Formats, by id
+    uint32_t max_formats = 0;
+    char ident [256] = "";
+    bool started = false;
+    int events = 0;
+    int rc = 0;
+
+    int type;
+    while (rc == 0 && (type = fgetc (input)) != EOF) {
+        if (type == 'Z') {
+            //  A header, which may come again if a log was appended to
+            char magic [3];
+            int version;
+            uint32_t byte_order;
+            uint16_t ident_size;
+            if (fread (magic, 1, 3, input) != 3 || memcmp (magic, "LOG", 3)
+            ||  (version = fgetc (input)) == EOF || version > ZSYS_LOG_VERSION
+            ||  fread (&byte_order, 4, 1, input) != 1 || byte_order != 0x01020304
+            ||  fread (&ident_size, 2, 1, input) != 1 || ident_size >= sizeof (ident)
+            ||  fread (ident, 1, ident_size, input) != ident_size)
+                rc = -1;
+            else {
+                ident [ident_size] = 0;
+                uint32_t format_nbr;
+                for (format_nbr = 0; format_nbr < max_formats; format_nbr++)
+                    zstr_free (&formats [format_nbr]);
+                started = true;
+            }
+        }
+        else
+        if (type == 'F' && started) {
+            uint32_t id;
+            uint16_t format_size;
+            if (fread (&id, 4, 1, input) != 1
+            ||  id == 0 || id >= ZSYS_LOG_FORMATS_MAX
+            ||  fread (&format_size, 2, 1, input) != 1)
+                rc = -1;
+            else {
+                if (id >= max_formats) {
+                    uint32_t new_max = id < ZSYS_LOG_FORMATS_MAX / 2? id * 2: ZSYS_LOG_FORMATS_MAX;
+                    formats = (char **) realloc (formats, new_max * sizeof (char *));
+                    assert (formats);
+                    memset (formats + max_formats, 0, (new_max - max_formats) * sizeof (char *));
+                    max_formats = new_max;
+                }
+                zstr_free (&formats [id]);
+                formats [id] = (char *) zmalloc (format_size + 1);
+                assert (formats [id]);
+                if (fread (formats [id], 1, format_size, input) != format_size)
+                    rc = -1;
+            }
+        }
+        else
+        if (type == 'E' && started) {
+            uint32_t id;
+            int64_t logtime;
+            int loglevel;
+            uint16_t size;
+            byte args [65536];
+            if (fread (&id, 4, 1, input) != 1
+            ||  fread (&logtime, 8, 1, input) != 1
+            ||  (loglevel = fgetc (input)) == EOF
+            ||  fread (&size, 2, 1, input) != 1
+            ||  fread (args, 1, size, input) != size
+            ||  id >= max_formats || !formats [id])
+                rc = -1;
+            else {
+                char text [1024];
+                if (!s_log_unpack (text, sizeof (text), formats [id], args, size))
+                    snprintf (text, sizeof (text), "(bad arguments for '%s')", formats [id]);
+                time_t curtime = (time_t) logtime;
+                struct tm *loctime = localtime (&curtime);
+                char date [20];
+                strftime (date, 20, "%y-%m-%d %H:%M:%S", loctime);
+                if (*ident)
+                    fprintf (output, "%c: (%s) %s %s\n", loglevel, ident, date, text);
+                else
+                    fprintf (output, "%c: %s %s\n", loglevel, date, text);
+                events++;
+            }
+        }
+        else
+            rc = -1;
+    }
+    uint32_t format_nbr;
+    for (format_nbr = 0; format_nbr < max_formats; format_nbr++)
+        zstr_free (&formats [format_nbr]);
+    freen (formats);
+    return rc == -1 || !started? -1: events;
+}
+
+
+//  Log a message, from one of the zsys log functions
+
+static void
+s_logv (char loglevel, const char *format, va_list argptr)
+{
+#if defined (ZSYS_LOGASYNC)
+    if (__atomic_load_n (&s_logasync, __ATOMIC_RELAXED)) {
+        s_log_async (loglevel, format, argptr);
+        return;
+    }
+#endif
+    char *string = zsys_vprintf (format, argptr);
+    s_log (loglevel, string);
     zstr_free (&string);
 }
 
 
+//  --------------------------------------------------------------------------
+//  Log error condition - highest priority
+
+void
+zsys_error (const char *format, ...)
+{
+    va_list argptr;
+    va_start (argptr, format);
+    s_logv ('E', format, argptr);
+    va_end (argptr);
+}
+
+
 //  --------------------------------------------------------------------------
 //  Log warning condition - high priority
 
@@ -2631,10 +3891,8 @@ zsys_warning (const char *format, ...)
 {
     va_list argptr;
     va_start (argptr, format);
-    char *string = zsys_vprintf (format, argptr);
+    s_logv ('W', format, argptr);
     va_end (argptr);
-    s_log ('W', string);
-    zstr_free (&string);
 }
 
 
@@ -2646,10 +3904,8 @@ zsys_notice (const char *format, ...)
 {
     va_list argptr;
     va_start (argptr, format);
-    char *string = zsys_vprintf (format, argptr);
+    s_logv ('N', format, argptr);
     va_end (argptr);
-    s_log ('N', string);
-    zstr_free (&string);
 }
 
 
@@ -2661,10 +3917,8 @@ zsys_info (const char *format, ...)
 {
     va_list argptr;
     va_start (argptr, format);
-    char *string = zsys_vprintf (format, argptr);
+    s_logv ('I', format, argptr);
     va_end (argptr);
-    s_log ('I', string);
-    zstr_free (&string);
 }
 
 
@@ -2676,15 +3930,30 @@ zsys_debug (const char *format, ...)
 {
     va_list argptr;
     va_start (argptr, format);
-    char *string = zsys_vprintf (format, argptr);
+    s_logv ('D', format, argptr);
     va_end (argptr);
-    s_log ('D', string);
-    zstr_free (&string);
 }
 
 //  --------------------------------------------------------------------------
 //  Selftest
 
+#ifdef CZMQ_BUILD_DRAFT_API
+//  Log 100 messages, telling the caller when we have started
+
+static void
+s_log_test_actor (zsock_t *pipe, void *args)
+{
+    zsock_signal (pipe, 0);
+    int line_nbr;
+    for (line_nbr = 0; line_nbr < 100; line_nbr++) {
+        zsys_debug ("This is actor message %d", line_nbr);
+        if (line_nbr == 0)
+            zsock_signal (pipe, 0);
+    }
+    zsock_wait (pipe);
+}
+#endif
+
 void
 zsys_test (bool verbose)
 {
@@ -2739,6 +4008,37 @@ zsys_test (bool verbose)
     assert (0 == zsys_zero_copy_recv());
     zsys_set_zero_copy_recv(1);
     assert (1 == zsys_zero_copy_recv());
+    size_t pool_size = zsys_pool_size ();
+    zsys_set_pool_size (100);
+    assert (zsys_pool_size () == 100);
+    zsys_set_pool_size (pool_size);
+
+    //  Sockets are tracked until they are closed, in any order
+    void *handles [100];
+    int index;
+    for (index = 0; index < 100; index++) {
+        handles [index] = zsys_socket (ZMQ_PAIR, __FILE__, __LINE__);
+        assert (handles [index]);
+    }
+    for (index = 0; index < 100; index += 2)
+        zsys_close (handles [index], __FILE__, __LINE__);
+    for (index = 99; index > 0; index -= 2)
+        zsys_close (handles [index], __FILE__, __LINE__);
+    //  This asserts that no sockets are open
+    zsys_set_io_threads (1);
+
+    if (verbose) {
+        //  Close many sockets, newest first, which was the worst case when
+        //  we tracked sockets in a list
+        void *many [500];
+        for (index = 0; index < 500; index++)
+            many [index] = zsys_socket (ZMQ_PAIR, __FILE__, __LINE__);
+        int64_t start = zclock_usecs ();
+        for (index = 499; index >= 0; index--)
+            zsys_close (many [index], __FILE__, __LINE__);
+        zsys_info ("zsys: %d ns per socket close, with up to 500 open",
+                   (int) ((zclock_usecs () - start) * 1000 / 500));
+    }
 
     //  Test pipe creation
     zsock_t *pipe_back;
@@ -2915,6 +4215,320 @@ zsys_test (bool verbose)
     }
     zsys_close (logger, NULL, 0);
 
+#ifdef CZMQ_BUILD_DRAFT_API
+    //  Asynchronous logging goes to the same places, and keeps each thread's
+    //  messages in order; a message is either written or counted as dropped
+    logger = zsys_socket (ZMQ_SUB, NULL, 0);
+    assert (logger);
+    rc = zmq_connect (logger, "inproc://logging");
+    assert (rc == 0);
+    rc = zmq_setsockopt (logger, ZMQ_SUBSCRIBE, "", 0);
+    assert (rc == 0);
+    if (!verbose)
+        zsys_set_logstream (NULL);
+    zsys_set_logasync (true);
+#   if defined (__UNIX__)
+    assert (zsys_logasync ());
+#   endif
+    //  Wait until the log sender has our subscription
+    char *line = NULL;
+    while (!line) {
+        zsys_debug ("This is a probe message");
+        zsys_log_flush ();
+        zclock_sleep (1);
+        line = zstr_recv_nowait (logger);
+    }
+    while (line) {
+        zstr_free (&line);
+        line = zstr_recv_nowait (logger);
+    }
+    uint64_t dropped = zsys_log_dropped ();
+    uint64_t truncated = zsys_log_truncated ();
+
+    //  Bursts that fit in the ring arrive whole, and in order
+    int line_nbr;
+    for (line_nbr = 0; line_nbr < 500; line_nbr++) {
+        zsys_debug ("This is asynchronous message %d", line_nbr);
+        if (line_nbr % 100 == 99)
+            zsys_log_flush ();
+    }
+    int received = 0;
+    line = zstr_recv_nowait (logger);
+    while (line) {
+        char *text = strstr (line, "This is asynchronous message ");
+        assert (text);
+        assert (atoi (text + strlen ("This is asynchronous message ")) == received);
+        received++;
+        zstr_free (&line);
+        line = zstr_recv_nowait (logger);
+    }
+    assert (received == 500);
+    assert (zsys_log_dropped () == dropped);
+
+    //  A burst that overflows the ring loses messages, but not the first
+    //  ones, and what arrives is still in order
+    for (line_nbr = 0; line_nbr < 500; line_nbr++)
+        zsys_debug ("This is asynchronous message %d", line_nbr);
+    zsys_log_flush ();
+    received = 0;
+    int previous = -1;
+    line = zstr_recv_nowait (logger);
+    while (line) {
+        char *text = strstr (line, "This is asynchronous message ");
+        assert (text);
+        int number = atoi (text + strlen ("This is asynchronous message "));
+        assert (number > previous);
+        assert (received || number == 0);
+        previous = number;
+        received++;
+        zstr_free (&line);
+        line = zstr_recv_nowait (logger);
+    }
+    assert (received > 0);
+    assert (received + (int) (zsys_log_dropped () - dropped) == 500);
+
+    //  Switching to synchronous logging writes out what is queued first
+    for (line_nbr = 0; line_nbr < 100; line_nbr++)
+        zsys_debug ("This is asynchronous message %d", line_nbr);
+    zsys_set_logasync (false);
+    zsys_debug ("This is synchronous message");
+    for (line_nbr = 0; line_nbr <= 100; line_nbr++) {
+        line = zstr_recv (logger);
+        assert (line);
+        if (line_nbr < 100) {
+            char *text = strstr (line, "This is asynchronous message ");
+            assert (text);
+            assert (atoi (text + strlen ("This is asynchronous message ")) == line_nbr);
+        }
+        else
+            assert (strstr (line, "This is synchronous message"));
+        zstr_free (&line);
+    }
+
+    //  A thread that is logging while we switch to synchronous logging
+    //  loses nothing, whether its messages were queued or not
+    zsys_set_logasync (true);
+    dropped = zsys_log_dropped ();
+    zactor_t *actor = zactor_new (s_log_test_actor, NULL);
+    assert (actor);
+    zsock_wait (actor);
+    zsys_set_logasync (false);
+    zsock_signal (actor, 0);
+    zactor_destroy (&actor);
+    received = 0;
+    line = zstr_recv_nowait (logger);
+    while (line) {
+        assert (strstr (line, "This is actor message "));
+        received++;
+        zstr_free (&line);
+        line = zstr_recv_nowait (logger);
+    }
+    assert (received + (int) (zsys_log_dropped () - dropped) == 100);
+    zsys_set_logasync (true);
+
+    char long_text [600];
+    memset (long_text, 'x', sizeof (long_text) - 1);
+    long_text [sizeof (long_text) - 1] = 0;
+    zsys_debug ("%s", long_text);
+    zsys_log_flush ();
+#   if defined (__UNIX__)
+    assert (zsys_log_truncated () == truncated + 1);
+    line = zstr_recv (logger);
+    assert (line);
+    assert (strlen (line) < sizeof (long_text));
+    zstr_free (&line);
+#   endif
+
+    //  Log events are formatted by the log writer, unless they go to a
+    //  binary log, which zsys_log_decode turns into the same text
+    zsys_log_event ("This is event %d", 1);
+    zsys_log_flush ();
+#   if defined (__UNIX__)
+    line = zstr_recv (logger);
+    assert (line);
+    assert (streq (line + strlen (line) - strlen ("This is event 1"), "This is event 1"));
+    zstr_free (&line);
+
+    FILE *binlog = tmpfile ();
+    assert (binlog);
+    zsys_set_logbinary (binlog);
+    zsys_log_event ("Event %d %s %5.2f %x %c %lu %p %lld %hhd %% done", -42, "text",
+                    3.14159, 255, 'z', (unsigned long) 123456, (void *) binlog,
+                    (long long) -1, 300);
+    zsys_log_event ("Event %*d|%-.*s|", 6, 7, 3, "abcdef");
+    zsys_log_event ("Event %d %s %5.2f %x %c %lu %p %lld %hhd %% done", 1, "again",
+                    2.5, 16, 'a', (unsigned long) 0, (void *) NULL,
+                    (long long) 1 << 40, -1);
+    zsys_set_logbinary (NULL);
+    rewind (binlog);
+    FILE *decoded = tmpfile ();
+    assert (decoded);
+    rc = zsys_log_decode (binlog, decoded);
+    assert (rc == 3);
+    rewind (decoded);
+    char *expected [3];
+    expected [0] = zsys_sprintf ("Event %d %s %5.2f %x %c %lu %p %lld %hhd %% done\n",
+                                 -42, "text", 3.14159, 255, 'z', (unsigned long) 123456,
+                                 (void *) binlog, (long long) -1, (signed char) 300);
+    expected [1] = zsys_sprintf ("Event %*d|%-.*s|\n", 6, 7, 3, "abcdef");
+    expected [2] = zsys_sprintf ("Event %d %s %5.2f %x %c %lu %p %lld %hhd %% done\n",
+                                 1, "again", 2.5, 16, 'a', (unsigned long) 0,
+                                 (void *) NULL, (long long) 1 << 40, (signed char) -1);
+    int event_nbr;
+    for (event_nbr = 0; event_nbr < 3; event_nbr++) {
+        char decoded_line [256];
+        assert (fgets (decoded_line, sizeof (decoded_line), decoded));
+        assert (decoded_line [0] == 'D');
+        assert (streq (decoded_line + strlen (decoded_line) - strlen (expected [event_nbr]),
+                       expected [event_nbr]));
+        zstr_free (&expected [event_nbr]);
+    }
+    fclose (decoded);
+
+    //  Anything else is not a binary log
+    rewind (binlog);
+    fputs ("ZLOX", binlog);
+    rewind (binlog);
+    decoded = tmpfile ();
+    assert (decoded);
+    assert (zsys_log_decode (binlog, decoded) == -1);
+    fclose (decoded);
+    fclose (binlog);
+
+    //  Nor is a log with corrupt records: format ids out of range, and
+    //  events that use formats never defined
+    uint32_t bad_ids [] = { 0, ZSYS_LOG_FORMATS_MAX, 0x80000000, 0xFFFFFFFF };
+    int bad_nbr;
+    for (bad_nbr = 0; bad_nbr < 5; bad_nbr++) {
+        binlog = tmpfile ();
+        assert (binlog);
+        uint32_t byte_order = 0x01020304;
+        uint16_t zero_size = 0;
+        fputs ("ZLOG", binlog);
+        fputc (ZSYS_LOG_VERSION, binlog);
+        fwrite (&byte_order, 4, 1, binlog);
+        fwrite (&zero_size, 2, 1, binlog);
+        uint32_t id = 7;
+        if (bad_nbr < 4) {
+            id = bad_ids [bad_nbr];
+            fputc ('F', binlog);
+            fwrite (&id, 4, 1, binlog);
+            fwrite (&zero_size, 2, 1, binlog);
+        }
+        else {
+            int64_t logtime = 0;
+            fputc ('E', binlog);
+            fwrite (&id, 4, 1, binlog);
+            fwrite (&logtime, 8, 1, binlog);
+            fputc ('D', binlog);
+            fwrite (&zero_size, 2, 1, binlog);
+        }
+        rewind (binlog);
+        decoded = tmpfile ();
+        assert (decoded);
+        assert (zsys_log_decode (binlog, decoded) == -1);
+        fclose (decoded);
+        fclose (binlog);
+    }
+
+    //  An event whose format takes more arguments for width and precision
+    //  than printf allows is decoded as bad arguments, and nothing more
+    binlog = tmpfile ();
+    assert (binlog);
+    uint32_t byte_order = 0x01020304;
+    uint16_t zero_size = 0;
+    fputs ("ZLOG", binlog);
+    fputc (ZSYS_LOG_VERSION, binlog);
+    fwrite (&byte_order, 4, 1, binlog);
+    fwrite (&zero_size, 2, 1, binlog);
+    char stars_format [33];
+    stars_format [0] = '%';
+    memset (stars_format + 1, '*', 30);
+    stars_format [31] = 'd';
+    stars_format [32] = 0;
+    uint32_t id = 1;
+    uint16_t format_size = (uint16_t) strlen (stars_format);
+    fputc ('F', binlog);
+    fwrite (&id, 4, 1, binlog);
+    fwrite (&format_size, 2, 1, binlog);
+    fwrite (stars_format, 1, format_size, binlog);
+    int64_t logtime = 0;
+    uint16_t args_size = 31 * 9;
+    fputc ('E', binlog);
+    fwrite (&id, 4, 1, binlog);
+    fwrite (&logtime, 8, 1, binlog);
+    fputc ('D', binlog);
+    fwrite (&args_size, 2, 1, binlog);
+    int arg_nbr;
+    for (arg_nbr = 0; arg_nbr < 31; arg_nbr++) {
+        int64_t integer = -1000000000;
+        fputc ('i', binlog);
+        fwrite (&integer, 8, 1, binlog);
+    }
+    rewind (binlog);
+    decoded = tmpfile ();
+    assert (decoded);
+    assert (zsys_log_decode (binlog, decoded) == 1);
+    rewind (decoded);
+    char decoded_line [256];
+    assert (fgets (decoded_line, sizeof (decoded_line), decoded));
+    assert (strstr (decoded_line, "(bad arguments for '%"));
+    fclose (decoded);
+    fclose (binlog);
+#   else
+    zsys_set_logbinary (NULL);
+#   endif
+
+    zsys_set_logasync (false);
+    assert (!zsys_logasync ());
+    zsys_close (logger, NULL, 0);
+
+#   if defined (__UNIX__)
+    if (verbose) {
+        //  Compare what logging costs the caller, writing to a file, in
+        //  bursts that fit in the ring
+        FILE *logfile = tmpfile ();
+        assert (logfile);
+        zsys_set_logstream (logfile);
+        dropped = zsys_log_dropped ();
+        const char *passes [] = {
+            "synchronous messages", "asynchronous messages",
+            "log events", "binary log events"
+        };
+        int pass;
+        for (pass = 0; pass < 4; pass++) {
+            zsys_set_logasync (pass > 0);
+            if (pass == 3)
+                zsys_set_logbinary (logfile);
+            int64_t elapsed = 0;
+            int burst;
+            for (burst = 0; burst < 100; burst++) {
+                int64_t start = zclock_usecs ();
+                if (pass < 2)
+                    for (line_nbr = 0; line_nbr < 100; line_nbr++)
+                        zsys_debug ("This is benchmark message %d", line_nbr);
+                else
+                    for (line_nbr = 0; line_nbr < 100; line_nbr++)
+                        zsys_log_event ("This is benchmark message %d", line_nbr);
+                elapsed += zclock_usecs () - start;
+                zsys_log_flush ();
+            }
+            zsys_set_logbinary (NULL);
+            zsys_set_logasync (false);
+            zsys_set_logstream (stdout);
+            zsys_info ("zsys: %s take %d nsecs each", passes [pass],
+                       (int) (elapsed * 1000 / 10000));
+            zsys_set_logstream (logfile);
+        }
+        zsys_set_logstream (stdout);
+        zsys_info ("zsys: %d asynchronous messages dropped",
+                   (int) (zsys_log_dropped () - dropped));
+        fclose (logfile);
+    }
+#   endif
+    zsys_set_logstream (stdout);
+#endif
+
     {
         // zhash based printf
         zhash_t *args = zhash_new ();